@@ -0,0 +1,1058 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ *
+ */
+
+/**
+ * End to end benchmark of the graph algorithms.
+ *
+ * Every run generates its input in memory from --seed, so two runs
+ * with the same options and the same number of processes see the same
+ * graph. The algorithms are run for every combination of --engines and
+ * --threads, each on a freshly generated graph:
+ *
+ * \verbatim
+ *   pagerank   dynamic PageRank on the --graph input
+ *   sssp       single source shortest path from vertex 0 on --graph
+ *   cc         connected components on --graph
+ *   triangles  triangle counting on --graph (synchronous engine only)
+ *   als        alternating least squares on a synthetic rating matrix
+ *   lda        collapsed Gibbs LDA on the rating matrix read as a corpus
+ * \endverbatim
+ *
+ * Each run prints one JSON object per line and, with --results, appends
+ * it to a file. The fields are the phase times in seconds (load,
+ * finalize, run), the number of updates, edges per second (the edges
+ * of the graph over the run time), the network bytes sent by all
+ * machines during the run, the sum over the machines of the peak
+ * tagged memory (see memory_info::peak_tagged_bytes) and an algorithm
+ * specific checksum. A results file can be passed back with --baseline
+ * to flag the runs which became slower by more than --tolerance. Runs
+ * are only compared with runs of the same algorithm, engine, input and
+ * numbers of processes and threads.
+ *
+ * Several processes on one machine are started with run_local.sh, which
+ * splits the cores of the machine between them:
+ *
+ * \verbatim
+ *   ./run_local.sh 4 --nverts=1000000 --results=base.json
+ *   (change the code and rebuild)
+ *   ./run_local.sh 4 --nverts=1000000 --baseline=base.json
+ * \endverbatim
+ */
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <numeric>
+#include <algorithm>
+
+#include <graphlab.hpp>
+#include <graphlab/util/memory_info.hpp>
+#include <graphlab/util/stl_util.hpp>
+#include <graphlab/macros_def.hpp>
+
+
+// Input parameters shared by the generators and vertex programs
+size_t NVERTS = 100000;
+size_t SEED = 1;
+// number of users and movies of the rating matrix
+size_t NUSERS = 0;
+size_t NMOVIES = 0;
+size_t MAX_ITERATIONS = 20;
+double PAGERANK_TOLERANCE = 1e-3;
+
+// A large prime number, as in distributed_graph::load_synthetic_powerlaw
+const size_t HASH_OFFSET = 2654435761;
+
+
+/**
+ * Adds the edges of a 4-connected grid with about NVERTS vertices. Each
+ * machine adds the edges leaving its rows.
+ */
+template <typename Graph>
+void load_grid(Graph& graph) {
+  graphlab::distributed_control& dc = graph.dc();
+  const size_t side = std::max<size_t>(1, std::sqrt(double(NVERTS)));
+  for (size_t row = dc.procid(); row < side; row += dc.numprocs()) {
+    for (size_t col = 0; col < side; ++col) {
+      const size_t vid = row * side + col;
+      if (col + 1 < side) graph.add_edge(vid, vid + 1);
+      if (row + 1 < side) graph.add_edge(vid, vid + side);
+    }
+  }
+  dc.full_barrier();
+}
+
+/**
+ * Loads the --graph input of the general graph algorithms.
+ */
+template <typename Graph>
+void load_input(Graph& graph, const std::string& kind) {
+  if (kind == "powerlaw") {
+    // the generator draws from the random source of this thread
+    graphlab::random::get_source().seed(SEED + graph.dc().procid());
+    graph.load_synthetic_powerlaw(NVERTS, false, 2.1, 100000);
+  } else if (kind == "rmat") {
+    // the power of two at or above NVERTS
+    size_t scale = 0;
+    while ((size_t(1) << scale) < NVERTS) ++scale;
+    graph.load_synthetic_rmat(scale, 16, 0.57, 0.19, 0.19, SEED);
+  } else if (kind == "lfr") {
+    graph.load_synthetic_lfr(NVERTS, 5, 100, 2.5, 20, 1000, 1.5, 0.2, SEED);
+  } else if (kind == "grid") {
+    load_grid(graph);
+  } else {
+    logstream(LOG_FATAL) << "Unknown graph: " << kind << std::endl;
+  }
+}
+
+
+// Dimension of the latent factors of the rating matrix
+const size_t RATINGS_D = 5;
+
+/// Latent factor of a user or a movie of the synthetic rating matrix
+inline void ratings_factor(size_t vid, double factor[RATINGS_D]) {
+  graphlab::random::counter_generator rng(SEED, vid, 1);
+  for (size_t d = 0; d < RATINGS_D; ++d) factor[d] = rng.gaussian(0, 1);
+}
+
+/**
+ * Adds the rating matrix of make_synthetic_als_data: the movies get
+ * power-law numbers of ratings from hashed users, and each rating is
+ * the product of the latent factors of the user and the movie plus
+ * noise. Users have ids [0, NUSERS) and movies [NUSERS, NUSERS +
+ * NMOVIES). The draws of a movie come from its own counter based
+ * stream, so the matrix does not depend on the number of machines.
+ */
+template <typename Graph>
+void load_ratings(Graph& graph) {
+  typedef typename Graph::edge_data_type edge_data_type;
+  graphlab::distributed_control& dc = graph.dc();
+  std::vector<double> prob(std::min<size_t>(NUSERS, 10000));
+  for(size_t i = 0; i < prob.size(); ++i) prob[i] = std::pow(double(i+1), -1.8);
+  graphlab::random::pdf2cdf(prob);
+  double user_factor[RATINGS_D], movie_factor[RATINGS_D];
+  for (size_t movie = dc.procid(); movie < NMOVIES; movie += dc.numprocs()) {
+    const size_t movie_id = NUSERS + movie;
+    graphlab::random::counter_generator rng(SEED, movie_id, 0);
+    ratings_factor(movie_id, movie_factor);
+    const size_t out_degree = rng.multinomial_cdf(prob) + 1;
+    size_t user_id = (movie * HASH_OFFSET) % NUSERS;
+    for (size_t i = 0; i < out_degree; ++i) {
+      user_id = (user_id + HASH_OFFSET) % NUSERS;
+      ratings_factor(user_id, user_factor);
+      double rating = rng.gaussian(0, 0.1);
+      for (size_t d = 0; d < RATINGS_D; ++d) {
+        rating += user_factor[d] * movie_factor[d];
+      }
+      graph.add_edge(user_id, movie_id, edge_data_type(rating));
+    }
+  }
+  dc.full_barrier();
+}
+
+
+inline bool is_user(graphlab::vertex_id_type vid) { return vid < NUSERS; }
+
+
+
+/**
+ * Dynamic PageRank, as in toolkits/graph_analytics/pagerank.cpp.
+ * Checksum: the total rank.
+ */
+struct pagerank_algorithm {
+  typedef graphlab::distributed_graph<float, graphlab::empty> graph_type;
+
+  class vertex_program :
+    public graphlab::ivertex_program<graph_type, float>,
+    public graphlab::IS_POD_TYPE {
+    float last_change;
+  public:
+    edge_dir_type gather_edges(icontext_type& context,
+                               const vertex_type& vertex) const {
+      return graphlab::IN_EDGES;
+    }
+    float gather(icontext_type& context, const vertex_type& vertex,
+                 edge_type& edge) const {
+      return edge.source().data() / edge.source().num_out_edges();
+    }
+    void apply(icontext_type& context, vertex_type& vertex,
+               const float& total) {
+      const float newval = 0.15 + 0.85 * total;
+      last_change = std::fabs(newval - vertex.data());
+      vertex.data() = newval;
+    }
+    edge_dir_type scatter_edges(icontext_type& context,
+                                const vertex_type& vertex) const {
+      return last_change > PAGERANK_TOLERANCE ?
+        graphlab::OUT_EDGES : graphlab::NO_EDGES;
+    }
+    void scatter(icontext_type& context, const vertex_type& vertex,
+                 edge_type& edge) const {
+      context.signal(edge.target());
+    }
+  };
+
+  static void load(graph_type& graph, const std::string& kind) {
+    load_input(graph, kind);
+  }
+  static void init_vertex(graph_type::vertex_type& vertex) {
+    vertex.data() = 1;
+  }
+  static void init(graph_type& graph) {
+    graph.transform_vertices(init_vertex);
+  }
+  static size_t run(graphlab::distributed_control& dc, graph_type& graph,
+                    const std::string& exec_type,
+                    const graphlab::graphlab_options& opts) {
+    graphlab::omni_engine<vertex_program> engine(dc, graph, exec_type, opts);
+    engine.signal_all();
+    engine.start();
+    return engine.num_updates();
+  }
+  static double rank(const graph_type::vertex_type& vertex) {
+    return vertex.data();
+  }
+  static double checksum(graph_type& graph) {
+    return graph.map_reduce_vertices<double>(rank);
+  }
+}; // end of pagerank_algorithm
+
+
+
+/// Reduces messages to their smallest value
+struct min_message : graphlab::IS_POD_TYPE {
+  double value;
+  min_message(double value = std::numeric_limits<double>::max()) :
+    value(value) { }
+  min_message& operator+=(const min_message& other) {
+    value = std::min(value, other.value);
+    return *this;
+  }
+};
+
+template <typename Graph>
+inline typename Graph::vertex_type
+other_vertex(typename Graph::edge_type& edge,
+             const typename Graph::vertex_type& vertex) {
+  return vertex.id() == edge.source().id() ? edge.target() : edge.source();
+}
+
+
+/**
+ * Undirected single source shortest path from vertex 0 with unit edge
+ * weights, as in toolkits/graph_analytics/sssp.cpp.
+ * Checksum: the sum of the finite distances.
+ */
+struct sssp_algorithm {
+  typedef graphlab::distributed_graph<double, graphlab::empty> graph_type;
+
+  class vertex_program :
+    public graphlab::ivertex_program<graph_type, graphlab::empty,
+                                     min_message>,
+    public graphlab::IS_POD_TYPE {
+    double min_dist;
+    bool changed;
+  public:
+    void init(icontext_type& context, const vertex_type& vertex,
+              const min_message& msg) {
+      min_dist = msg.value;
+    }
+    edge_dir_type gather_edges(icontext_type& context,
+                               const vertex_type& vertex) const {
+      return graphlab::NO_EDGES;
+    }
+    void apply(icontext_type& context, vertex_type& vertex,
+               const graphlab::empty& empty) {
+      changed = min_dist < vertex.data();
+      if (changed) vertex.data() = min_dist;
+    }
+    edge_dir_type scatter_edges(icontext_type& context,
+                                const vertex_type& vertex) const {
+      return changed ? graphlab::ALL_EDGES : graphlab::NO_EDGES;
+    }
+    void scatter(icontext_type& context, const vertex_type& vertex,
+                 edge_type& edge) const {
+      const vertex_type other = other_vertex<graph_type>(edge, vertex);
+      if (other.data() > vertex.data() + 1) {
+        context.signal(other, min_message(vertex.data() + 1));
+      }
+    }
+  };
+
+  static void load(graph_type& graph, const std::string& kind) {
+    load_input(graph, kind);
+  }
+  static void init_vertex(graph_type::vertex_type& vertex) {
+    vertex.data() = std::numeric_limits<double>::max();
+  }
+  static void init(graph_type& graph) {
+    graph.transform_vertices(init_vertex);
+  }
+  static size_t run(graphlab::distributed_control& dc, graph_type& graph,
+                    const std::string& exec_type,
+                    const graphlab::graphlab_options& opts) {
+    graphlab::omni_engine<vertex_program> engine(dc, graph, exec_type, opts);
+    engine.signal(0, min_message(0));
+    engine.start();
+    return engine.num_updates();
+  }
+  static double distance(const graph_type::vertex_type& vertex) {
+    return vertex.data() < std::numeric_limits<double>::max() ?
+      vertex.data() : 0;
+  }
+  static double checksum(graph_type& graph) {
+    return graph.map_reduce_vertices<double>(distance);
+  }
+}; // end of sssp_algorithm
+
+
+
+/**
+ * Connected components by propagating the smallest vertex id.
+ * Checksum: the number of components.
+ */
+struct cc_algorithm {
+  typedef graphlab::distributed_graph<double, graphlab::empty> graph_type;
+
+  class vertex_program :
+    public graphlab::ivertex_program<graph_type, graphlab::empty,
+                                     min_message>,
+    public graphlab::IS_POD_TYPE {
+    double min_label;
+    bool changed;
+  public:
+    void init(icontext_type& context, const vertex_type& vertex,
+              const min_message& msg) {
+      min_label = std::min(msg.value, double(vertex.id()));
+    }
+    edge_dir_type gather_edges(icontext_type& context,
+                               const vertex_type& vertex) const {
+      return graphlab::NO_EDGES;
+    }
+    void apply(icontext_type& context, vertex_type& vertex,
+               const graphlab::empty& empty) {
+      changed = min_label < vertex.data();
+      if (changed) vertex.data() = min_label;
+    }
+    edge_dir_type scatter_edges(icontext_type& context,
+                                const vertex_type& vertex) const {
+      return changed ? graphlab::ALL_EDGES : graphlab::NO_EDGES;
+    }
+    void scatter(icontext_type& context, const vertex_type& vertex,
+                 edge_type& edge) const {
+      const vertex_type other = other_vertex<graph_type>(edge, vertex);
+      if (std::min(other.data(), double(other.id())) > vertex.data()) {
+        context.signal(other, min_message(vertex.data()));
+      }
+    }
+  };
+
+  static void load(graph_type& graph, const std::string& kind) {
+    load_input(graph, kind);
+  }
+  static void init_vertex(graph_type::vertex_type& vertex) {
+    vertex.data() = std::numeric_limits<double>::max();
+  }
+  static void init(graph_type& graph) {
+    graph.transform_vertices(init_vertex);
+  }
+  static size_t run(graphlab::distributed_control& dc, graph_type& graph,
+                    const std::string& exec_type,
+                    const graphlab::graphlab_options& opts) {
+    graphlab::omni_engine<vertex_program> engine(dc, graph, exec_type, opts);
+    engine.signal_all();
+    engine.start();
+    return engine.num_updates();
+  }
+  static double is_root(const graph_type::vertex_type& vertex) {
+    return vertex.data() == double(vertex.id());
+  }
+  static double checksum(graph_type& graph) {
+    return graph.map_reduce_vertices<double>(is_root);
+  }
+}; // end of cc_algorithm
+
+
+
+/**
+ * Triangle counting by intersecting the sorted sets of the neighbors
+ * with larger ids, as in simple_undirected_triangle_count.cpp. The
+ * scatter reads the sets of both ends of the edge, so the count is only
+ * exact on the synchronous engine.
+ * Checksum: the number of triangles.
+ */
+struct triangles_algorithm {
+  typedef std::vector<graphlab::vertex_id_type> vid_vector;
+
+  struct vertex_data {
+    vid_vector neighbors;
+    void save(graphlab::oarchive& oarc) const { oarc << neighbors; }
+    void load(graphlab::iarchive& iarc) { iarc >> neighbors; }
+  };
+  typedef graphlab::distributed_graph<vertex_data, size_t> graph_type;
+
+  struct neighbor_gather {
+    vid_vector neighbors;
+    neighbor_gather& operator+=(const neighbor_gather& other) {
+      neighbors.insert(neighbors.end(), other.neighbors.begin(),
+                       other.neighbors.end());
+      return *this;
+    }
+    void save(graphlab::oarchive& oarc) const { oarc << neighbors; }
+    void load(graphlab::iarchive& iarc) { iarc >> neighbors; }
+  };
+
+  class vertex_program :
+    public graphlab::ivertex_program<graph_type, neighbor_gather>,
+    public graphlab::IS_POD_TYPE {
+  public:
+    edge_dir_type gather_edges(icontext_type& context,
+                               const vertex_type& vertex) const {
+      return graphlab::ALL_EDGES;
+    }
+    neighbor_gather gather(icontext_type& context, const vertex_type& vertex,
+                           edge_type& edge) const {
+      neighbor_gather ret;
+      const vertex_id_type other = other_vertex<graph_type>(edge, vertex).id();
+      if (other > vertex.id()) ret.neighbors.push_back(other);
+      return ret;
+    }
+    void apply(icontext_type& context, vertex_type& vertex,
+               const neighbor_gather& total) {
+      vid_vector& neighbors = vertex.data().neighbors;
+      neighbors = total.neighbors;
+      std::sort(neighbors.begin(), neighbors.end());
+      neighbors.erase(std::unique(neighbors.begin(), neighbors.end()),
+                      neighbors.end());
+    }
+    edge_dir_type scatter_edges(icontext_type& context,
+                                const vertex_type& vertex) const {
+      return graphlab::OUT_EDGES;
+    }
+    void scatter(icontext_type& context, const vertex_type& vertex,
+                 edge_type& edge) const {
+      const vid_vector& a = edge.source().data().neighbors;
+      const vid_vector& b = edge.target().data().neighbors;
+      size_t count = 0;
+      for (size_t i = 0, j = 0; i < a.size() && j < b.size(); ) {
+        if (a[i] < b[j]) ++i;
+        else if (b[j] < a[i]) ++j;
+        else { ++count; ++i; ++j; }
+      }
+      edge.data() = count;
+    }
+  };
+
+  static void load(graph_type& graph, const std::string& kind) {
+    load_input(graph, kind);
+  }
+  static void init(graph_type& graph) { }
+  static size_t run(graphlab::distributed_control& dc, graph_type& graph,
+                    const std::string& exec_type,
+                    const graphlab::graphlab_options& opts) {
+    graphlab::omni_engine<vertex_program> engine(dc, graph, exec_type, opts);
+    engine.signal_all();
+    engine.start();
+    return engine.num_updates();
+  }
+  static double edge_count(const graph_type::edge_type& edge) {
+    return edge.data();
+  }
+  static double checksum(graph_type& graph) {
+    return graph.map_reduce_edges<double>(edge_count);
+  }
+}; // end of triangles_algorithm
+
+
+
+/**
+ * Alternating least squares with RATINGS_D latent factors, as in
+ * toolkits/collaborative_filtering/als.cpp. Every vertex solves its
+ * regularized least squares problem against the factors of its
+ * neighbors and signals them while its factor still moves. The
+ * synchronous engine stops after MAX_ITERATIONS.
+ * Checksum: the training RMSE.
+ */
+struct als_algorithm {
+  struct vertex_data : graphlab::IS_POD_TYPE {
+    double factor[RATINGS_D];
+  };
+  struct edge_data : graphlab::IS_POD_TYPE {
+    double rating;
+    edge_data(double rating = 0) : rating(rating) { }
+  };
+  typedef graphlab::distributed_graph<vertex_data, edge_data> graph_type;
+
+  /// The normal equations XtX w = Xy of a vertex
+  struct normal_equations : graphlab::IS_POD_TYPE {
+    double XtX[RATINGS_D * RATINGS_D];
+    double Xy[RATINGS_D];
+    normal_equations() {
+      std::fill(XtX, XtX + RATINGS_D * RATINGS_D, 0);
+      std::fill(Xy, Xy + RATINGS_D, 0);
+    }
+    normal_equations& operator+=(const normal_equations& other) {
+      for (size_t i = 0; i < RATINGS_D * RATINGS_D; ++i) XtX[i] += other.XtX[i];
+      for (size_t i = 0; i < RATINGS_D; ++i) Xy[i] += other.Xy[i];
+      return *this;
+    }
+  };
+
+  /// Solves A x = b for a symmetric positive definite A, in place
+  static void cholesky_solve(double A[RATINGS_D * RATINGS_D],
+                             double b[RATINGS_D]) {
+    const size_t D = RATINGS_D;
+    for (size_t j = 0; j < D; ++j) {
+      double sum = A[j * D + j];
+      for (size_t k = 0; k < j; ++k) sum -= A[j * D + k] * A[j * D + k];
+      A[j * D + j] = std::sqrt(sum);
+      for (size_t i = j + 1; i < D; ++i) {
+        double s = A[i * D + j];
+        for (size_t k = 0; k < j; ++k) s -= A[i * D + k] * A[j * D + k];
+        A[i * D + j] = s / A[j * D + j];
+      }
+    }
+    for (size_t i = 0; i < D; ++i) {
+      for (size_t k = 0; k < i; ++k) b[i] -= A[i * D + k] * b[k];
+      b[i] /= A[i * D + i];
+    }
+    for (size_t i = D; i-- > 0; ) {
+      for (size_t k = i + 1; k < D; ++k) b[i] -= A[k * D + i] * b[k];
+      b[i] /= A[i * D + i];
+    }
+  }
+
+  class vertex_program :
+    public graphlab::ivertex_program<graph_type, normal_equations>,
+    public graphlab::IS_POD_TYPE {
+    double change;
+  public:
+    edge_dir_type gather_edges(icontext_type& context,
+                               const vertex_type& vertex) const {
+      return graphlab::ALL_EDGES;
+    }
+    normal_equations gather(icontext_type& context, const vertex_type& vertex,
+                            edge_type& edge) const {
+      const double* x = other_vertex<graph_type>(edge, vertex).data().factor;
+      normal_equations ret;
+      for (size_t i = 0; i < RATINGS_D; ++i) {
+        for (size_t j = 0; j < RATINGS_D; ++j) {
+          ret.XtX[i * RATINGS_D + j] = x[i] * x[j];
+        }
+        ret.Xy[i] = x[i] * edge.data().rating;
+      }
+      return ret;
+    }
+    void apply(icontext_type& context, vertex_type& vertex,
+               const normal_equations& total) {
+      normal_equations eq = total;
+      for (size_t i = 0; i < RATINGS_D; ++i) {
+        eq.XtX[i * RATINGS_D + i] += 0.065;
+      }
+      cholesky_solve(eq.XtX, eq.Xy);
+      change = 0;
+      for (size_t i = 0; i < RATINGS_D; ++i) {
+        change += std::fabs(eq.Xy[i] - vertex.data().factor[i]);
+        vertex.data().factor[i] = eq.Xy[i];
+      }
+    }
+    edge_dir_type scatter_edges(icontext_type& context,
+                                const vertex_type& vertex) const {
+      return change > 1e-3 ? graphlab::ALL_EDGES : graphlab::NO_EDGES;
+    }
+    void scatter(icontext_type& context, const vertex_type& vertex,
+                 edge_type& edge) const {
+      context.signal(other_vertex<graph_type>(edge, vertex));
+    }
+  };
+
+  static void load(graph_type& graph, const std::string& kind) {
+    load_ratings(graph);
+  }
+  static void init_vertex(graph_type::vertex_type& vertex) {
+    graphlab::random::counter_generator rng(SEED, vertex.id(), 2);
+    for (size_t i = 0; i < RATINGS_D; ++i) {
+      vertex.data().factor[i] = rng.uniform<double>(0, 1);
+    }
+  }
+  static void init(graph_type& graph) {
+    graph.transform_vertices(init_vertex);
+  }
+  static size_t run(graphlab::distributed_control& dc, graph_type& graph,
+                    const std::string& exec_type,
+                    const graphlab::graphlab_options& opts) {
+    graphlab::graphlab_options als_opts = opts;
+    if (exec_type == "synchronous") {
+      als_opts.get_engine_args().set_option("max_iterations", MAX_ITERATIONS);
+    }
+    graphlab::omni_engine<vertex_program> engine(dc, graph, exec_type,
+                                                 als_opts);
+    engine.signal_all();
+    engine.start();
+    return engine.num_updates();
+  }
+  static double squared_error(const graph_type::edge_type& edge) {
+    double prediction = 0;
+    for (size_t i = 0; i < RATINGS_D; ++i) {
+      prediction += edge.source().data().factor[i] *
+        edge.target().data().factor[i];
+    }
+    return (prediction - edge.data().rating) * (prediction - edge.data().rating);
+  }
+  static double checksum(graph_type& graph) {
+    const double error = graph.map_reduce_edges<double>(squared_error);
+    return std::sqrt(error / std::max<size_t>(1, graph.num_edges()));
+  }
+}; // end of als_algorithm
+
+
+
+/**
+ * Collapsed Gibbs sampling LDA on the rating matrix, read as a corpus in
+ * which the users are documents and the movies words. A rating becomes
+ * one to LDA_MAX_TOKENS tokens, and the topics of the tokens are kept on
+ * the edges. Each of the MAX_ITERATIONS rounds resamples the tokens of
+ * every document against the counts of the previous round (as in
+ * approximate distributed LDA) and then recounts the words.
+ * Checksum: the fraction of the tokens of a word in its most common
+ * topic, averaged over the words.
+ */
+struct lda_algorithm {
+  enum { LDA_TOPICS = 20, LDA_MAX_TOKENS = 4 };
+
+  /// The topic counts of a document, a word or of the whole corpus
+  struct topic_counts : graphlab::IS_POD_TYPE {
+    uint32_t counts[LDA_TOPICS];
+    topic_counts() { std::fill(counts, counts + LDA_TOPICS, 0); }
+    topic_counts& operator+=(const topic_counts& other) {
+      for (size_t i = 0; i < LDA_TOPICS; ++i) counts[i] += other.counts[i];
+      return *this;
+    }
+  };
+  struct edge_data : graphlab::IS_POD_TYPE {
+    uint16_t ntokens;
+    uint16_t topics[LDA_MAX_TOKENS];
+    edge_data(double rating = 0) :
+      ntokens(1 + size_t(std::fabs(rating)) % LDA_MAX_TOKENS) {
+      std::fill(topics, topics + LDA_MAX_TOKENS, 0);
+    }
+  };
+  typedef graphlab::distributed_graph<topic_counts, edge_data> graph_type;
+
+  // The corpus counts of the previous round, and whether the documents
+  // sample in this round
+  static topic_counts& global_counts() {
+    static topic_counts counts;
+    return counts;
+  }
+  static size_t& round() {
+    static size_t current_round = 0;
+    return current_round;
+  }
+
+  static uint64_t edge_stream(const graph_type::edge_type& edge) {
+    return (uint64_t(edge.source().id()) << 32) ^ edge.target().id();
+  }
+
+  class vertex_program :
+    public graphlab::ivertex_program<graph_type, topic_counts>,
+    public graphlab::IS_POD_TYPE {
+  public:
+    edge_dir_type gather_edges(icontext_type& context,
+                               const vertex_type& vertex) const {
+      return graphlab::ALL_EDGES;
+    }
+    topic_counts gather(icontext_type& context, const vertex_type& vertex,
+                        edge_type& edge) const {
+      topic_counts ret;
+      for (size_t i = 0; i < edge.data().ntokens; ++i) {
+        ++ret.counts[edge.data().topics[i]];
+      }
+      return ret;
+    }
+    void apply(icontext_type& context, vertex_type& vertex,
+               const topic_counts& total) {
+      vertex.data() = total;
+    }
+    edge_dir_type scatter_edges(icontext_type& context,
+                                const vertex_type& vertex) const {
+      return round() > 0 && is_user(vertex.id()) ?
+        graphlab::OUT_EDGES : graphlab::NO_EDGES;
+    }
+    void scatter(icontext_type& context, const vertex_type& vertex,
+                 edge_type& edge) const {
+      const double alpha = 0.1, beta = 0.01;
+      const topic_counts& doc = vertex.data();
+      const topic_counts& word = edge.target().data();
+      const topic_counts& corpus = global_counts();
+      graphlab::random::counter_generator rng(SEED, edge_stream(edge),
+                                              round());
+      double prob[LDA_TOPICS];
+      for (size_t t = 0; t < edge.data().ntokens; ++t) {
+        const size_t old_topic = edge.data().topics[t];
+        double sum = 0;
+        for (size_t k = 0; k < LDA_TOPICS; ++k) {
+          // leave the token out of the counts
+          const double self = k == old_topic;
+          const double ndk = std::max(double(doc.counts[k]) - self, 0.0);
+          const double nwk = std::max(double(word.counts[k]) - self, 0.0);
+          const double nk = std::max(double(corpus.counts[k]) - self, 0.0);
+          sum += (ndk + alpha) * (nwk + beta) / (nk + NMOVIES * beta);
+          prob[k] = sum;
+        }
+        const double u = rng.rand01() * sum;
+        size_t new_topic = 0;
+        while (new_topic + 1 < LDA_TOPICS && prob[new_topic] <= u) ++new_topic;
+        edge.data().topics[t] = new_topic;
+      }
+      context.signal(edge.target());
+    }
+  };
+
+  static void load(graph_type& graph, const std::string& kind) {
+    load_ratings(graph);
+  }
+  static void init_edge(graph_type::edge_type& edge) {
+    graphlab::random::counter_generator rng(SEED, edge_stream(edge), 0);
+    for (size_t t = 0; t < edge.data().ntokens; ++t) {
+      edge.data().topics[t] = rng.uniform<size_t>(0, LDA_TOPICS - 1);
+    }
+  }
+  static void init(graph_type& graph) {
+    graph.transform_edges(init_edge);
+  }
+  static bool is_document(const graph_type::vertex_type& vertex) {
+    return is_user(vertex.id());
+  }
+  static topic_counts word_counts(const graph_type::vertex_type& vertex) {
+    return is_user(vertex.id()) ? topic_counts() : vertex.data();
+  }
+  static size_t run(graphlab::distributed_control& dc, graph_type& graph,
+                    const std::string& exec_type,
+                    const graphlab::graphlab_options& opts) {
+    graphlab::omni_engine<vertex_program> engine(dc, graph, exec_type, opts);
+    // round 0 only counts the initial topics
+    round() = 0;
+    engine.signal_all();
+    engine.start();
+    size_t updates = engine.num_updates();
+    const graphlab::vertex_set documents = graph.select(is_document);
+    for (round() = 1; round() <= MAX_ITERATIONS; ++round()) {
+      global_counts() = graph.map_reduce_vertices<topic_counts>(word_counts);
+      engine.signal_vset(documents);
+      engine.start();
+      updates += engine.num_updates();
+    }
+    round() = 0;
+    return updates;
+  }
+  static double word_concentration(const graph_type::vertex_type& vertex) {
+    if (is_user(vertex.id())) return 0;
+    const uint32_t* counts = vertex.data().counts;
+    const double total = std::accumulate(counts, counts + LDA_TOPICS, 0.0);
+    return total > 0 ? *std::max_element(counts, counts + LDA_TOPICS) / total : 0;
+  }
+  static double checksum(graph_type& graph) {
+    return graph.map_reduce_vertices<double>(word_concentration) /
+      std::max<size_t>(1, NMOVIES);
+  }
+}; // end of lda_algorithm
+
+
+
+/**
+ * The measurements of one run of an algorithm
+ */
+struct benchmark_result {
+  std::string algorithm, engine, graph;
+  size_t nprocs, ncpus, nverts, nedges, updates, bytes_sent, peak_memory_bytes;
+  double load_seconds, finalize_seconds, run_seconds, edges_per_second,
+    checksum;
+
+  /// The options which must match for two runs to be compared
+  std::string key() const {
+    std::stringstream strm;
+    strm << algorithm << " " << engine << " " << graph << " nverts=" << nverts
+         << " nprocs=" << nprocs << " ncpus=" << ncpus;
+    return strm.str();
+  }
+
+  std::string to_json() const {
+    std::stringstream strm;
+    strm.precision(10);
+    strm << "{\"algorithm\":\"" << algorithm << "\""
+         << ",\"engine\":\"" << engine << "\""
+         << ",\"graph\":\"" << graph << "\""
+         << ",\"nprocs\":" << nprocs
+         << ",\"ncpus\":" << ncpus
+         << ",\"nverts\":" << nverts
+         << ",\"nedges\":" << nedges
+         << ",\"load_seconds\":" << load_seconds
+         << ",\"finalize_seconds\":" << finalize_seconds
+         << ",\"run_seconds\":" << run_seconds
+         << ",\"updates\":" << updates
+         << ",\"edges_per_second\":" << edges_per_second
+         << ",\"bytes_sent\":" << bytes_sent
+         << ",\"peak_memory_bytes\":" << peak_memory_bytes
+         << ",\"checksum\":" << checksum << "}";
+    return strm.str();
+  }
+
+  /// Returns the value of a field of a line written by to_json()
+  static std::string json_field(const std::string& line,
+                                const std::string& name) {
+    const std::string pattern = "\"" + name + "\":";
+    size_t begin = line.find(pattern);
+    if (begin == std::string::npos) return std::string();
+    begin += pattern.length();
+    if (line[begin] == '"') {
+      ++begin;
+      return line.substr(begin, line.find('"', begin) - begin);
+    }
+    return line.substr(begin, line.find_first_of(",}", begin) - begin);
+  }
+
+  /// Reads the fields needed to compare against a line of to_json()
+  static benchmark_result from_json(const std::string& line) {
+    benchmark_result ret;
+    ret.algorithm = json_field(line, "algorithm");
+    ret.engine = json_field(line, "engine");
+    ret.graph = json_field(line, "graph");
+    ret.nprocs = atol(json_field(line, "nprocs").c_str());
+    ret.ncpus = atol(json_field(line, "ncpus").c_str());
+    ret.nverts = atol(json_field(line, "nverts").c_str());
+    ret.run_seconds = atof(json_field(line, "run_seconds").c_str());
+    ret.checksum = atof(json_field(line, "checksum").c_str());
+    return ret;
+  }
+}; // end of benchmark_result
+
+
+/**
+ * Generates the input of an algorithm, runs it and measures the
+ * phases. Must be called on all machines simultaneously.
+ */
+template <typename Algorithm>
+benchmark_result run_benchmark(graphlab::distributed_control& dc,
+                               const graphlab::graphlab_options& opts,
+                               const std::string& algorithm,
+                               const std::string& exec_type,
+                               const std::string& graph_kind) {
+  typedef typename Algorithm::graph_type graph_type;
+  benchmark_result result;
+  result.algorithm = algorithm;
+  result.engine = exec_type;
+  result.graph = (algorithm == "als" || algorithm == "lda") ?
+    "ratings" : graph_kind;
+  result.nprocs = dc.numprocs();
+  result.ncpus = opts.get_ncpus();
+
+  dc.full_barrier();
+  graphlab::memory_info::reset_peak_tagged_bytes();
+  graphlab::timer ti;
+  graph_type graph(dc, opts);
+  Algorithm::load(graph, graph_kind);
+  result.load_seconds = ti.current_time();
+
+  ti.start();
+  graph.finalize();
+  Algorithm::init(graph);
+  result.finalize_seconds = ti.current_time();
+  result.nverts = graph.num_vertices();
+  result.nedges = graph.num_edges();
+
+  dc.full_barrier();
+  const size_t bytes_before = dc.network_bytes_sent();
+  ti.start();
+  result.updates = Algorithm::run(dc, graph, exec_type, opts);
+  result.run_seconds = ti.current_time();
+  dc.full_barrier();
+  result.edges_per_second = result.nedges / std::max(result.run_seconds, 1e-9);
+
+  result.bytes_sent = dc.network_bytes_sent() - bytes_before;
+  dc.all_reduce(result.bytes_sent);
+  result.peak_memory_bytes = graphlab::memory_info::peak_tagged_bytes();
+  dc.all_reduce(result.peak_memory_bytes);
+  result.checksum = Algorithm::checksum(graph);
+  return result;
+} // end of run_benchmark
+
+
+/**
+ * Compares the run times against the results stored in a baseline
+ * file and returns the number of runs slower by more than the
+ * tolerance.
+ */
+size_t compare_to_baseline(const std::string& fname,
+                           const std::vector<benchmark_result>& results,
+                           double tolerance) {
+  std::ifstream fin(fname.c_str());
+  if (!fin.good()) {
+    logstream(LOG_ERROR) << "Unable to open baseline " << fname << std::endl;
+    return results.size();
+  }
+  std::map<std::string, benchmark_result> baseline;
+  std::string line;
+  while (std::getline(fin, line)) {
+    if (line.empty()) continue;
+    const benchmark_result result = benchmark_result::from_json(line);
+    baseline[result.key()] = result;
+  }
+
+  size_t regressions = 0;
+  std::cout << "Comparison against " << fname << ":\n";
+  foreach(const benchmark_result& result, results) {
+    if (baseline.count(result.key()) == 0) {
+      std::cout << "  " << result.key() << ": not in baseline\n";
+      continue;
+    }
+    const benchmark_result& base = baseline[result.key()];
+    const double ratio = result.run_seconds / std::max(base.run_seconds, 1e-9);
+    const bool regressed = ratio > 1 + tolerance;
+    regressions += regressed;
+    std::cout << "  " << result.key() << ": " << base.run_seconds << "s -> "
+              << result.run_seconds << "s (x" << ratio << ")"
+              << (regressed ? " REGRESSION" : "");
+    if (std::fabs(result.checksum - base.checksum) >
+        1e-6 * std::max(1.0, std::fabs(base.checksum))) {
+      std::cout << " checksum " << base.checksum << " -> " << result.checksum;
+    }
+    std::cout << "\n";
+  }
+  std::cout << regressions << " regressions" << std::endl;
+  return regressions;
+} // end of compare_to_baseline
+
+
+int main(int argc, char** argv) {
+  graphlab::mpi_tools::init(argc, argv);
+  graphlab::distributed_control dc;
+  global_logger().set_log_level(LOG_WARNING);
+
+  graphlab::command_line_options clopts(
+    "Benchmark of the graph algorithms on reproducible synthetic inputs.");
+  std::string graph_kind = "powerlaw";
+  std::string algorithms = "pagerank,sssp,cc,triangles,als,lda";
+  std::string engines = "synchronous,asynchronous";
+  std::string threads;
+  std::string results_file, baseline_file;
+  double tolerance = 0.1;
+  clopts.attach_option("graph", graph_kind,
+                       "The input of pagerank, sssp, cc and triangles: "
+                       "powerlaw, rmat, lfr or grid. als and lda always run "
+                       "on a synthetic rating matrix.");
+  clopts.attach_option("nverts", NVERTS,
+                       "The number of vertices of the graph, and of users "
+                       "of the rating matrix.");
+  clopts.attach_option("seed", SEED, "The seed of the generated inputs.");
+  clopts.attach_option("algorithms", algorithms,
+                       "Comma separated algorithms to run.");
+  clopts.attach_option("engines", engines,
+                       "Comma separated engines to run with.");
+  clopts.attach_option("threads", threads,
+                       "Comma separated thread counts to run with. "
+                       "Defaults to --ncpus.");
+  clopts.attach_option("iterations", MAX_ITERATIONS,
+                       "The iterations of als on the synchronous engine "
+                       "and the rounds of lda.");
+  clopts.attach_option("tol", PAGERANK_TOLERANCE,
+                       "The PageRank convergence tolerance.");
+  clopts.attach_option("results", results_file,
+                       "If set, appends the results to this file.");
+  clopts.attach_option("baseline", baseline_file,
+                       "If set, compares the run times against the results "
+                       "stored in this file.");
+  clopts.attach_option("tolerance", tolerance,
+                       "The relative slowdown reported as a regression.");
+  if(!clopts.parse(argc, argv)) {
+    dc.cout() << "Error in parsing command line arguments." << std::endl;
+    return EXIT_FAILURE;
+  }
+  NUSERS = std::max<size_t>(NVERTS, 1);
+  NMOVIES = std::max<size_t>(NVERTS / 10, 1);
+
+  std::vector<size_t> thread_counts;
+  foreach(const std::string& count, graphlab::strsplit(threads, ",", true)) {
+    thread_counts.push_back(atol(count.c_str()));
+  }
+  if (thread_counts.empty()) thread_counts.push_back(clopts.get_ncpus());
+
+  std::vector<benchmark_result> results;
+  foreach(const std::string& algorithm,
+          graphlab::strsplit(algorithms, ",", true)) {
+    foreach(const std::string& engine, graphlab::strsplit(engines, ",", true)) {
+      if (algorithm == "triangles" && engine != "synchronous") {
+        dc.cout() << "Skipping triangles on the " << engine << " engine"
+                  << std::endl;
+        continue;
+      }
+      foreach(size_t ncpus, thread_counts) {
+        graphlab::graphlab_options opts = clopts;
+        opts.set_ncpus(ncpus);
+        benchmark_result result;
+        if (algorithm == "pagerank") {
+          result = run_benchmark<pagerank_algorithm>(dc, opts, algorithm,
+                                                     engine, graph_kind);
+        } else if (algorithm == "sssp") {
+          result = run_benchmark<sssp_algorithm>(dc, opts, algorithm,
+                                                 engine, graph_kind);
+        } else if (algorithm == "cc") {
+          result = run_benchmark<cc_algorithm>(dc, opts, algorithm,
+                                               engine, graph_kind);
+        } else if (algorithm == "triangles") {
+          result = run_benchmark<triangles_algorithm>(dc, opts, algorithm,
+                                                      engine, graph_kind);
+        } else if (algorithm == "als") {
+          result = run_benchmark<als_algorithm>(dc, opts, algorithm,
+                                                engine, graph_kind);
+        } else if (algorithm == "lda") {
+          result = run_benchmark<lda_algorithm>(dc, opts, algorithm,
+                                                engine, graph_kind);
+        } else {
+          dc.cout() << "Unknown algorithm: " << algorithm << std::endl;
+          return EXIT_FAILURE;
+        }
+        dc.cout() << result.to_json() << std::endl;
+        results.push_back(result);
+      }
+    }
+  }
+
+  size_t regressions = 0;
+  if (dc.procid() == 0) {
+    if (!results_file.empty()) {
+      std::ofstream fout(results_file.c_str(), std::ios::app);
+      foreach(const benchmark_result& result, results) {
+        fout << result.to_json() << "\n";
+      }
+    }
+    if (!baseline_file.empty()) {
+      regressions = compare_to_baseline(baseline_file, results, tolerance);
+    }
+  }
+  dc.broadcast(regressions, dc.procid() == 0);
+
+  graphlab::mpi_tools::finalize();
+  return regressions == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+} // End of main
+
+#include <graphlab/macros_undef.hpp>
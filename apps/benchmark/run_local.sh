@@ -0,0 +1,19 @@
+#!/bin/bash
+
+# Runs the benchmark with several processes on this machine.
+# Usage: run_local.sh <number of processes> [benchmark options]
+# The benchmark binary is taken from $BENCHMARK, or from the directory
+# of this script.
+if [ $# -lt 1 ]; then
+  echo "Usage: $0 <number of processes> [benchmark options]"
+  exit 1
+fi
+NPROCS=$1
+shift
+BENCHMARK=${BENCHMARK:-$(dirname $0)/benchmark}
+# split the cores of the machine between the processes
+NCPUS=$(( $(getconf _NPROCESSORS_ONLN) / NPROCS ))
+if [ $NCPUS -lt 1 ]; then
+  NCPUS=1
+fi
+mpiexec -n $NPROCS $BENCHMARK --ncpus=$NCPUS "$@"
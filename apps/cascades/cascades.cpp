@@ -19,6 +19,7 @@
 
 
 #include <graphlab.hpp>
+#include <graphlab/engine/stochastic_diffusion.hpp>
 #include <math.h>
 #include <cstdlib>
 #include <ctime>
@@ -181,6 +182,77 @@ struct cascades_writer{
   std::string save_edge (graph_type::edge_type e) { return ""; }
 };
 
+bool is_infected(const graph_type::vertex_type& vertex) {
+  return vertex.data() == INFECTED;
+}
+
+// The independent cascade fires every edge with the infection chance
+template <typename EdgeType>
+void set_infection_chance(EdgeType& edge) {
+  edge.data().weight = infection_chance;
+}
+
+// The linear threshold model weighs the in neighbors equally
+template <typename EdgeType>
+void set_uniform_weight(EdgeType& edge) {
+  edge.data().weight = 1.0 / edge.target().num_in_edges();
+}
+
+template <typename VertexType>
+struct activation_writer {
+  size_t runs;
+  std::string save_vertex(VertexType v) {
+    std::stringstream strm;
+    strm << v.id() << "\t" << double(v.data().activations) / runs << "\n";
+    return strm.str();
+  }
+  template <typename EdgeType>
+  std::string save_edge(EdgeType e) { return ""; }
+};
+
+/*
+ * Estimates the expected number of vertices reached by a diffusion
+ * model from the infected vertices of the input, and saves the
+ * probability that each vertex is reached.
+ */
+template <graphlab::diffusion::model_type Model>
+void run_diffusion(graphlab::distributed_control& dc, graph_type& graph,
+                   const std::string& execution_type,
+                   const graphlab::command_line_options& clopts,
+                   size_t runs, size_t seed, const std::string& saveprefix) {
+  typedef graphlab::diffusion::simulator<Model> simulator_type;
+  typedef typename simulator_type::graph_type diffusion_graph_type;
+  // the copy keeps the local vertex ids, so the seeds carry over
+  diffusion_graph_type diffusion_graph(dc, graph, clopts);
+  if (Model == graphlab::diffusion::INDEPENDENT_CASCADE) {
+    diffusion_graph.transform_edges(
+        set_infection_chance<typename diffusion_graph_type::edge_type>);
+  } else {
+    diffusion_graph.transform_edges(
+        set_uniform_weight<typename diffusion_graph_type::edge_type>);
+  }
+  const graphlab::vertex_set seeds = graph.select(is_infected);
+
+  dc.cout() << "Simulating " << runs << " runs with seed " << seed
+            << std::endl;
+  graphlab::timer ti;
+  const double spread = simulator_type::simulate(dc, diffusion_graph, seeds,
+                                                 runs, seed, execution_type,
+                                                 clopts);
+  dc.cout() << "Expected number of infected vertices: " << spread
+            << " over " << runs << " runs in " << ti.current_time()
+            << " seconds." << std::endl;
+
+  if (saveprefix != "") {
+    activation_writer<typename diffusion_graph_type::vertex_type> writer;
+    writer.runs = runs;
+    diffusion_graph.save(saveprefix, writer,
+       false,  // do not gzip
+       true,   //save vertices
+       false); // do not save edges
+  }
+}
+
 
 int main(int argc, char** argv) {
   srand((unsigned) time(0));
@@ -196,6 +268,9 @@ int main(int argc, char** argv) {
   double recovery = -1;
   double infection = -1;
   size_t iterations = -1;
+  std::string model = "sir";
+  size_t runs = 1000;
+  size_t seed = time(0);
 
   clopts.attach_option("graph", graph_dir, "The graph file. Required ");
   clopts.add_positional("graph");
@@ -209,6 +284,10 @@ int main(int argc, char** argv) {
   clopts.attach_option("recovery chance", recovery, "Chance of recovery for an infected individual at each step. Required.");
   clopts.attach_option("infection chance", infection, "Chance of infection for a susceptible individual per person at each step. Required.");
 
+  clopts.attach_option("model", model, "The model: sir, or ic (independent cascade) or lt (linear threshold) to estimate the expected number of vertices infected from the infected vertices of the input. Defaults to sir.");
+  clopts.attach_option("runs", runs, "The number of Monte-Carlo runs of the ic and lt models.");
+  clopts.attach_option("seed", seed, "The seed of the random draws of the ic and lt models. Defaults to the time on machine 0.");
+
   clopts.attach_option("iterations", iterations, "If set, will force the use of synchronous engine overriding any engine option set by the --engine parameter. Runs cascades for a fixed number of iterations. Also overrides the max_iterations option in the engine.");
 
   if(!clopts.parse(argc, argv)) {
@@ -220,18 +299,25 @@ int main(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
-  if (recovery == -1) {
+  if (model != "sir" && model != "ic" && model != "lt") {
+    dc.cout() << "Unknown model " << model << ". Cannot continue";
+    return EXIT_FAILURE;
+  }
+
+  if (recovery == -1 && model == "sir") {
     dc.cout() << "Recovery chance not specified. Cannot continue";
     return EXIT_FAILURE;
   }
 
-  if (infection == -1) {
+  if (infection == -1 && model != "lt") {
     dc.cout() << "Infection chance not specified. Cannot continue";
     return EXIT_FAILURE;
   }
 
   infection_chance = infection;
   recovery_chance = recovery;
+  // every machine must draw from the same seed
+  dc.broadcast(seed, dc.procid() == 0);
   
   if (iterations != -1) {
     // make sure this is the synchronous engine
@@ -250,6 +336,18 @@ int main(int argc, char** argv) {
 
   dc.cout() << "#vertices: " << graph.num_vertices() << " #edges:" << graph.num_edges() << std::endl;
 
+  if (model == "ic" || model == "lt") {
+    if (model == "ic") {
+      run_diffusion<graphlab::diffusion::INDEPENDENT_CASCADE>(
+          dc, graph, execution_type, clopts, runs, seed, saveprefix);
+    } else {
+      run_diffusion<graphlab::diffusion::LINEAR_THRESHOLD>(
+          dc, graph, execution_type, clopts, runs, seed, saveprefix);
+    }
+    graphlab::mpi_tools::finalize();
+    return EXIT_SUCCESS;
+  }
+
   graphlab::omni_engine<cascades> engine(dc, graph, execution_type, clopts);
 
   engine.signal_all();
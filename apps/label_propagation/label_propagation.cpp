@@ -19,12 +19,32 @@
 
 
 #include <graphlab.hpp>
+#include <graphlab/rpc/string_dictionary.hpp>
+
+/*
+ * Label propagation runs on integer labels by default: the string labels
+ * are interned into a graphlab::string_dictionary after loading, the
+ * vertex program counts the labels of the neighbors in a small sorted
+ * vector, and the labels are translated back to strings when saving.
+ * With --intern_labels=false it runs on the string labels and counts
+ * them in a std::map, and with --compare=true it runs both and reports
+ * their throughput.
+ *
+ * Both versions keep the most frequent label of the neighbors. Ties go
+ * to the smallest label, which is the smallest string or the smallest
+ * id, so the two versions may break ties differently.
+ */
 
 struct label_counter {
-  std::map<std::string, int> label_count;
+  typedef std::map<std::string, int> container_type;
+  container_type label_count;
 
   label_counter() {
   }
+
+  explicit label_counter(const std::string& label) {
+    label_count[label] = 1;
+  }
     
   label_counter& operator+=(const label_counter& other) { 
     for ( std::map<std::string, int>::const_iterator iter = other.label_count.begin();
@@ -44,13 +64,71 @@ struct label_counter {
   }
 };
 
-// The vertex data is its label 
-typedef std::string vertex_data_type;
+typedef graphlab::string_dictionary::id_type label_id_type;
+
+/**
+ * Counts integer labels in a vector of (label, count) sorted by label.
+ * A vertex sees few distinct labels, so the vector is small and is
+ * merged without allocating map nodes.
+ */
+struct flat_label_counter {
+  typedef std::vector<std::pair<label_id_type, int> > container_type;
+  container_type label_count;
+
+  flat_label_counter() {
+  }
+
+  explicit flat_label_counter(label_id_type label) :
+    label_count(1, std::make_pair(label, 1)) {
+  }
+
+  flat_label_counter& operator+=(const flat_label_counter& other) {
+    if (other.label_count.size() == 1) {
+      // the common case of adding the label of one neighbor
+      const std::pair<label_id_type, int>& entry = other.label_count[0];
+      container_type::iterator iter =
+        std::lower_bound(label_count.begin(), label_count.end(),
+                         std::make_pair(entry.first, 0));
+      if (iter != label_count.end() && iter->first == entry.first) {
+        iter->second += entry.second;
+      } else {
+        label_count.insert(iter, entry);
+      }
+      return *this;
+    }
+    const container_type& mine = label_count;
+    const container_type& theirs = other.label_count;
+    container_type merged;
+    merged.reserve(mine.size() + theirs.size());
+    container_type::const_iterator a = mine.begin();
+    container_type::const_iterator b = theirs.begin();
+    while (a != mine.end() && b != theirs.end()) {
+      if (a->first < b->first) merged.push_back(*a++);
+      else if (b->first < a->first) merged.push_back(*b++);
+      else {
+        merged.push_back(std::make_pair(a->first, a->second + b->second));
+        ++a; ++b;
+      }
+    }
+    merged.insert(merged.end(), a, mine.end());
+    merged.insert(merged.end(), b, theirs.end());
+    label_count.swap(merged);
+    return *this;
+  }
+
+  void save(graphlab::oarchive& oarc) const {
+    oarc << label_count;
+  }
+
+  void load(graphlab::iarchive& iarc) {
+    iarc >> label_count;
+  }
+};
 
-typedef label_counter gather_type;
- 
 // The graph type is determined by the vertex and edge data types
+// The vertex data is its label
 typedef graphlab::distributed_graph<std::string, graphlab::empty> graph_type;
+typedef graphlab::distributed_graph<label_id_type, graphlab::empty> id_graph_type;
 
 bool line_parser(graph_type& graph, const std::string& filename, const std::string& textline) {
   std::stringstream strm(textline);
@@ -73,9 +151,24 @@ bool line_parser(graph_type& graph, const std::string& filename, const std::stri
   return true;
 }
 
+/**
+ * The label propagation vertex program, on a graph of string labels
+ * with a label_counter, or of integer labels with a flat_label_counter.
+ */
+template <typename Graph, typename Counter>
 class labelpropagation :
-  public graphlab::ivertex_program<graph_type, gather_type>,
+  public graphlab::ivertex_program<Graph, Counter>,
   public graphlab::IS_POD_TYPE {
+  public:
+    typedef graphlab::ivertex_program<Graph, Counter> base_type;
+    typedef typename base_type::icontext_type icontext_type;
+    typedef typename base_type::vertex_type vertex_type;
+    typedef typename base_type::edge_type edge_type;
+    typedef typename base_type::edge_dir_type edge_dir_type;
+    typedef typename Graph::vertex_data_type label_type;
+    typedef Counter gather_type;
+
+  private:
     bool changed;
 
   public:
@@ -86,26 +179,22 @@ class labelpropagation :
     gather_type gather(icontext_type& context, const vertex_type& vertex, edge_type& edge) const {
       // figure out which data to get from the edge.
       bool isEdgeSource = (vertex.id() == edge.source().id());
-      std::string neighbor_label = isEdgeSource ? edge.target().data() : edge.source().data();
-
-      // make a label_counter and place the neighbor data in it
-      label_counter counter;
-      counter.label_count[neighbor_label] = 1;
-
+      const label_type& neighbor_label =
+        isEdgeSource ? edge.target().data() : edge.source().data();
 
-      // gather_type is a label counter, so += will add neighbor counts to the
-      // label_count map.
-      return counter;
+      // make a counter holding the neighbor label. gather_type is a label
+      // counter, so += will add neighbor counts to the label counts.
+      return gather_type(neighbor_label);
     }
 
     void apply(icontext_type& context, vertex_type& vertex, const gather_type& total) {
 
       int maxCount = 0;
 
-      std::string maxLabel = vertex.data();
+      label_type maxLabel = vertex.data();
 
       // Figure out which label of the vertex's neighbors' labels is most common
-      for ( std::map<std::string, int>::const_iterator iter = total.label_count.begin();
+      for ( typename gather_type::container_type::const_iterator iter = total.label_count.begin();
                 iter != total.label_count.end(); ++iter ) {
               if (iter->second > maxCount) {
                 maxCount = iter->second;
@@ -116,7 +205,7 @@ class labelpropagation :
       
       // if maxLabel differs to vertex data, mark vertex as changed and update
       // its data.
-      if ((vertex.data()).compare(maxLabel) != 0) {
+      if (!(vertex.data() == maxLabel)) {
         changed = true;
         vertex.data() = maxLabel;
       } else {
@@ -140,6 +229,9 @@ class labelpropagation :
     }
   };
 
+typedef labelpropagation<graph_type, label_counter> string_program_type;
+typedef labelpropagation<id_graph_type, flat_label_counter> id_program_type;
+
 struct labelpropagation_writer {
   std::string save_vertex(graph_type::vertex_type v) {
     std::stringstream strm;
@@ -149,6 +241,75 @@ struct labelpropagation_writer {
   std::string save_edge (graph_type::edge_type e) { return ""; }
 };
 
+typedef boost::unordered_map<label_id_type, std::string> label_names_type;
+
+/// Writes the integer labels by their strings
+struct id_labelpropagation_writer {
+  const label_names_type* names;
+  id_labelpropagation_writer(const label_names_type& names) : names(&names) { }
+  std::string save_vertex(id_graph_type::vertex_type v) {
+    std::stringstream strm;
+    strm << v.id() << "\t" << names->find(v.data())->second << "\n";
+    return strm.str();
+  }
+  std::string save_edge (id_graph_type::edge_type e) { return ""; }
+};
+
+
+/**
+ * Sets the label of each vertex of id_graph to the id of its label in
+ * graph. id_graph has the topology of graph.
+ */
+void intern_labels(graph_type& graph, id_graph_type& id_graph,
+                   graphlab::string_dictionary& dictionary) {
+  std::vector<std::string> labels;
+  std::vector<graphlab::lvid_type> lvids;
+  for (graphlab::lvid_type lvid = 0; lvid < graph.num_local_vertices(); ++lvid) {
+    if (graph.l_is_master(lvid)) {
+      labels.push_back(graph.l_vertex(lvid).data());
+      lvids.push_back(lvid);
+    }
+  }
+  std::vector<label_id_type> ids;
+  dictionary.intern(labels, ids);
+  for (size_t i = 0; i < lvids.size(); ++i) {
+    id_graph.l_vertex(lvids[i]).data() = ids[i];
+  }
+  id_graph.synchronize();
+}
+
+
+/// Returns the strings of the labels of the master vertices
+label_names_type label_names(id_graph_type& id_graph,
+                             graphlab::string_dictionary& dictionary) {
+  std::vector<label_id_type> ids;
+  for (graphlab::lvid_type lvid = 0; lvid < id_graph.num_local_vertices(); ++lvid) {
+    if (id_graph.l_is_master(lvid)) ids.push_back(id_graph.l_vertex(lvid).data());
+  }
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  std::vector<std::string> strings;
+  dictionary.lookup(ids, strings);
+  label_names_type names;
+  for (size_t i = 0; i < ids.size(); ++i) names[ids[i]] = strings[i];
+  return names;
+}
+
+
+/// Runs the engine and reports its run time and update rate
+template <typename Engine>
+double run_engine(graphlab::distributed_control& dc, Engine& engine,
+                  const std::string& name) {
+  engine.signal_all();
+  engine.start();
+  const double runtime = engine.elapsed_seconds();
+  const size_t updates = engine.num_updates();
+  dc.cout() << "Finished Running engine on " << name << " labels in "
+            << runtime << " seconds (" << updates << " updates, "
+            << updates / runtime << " updates/sec)." << std::endl;
+  return runtime;
+}
+
 
 int main(int argc, char** argv) {
   // Initialize control plain using mpi
@@ -168,6 +329,14 @@ int main(int argc, char** argv) {
   clopts.attach_option("saveprefix", saveprefix,
                        "If set, will save the resultant pagerank to a "
                        "sequence of files with prefix saveprefix");
+  bool use_ids = true;
+  clopts.attach_option("intern_labels", use_ids,
+                       "If true, the labels are replaced by integer ids "
+                       "while the engine runs");
+  bool compare = false;
+  clopts.attach_option("compare", compare,
+                       "If true, runs on both integer and string labels "
+                       "and reports the difference of throughput");
 
   if(!clopts.parse(argc, argv)) {
     dc.cout() << "Error in parsing command line arguments." << std::endl;
@@ -187,19 +356,45 @@ int main(int argc, char** argv) {
 
   dc.cout() << "#vertices: " << graph.num_vertices() << " #edges:" << graph.num_edges() << std::endl;
 
-  graphlab::omni_engine<labelpropagation> engine(dc, graph, execution_type, clopts);
-
-  engine.signal_all();
-  engine.start();
-
-  const float runtime = engine.elapsed_seconds();
-  dc.cout() << "Finished Running engine in " << runtime << " seconds." << std::endl;
+  if (use_ids) {
+    graphlab::timer ti;
+    ti.start();
+    id_graph_type id_graph(dc, graph, clopts);
+    graphlab::string_dictionary dictionary(dc);
+    intern_labels(graph, id_graph, dictionary);
+    dc.cout() << "Interned " << dictionary.size() << " labels in "
+              << ti.current_time() << " seconds" << std::endl;
+    // the string labels are only needed again to compare against them
+    if (!compare) graph.clear();
+
+    graphlab::omni_engine<id_program_type> engine(dc, id_graph, execution_type, clopts);
+    const double id_runtime = run_engine(dc, engine, "integer");
+
+    if (compare) {
+      graphlab::omni_engine<string_program_type>
+        string_engine(dc, graph, execution_type, clopts);
+      const double string_runtime = run_engine(dc, string_engine, "string");
+      dc.cout() << "Integer labels are " << string_runtime / id_runtime
+                << "x faster than string labels" << std::endl;
+    }
 
-  if (saveprefix != "") {
-    graph.save(saveprefix, labelpropagation_writer(),
-       false,  // do not gzip
-       true,   //save vertices
-       false); // do not save edges 
+    if (saveprefix != "") {
+      const label_names_type names = label_names(id_graph, dictionary);
+      id_graph.save(saveprefix, id_labelpropagation_writer(names),
+         false,  // do not gzip
+         true,   //save vertices
+         false); // do not save edges
+    }
+  } else {
+    graphlab::omni_engine<string_program_type> engine(dc, graph, execution_type, clopts);
+    run_engine(dc, engine, "string");
+
+    if (saveprefix != "") {
+      graph.save(saveprefix, labelpropagation_writer(),
+         false,  // do not gzip
+         true,   //save vertices
+         false); // do not save edges
+    }
   }
   
 
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_DSL_LOADER_HPP
+#define GRAPHLAB_DSL_LOADER_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <cstdio>
+#include <cstdlib>
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <stdint.h>
+
+#include <graphlab/logger/logger.hpp>
+#include "dsl_plugin.hpp"
+
+#ifndef GRAPHLAB_DSL_DIR
+#define GRAPHLAB_DSL_DIR "."
+#endif
+#ifndef GRAPHLAB_DSL_SOURCE_DIR
+#define GRAPHLAB_DSL_SOURCE_DIR "."
+#endif
+#ifndef GRAPHLAB_DSL_DEPS_DIR
+#define GRAPHLAB_DSL_DEPS_DIR "."
+#endif
+
+
+/**
+ * Reads a whole file. Returns false if it cannot be opened.
+ */
+inline bool read_file(const std::string& path, std::string& contents) {
+  std::ifstream fin(path.c_str());
+  if (!fin.good()) return false;
+  contents.assign(std::istreambuf_iterator<char>(fin),
+                  std::istreambuf_iterator<char>());
+  return true;
+}
+
+/**
+ * 64 bit FNV-1a. The cache key has to be stable across runs and
+ * builds, so std and boost hashes are not used.
+ */
+inline uint64_t fnv_hash(const std::string& s,
+                         uint64_t h = 14695981039346656037ULL) {
+  for (size_t i = 0; i < s.length(); ++i) {
+    h ^= (unsigned char)s[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+/**
+ * Lists the files which the compiler reads to build program with
+ * command, from its -M output: the program itself and every header it
+ * includes. Returns false if the preprocessor fails.
+ */
+inline bool plugin_dependencies(const std::string& command,
+                                const std::string& program,
+                                std::vector<std::string>& deps) {
+  const std::string deps_command = command + " -M " + program;
+  FILE* pipe = popen(deps_command.c_str(), "r");
+  if (pipe == NULL) return false;
+  std::string output;
+  char buf[4096];
+  size_t len;
+  while ((len = fread(buf, 1, sizeof(buf), pipe)) > 0) output.append(buf, len);
+  if (pclose(pipe) != 0) return false;
+  // a make rule: "program.o: dep dep \<newline> dep ..."
+  const size_t colon = output.find(':');
+  if (colon == std::string::npos) return false;
+  std::stringstream strm(output.substr(colon + 1));
+  std::string dep;
+  while (strm >> dep) {
+    if (dep != "\\") deps.push_back(dep);
+  }
+  return true;
+}
+
+/**
+ * The definitions this server was built with that change the layout
+ * of the types a plugin shares with it.
+ */
+inline std::string plugin_definitions() {
+  std::string defs;
+#ifdef USE_DYNAMIC_LOCAL_GRAPH
+  defs += " -DUSE_DYNAMIC_LOCAL_GRAPH";
+#endif
+#ifdef USE_VID32
+  defs += " -DUSE_VID32";
+#endif
+#ifdef __NO_OPENMP__
+  defs += " -D__NO_OPENMP__";
+#endif
+  return defs;
+}
+
+
+/**
+ * Compiles the user program into a shared object in cache_dir unless
+ * an object built from the same command and the same contents of the
+ * program and of every header it includes is already there. Returns the path of the object, or an empty string
+ * if the program cannot be read or compiled.
+ */
+inline std::string compile_plugin(const std::string& program,
+                                  const std::string& cache_dir,
+                                  const std::string& cxx,
+                                  const std::string& cxxflags) {
+  const std::string source_dir = GRAPHLAB_DSL_SOURCE_DIR;
+  const std::string include_flags =
+    " -I" + std::string(GRAPHLAB_DSL_DIR) +
+    " -I" + source_dir +
+    " -I" + std::string(GRAPHLAB_DSL_DEPS_DIR);
+  const std::string command = cxx + " " + cxxflags +
+    plugin_definitions() + " -shared -fPIC" + include_flags;
+
+  std::string source;
+  if (!read_file(program, source)) {
+    logstream(LOG_ERROR) << "Cannot read user program " << program
+                         << std::endl;
+    return "";
+  }
+  // any header the plugin includes may change the types it shares with
+  // the server, so the key covers all of them
+  std::vector<std::string> deps;
+  if (!plugin_dependencies(command, program, deps)) {
+    logstream(LOG_ERROR) << "Failed to list the headers of " << program
+                         << std::endl;
+    return "";
+  }
+  uint64_t key = fnv_hash(command);
+  key = fnv_hash(source, key);
+  for (size_t i = 0; i < deps.size(); ++i) {
+    std::string contents;
+    read_file(deps[i], contents);
+    key = fnv_hash(deps[i], key);
+    key = fnv_hash(contents, key);
+  }
+
+  char name[64];
+  sprintf(name, "/plugin_%016llx.so", (unsigned long long)key);
+  const std::string path = cache_dir + name;
+  struct stat st;
+  if (stat(path.c_str(), &st) == 0) {
+    logstream(LOG_INFO) << "Using cached plugin " << path << std::endl;
+    return path;
+  }
+
+  // several processes may share a machine and a cache directory. Each
+  // one builds into its own file and renames it into place, which is
+  // atomic, so a reader never sees a partially written object.
+  mkdir(cache_dir.c_str(), 0755);
+  std::stringstream tmp;
+  tmp << path << "." << getpid() << ".tmp";
+  const std::string build = command + " -o " + tmp.str() + " " + program;
+  logstream(LOG_INFO) << "Compiling plugin: " << build << std::endl;
+  if (system(build.c_str()) != 0) {
+    logstream(LOG_ERROR) << "Failed to compile " << program << std::endl;
+    unlink(tmp.str().c_str());
+    return "";
+  }
+  if (rename(tmp.str().c_str(), path.c_str()) != 0) {
+    logstream(LOG_ERROR) << "Cannot move plugin into " << path << std::endl;
+    unlink(tmp.str().c_str());
+    return "";
+  }
+  return path;
+}
+
+
+/**
+ * Loads a compiled user program and checks that it was built against
+ * the same plugin interface and data types as this server. Returns
+ * NULL, and leaves nothing loaded, if it was not.
+ */
+inline const dsl_plugin* load_plugin(const std::string& path, void*& handle) {
+  handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (handle == NULL) {
+    logstream(LOG_ERROR) << dlerror() << std::endl;
+    return NULL;
+  }
+  typedef const dsl_plugin* (*entry_type)();
+  entry_type entry =
+    reinterpret_cast<entry_type>(dlsym(handle, "graphlab_dsl_plugin"));
+  if (entry == NULL) {
+    logstream(LOG_ERROR) << path << " does not export graphlab_dsl_plugin"
+                         << std::endl;
+    dlclose(handle);
+    handle = NULL;
+    return NULL;
+  }
+  const dsl_plugin* loaded = entry();
+  if (loaded->abi_version != GRAPHLAB_DSL_PLUGIN_ABI ||
+      loaded->vertex_data_size != sizeof(vertex_data_type) ||
+      loaded->edge_data_size != sizeof(edge_data_type) ||
+      loaded->local_graph_size != sizeof(dsl_local_graph) ||
+      loaded->lvid_size != sizeof(graphlab::lvid_type)) {
+    logstream(LOG_ERROR) << path << " was built against a different "
+                         << "plugin interface or graph_typedefs.gen"
+                         << std::endl;
+    dlclose(handle);
+    handle = NULL;
+    return NULL;
+  }
+  return loaded;
+}
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_DSL_PLUGIN_HPP
+#define GRAPHLAB_DSL_PLUGIN_HPP
+
+#include <cassert>
+#include <cstddef>
+#include "graph_typedefs.gen"
+#ifdef USE_DYNAMIC_LOCAL_GRAPH
+#include <graphlab/graph/dynamic_local_graph.hpp>
+#else
+#include <graphlab/graph/local_graph.hpp>
+#endif
+#include <graphlab/macros_def.hpp>
+
+/**
+ * Bumped whenever the layout of dsl_plugin or the calling convention
+ * of its entries changes. gl_server refuses plugins built against a
+ * different version.
+ */
+#define GRAPHLAB_DSL_PLUGIN_ABI 2
+
+/**
+ * The local graph of each machine, as stored by the distributed_graph
+ * of gl_server. The plugin must be compiled with the same
+ * USE_DYNAMIC_LOCAL_GRAPH and USE_VID32 settings as the server.
+ */
+#ifdef USE_DYNAMIC_LOCAL_GRAPH
+typedef graphlab::dynamic_local_graph<vertex_data_type, edge_data_type>
+    dsl_local_graph;
+#else
+typedef graphlab::local_graph<vertex_data_type, edge_data_type>
+    dsl_local_graph;
+#endif
+
+/**
+ * The entry table exported by a compiled user program. The plugin is
+ * built against the same graph_typedefs.gen as gl_server, so the
+ * entries take the concrete vertex data type and no marshalling is
+ * needed across the boundary.
+ *
+ * The plugin contains no engine or RPC code: remote calls are
+ * identified by function address, and a shared object is loaded at a
+ * different address on every machine. The server therefore runs the
+ * communication. The synchronous engine calls gather once per vertex
+ * and machine, and the plugin loops over the local edges itself with
+ * the user's reduce inlined. The other engines gather one edge at a
+ * time and call reduce per combined neighbor. apply is called once
+ * per vertex.
+ */
+struct dsl_plugin {
+  size_t abi_version;
+  size_t vertex_data_size;
+  size_t edge_data_size;
+  size_t local_graph_size;
+  size_t lvid_size;
+  /// The edges reduce_neighbors() runs over
+  graphlab::edge_dir_type gather_edges;
+  /// The edges signal_neighbors() runs over
+  graphlab::edge_dir_type scatter_edges;
+  /// Combines two neighbor values. This is the user's vertex_reduce
+  void (*reduce)(vertex_data_type& a, const vertex_data_type& b);
+  /// Reduces the neighbors of a vertex over its edges in the local
+  /// graph. Returns false if the vertex has no local edges in dir
+  bool (*gather)(dsl_local_graph& graph, graphlab::lvid_type lvid,
+                 graphlab::edge_dir_type dir, vertex_data_type& result);
+  /// Runs the user's update given the reduced neighborhood. Returns
+  /// true if the update signalled its neighbors.
+  bool (*apply)(vertex_data_type& data, const vertex_data_type& neighbors);
+};
+
+/**
+ * The context a user update is instantiated with. Every call is
+ * inline: reduce_neighbors() returns the value the server already
+ * gathered and signal_neighbors() only records the request.
+ */
+class dsl_apply_context {
+ public:
+  dsl_apply_context(vertex_data_type& data,
+                    const vertex_data_type& neighbors,
+                    graphlab::edge_dir_type gather_edges,
+                    graphlab::edge_dir_type scatter_edges)
+    : data(data), neighbors(neighbors), gather_edges(gather_edges),
+      scatter_edges(scatter_edges), signalled(false) { }
+
+  vertex_data_type get_vertex_data() const { return data; }
+
+  void set_vertex_data(const vertex_data_type& value) { data = value; }
+
+  vertex_data_type reduce_neighbors(graphlab::edge_dir_type dir) const {
+    assert(dir == gather_edges);
+    return neighbors;
+  }
+
+  void signal_neighbors(graphlab::edge_dir_type dir) {
+    assert(dir == scatter_edges);
+    signalled = true;
+  }
+
+  bool has_signalled() const { return signalled; }
+
+ private:
+  vertex_data_type& data;
+  const vertex_data_type& neighbors;
+  graphlab::edge_dir_type gather_edges;
+  graphlab::edge_dir_type scatter_edges;
+  bool signalled;
+};
+
+/**
+ * Reduces the data of the neighbors of local vertex lvid over the
+ * edges in dir. Reduce is a template argument so the user's combine
+ * is inlined into the loop.
+ */
+template <void (*Reduce)(vertex_data_type&, const vertex_data_type&)>
+bool dsl_local_gather(dsl_local_graph& graph, graphlab::lvid_type lvid,
+                      graphlab::edge_dir_type dir, vertex_data_type& result) {
+  typedef dsl_local_graph::edge_type edge_type;
+  bool is_set = false;
+  if (dir == graphlab::IN_EDGES || dir == graphlab::ALL_EDGES) {
+    foreach(const edge_type& edge, graph.in_edges(lvid)) {
+      const vertex_data_type& value = graph.vertex_data(edge.source().id());
+      if (is_set) {
+        Reduce(result, value);
+      } else {
+        result = value;
+        is_set = true;
+      }
+    }
+  }
+  if (dir == graphlab::OUT_EDGES || dir == graphlab::ALL_EDGES) {
+    foreach(const edge_type& edge, graph.out_edges(lvid)) {
+      const vertex_data_type& value = graph.vertex_data(edge.target().id());
+      if (is_set) {
+        Reduce(result, value);
+      } else {
+        result = value;
+        is_set = true;
+      }
+    }
+  }
+  return is_set;
+}
+
+/**
+ * Exports a user program from a generated source file. UPDATE is a
+ * function template taking the context by reference and REDUCE an
+ * inline combine function; both are instantiated here so they are
+ * inlined into the exported entries. REDUCE must be a function, not
+ * a macro, since it is also a template argument of the gather loop.
+ *
+ * \code
+ * template <typename Context>
+ * void update(Context& f) { ... f.reduce_neighbors(IN_EDGES) ... }
+ * inline void vertex_reduce(vertex_data_type& a,
+ *                           const vertex_data_type& b) { a += b; }
+ * GRAPHLAB_DSL_PLUGIN(update, vertex_reduce, IN_EDGES, OUT_EDGES)
+ * \endcode
+ */
+#define GRAPHLAB_DSL_PLUGIN(UPDATE, REDUCE, GATHER_EDGES, SCATTER_EDGES)   \
+  static void graphlab_dsl_reduce(vertex_data_type& a,                     \
+                                  const vertex_data_type& b) {             \
+    REDUCE(a, b);                                                          \
+  }                                                                        \
+  static bool graphlab_dsl_apply(vertex_data_type& data,                   \
+                                 const vertex_data_type& neighbors) {      \
+    dsl_apply_context context(data, neighbors,                             \
+                              GATHER_EDGES, SCATTER_EDGES);                \
+    UPDATE(context);                                                       \
+    return context.has_signalled();                                        \
+  }                                                                        \
+  static bool graphlab_dsl_gather(dsl_local_graph& graph,                  \
+                                  graphlab::lvid_type lvid,                \
+                                  graphlab::edge_dir_type dir,             \
+                                  vertex_data_type& result) {              \
+    return dsl_local_gather<REDUCE>(graph, lvid, dir, result);             \
+  }                                                                        \
+  extern "C" const dsl_plugin* graphlab_dsl_plugin() {                     \
+    static const dsl_plugin plugin = {                                     \
+      GRAPHLAB_DSL_PLUGIN_ABI, sizeof(vertex_data_type),                   \
+      sizeof(edge_data_type), sizeof(dsl_local_graph),                     \
+      sizeof(graphlab::lvid_type), GATHER_EDGES, SCATTER_EDGES,            \
+      graphlab_dsl_reduce, graphlab_dsl_gather, graphlab_dsl_apply };      \
+    return &plugin;                                                        \
+  }
+
+#include <graphlab/macros_undef.hpp>
+#endif
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <cxxtest/TestSuite.h>
+
+#include <string>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+
+#include "dsl_loader.hpp"
+
+// a program whose gather takes the maximum of the neighbors
+const char* max_program =
+  "#include \"dsl_plugin.hpp\"\n"
+  "template <typename Context> void update(Context& f) {\n"
+  "  f.set_vertex_data(f.reduce_neighbors(graphlab::ALL_EDGES));\n"
+  "}\n"
+  "inline void vertex_reduce(vertex_data_type& a,\n"
+  "                          const vertex_data_type& b) {\n"
+  "  if (b > a) a = b;\n"
+  "}\n"
+  "GRAPHLAB_DSL_PLUGIN(update, vertex_reduce, graphlab::ALL_EDGES,\n"
+  "                    graphlab::NO_EDGES)\n";
+
+// exports the entry with an interface version the server does not know
+const char* future_abi_program =
+  "#include \"dsl_plugin.hpp\"\n"
+  "extern \"C\" const dsl_plugin* graphlab_dsl_plugin() {\n"
+  "  static dsl_plugin plugin;\n"
+  "  plugin.abi_version = GRAPHLAB_DSL_PLUGIN_ABI + 1;\n"
+  "  return &plugin;\n"
+  "}\n";
+
+// exports the entry but was built for another vertex data type
+const char* wrong_type_program =
+  "#include \"dsl_plugin.hpp\"\n"
+  "extern \"C\" const dsl_plugin* graphlab_dsl_plugin() {\n"
+  "  static dsl_plugin plugin;\n"
+  "  plugin.abi_version = GRAPHLAB_DSL_PLUGIN_ABI;\n"
+  "  plugin.vertex_data_size = sizeof(vertex_data_type) + 1;\n"
+  "  return &plugin;\n"
+  "}\n";
+
+const char* no_entry_program = "extern \"C\" int not_a_plugin() { return 1; }\n";
+
+const char* broken_program = "this is not C++\n";
+
+
+class DslPluginTestSuite: public CxxTest::TestSuite {
+  std::string dir, cache, cxx, cxxflags;
+
+  std::string write_program(const std::string& name, const char* source) {
+    const std::string path = dir + "/" + name;
+    std::ofstream fout(path.c_str());
+    fout << source;
+    return path;
+  }
+
+  std::string compile(const std::string& program) {
+    return compile_plugin(program, cache, cxx, cxxflags);
+  }
+
+  /// Returns the number of files in the cache directory
+  size_t cache_entries() {
+    size_t count = 0;
+    DIR* d = opendir(cache.c_str());
+    if (d == NULL) return 0;
+    while (struct dirent* entry = readdir(d)) {
+      if (entry->d_name[0] != '.') ++count;
+    }
+    closedir(d);
+    return count;
+  }
+
+ public:
+  void setUp() {
+    char templ[] = "/tmp/dsl_plugin_test_XXXXXX";
+    dir = mkdtemp(templ);
+    cache = dir + "/cache";
+    cxx = getenv("CXX") != NULL ? getenv("CXX") : "g++";
+    cxxflags = getenv("CXXFLAGS") != NULL ? getenv("CXXFLAGS") : "-O2";
+  }
+
+  void tearDown() {
+    const std::string command = "rm -rf " + dir;
+    TS_ASSERT_EQUALS(system(command.c_str()), 0);
+  }
+
+  void test_compile_and_gather() {
+    void* handle = NULL;
+    const std::string path = compile(write_program("max.cpp", max_program));
+    TS_ASSERT(path != "");
+    const dsl_plugin* plugin = load_plugin(path, handle);
+    TS_ASSERT(plugin != NULL);
+    if (plugin == NULL) return;
+    TS_ASSERT_EQUALS(plugin->gather_edges, graphlab::ALL_EDGES);
+
+    // 0 -> 1, 2 -> 1, 1 -> 3 and an isolated vertex 4
+    dsl_local_graph graph;
+    graph.resize(5);
+    graph.add_edge(0, 1);
+    graph.add_edge(2, 1);
+    graph.add_edge(1, 3);
+    graph.finalize();
+    for (size_t i = 0; i < 5; ++i) graph.vertex_data(i) = 10 * i;
+
+    vertex_data_type result = 0;
+    TS_ASSERT(plugin->gather(graph, 1, graphlab::IN_EDGES, result));
+    TS_ASSERT_EQUALS(result, 20);
+    TS_ASSERT(plugin->gather(graph, 1, graphlab::OUT_EDGES, result));
+    TS_ASSERT_EQUALS(result, 30);
+    TS_ASSERT(plugin->gather(graph, 1, graphlab::ALL_EDGES, result));
+    TS_ASSERT_EQUALS(result, 30);
+    TS_ASSERT(!plugin->gather(graph, 0, graphlab::IN_EDGES, result));
+    TS_ASSERT(!plugin->gather(graph, 4, graphlab::ALL_EDGES, result));
+
+    vertex_data_type a = 5;
+    plugin->reduce(a, 7);
+    TS_ASSERT_EQUALS(a, 7);
+    vertex_data_type data = 0;
+    TS_ASSERT(!plugin->apply(data, 42));
+    TS_ASSERT_EQUALS(data, 42);
+    dlclose(handle);
+  }
+
+  void test_cache() {
+    const std::string program = write_program("max.cpp", max_program);
+    const std::string path = compile(program);
+    TS_ASSERT(path != "");
+    TS_ASSERT_EQUALS(cache_entries(), 1);
+    // a cache hit does not run the compiler
+    TS_ASSERT_EQUALS(compile_plugin(program, cache, cxx, cxxflags), path);
+    const std::string saved_cxx = cxx;
+    cxx = "false";
+    TS_ASSERT_EQUALS(compile(program), "");
+    cxx = saved_cxx;
+    // a changed program is compiled again
+    std::ofstream(program.c_str(), std::ios::app) << "// changed\n";
+    const std::string changed = compile(program);
+    TS_ASSERT(changed != "");
+    TS_ASSERT(changed != path);
+    TS_ASSERT_EQUALS(cache_entries(), 2);
+  }
+
+  void test_header_change() {
+    // the program includes a header next to it
+    write_program("bound.hpp", "const int BOUND = 1;\n");
+    const std::string program = write_program("bounded.cpp",
+      "#include \"bound.hpp\"\n"
+      "extern \"C\" int bound() { return BOUND; }\n");
+    const std::string path = compile(program);
+    TS_ASSERT(path != "");
+    TS_ASSERT_EQUALS(compile(program), path);
+    // a changed header is compiled again
+    write_program("bound.hpp", "const int BOUND = 2;\n");
+    const std::string changed = compile(program);
+    TS_ASSERT(changed != "");
+    TS_ASSERT(changed != path);
+    TS_ASSERT_EQUALS(cache_entries(), 2);
+  }
+
+  void test_compile_error() {
+    TS_ASSERT_EQUALS(compile(write_program("broken.cpp", broken_program)), "");
+    TS_ASSERT_EQUALS(compile(dir + "/missing.cpp"), "");
+    // no partial object is left behind
+    TS_ASSERT_EQUALS(cache_entries(), 0);
+  }
+
+  void test_dlopen_errors() {
+    void* handle = NULL;
+    const std::string not_object = write_program("not_object.so", "text");
+    TS_ASSERT(load_plugin(not_object, handle) == NULL);
+    TS_ASSERT(handle == NULL);
+    const std::string no_entry =
+      compile(write_program("no_entry.cpp", no_entry_program));
+    TS_ASSERT(no_entry != "");
+    TS_ASSERT(load_plugin(no_entry, handle) == NULL);
+    TS_ASSERT(handle == NULL);
+  }
+
+  void test_abi_mismatch() {
+    void* handle = NULL;
+    const std::string future =
+      compile(write_program("future.cpp", future_abi_program));
+    TS_ASSERT(future != "");
+    TS_ASSERT(load_plugin(future, handle) == NULL);
+    TS_ASSERT(handle == NULL);
+    const std::string wrong_type =
+      compile(write_program("wrong_type.cpp", wrong_type_program));
+    TS_ASSERT(wrong_type != "");
+    TS_ASSERT(load_plugin(wrong_type, handle) == NULL);
+    TS_ASSERT(handle == NULL);
+  }
+};
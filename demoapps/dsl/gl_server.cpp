@@ -23,115 +23,104 @@
 
 #include <vector>
 #include <string>
-#include <fstream>
+#include <sstream>
+#include <cstdlib>
 
-#include <graphlab.hpp>
-#include <graphlab/engine/gl3engine.hpp>
+#include <boost/type_traits/is_same.hpp>
+#include <boost/static_assert.hpp>
 
-#include <dlfcn.h>
+#include <graphlab.hpp>
 
 using namespace graphlab;
 
-#include "graph_typedefs.gen"
-
-#define GET_EDGE_DATA 100
-#define GET_VERTEX_DATA 101
+#include "dsl_loader.hpp"
 
 typedef distributed_graph<vertex_data_type, edge_data_type> graph_type;
-typedef gl3engine<graph_type> engine_type;
-
-
-//here we keep one global copy of the user defined function pointers
-void (*user_program)(user_funs*) = NULL;
-void (*vertex_reduce)(vertex_data_type&,const vertex_data_type&) = NULL;
-void (*edge_reduce)(edge_data_type&,const edge_data_type&) = NULL;
-
-//here are definitions of functions passed to dynamically linked user code
-graph_type::vertex_data_type get_vertex_data(graph_type::vertex_type* v) {
-    return v->data();
-}
-void set_vertex_data(graph_type::vertex_data_type& d, graph_type::vertex_type* v) {
-    v->data() = d;
-}
-
-// graph_type::edge_data_type edge_get_map(graph_type::edge_type& e) {
-//     return e.data();
-// }
-graph_type::vertex_data_type vertex_get_map(const graph_type::vertex_type& v) {
-    return v.data();
-}
-
-// void edge_get_reduce(edge_data_type& ev, const edge_data_type ed) {
-//     edge_reduce(ev,ed);
-// }
-
-void vertex_get_reduce(vertex_data_type& ev, const vertex_data_type ed) {
-    vertex_reduce(ev,ed);
-}
-
-//wonder why this isn't working. hm...
-// void edge_get_reduce(std::vector<graph_type::edge_data_type>& ev, const graph_type::edge_data_type ed) {
-//     ev.push_back(ed);
-// }
-
-// void vertex_get_reduce(std::vector<graph_type::vertex_data_type>& vv, const graph_type::edge_data_type vd) {
-//     vv.push_back(vd);
-// }
-
-// std::vector<edge_data_type> get_neighboring_edges() {
-//     return current_context->map_reduce<std::vector<edge_data_type> >(GET_EDGE_DATA, ALL_EDGES);
-// }
-// std::vector<vertex_data_type> get_neighboring_vertices() {
-//     return current_context->map_reduce<std::vector<vertex_data_type> >(GET_VERTEX_DATA, ALL_EDGES);
-// }
-
-vertex_data_type reduce_neighbors(edge_dir_type d, engine_type::context_type* ctx) {
-    return ctx->map_reduce<vertex_data_type>(GET_VERTEX_DATA, d);
-}
-
-void signal_neighbors(edge_dir_type d, engine_type::context_type* ctx) {
-    ctx->broadcast_signal(d);
-}
-
-// edge_data_type reduce_edges() {
-//     return current_context->map_reduce<edge_data_type>(GET_EDGE_DATA, ALL_EDGES);
-// }
-
-void server_program(engine_type::context_type& context,
-		      graph_type::vertex_type& vertex,
-		      const engine_type::message_type& unused) {
-
-
-
-        //capture functions for user to call
-    user_funs f;
-    f.vtx = &vertex;
-    f.ctx = &context;
-    f._get_vertex_data = (vertex_data_type (*)(void*))get_vertex_data;
-    f._set_vertex_data = (void (*)(vertex_data_type&,void*))set_vertex_data;
-    f._reduce_neighbors = (vertex_data_type (*)(edge_dir_type,void*))reduce_neighbors;
-    f._signal_neighbors = (void (*)(edge_dir_type,void*))signal_neighbors;
-    //f.reduce_edges = reduce_edges;
-
-    //call dynamically linked user function
-    user_program(&f);
-    
-    // float prev = vertex.data();
-    // // map reduce over neighbors
-    // vertex.data() = 0.15 + 0.85 *
-    // 	context.map_reduce<float>(PAGERANK_MAP_REDUCE, IN_EDGES);
-
-    // float last_change = std::fabs((vertex.data()- prev) / vertex.num_out_edges());
-    // if (last_change > TOLERANCE) {
-    // 	// signals out neighbors if I change substantially
-    // 	context.broadcast_signal(OUT_EDGES);
-    // }
-}
+// the plugin gathers directly over the local graph of the server
+BOOST_STATIC_ASSERT((boost::is_same<graph_type::local_graph_type,
+                                    dsl_local_graph>::value));
+
+// the user program currently loaded. Every machine loads its own copy.
+const dsl_plugin* plugin = NULL;
+
+
+/**
+ * The gather type wraps the user's vertex data so that combining two
+ * partial gathers calls the user's vertex_reduce.
+ */
+struct dsl_gather {
+  vertex_data_type value;
+  dsl_gather(): value() { }
+  explicit dsl_gather(const vertex_data_type& value): value(value) { }
+  dsl_gather& operator+=(const dsl_gather& other) {
+    plugin->reduce(value, other.value);
+    return *this;
+  }
+  void save(oarchive& oarc) const { oarc << value; }
+  void load(iarchive& iarc) { iarc >> value; }
+};
+
+
+/**
+ * Runs a compiled user program as an ordinary vertex program. The
+ * synchronous engine hands the whole local gather of a vertex to the
+ * plugin, which reads the neighbor values from the local graph. The
+ * other engines gather per edge and enter the plugin to combine.
+ */
+class dsl_vertex_program :
+  public ivertex_program<graph_type, dsl_gather>,
+  public IS_POD_TYPE {
+  bool signalled;
+public:
+  dsl_vertex_program(): signalled(false) { }
+
+  edge_dir_type gather_edges(icontext_type& context,
+                             const vertex_type& vertex) const {
+    return plugin->gather_edges;
+  }
+
+  bool local_gather(icontext_type& context, const vertex_type& vertex,
+                    edge_dir_type gather_dir, gather_type& accum) const {
+    return plugin->gather(vertex.graph_ref.get_local_graph(),
+                          vertex.local_id(), gather_dir, accum.value);
+  }
 
+  dsl_gather gather(icontext_type& context, const vertex_type& vertex,
+                    edge_type& edge) const {
+    return dsl_gather(edge.source().id() == vertex.id() ?
+                      edge.target().data() : edge.source().data());
+  }
+
+  void apply(icontext_type& context, vertex_type& vertex,
+             const gather_type& total) {
+    signalled = plugin->apply(vertex.data(), total.value);
+  }
+
+  edge_dir_type scatter_edges(icontext_type& context,
+                              const vertex_type& vertex) const {
+    return signalled ? plugin->scatter_edges : NO_EDGES;
+  }
+
+  void scatter(icontext_type& context, const vertex_type& vertex,
+               edge_type& edge) const {
+    context.signal(edge.source().id() == vertex.id() ?
+                   edge.target() : edge.source());
+  }
+}; // end of dsl_vertex_program
 
 
 void init_vertex(graph_type::vertex_type& vertex) { vertex.data() = 1; }
 
+struct vertex_data_writer {
+  std::string save_vertex(graph_type::vertex_type v) {
+    std::stringstream strm;
+    strm << v.id() << "\t" << v.data() << "\n";
+    return strm.str();
+  }
+  std::string save_edge(graph_type::edge_type e) { return ""; }
+}; // end of vertex_data_writer
+
+
 int main(int argc, char** argv) {
 
   // Initialize control plain using mpi
@@ -140,10 +129,14 @@ int main(int argc, char** argv) {
   global_logger().set_log_level(LOG_INFO);
 
   // Parse command line options -----------------------------------------------
-  graphlab::command_line_options clopts("PageRank algorithm.");
+  graphlab::command_line_options clopts("Run a compiled DSL user program.");
   std::string graph_dir;
   std::string format = "adj";
   std::string exec_type = "synchronous";
+  std::string program = std::string(GRAPHLAB_DSL_DIR) + "/gen_impl.cpp";
+  std::string cache_dir = "dsl_cache";
+  std::string cxx = getenv("CXX") != NULL ? getenv("CXX") : "g++";
+  std::string cxxflags = "-O3";
   clopts.attach_option("graph", graph_dir,
                        "The graph file. Required ");
   clopts.add_positional("graph");
@@ -151,14 +144,20 @@ int main(int argc, char** argv) {
                        "The graph file format");
   clopts.attach_option("engine", exec_type, 
                        "The engine type synchronous or asynchronous");
-  //clopts.attach_option("tol", TOLERANCE,
-  //                     "The permissible change at convergence.");
+  clopts.attach_option("program", program,
+                       "The generated user program to compile and run");
+  clopts.attach_option("cache", cache_dir,
+                       "Directory of compiled user programs. A program is "
+                       "only recompiled when its source or the compiler "
+                       "command changes.");
+  clopts.attach_option("cxx", cxx,
+                       "The compiler used to build user programs");
+  clopts.attach_option("cxxflags", cxxflags,
+                       "Flags used to build user programs");
   std::string saveprefix;
   clopts.attach_option("saveprefix", saveprefix,
-                       "If set, will save the resultant pagerank to a "
+                       "If set, will save the resultant vertex data to a "
                        "sequence of files with prefix saveprefix");
-  //set single threaded
-  //clopts.set_ncpus(1);
   if(!clopts.parse(argc, argv)) {
     dc.cout() << "Error in parsing command line arguments." << std::endl;
     return EXIT_FAILURE;
@@ -169,26 +168,18 @@ int main(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
-
-  // Dynamically link the functions
-  dc.cout() << "Starting dynamic linking" << std::endl;
-  void* handle = dlopen("/home/emullen/graphlab/graphlab2.2/graphlabapi/debug/demoapps/dsl/libgen_impl.so", RTLD_LAZY);
-  if (handle == NULL) {
-      dc.cout() << dlerror() << std::endl;
-      assert(handle != NULL);
+  // Compile and load the user program ----------------------------------------
+  // every machine compiles and loads its own copy since the cache
+  // directory need not be shared.
+  void* handle = NULL;
+  const std::string plugin_path =
+    compile_plugin(program, cache_dir, cxx, cxxflags);
+  if (plugin_path != "") plugin = load_plugin(plugin_path, handle);
+  if (plugin == NULL) {
+    logstream(LOG_FATAL) << "Cannot load user program " << program
+                         << std::endl;
   }
-
-  // pagerank_map = (float (*)(const graphlab::distributed_graph<float, graphlab::empty>::vertex_type&))dlsym(pagerank_handle, "pagerank_map");
-  // assert(pagerank_map != NULL);
-  // pagerank_combine = (void (*)(float&, const float&))dlsym(pagerank_handle, "pagerank_combine");
-  // assert(pagerank_combine != NULL);
-  user_program = (void (*)(user_funs*))dlsym(handle, "user_program");
-  assert(user_program != NULL);
-  vertex_reduce = (void (*)(vertex_data_type&,const vertex_data_type&))dlsym(handle, "vertex_reduce");
-  assert(vertex_reduce != NULL);
-  // edge_reduce = (void (*)(edge_data_type&,const edge_data_type&))dlsym(handle, "edge_reduce");
-  // assert(edge_reduce != NULL);
-  dc.cout() << "Finished dynamic linking" << std::endl;
+  dc.cout() << "Loaded user program " << program << std::endl;
 
   // Build the graph ----------------------------------------------------------
   graph_type graph(dc, clopts);
@@ -202,33 +193,23 @@ int main(int argc, char** argv) {
   // Initialize the vertex data
   graph.transform_vertices(init_vertex);
 
-    // Running The Engine -------------------------------------------------------
-  engine_type engine(dc, graph, clopts);
-
-  // register the map reduce operation before usage
-  // Each task registration must have a distinct ID ranging fro 0 to 223
-  //engine.register_map_reduce(PAGERANK_MAP_REDUCE,
-  //                           pagerank_map,
-  //                           pagerank_combine);
-  // engine.register_map_reduce(GET_EDGE_DATA,
-  // 			     edge_get_map,
-  // 			     edge_get_reduce);
-  engine.register_map_reduce(GET_VERTEX_DATA,
-			     vertex_get_map,
-			     vertex_get_reduce);
-
-  engine.set_vertex_program(server_program);
+  // Running The Engine -------------------------------------------------------
+  omni_engine<dsl_vertex_program> engine(dc, graph, exec_type, clopts);
   engine.signal_all();
-  engine.wait();
-  
+  engine.start();
+  const double runtime = engine.elapsed_seconds();
+  dc.cout() << "Finished Running engine in " << runtime
+            << " seconds." << std::endl;
+
   // Save the final graph -----------------------------------------------------
-  // if (saveprefix != "") {
-  //   graph.save(saveprefix, pagerank_writer(),
-  //              false,    // do not gzip
-  //              true,     // save vertices
-  //              false);   // do not save edges
-  // }
+  if (saveprefix != "") {
+    graph.save(saveprefix, vertex_data_writer(),
+               false,    // do not gzip
+               true,     // save vertices
+               false);   // do not save edges
+  }
 
+  plugin = NULL;
   dlclose(handle);
 
   // Tear-down communication layer and quit -----------------------------------
@@ -44,6 +44,7 @@
 
 #include <graphlab/util/tracepoint.hpp>
 #include <graphlab/util/memory_info.hpp>
+#include <graphlab/util/first_touch_array.hpp>
 #include <graphlab/util/generics/conditional_addition_wrapper.hpp>
 #include <graphlab/rpc/distributed_event_log.hpp>
 #include <graphlab/parallel/fiber_group.hpp>
@@ -329,7 +330,7 @@ namespace graphlab {
     distributed_chandy_misra<graph_type>* cmlocks;
 
     /// Per vertex data locks
-    std::vector<simple_spinlock> vertexlocks;
+    first_touch_array<simple_spinlock> vertexlocks;
 
     /// Total update function completion time
     std::vector<double> total_completion_time;
@@ -341,7 +342,7 @@ namespace graphlab {
      * Caching is done locally and therefore a high-degree vertex may
      * have multiple caches (one per machine).
      */
-    std::vector<gather_type>  gather_cache;
+    first_touch_array<gather_type>  gather_cache;
 
     /**
      * \brief A bit indicating if the local gather for that vertex is
@@ -383,7 +384,7 @@ namespace graphlab {
       bool philosopher_ready;
       size_t fiber_handle;
     };
-    std::vector<vertex_fiber_cm_handle*> cm_handles;
+    first_touch_array<vertex_fiber_cm_handle*> cm_handles;
 
     dense_bitset program_running;
     dense_bitset hasnext;
@@ -391,6 +392,12 @@ namespace graphlab {
     // Various counters.
     atomic<uint64_t> programs_executed;
 
+    DECLARE_EVENT(EVENT_UPDATES);
+    DECLARE_EVENT(EVENT_PENDING_VERTICES);
+    DECLARE_EVENT(EVENT_ACTIVE_FIBERS);
+    DECLARE_EVENT(EVENT_LOCK_WAIT);
+    DECLARE_EVENT(EVENT_UPDATE_LATENCY);
+
     timer launch_timer;
 
     /// Defaults to (-1), defines a timeout
@@ -414,6 +421,10 @@ namespace graphlab {
 
     std::vector<mutex> aggregation_lock;
     std::vector<std::deque<std::string> > aggregation_queue;
+
+    /// The memory of the engine reported to memory_info
+    memory_info::tracked_bytes state_bytes;
+    memory_info::tracked_bytes cache_bytes;
   public:
 
     /**
@@ -440,7 +451,10 @@ namespace graphlab {
                             const graphlab_options& opts = graphlab_options()) :
         rmi(dc, this), graph(graph), scheduler_ptr(NULL),
         aggregator(dc, graph, new context_type(*this, graph)), started(false),
-        engine_start_time(timer::approx_time_seconds()), force_stop(false) {
+        engine_start_time(timer::approx_time_seconds()), force_stop(false),
+        state_bytes(memory_info::ENGINE_STATE),
+        cache_bytes(memory_info::GATHER_CACHE) {
+      graphlab::timer ti; ti.start();
       rmi.barrier();
 
       nfibers = 10000;
@@ -451,10 +465,17 @@ namespace graphlab {
       timed_termination = (size_t)(-1);
       termination_reason = execution_status::UNSET;
       set_options(opts);
-      init();
+      INITIALIZE_EVENT_LOG(dc);
+      ADD_CUMULATIVE_EVENT(EVENT_UPDATES, "Updates", "Updates");
+      ADD_INSTANTANEOUS_EVENT(EVENT_PENDING_VERTICES, "Pending Vertices", "Vertices");
+      ADD_INSTANTANEOUS_EVENT(EVENT_ACTIVE_FIBERS, "Active Fibers", "Fibers");
+      ADD_HISTOGRAM_EVENT(EVENT_LOCK_WAIT, "Lock Wait", "us");
+      ADD_HISTOGRAM_EVENT(EVENT_UPDATE_LATENCY, "Update Latency", "us");
       total_completion_time.resize(fiber_control::get_instance().num_workers());
       init();
       rmi.barrier();
+      logstream(LOG_INFO) << rmi.procid() << ": Engine constructed in "
+                          << ti.current_time() << " seconds" << std::endl;
     }
 
   private:
@@ -553,6 +574,16 @@ namespace graphlab {
       if (!factorized_consistency) {
         cm_handles.resize(graph.num_local_vertices());
       }
+      const size_t nverts = graph.num_local_vertices();
+      // the message boxes, locks, lock handles and 2 bitsets
+      state_bytes.set(sizeof(messages)
+                      + nverts * (sizeof(message_type) + sizeof(bool)
+                                  + sizeof(simple_spinlock))
+                      + cm_handles.size() * sizeof(vertex_fiber_cm_handle*)
+                      + 2 * (nverts / 8));
+      cache_bytes.set(gather_cache.size() * sizeof(gather_type)
+                      + (gather_cache.empty() ? 0 : nverts / 8));
+      memory_info::log_tagged_usage("After Engine Initialization");
       rmi.barrier();
     }
 
@@ -595,6 +626,18 @@ namespace graphlab {
 
   private:
 
+    /**
+     * \internal
+     * Adds a message to a vertex, counting the vertex as pending if it
+     * did not have a message.
+     */
+    void add_message(const lvid_type lvid, const message_type& message,
+                     double* priority = NULL) {
+      if (messages.add(lvid, message, priority)) {
+        INCREMENT_EVENT(EVENT_PENDING_VERTICES, 1);
+      }
+    }
+
     /**
      * \internal
      * This is used to receive a message forwarded from another machine
@@ -604,7 +647,7 @@ namespace graphlab {
       if (force_stop) return;
       const lvid_type local_vid = graph.local_vid(vid);
       double priority;
-      messages.add(local_vid, message, &priority);
+      add_message(local_vid, message, &priority);
       scheduler_ptr->schedule(local_vid, priority);
       consensus->cancel();
     }
@@ -620,17 +663,16 @@ namespace graphlab {
                          const message_type& message = message_type()) {
       if (force_stop) return;
       if (started) {
-        const typename graph_type::vertex_record& rec = graph.l_get_vertex_record(vtx.local_id());
-        const procid_t owner = rec.owner;
+        const procid_t owner = graph.l_master(vtx.local_id());
         if (endgame_mode) {
           // fast signal. push to the remote machine immediately
           if (owner != rmi.procid()) {
-            const vertex_id_type vid = rec.gvid;
+            const vertex_id_type vid = vtx.id();
             rmi.remote_call(owner, &engine_type::rpc_signal, vid, message);
           }
           else {
             double priority;
-            messages.add(vtx.local_id(), message, &priority);
+            add_message(vtx.local_id(), message, &priority);
             scheduler_ptr->schedule(vtx.local_id(), priority);
             consensus->cancel();
           }
@@ -638,14 +680,14 @@ namespace graphlab {
         else {
 
           double priority;
-          messages.add(vtx.local_id(), message, &priority);
+          add_message(vtx.local_id(), message, &priority);
           scheduler_ptr->schedule(vtx.local_id(), priority);
           consensus->cancel();
         }
       }
       else {
         double priority;
-        messages.add(vtx.local_id(), message, &priority);
+        add_message(vtx.local_id(), message, &priority);
         scheduler_ptr->schedule(vtx.local_id(), priority);
         consensus->cancel();
       }
@@ -775,7 +817,7 @@ namespace graphlab {
       }
       foreach(lvid_type lvid, vtxs) {
         double priority;
-        messages.add(lvid, message, &priority);
+        add_message(lvid, message, &priority);
         scheduler_ptr->schedule(lvid, priority);
       }
       rmi.barrier();
@@ -794,7 +836,10 @@ namespace graphlab {
         sched_status::status_enum stat = 
             scheduler_ptr->get_next(threadid % ncpus, lvid);
         if (stat == sched_status::NEW_TASK) {
-          if (messages.get(lvid, msg)) return stat;
+          if (messages.get(lvid, msg)) {
+            DECREMENT_EVENT(EVENT_PENDING_VERTICES, 1);
+            return stat;
+          }
           else continue;
         }
         return stat;
@@ -975,7 +1020,7 @@ namespace graphlab {
       if (someone_else_running) {
         // bad. someone else is here.
         // drop it into the message array
-        messages.add(lvid, msg);
+        add_message(lvid, msg);
         hasnext.set_bit(lvid);
       } 
       vertexlocks[lvid].unlock();
@@ -1009,8 +1054,7 @@ namespace graphlab {
      */
     void eval_sched_task(const lvid_type lvid,
                          const message_type& msg) {
-      const typename graph_type::vertex_record& rec = graph.l_get_vertex_record(lvid);
-      vertex_id_type vid = rec.gvid;
+      vertex_id_type vid = graph.global_vid(lvid);
       char task_time_data[sizeof(timer)];
       timer* task_time;
       if (track_task_time) {
@@ -1019,14 +1063,19 @@ namespace graphlab {
         new (task_time) timer();
       }
       // if this is another machine's forward it
-      if (rec.owner != rmi.procid()) {
-        rmi.remote_call(rec.owner, &engine_type::rpc_signal, vid, msg);
+      const procid_t owner = graph.l_master(lvid);
+      if (owner != rmi.procid()) {
+        rmi.remote_call(owner, &engine_type::rpc_signal, vid, msg);
         return;
       }
       // I have to run this myself
       
       if (!get_exclusive_access_to_vertex(lvid, msg)) return;
 
+      // the clock is only read when someone is looking at the histograms
+      const bool sample_times = EVENT_LOG_SAMPLING();
+      const size_t start_usec = sample_times ? timer::usec_of_day() : 0;
+
       /**************************************************************************/
       /*                             Acquire Locks                              */
       /**************************************************************************/
@@ -1042,6 +1091,11 @@ namespace graphlab {
           cm_handles[lvid]->lock.lock();
         }
         cm_handles[lvid]->lock.unlock();
+        if (sample_times) {
+          const size_t now = timer::usec_of_day();
+          // usec_of_day wraps at midnight
+          if (now >= start_usec) HISTOGRAM_EVENT(EVENT_LOCK_WAIT, now - start_usec);
+        }
       }
 
       /**************************************************************************/
@@ -1127,6 +1181,11 @@ namespace graphlab {
             task_time->current_time();
         task_time->~timer();
       }
+      if (sample_times) {
+        const size_t now = timer::usec_of_day();
+        if (now >= start_usec) HISTOGRAM_EVENT(EVENT_UPDATE_LATENCY, now - start_usec);
+      }
+      INCREMENT_EVENT(EVENT_UPDATES, 1);
       programs_executed.inc(); 
     }
 
@@ -1143,6 +1202,7 @@ namespace graphlab {
       message_type msg;
       float last_aggregator_check = timer::approx_time_seconds();
       timer ti; ti.start();
+      INCREMENT_EVENT(EVENT_ACTIVE_FIBERS, 1);
       while(1) {
         if (timer::approx_time_seconds() != last_aggregator_check && !endgame_mode) {
           last_aggregator_check = timer::approx_time_seconds();
@@ -1190,6 +1250,7 @@ namespace graphlab {
           fiber_control::yield();
         }
       }
+      DECREMENT_EVENT(EVENT_ACTIVE_FIBERS, 1);
     } // end of thread start
 
 /**************************************************************************
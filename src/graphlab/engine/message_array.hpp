@@ -28,6 +28,7 @@
 #include <vector>
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/parallel/atomic.hpp>
+#include <graphlab/util/first_touch_array.hpp>
 #include <graphlab/scheduler/get_message_priority.hpp>
 namespace graphlab {
 
@@ -67,7 +68,7 @@ namespace graphlab {
       
     }; 
 
-    std::vector<message_box> message_vector;
+    first_touch_array<message_box> message_vector;
     // lock array
     simple_spinlock lock_array[65536];
     size_t joincounter[65536];
@@ -81,8 +82,8 @@ namespace graphlab {
     }
   public:
     /** Initialize the per vertex task set */
-    message_array(size_t num_vertices = 0) :
-              message_vector(num_vertices) { 
+    message_array(size_t num_vertices = 0) {
+      message_vector.resize(num_vertices);
       for (size_t i = 0; i < 65536; ++i) {
         joincounter[i] = 0; 
         addcounter[i] = 0;
@@ -0,0 +1,374 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_STOCHASTIC_DIFFUSION_HPP
+#define GRAPHLAB_STOCHASTIC_DIFFUSION_HPP
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <algorithm>
+
+#include <graphlab/graph/distributed_graph.hpp>
+#include <graphlab/engine/omni_engine.hpp>
+#include <graphlab/util/random.hpp>
+
+namespace graphlab {
+
+/**
+ * \brief Monte-Carlo simulation of the independent cascade and linear
+ * threshold diffusion models (Kempe, Kleinberg and Tardos, 2003).
+ *
+ * A run starts with a set of seed vertices active. In the independent
+ * cascade model a newly active vertex gets one chance to activate
+ * each out neighbor, with the probability given by the weight of the
+ * edge. In the linear threshold model a vertex becomes active when the
+ * weights of its active in neighbors pass a uniformly random
+ * threshold. The linear threshold model is simulated in its
+ * equivalent live edge form: each vertex picks at most one of its in
+ * edges, edge e with probability weight(e) (weights summing past 1 are
+ * normalized), and becomes active when the source of the picked edge
+ * does.
+ *
+ * Only the frontier of newly active vertices runs, pushing activation
+ * attempts along its out edges, so a step costs the out edges of the
+ * frontier rather than all the edges of the graph. 64 independent
+ * runs are batched in the bits of a word: the vertex state is the
+ * mask of the runs in which the vertex is active, a message is the
+ * mask of the runs in which an edge fired, and one engine execution
+ * advances all 64 runs. Every random draw is a counter based function
+ * of the seed, the edge and the run, so the results do not depend on
+ * the engine, the number of machines or the scheduling.
+ *
+ * \code
+ * typedef diffusion::simulator<diffusion::INDEPENDENT_CASCADE> ic;
+ * ic::graph_type graph(dc, clopts);
+ * ... load the graph with diffusion::edge_data(probability) edges ...
+ * graph.finalize();
+ * vertex_set seeds = graph.select(is_seed);
+ * double spread = ic::simulate(dc, graph, seeds, 10000, 1);
+ * \endcode
+ *
+ * After simulate() the activations field of every vertex counts the
+ * runs in which it was active.
+ */
+namespace diffusion {
+
+  /// The diffusion models
+  enum model_type { INDEPENDENT_CASCADE, LINEAR_THRESHOLD };
+
+  /// One bit per simulated run
+  typedef uint64_t run_mask;
+
+  /// The number of runs advanced by one engine execution
+  const size_t RUNS_PER_BATCH = 64;
+
+  /**
+   * The vertex data of the independent cascade model.
+   */
+  template <model_type Model>
+  struct vertex_data : public IS_POD_TYPE {
+    /// The runs of the current batch in which the vertex is active
+    run_mask active;
+    /// The number of runs in which the vertex was active
+    uint32_t activations;
+    vertex_data() : active(0), activations(0) { }
+  };
+
+  /**
+   * The vertex data of the linear threshold model, which also holds
+   * the clock of the in edge picked in each run of the batch.
+   */
+  template <>
+  struct vertex_data<LINEAR_THRESHOLD> : public IS_POD_TYPE {
+    run_mask active;
+    uint32_t activations;
+    /// The clock of the picked in edge of each run, or -1 if none
+    float live_clock[RUNS_PER_BATCH];
+    vertex_data() : active(0), activations(0) {
+      std::fill(live_clock, live_clock + RUNS_PER_BATCH, -1);
+    }
+  };
+
+  /**
+   * The live edge clocks of a vertex, NULL for the models without them
+   */
+  inline float* live_clocks(vertex_data<INDEPENDENT_CASCADE>& vdata) {
+    return NULL;
+  }
+  inline const float*
+  live_clocks(const vertex_data<INDEPENDENT_CASCADE>& vdata) {
+    return NULL;
+  }
+  inline float* live_clocks(vertex_data<LINEAR_THRESHOLD>& vdata) {
+    return vdata.live_clock;
+  }
+  inline const float* live_clocks(const vertex_data<LINEAR_THRESHOLD>& vdata) {
+    return vdata.live_clock;
+  }
+
+  /**
+   * The edge data: the activation probability of the edge in the
+   * independent cascade model, and its weight in the linear threshold
+   * model.
+   */
+  struct edge_data : public IS_POD_TYPE {
+    float weight;
+    edge_data(float weight = 0) : weight(weight) { }
+  };
+
+  /// The message of a set of runs, combined by union
+  struct run_message : public IS_POD_TYPE {
+    run_mask runs;
+    run_message(run_mask runs = 0) : runs(runs) { }
+    run_message& operator+=(const run_message& other) {
+      runs |= other.runs;
+      return *this;
+    }
+  };
+
+  /// For each in edge and run, the smallest edge clock, and the weights
+  struct clock_gather : public IS_POD_TYPE {
+    float weight;
+    float clock[RUNS_PER_BATCH];
+    clock_gather() : weight(0) {
+      std::fill(clock, clock + RUNS_PER_BATCH,
+                std::numeric_limits<float>::infinity());
+    }
+    clock_gather& operator+=(const clock_gather& other) {
+      weight += other.weight;
+      for (size_t i = 0; i < RUNS_PER_BATCH; ++i) {
+        clock[i] = std::min(clock[i], other.clock[i]);
+      }
+      return *this;
+    }
+  };
+
+
+  /**
+   * Simulates a diffusion model on a graph of vertex_data<Model> and
+   * edge_data.
+   */
+  template <model_type Model>
+  class simulator {
+  public:
+    typedef distributed_graph<vertex_data<Model>, edge_data> graph_type;
+    typedef typename graph_type::vertex_type vertex_type;
+    typedef typename graph_type::edge_type edge_type;
+
+    /**
+     * Pushes the newly active runs of a vertex along its out edges.
+     */
+    class vertex_program :
+      public ivertex_program<graph_type, empty, run_message>,
+      public IS_POD_TYPE {
+      run_mask frontier;
+    public:
+      typedef ivertex_program<graph_type, empty, run_message> base;
+      typedef typename base::icontext_type icontext_type;
+      typedef typename base::edge_dir_type edge_dir_type;
+
+      void init(icontext_type& context, const vertex_type& vertex,
+                const run_message& msg) {
+        frontier = msg.runs;
+      }
+      edge_dir_type gather_edges(icontext_type& context,
+                                 const vertex_type& vertex) const {
+        return NO_EDGES;
+      }
+      void apply(icontext_type& context, vertex_type& vertex,
+                 const empty& empty) {
+        frontier &= ~vertex.data().active;
+        vertex.data().active |= frontier;
+      }
+      edge_dir_type scatter_edges(icontext_type& context,
+                                  const vertex_type& vertex) const {
+        return frontier ? OUT_EDGES : NO_EDGES;
+      }
+      void scatter(icontext_type& context, const vertex_type& vertex,
+                   edge_type& edge) const {
+        // the target replica may lag, which only costs extra draws
+        run_mask candidates = frontier & ~edge.target().data().active;
+        run_mask fired = 0;
+        while (candidates) {
+          const size_t run = __builtin_ctzll(candidates);
+          candidates &= candidates - 1;
+          if (edge_fires(edge, run)) fired |= run_mask(1) << run;
+        }
+        if (fired) context.signal(edge.target(), run_message(fired));
+      }
+    };
+
+    /**
+     * Picks the live in edge of each run of the batch for the linear
+     * threshold model: every in edge draws an exponential clock of rate
+     * equal to its weight, the vertex draws one of rate 1 - the total
+     * weight for picking no edge, and the earliest clock wins.
+     */
+    class clock_program :
+      public ivertex_program<graph_type, clock_gather>,
+      public IS_POD_TYPE {
+    public:
+      typedef ivertex_program<graph_type, clock_gather> base;
+      typedef typename base::icontext_type icontext_type;
+      typedef typename base::edge_dir_type edge_dir_type;
+
+      edge_dir_type gather_edges(icontext_type& context,
+                                 const vertex_type& vertex) const {
+        return IN_EDGES;
+      }
+      clock_gather gather(icontext_type& context, const vertex_type& vertex,
+                          edge_type& edge) const {
+        clock_gather ret;
+        ret.weight = edge.data().weight;
+        for (size_t run = 0; run < RUNS_PER_BATCH; ++run) {
+          ret.clock[run] = edge_clock(edge, run);
+        }
+        return ret;
+      }
+      void apply(icontext_type& context, vertex_type& vertex,
+                 const clock_gather& total) {
+        const double none_rate = std::max(0.0, 1.0 - total.weight);
+        for (size_t run = 0; run < RUNS_PER_BATCH; ++run) {
+          const double none_clock = none_rate > 0 ?
+            exponential(draw(vertex.id(), 0, run, NONE_KEY), none_rate) :
+            std::numeric_limits<double>::infinity();
+          live_clocks(vertex.data())[run] =
+            total.clock[run] < none_clock ? total.clock[run] : -1;
+        }
+      }
+      edge_dir_type scatter_edges(icontext_type& context,
+                                  const vertex_type& vertex) const {
+        return NO_EDGES;
+      }
+    };
+
+    /**
+     * Simulates the given number of runs from the seed vertices, and
+     * returns the average number of active vertices at the end of a
+     * run. The activations of the vertices are reset first. Must be
+     * called on all machines simultaneously.
+     *
+     * \param seeds The vertices active at the start of every run
+     * \param runs The number of runs, simulated in batches of 64
+     * \param seed The seed of the random draws
+     * \param exec_type The engine used: synchronous or asynchronous
+     * \param opts The options of the engine
+     */
+    static double simulate(distributed_control& dc, graph_type& graph,
+                           const vertex_set& seeds, size_t runs,
+                           uint64_t seed,
+                           const std::string& exec_type = "synchronous",
+                           const graphlab_options& opts = graphlab_options()) {
+      random_seed() = seed;
+      graph.transform_vertices(reset_activations);
+      omni_engine<vertex_program> engine(dc, graph, exec_type, opts);
+      omni_engine<clock_program>* clock_engine = NULL;
+      if (Model == LINEAR_THRESHOLD) {
+        clock_engine = new omni_engine<clock_program>(dc, graph, exec_type,
+                                                      opts);
+      }
+      size_t total = 0;
+      for (size_t first = 0; first < runs; first += RUNS_PER_BATCH) {
+        batch() = first / RUNS_PER_BATCH;
+        const size_t nruns = std::min(RUNS_PER_BATCH, runs - first);
+        const run_mask mask = nruns == RUNS_PER_BATCH ?
+          ~run_mask(0) : (run_mask(1) << nruns) - 1;
+        graph.transform_vertices(clear_active);
+        if (clock_engine != NULL) {
+          clock_engine->signal_all();
+          clock_engine->start();
+        }
+        engine.signal_vset(seeds, run_message(mask));
+        engine.start();
+        graph.transform_vertices(count_activations);
+        total += graph.template map_reduce_vertices<size_t>(active_runs);
+      }
+      delete clock_engine;
+      return runs > 0 ? double(total) / runs : 0;
+    } // end of simulate
+
+  private:
+    enum { EDGE_KEY = 0, NONE_KEY = 1 };
+
+    // The seed and the batch of the current simulation
+    static uint64_t& random_seed() {
+      static uint64_t value = 0;
+      return value;
+    }
+    static size_t& batch() {
+      static size_t value = 0;
+      return value;
+    }
+
+    /// The draw of a run of the batch for an edge or a vertex
+    static uint32_t draw(uint64_t a, uint64_t b, size_t run, uint64_t key) {
+      random::counter_generator rng(random_seed() * 2 + key,
+                                    (a << 32) ^ b,
+                                    batch() * RUNS_PER_BATCH + run);
+      return rng.next_uint32();
+    }
+
+    /// An exponential variable of the given rate from a 32 bit draw
+    static double exponential(uint32_t bits, double rate) {
+      return -std::log((bits + 0.5) / 4294967296.0) / rate;
+    }
+
+    /// The clock of an edge in the linear threshold model
+    static float edge_clock(const edge_type& edge, size_t run) {
+      const float weight = edge.data().weight;
+      if (weight <= 0) return std::numeric_limits<float>::infinity();
+      return exponential(draw(edge.source().id(), edge.target().id(), run,
+                              EDGE_KEY), weight);
+    }
+
+    /// Whether an edge activates its target in a run
+    static bool edge_fires(const edge_type& edge, size_t run) {
+      if (Model == INDEPENDENT_CASCADE) {
+        const double bits = draw(edge.source().id(), edge.target().id(), run,
+                                 EDGE_KEY);
+        return bits < edge.data().weight * 4294967296.0;
+      }
+      // the picked in edge of the target has the same clock
+      const float clock = edge_clock(edge, run);
+      return clock == live_clocks(edge.target().data())[run];
+    }
+
+    static void reset_activations(vertex_type& vertex) {
+      vertex.data().activations = 0;
+    }
+    static void clear_active(vertex_type& vertex) {
+      vertex.data().active = 0;
+    }
+    static void count_activations(vertex_type& vertex) {
+      vertex.data().activations += __builtin_popcountll(vertex.data().active);
+    }
+    static size_t active_runs(const vertex_type& vertex) {
+      return __builtin_popcountll(vertex.data().active);
+    }
+  }; // end of class simulator
+
+} // end of namespace diffusion
+} // end of namespace graphlab
+
+#endif
@@ -44,6 +44,8 @@
 #include <graphlab/parallel/fiber_barrier.hpp>
 #include <graphlab/util/tracepoint.hpp>
 #include <graphlab/util/memory_info.hpp>
+#include <graphlab/util/first_touch_array.hpp>
+#include <graphlab/util/out_of_core.hpp>
 
 #include <graphlab/rpc/dc_dist_object.hpp>
 #include <graphlab/rpc/distributed_event_log.hpp>
@@ -415,7 +417,7 @@ namespace graphlab {
      * \ref graphlab::synchronous_engine::gather_accum
      * and \ref graphlab::synchronous_engine::messages.
      */
-    std::vector<simple_spinlock> vlocks;
+    first_touch_array<simple_spinlock> vlocks;
 
 
     /**
@@ -433,12 +435,12 @@ namespace graphlab {
      * \brief The vertex programs associated with each vertex on this
      * machine.
      */
-    std::vector<vertex_program_type> vertex_programs;
+    first_touch_array<vertex_program_type> vertex_programs;
 
     /**
      * \brief Vector of messages associated with each vertex.
      */
-    std::vector<message_type> messages;
+    first_touch_array<message_type> messages;
 
     /**
      * \brief Bit indicating whether a message is present for each vertex.
@@ -455,7 +457,7 @@ namespace graphlab {
      * once and therefore must be guarded by a vertex locks in
      * \ref graphlab::synchronous_engine::vlocks
      */
-    std::vector<gather_type>  gather_accum;
+    first_touch_array<gather_type>  gather_accum;
 
     /**
      * \brief Bit indicating if the gather has accumulator contains any
@@ -477,7 +479,7 @@ namespace graphlab {
      * Caching is done locally and therefore a high-degree vertex may
      * have multiple caches (one per machine).
      */
-    std::vector<gather_type>  gather_cache;
+    first_touch_array<gather_type>  gather_cache;
 
     /**
      * \brief A bit indicating if the local gather for that vertex is
@@ -497,6 +499,12 @@ namespace graphlab {
      */
     atomic<size_t> num_active_vertices;
 
+    /**
+     * \brief The local active vertices last added to the
+     * EVENT_ACTIVE_VERTICES event.
+     */
+    size_t reported_active_vertices;
+
     /**
      * \brief A bit indicating (for all vertices) whether to
      * participate in the current minor-step (gather or scatter).
@@ -515,6 +523,19 @@ namespace graphlab {
      */
     atomic<size_t> shared_lvid_counter;
 
+    /**
+     * \brief The number of local vertices whose edges are read ahead
+     * together when the local graph is out of core. Zero when the
+     * edges are in memory.
+     */
+    size_t stream_window;
+
+    /**
+     * \brief True if the edges of finished windows are released to
+     * stay within the out of core memory budget.
+     */
+    bool stream_release;
+
 
     /**
      * \brief The pair type used to synchronize vertex programs across machines.
@@ -587,10 +608,22 @@ namespace graphlab {
      */
     aggregator_type aggregator;
 
+    /** The memory of the engine reported to memory_info */
+    memory_info::tracked_bytes state_bytes;
+    memory_info::tracked_bytes cache_bytes;
+
     DECLARE_EVENT(EVENT_APPLIES);
     DECLARE_EVENT(EVENT_GATHERS);
     DECLARE_EVENT(EVENT_SCATTERS);
     DECLARE_EVENT(EVENT_ACTIVE_CPUS);
+    DECLARE_EVENT(EVENT_ACTIVE_VERTICES);
+    DECLARE_EVENT(EVENT_EXCHANGE_TIME);
+    DECLARE_EVENT(EVENT_RECEIVE_TIME);
+    DECLARE_EVENT(EVENT_GATHER_TIME);
+    DECLARE_EVENT(EVENT_APPLY_TIME);
+    DECLARE_EVENT(EVENT_SCATTER_TIME);
+    DECLARE_EVENT(EVENT_GATHER_EDGES);
+    DECLARE_EVENT(EVENT_SCATTER_EDGES);
   public:
 
     /**
@@ -603,10 +636,10 @@ namespace graphlab {
      *
      * In the distributed engine the synchronous engine must be called
      * on all machines at the same time (in the same order) passing
-     * the \ref graphlab::distributed_control object.  Upon
-     * construction the synchronous engine allocates several
-     * data-structures to store messages, gather accumulants, and
-     * vertex programs and therefore may require considerable memory.
+     * the \ref graphlab::distributed_control object.  The first
+     * call to signal or start allocates several data-structures to
+     * store messages, gather accumulants, and vertex programs and
+     * therefore may require considerable memory.
      *
      * The number of threads to create are read from
      * \ref graphlab_options::get_ncpus "opts.get_ncpus()".
@@ -703,6 +736,18 @@ namespace graphlab {
      */
     void resize();
 
+    /**
+     * \brief Reports the memory of the per vertex arrays and of the
+     * gather cache to memory_info.
+     */
+    void update_memory_accounting();
+
+    /**
+     * \brief Frees the gather cache and disables caching on this
+     * machine. Called when the memory budget is exceeded.
+     */
+    void release_gather_cache();
+
     /**
      * \brief This internal stop function is called by the \ref graphlab::context to
      * terminate execution of the engine.
@@ -816,6 +861,17 @@ namespace graphlab {
       }
     } // end of run_synchronous
 
+    /**
+     * \brief Calls run_synchronous() and adds the time it took in
+     * microseconds to a cumulative event.
+     */
+    template<typename MemberFunction>
+    void run_synchronous_timed(size_t time_event, MemberFunction member_fun) {
+      graphlab::timer ti; ti.start();
+      run_synchronous(member_fun);
+      INCREMENT_EVENT(time_event, size_t(ti.current_time() * 1000000));
+    } // end of run_synchronous_timed
+
     // /**
     //  * \brief Initialize all vertex programs by invoking
     //  * \ref graphlab::ivertex_program::init on all vertices.
@@ -876,6 +932,20 @@ namespace graphlab {
      */
     void execute_scatters(size_t thread_id);
 
+    /**
+     * \brief Sizes the read ahead window of the local edges from the
+     * out of core memory budget. See stream_edges.
+     */
+    void init_edge_stream();
+
+    /**
+     * \brief Called when a thread claims the block of vertices
+     * starting at lvid_block_start in a gather or scatter. When the
+     * block starts a window, the edges of the next window are read
+     * ahead and those of the window before the last are released.
+     */
+    void stream_edges(lvid_type lvid_block_start);
+
     // Data Synchronization ===================================================
     /**
      * \brief Send the vertex program for the local vertex id to all
@@ -1012,11 +1082,16 @@ namespace graphlab {
     vdata_exchange(dc),
     gather_exchange(dc),
     message_exchange(dc),
-    aggregator(dc, graph, new context_type(*this, graph)) {
+    aggregator(dc, graph, new context_type(*this, graph)),
+    state_bytes(memory_info::ENGINE_STATE),
+    cache_bytes(memory_info::GATHER_CACHE) {
+    graphlab::timer ti; ti.start();
     // Process any additional options
     std::vector<std::string> keys = opts.get_engine_args().get_option_keys();
     per_thread_compute_time.resize(opts.get_ncpus());
     use_cache = false;
+    stream_window = 0;
+    stream_release = false;
     foreach(std::string opt, keys) {
       if (opt == "max_iterations") {
         opts.get_engine_args().get_option("max_iterations", max_iterations);
@@ -1062,8 +1137,27 @@ namespace graphlab {
     ADD_CUMULATIVE_EVENT(EVENT_GATHERS , "Gathers", "Calls");
     ADD_CUMULATIVE_EVENT(EVENT_SCATTERS , "Scatters", "Calls");
     ADD_INSTANTANEOUS_EVENT(EVENT_ACTIVE_CPUS, "Active Threads", "Threads");
+    ADD_INSTANTANEOUS_EVENT(EVENT_ACTIVE_VERTICES, "Active Vertices", "Vertices");
+    ADD_GROUPED_CUMULATIVE_EVENT(EVENT_EXCHANGE_TIME, "Superstep Phase Time",
+                                 "Exchange Messages", "us");
+    ADD_GROUPED_CUMULATIVE_EVENT(EVENT_RECEIVE_TIME, "Superstep Phase Time",
+                                 "Receive Messages", "us");
+    ADD_GROUPED_CUMULATIVE_EVENT(EVENT_GATHER_TIME, "Superstep Phase Time",
+                                 "Gather", "us");
+    ADD_GROUPED_CUMULATIVE_EVENT(EVENT_APPLY_TIME, "Superstep Phase Time",
+                                 "Apply", "us");
+    ADD_GROUPED_CUMULATIVE_EVENT(EVENT_SCATTER_TIME, "Superstep Phase Time",
+                                 "Scatter", "us");
+    ADD_HISTOGRAM_EVENT(EVENT_GATHER_EDGES, "Gather Edges Per Vertex", "Edges");
+    ADD_HISTOGRAM_EVENT(EVENT_SCATTER_EDGES, "Scatter Edges Per Vertex", "Edges");
+    reported_active_vertices = 0;
     graph.finalize();
-    init();
+    // The per vertex arrays are not allocated here. signal() and
+    // start() resize them to the graph on first use, so programs that
+    // construct several engines only pay for the ones they run.
+    force_abort = false;
+    logstream(LOG_INFO) << rmi.procid() << ": Engine constructed in "
+                        << ti.current_time() << " seconds" << std::endl;
   } // end of synchronous engine
 
 
@@ -1085,6 +1179,7 @@ namespace graphlab {
   template<typename VertexProgram>
   void synchronous_engine<VertexProgram>:: resize() {
     memory_info::log_usage("Before Engine Initialization");
+    graphlab::timer ti; ti.start();
     // Allocate vertex locks and vertex programs
     vlocks.resize(graph.num_local_vertices());
     vertex_programs.resize(graph.num_local_vertices());
@@ -1106,8 +1201,39 @@ namespace graphlab {
     active_superstep.resize(graph.num_local_vertices());
     active_minorstep.resize(graph.num_local_vertices());
 
+    update_memory_accounting();
+    logstream(LOG_INFO) << rmi.procid() << ": Allocated engine state for "
+                        << graph.num_local_vertices() << " vertices in "
+                        << ti.current_time() << " seconds" << std::endl;
     // Print memory usage after initialization
     memory_info::log_usage("After Engine Initialization");
+    memory_info::log_tagged_usage("After Engine Initialization");
+  }
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>:: update_memory_accounting() {
+    const size_t nverts = graph.num_local_vertices();
+    // 4 bitsets: has_message, has_gather_accum, active super and minor steps
+    state_bytes.set(nverts * (sizeof(simple_spinlock)
+                              + sizeof(vertex_program_type)
+                              + sizeof(message_type)
+                              + sizeof(gather_type))
+                    + 4 * (nverts / 8));
+    cache_bytes.set(gather_cache.size() * sizeof(gather_type)
+                    + (gather_cache.empty() ? 0 : nverts / 8));
+  }
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>:: release_gather_cache() {
+    logstream(LOG_WARNING) << rmi.procid() << ": Over the memory budget. "
+                           << "Dropping the gather cache" << std::endl;
+    // caching is local to each machine, so this needs no coordination
+    use_cache = false;
+    gather_cache.clear();
+    has_cache.clear();
+    update_memory_accounting();
   }
 
 
@@ -1271,6 +1397,7 @@ namespace graphlab {
   synchronous_engine<VertexProgram>::start() {
     if (vlocks.size() != graph.num_local_vertices())
       resize();
+    init_edge_stream();
     completed_applys = 0;
     rmi.barrier();
 
@@ -1316,6 +1443,12 @@ namespace graphlab {
           << std::endl;
         last_print = elapsed_seconds();
       }
+      // Respect the memory budget -----------------------------------------
+      // The cache is the only structure the engine can give up
+      if (!gather_cache.empty() && memory_info::over_budget()) {
+        release_gather_cache();
+      }
+
       // Reset Active vertices ----------------------------------------------
       // Clear the active super-step and minor-step bits which will
       // be set upon receiving messages
@@ -1326,7 +1459,8 @@ namespace graphlab {
       // Exchange Messages --------------------------------------------------
       // Exchange any messages in the local message vectors
       // if (rmi.procid() == 0) std::cout << "Exchange messages..." << std::endl;
-      run_synchronous( &synchronous_engine::exchange_messages );
+      run_synchronous_timed( EVENT_EXCHANGE_TIME,
+                             &synchronous_engine::exchange_messages );
       /**
        * Post conditions:
        *   1) only master vertices have messages
@@ -1339,7 +1473,8 @@ namespace graphlab {
 
       // if (rmi.procid() == 0) std::cout << "Receive messages..." << std::endl;
       num_active_vertices = 0;
-      run_synchronous( &synchronous_engine::receive_messages );
+      run_synchronous_timed( EVENT_RECEIVE_TIME,
+                             &synchronous_engine::receive_messages );
       if (sched_allv) {
         active_minorstep.fill();
       }
@@ -1358,6 +1493,10 @@ namespace graphlab {
 
       // Check termination condition  ---------------------------------------
       size_t total_active_vertices = num_active_vertices;
+      // the event holds the active vertices of the current iteration
+      DECREMENT_EVENT(EVENT_ACTIVE_VERTICES, reported_active_vertices);
+      reported_active_vertices = total_active_vertices;
+      INCREMENT_EVENT(EVENT_ACTIVE_VERTICES, reported_active_vertices);
       rmi.all_reduce(total_active_vertices);
       if (rmi.procid() == 0 && print_this_round)
         logstream(LOG_EMPH)
@@ -1372,7 +1511,8 @@ namespace graphlab {
       // Execute the gather operation for all vertices that are active
       // in this minor-step (active-minorstep bit set).
       // if (rmi.procid() == 0) std::cout << "Gathering..." << std::endl;
-      run_synchronous( &synchronous_engine::execute_gathers );
+      run_synchronous_timed( EVENT_GATHER_TIME,
+                             &synchronous_engine::execute_gathers );
       // Clear the minor step bit since only super-step vertices
       // (only master vertices are required to participate in the
       // apply step)
@@ -1388,7 +1528,8 @@ namespace graphlab {
       // Execute Apply Operations -------------------------------------------
       // Run the apply function on all active vertices
       // if (rmi.procid() == 0) std::cout << "Applying..." << std::endl;
-      run_synchronous( &synchronous_engine::execute_applys );
+      run_synchronous_timed( EVENT_APPLY_TIME,
+                             &synchronous_engine::execute_applys );
       /**
        * Post conditions:
        *   1) any changes to the vertex data have been synchronized
@@ -1403,7 +1544,8 @@ namespace graphlab {
 
       // Execute Scatter Operations -----------------------------------------
       // Execute each of the scatters on all minor-step active vertices.
-      run_synchronous( &synchronous_engine::execute_scatters );
+      run_synchronous_timed( EVENT_SCATTER_TIME,
+                             &synchronous_engine::execute_scatters );
       /**
        * Post conditions:
        *   1) NONE
@@ -1424,6 +1566,8 @@ namespace graphlab {
       logstream(LOG_EMPH) << iteration_counter
                         << " iterations completed." << std::endl;
     }
+    DECREMENT_EVENT(EVENT_ACTIVE_VERTICES, reported_active_vertices);
+    reported_active_vertices = 0;
     // Final barrier to ensure that all engines terminate at the same time
     double total_compute_time = 0;
     for (size_t i = 0;i < per_thread_compute_time.size(); ++i) {
@@ -1575,6 +1719,7 @@ namespace graphlab {
       lvid_type lvid_block_start =
                   shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
       if (lvid_block_start >= graph.num_local_vertices()) break;
+      stream_edges(lvid_block_start);
       // get the bit field from has_message
       size_t lvid_bit_block = active_minorstep.containing_word(lvid_block_start);
       if (lvid_bit_block == 0) continue;
@@ -1602,7 +1747,11 @@ namespace graphlab {
           // Loop over in edges
           size_t edges_touched = 0;
           vprog.pre_local_gather(accum);
-          if(gather_dir == IN_EDGES || gather_dir == ALL_EDGES) {
+          const bool local_gathered = gather_dir != NO_EDGES &&
+            vprog.local_gather(context, vertex, gather_dir, accum);
+          if(local_gathered) accum_is_set = true;
+          if(!local_gathered &&
+             (gather_dir == IN_EDGES || gather_dir == ALL_EDGES)) {
             foreach(local_edge_type local_edge, local_vertex.in_edges()) {
               edge_type edge(local_edge);
               // elocks[local_edge.id()].lock();
@@ -1617,7 +1766,8 @@ namespace graphlab {
             }
           } // end of if in_edges/all_edges
             // Loop over out edges
-          if(gather_dir == OUT_EDGES || gather_dir == ALL_EDGES) {
+          if(!local_gathered &&
+             (gather_dir == OUT_EDGES || gather_dir == ALL_EDGES)) {
             foreach(local_edge_type local_edge, local_vertex.out_edges()) {
               edge_type edge(local_edge);
               // elocks[local_edge.id()].lock();
@@ -1631,6 +1781,7 @@ namespace graphlab {
               ++edges_touched;
             }
             INCREMENT_EVENT(EVENT_GATHERS, edges_touched);
+            HISTOGRAM_EVENT(EVENT_GATHER_EDGES, edges_touched);
           } // end of if out_edges/all_edges
           vprog.post_local_gather(accum);
           // If caching is enabled then save the accumulator to the
@@ -1746,6 +1897,7 @@ namespace graphlab {
       lvid_type lvid_block_start =
                   shared_lvid_counter.inc_ret_last(8 * sizeof(size_t));
       if (lvid_block_start >= graph.num_local_vertices()) break;
+      stream_edges(lvid_block_start);
       // get the bit field from has_message
       size_t lvid_bit_block = active_minorstep.containing_word(lvid_block_start);
       if (lvid_bit_block == 0) continue;
@@ -1782,6 +1934,7 @@ namespace graphlab {
 					++edges_touched;
         } // end of if out_edges/all_edges
 				INCREMENT_EVENT(EVENT_SCATTERS, edges_touched);
+				HISTOGRAM_EVENT(EVENT_SCATTER_EDGES, edges_touched);
         // Clear the vertex program
         vertex_programs[lvid] = vertex_program_type();
       } // end of if active on this minor step
@@ -1791,6 +1944,50 @@ namespace graphlab {
   } // end of execute_scatters
 
 
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::init_edge_stream() {
+    stream_window = 0;
+    stream_release = false;
+    const typename graph_type::local_graph_type& lgraph =
+        graph.get_local_graph();
+    if (!lgraph.is_out_of_core() || graph.num_local_vertices() == 0) return;
+    const size_t block = 8 * sizeof(size_t);
+    const size_t budget = out_of_core::memory_budget();
+    if (budget == size_t(-1)) {
+      stream_window = 1024 * block;
+    } else {
+      // the window being processed, the one before it and the two read
+      // ahead must fit in the budget
+      const size_t bytes_per_vertex =
+          std::max<size_t>(1, lgraph.estimate_sizeof() /
+                              graph.num_local_vertices());
+      stream_window = budget / 4 / bytes_per_vertex;
+      stream_release = true;
+    }
+    stream_window = std::max(block, stream_window / block * block);
+    if (rmi.procid() == 0) {
+      logstream(LOG_INFO) << "Streaming out of core edges in windows of "
+                          << stream_window << " vertices" << std::endl;
+    }
+  } // end of init_edge_stream
+
+
+  template<typename VertexProgram>
+  void synchronous_engine<VertexProgram>::
+  stream_edges(lvid_type lvid_block_start) {
+    if (stream_window == 0 || lvid_block_start % stream_window != 0) return;
+    const typename graph_type::local_graph_type& lgraph =
+        graph.get_local_graph();
+    if (lvid_block_start == 0) lgraph.prefetch_edges(0, stream_window);
+    lgraph.prefetch_edges(lvid_block_start + stream_window,
+                          lvid_block_start + 2 * stream_window);
+    if (stream_release && lvid_block_start >= 2 * stream_window) {
+      lgraph.release_edges(lvid_block_start - 2 * stream_window,
+                           lvid_block_start - stream_window);
+    }
+  } // end of stream_edges
+
+
 
   // Data Synchronization ===================================================
   template<typename VertexProgram>
@@ -773,12 +773,11 @@ namespace warp {
                          const message_type& message = message_type()) {
       if (force_stop) return;
       if (started) {
-        const typename graph_type::vertex_record& rec = graph.l_get_vertex_record(vtx.local_id());
-        const procid_t owner = rec.owner;
+        const procid_t owner = graph.l_master(vtx.local_id());
         if (endgame_mode) {
           // fast signal. push to the remote machine immediately
           if (owner != rmi.procid()) {
-            const vertex_id_type vid = rec.gvid;
+            const vertex_id_type vid = vtx.id();
             rmi.remote_call(owner, &engine_type::rpc_signal, vid, message);
           }
           else {
@@ -1154,11 +1153,11 @@ namespace warp {
      */
     void eval_sched_task(const lvid_type lvid,
                          const message_type& msg) {
-      const typename graph_type::vertex_record& rec = graph.l_get_vertex_record(lvid);
-      vertex_id_type vid = rec.gvid;
+      vertex_id_type vid = graph.global_vid(lvid);
       // if this is another machine's forward it
-      if (rec.owner != rmi.procid()) {
-        rmi.remote_call(rec.owner, &engine_type::rpc_signal, vid, msg);
+      const procid_t owner = graph.l_master(lvid);
+      if (owner != rmi.procid()) {
+        rmi.remote_call(owner, &engine_type::rpc_signal, vid, msg);
         return;
       }
       // I have to run this myself
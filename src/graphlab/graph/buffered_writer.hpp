@@ -0,0 +1,96 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_GRAPH_BUFFERED_WRITER_HPP
+#define GRAPHLAB_GRAPH_BUFFERED_WRITER_HPP
+
+#include <boost/type_traits/is_base_of.hpp>
+#include <graphlab/util/output_buffer.hpp>
+
+namespace graphlab {
+
+  /**
+   * \brief Inheriting from this type marks a graph Writer as a buffered
+   * writer.
+   *
+   * A regular Writer passed to distributed_graph::save() returns a
+   * std::string for each vertex and edge. A buffered writer instead appends
+   * its output directly into a per-thread \ref output_buffer, avoiding
+   * one string allocation per vertex and edge:
+   *
+   * \code
+   * struct pagerank_writer: public graphlab::buffered_writer {
+   *   void save_vertex(graph_type::vertex_type v, 
+   *                    graphlab::output_buffer& out) {
+   *     out << v.id() << '\t' << v.data() << '\n';
+   *   }
+   *   void save_edge(graph_type::edge_type e, 
+   *                  graphlab::output_buffer& out) { }
+   * };
+   * \endcode
+   *
+   * Each saving thread operates on its own copy of the writer.
+   */
+  struct buffered_writer { };
+
+  namespace graph_writer_impl {
+
+    /// Calls a string returning writer
+    template <typename Writer, bool IsBuffered>
+    struct writer_adapter {
+      template <typename VertexType>
+      static void save_vertex(Writer& writer, VertexType& v, 
+                              output_buffer& out) {
+        out << writer.save_vertex(v);
+      }
+      template <typename EdgeType>
+      static void save_edge(Writer& writer, EdgeType& e, output_buffer& out) {
+        out << writer.save_edge(e);
+      }
+    };
+
+    /// Calls a buffered writer
+    template <typename Writer>
+    struct writer_adapter<Writer, true> {
+      template <typename VertexType>
+      static void save_vertex(Writer& writer, VertexType& v, 
+                              output_buffer& out) {
+        writer.save_vertex(v, out);
+      }
+      template <typename EdgeType>
+      static void save_edge(Writer& writer, EdgeType& e, output_buffer& out) {
+        writer.save_edge(e, out);
+      }
+    };
+
+    template <typename Writer>
+    struct select_writer_adapter {
+      typedef writer_adapter<Writer, 
+                             boost::is_base_of<buffered_writer, Writer>::value> 
+          type;
+    };
+
+  } // namespace graph_writer_impl
+} // namespace graphlab
+#endif
@@ -85,12 +85,19 @@
 #include <graphlab/graph/graph_hash.hpp>
 
 #include <graphlab/util/hopscotch_map.hpp>
+#include <graphlab/graph/vid2lvid_map.hpp>
+#include <graphlab/graph/vertex_record_table.hpp>
 
 #include <graphlab/util/fs_util.hpp>
+#include <graphlab/util/out_of_core.hpp>
+#include <graphlab/util/memory_info.hpp>
 #include <graphlab/util/hdfs.hpp>
 
 
 #include <graphlab/graph/builtin_parsers.hpp>
+#include <graphlab/graph/buffered_writer.hpp>
+#include <graphlab/util/output_buffer.hpp>
+#include <graphlab/util/parallel_block_writer.hpp>
 #include <graphlab/graph/vertex_set.hpp>
 
 #include <graphlab/macros_def.hpp>
@@ -200,6 +207,23 @@ namespace graphlab {
    *                reducing runtime memory consumption significantly, without load-time penalty.
    *                Currently only works with p^2+p+1 number of machines (p prime).
    *
+   * ### Reusing the Topology
+   *
+   * Programs which run several computations on the same graph with
+   * different vertex or edge data types need not load and partition it
+   * again. A graph with other data types can be constructed from a
+   * finalized graph on all machines simultaneously:
+   * \code
+   * graphlab::distributed_graph<double, graphlab::empty> graph(dc, clopts);
+   * graph.load_format(...);
+   * graph.finalize();
+   * // ... run pagerank on graph ...
+   * graphlab::distributed_graph<size_t, graphlab::empty> cc_graph(dc, graph);
+   * \endcode
+   * The new graph has the same partitioning, vertex records and local
+   * vertex ids. Its vertex and edge data are default constructed and can
+   * be initialized with transform_vertices() and transform_edges().
+   *
    * ### Referencing Vertices / Edges Many GraphLab operations will pass around
    * vertex_type and edge_type objects. These objects are light-weight copyable
    * opaque references to vertices and edges in the distributed graph.  The
@@ -376,7 +400,10 @@ namespace graphlab {
                                  const std::string&)> line_parser_type;
 
 
-    typedef fixed_dense_bitset<RPC_MAX_N_PROCS> mirror_type;
+    typedef vertex_record_table::mirror_type mirror_type;
+
+    /// A range over the mirrors of a local vertex
+    typedef vertex_record_table::mirror_list mirror_list_type;
 
     /// The type of the local graph used to store the graph data
 #ifdef USE_DYNAMIC_LOCAL_GRAPH
@@ -390,6 +417,10 @@ namespace graphlab {
 
     friend class distributed_ingress_base<VertexData, EdgeData>;
 
+    // Make friends with graphs of other data types, for copying the topology
+    template <typename OtherVertexData, typename OtherEdgeData>
+    friend class distributed_graph;
+
 
     // Make friends with graph operation classes 
     template <typename Graph, typename GatherType>
@@ -458,12 +489,12 @@ namespace graphlab {
 
       /// \brief Returns the number of in edges of the vertex
       size_t num_in_edges() const {
-        return graph_ref.l_get_vertex_record(lvid).num_in_edges;
+        return graph_ref.l_global_num_in_edges(lvid);
       }
 
       /// \brief Returns the number of out edges of the vertex
       size_t num_out_edges() const {
-        return graph_ref.l_get_vertex_record(lvid).num_out_edges;
+        return graph_ref.l_global_num_out_edges(lvid);
       }
 
       /// \brief Returns the vertex ID of the vertex
@@ -603,6 +634,12 @@ namespace graphlab {
      *                Defaults to 50,000. Increasing this number will
      *                decrease partitioning time with a penalty to partitioning
      *                quality.
+     * \li \c memory_budget_mb The memory budget of each machine (see
+     *                \ref memory_info::set_budget). Defaults to 0, no
+     *                budget. When the tagged memory of a machine nears the
+     *                budget, its exchanges send smaller buffers, during
+     *                ingress as well as in the engines, and the synchronous
+     *                engine drops its gather cache.
      *
      * \param [in] dc Distributed controller to associate with
      * \param [in] opts A graphlab::graphlab_options object specifying engine
@@ -619,11 +656,70 @@ namespace graphlab {
 #else
       vertex_exchange(dc), 
 #endif
-      vset_exchange(dc), parallel_ingress(true) {
+      vset_exchange(dc), parallel_ingress(true),
+      structure_bytes(memory_info::GRAPH_STRUCTURE),
+      vertex_data_bytes(memory_info::VERTEX_DATA),
+      edge_data_bytes(memory_info::EDGE_DATA) {
       rpc.barrier();
       set_options(opts);
     }
 
+    /**
+     * \brief Constructs a finalized graph with the topology of another
+     * finalized graph, whose vertex and edge data types may differ.
+     *
+     * The vertex and edge placement, the vertex records and the local
+     * adjacency are copied, so no ingress or partitioning is done. The
+     * vertex and edge data are default constructed. This must be called
+     * on all machines simultaneously.
+     *
+     * \param [in] dc Distributed controller to associate with
+     * \param [in] other The finalized graph providing the topology
+     * \param [in] opts Graph options for the new graph. Only the options
+     *                  of the local graph layout apply.
+     */
+    template <typename OtherVertexData, typename OtherEdgeData>
+    distributed_graph(distributed_control& dc,
+                      const distributed_graph<OtherVertexData,
+                                              OtherEdgeData>& other,
+                      const graphlab_options& opts = graphlab_options()) :
+      rpc(dc, this), finalized(false), vid2lvid(),
+      nverts(0), nedges(0), local_own_nverts(0), nreplicas(0),
+      ingress_ptr(NULL),
+#ifdef _OPENMP
+      vertex_exchange(dc, omp_get_max_threads()),
+#else
+      vertex_exchange(dc),
+#endif
+      vset_exchange(dc), parallel_ingress(true),
+      structure_bytes(memory_info::GRAPH_STRUCTURE),
+      vertex_data_bytes(memory_info::VERTEX_DATA),
+      edge_data_bytes(memory_info::EDGE_DATA) {
+      rpc.barrier();
+      set_options(opts);
+      if (!other.finalized) {
+        logstream(LOG_FATAL)
+          << "\n\tAttempting to copy the topology of a graph before "
+          << "calling graph.finalize()." << std::endl;
+      }
+      timer ti; ti.start();
+      nverts = other.nverts;
+      nedges = other.nedges;
+      local_own_nverts = other.local_own_nverts;
+      nreplicas = other.nreplicas;
+      vid2lvid = other.vid2lvid;
+      lvid2record = other.lvid2record;
+      local_graph.copy_topology(other.local_graph);
+      lock_manager.resize(num_local_vertices());
+      finalized = true;
+      update_memory_accounting();
+      rpc.barrier();
+      if (rpc.procid() == 0) {
+        logstream(LOG_INFO) << "Graph topology copied in " << ti.current_time()
+                            << " secs" << std::endl;
+      }
+    }
+
     ~distributed_graph() {
       delete ingress_ptr; ingress_ptr = NULL;
     }
@@ -650,6 +746,53 @@ namespace graphlab {
           if (!parallel_ingress && rpc.procid() == 0)
             logstream(LOG_EMPH) << "Disable parallel ingress. Graph will be streamed through one node."
               << std::endl;
+        } else if (opt == "compress_adjacency") {
+          bool compress = false;
+          opts.get_graph_args().get_option("compress_adjacency", compress);
+#ifdef USE_DYNAMIC_LOCAL_GRAPH
+          if (compress && rpc.procid() == 0)
+            logstream(LOG_WARNING) << "compress_adjacency is not supported "
+                                   << "by the dynamic local graph." << std::endl;
+#else
+          local_graph.set_compressed_adjacency(compress);
+          if (rpc.procid() == 0)
+            logstream(LOG_EMPH) << "Graph Option: compress_adjacency = "
+              << compress << std::endl;
+#endif
+        } else if (opt == "out_of_core_dir") {
+          std::string dir;
+          opts.get_graph_args().get_option("out_of_core_dir", dir);
+          out_of_core::set_directory(dir);
+          if (rpc.procid() == 0)
+            logstream(LOG_EMPH) << "Graph Option: out_of_core_dir = "
+              << dir << std::endl;
+        } else if (opt == "out_of_core_budget_mb") {
+          size_t budget_mb = 0;
+          opts.get_graph_args().get_option("out_of_core_budget_mb", budget_mb);
+          out_of_core::set_memory_budget(budget_mb << 20);
+          if (rpc.procid() == 0)
+            logstream(LOG_EMPH) << "Graph Option: out_of_core_budget_mb = "
+              << budget_mb << std::endl;
+        } else if (opt == "memory_budget_mb") {
+          size_t budget_mb = 0;
+          opts.get_graph_args().get_option("memory_budget_mb", budget_mb);
+          memory_info::set_budget(budget_mb << 20);
+          if (rpc.procid() == 0)
+            logstream(LOG_EMPH) << "Graph Option: memory_budget_mb = "
+              << budget_mb << std::endl;
+        } else if (opt == "ingress_buffer_mb") {
+          size_t buffer_mb = 0;
+          opts.get_graph_args().get_option("ingress_buffer_mb", buffer_mb);
+#ifdef USE_DYNAMIC_LOCAL_GRAPH
+          if (buffer_mb > 0 && rpc.procid() == 0)
+            logstream(LOG_WARNING) << "ingress_buffer_mb is not supported "
+                                   << "by the dynamic local graph." << std::endl;
+#else
+          local_graph.set_edge_buffer_limit(buffer_mb << 20);
+          if (rpc.procid() == 0)
+            logstream(LOG_EMPH) << "Graph Option: ingress_buffer_mb = "
+              << buffer_mb << std::endl;
+#endif
         }
         /**
          * These options below are deprecated.
@@ -702,6 +845,9 @@ namespace graphlab {
       logstream(LOG_INFO) << "Distributed graph: enter finalize" << std::endl;
       ingress_ptr->finalize();
       lock_manager.resize(num_local_vertices());
+      compact_vid2lvid();
+      compact_vertex_records();
+      update_memory_accounting();
       rpc.barrier(); 
 
       finalized = true;
@@ -760,7 +906,7 @@ namespace graphlab {
      * machine or assertion failures will be produced.
      */
     size_t num_in_edges(const vertex_id_type vid) const {
-      return get_vertex_record(vid).num_in_edges;
+      return l_global_num_in_edges(local_vid(vid));
     }
 
 
@@ -774,7 +920,7 @@ namespace graphlab {
      * machine or assertion failures will be produced.
      */
     size_t num_out_edges(const vertex_id_type vid) const {
-      return get_vertex_record(vid).num_out_edges;
+      return l_global_num_out_edges(local_vid(vid));
     }
 
 
@@ -979,7 +1125,7 @@ namespace graphlab {
         #pragma omp for
 #endif
         for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
-          if (lvid2record[i].owner == rpc.procid() &&
+          if (lvid2record.owner(i) == rpc.procid() &&
               vset.l_contains((lvid_type)i)) {
             if (!result_set) {
               const vertex_type vtx(l_vertex(i));
@@ -1254,7 +1400,7 @@ namespace graphlab {
         #pragma omp for
 #endif
         for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
-          if (lvid2record[i].owner == rpc.procid() &&
+          if (lvid2record.owner(i) == rpc.procid() &&
               vset.l_contains((lvid_type)i)) {
             const vertex_type vtx(l_vertex(i));
             foldfunction(vtx, result);
@@ -1476,7 +1622,7 @@ namespace graphlab {
       #pragma omp parallel for
 #endif
       for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
-        if (lvid2record[i].owner == rpc.procid() &&
+        if (lvid2record.owner(i) == rpc.procid() &&
             vset.l_contains((lvid_type)i)) {
           vertex_type vtx(l_vertex(i));
           transform_functor(vtx);
@@ -1600,7 +1746,7 @@ namespace graphlab {
 #endif
       for (int i = 0; i < (int)accfunction.size(); ++i) {
         for (int j = i;j < (int)local_graph.num_vertices(); j+=numaccfunctions) {
-          if (lvid2record[j].owner == rpc.procid()) {
+          if (lvid2record.owner(j) == rpc.procid()) {
             accfunction[i](vertex_type(l_vertex(j)));
           }
         }
@@ -1650,6 +1796,9 @@ namespace graphlab {
           >> vid2lvid
           >> lvid2record
           >> local_graph;
+      compact_vid2lvid();
+      compact_vertex_records();
+      update_memory_accounting();
       finalized = true;
       // check the graph condition
     } // end of load
@@ -1677,13 +1826,15 @@ namespace graphlab {
 
     /// \brief Clears and resets the graph, releasing all memory used.
     void clear () {
-      foreach (vertex_record& vrec, lvid2record)
-        vrec.clear();
       lvid2record.clear();
       vid2lvid.clear();
       local_graph.clear();
+      lock_manager_type().swap(lock_manager);
       finalized=false;
       nverts = nedges = local_own_nverts = nreplicas = 0;
+      structure_bytes.set(0);
+      vertex_data_bytes.set(0);
+      edge_data_bytes.set(0);
     }
 
 
@@ -1829,17 +1980,10 @@ namespace graphlab {
                          bool save_vertex = true,
                          bool save_edge = true,
                          size_t files_per_machine = 4) {
-      typedef boost::function<void(vertex_type)> vertex_function_type;
-      typedef boost::function<void(edge_type)> edge_function_type;
-      typedef std::ofstream base_fstream_type;
-      typedef boost::iostreams::filtering_stream<boost::iostreams::output>
-        boost_fstream_type;
       rpc.full_barrier();
       finalize();
       // figure out the filenames
       std::vector<std::string> graph_files;
-      std::vector<base_fstream_type*> outstreams;
-      std::vector<boost_fstream_type*> booststreams;
       graph_files.resize(files_per_machine);
       for(size_t i = 0; i < files_per_machine; ++i) {
         //graph_files[i] = prefix + "_" + tostr(1 + i + rpc.procid() * files_per_machine)
@@ -1847,49 +1991,17 @@ namespace graphlab {
           + "_of_" + tostr(rpc.numprocs() * files_per_machine);
         if (gzip) graph_files[i] += ".gz";
       }
-
-      // create the vector of callbacks
-      std::vector<vertex_function_type> vertex_callbacks(graph_files.size());
-      std::vector<edge_function_type> edge_callbacks(graph_files.size());
-
+      std::vector<std::ostream*> outstreams;
       for(size_t i = 0; i < graph_files.size(); ++i) {
         logstream(LOG_INFO) << "Saving to file: " << graph_files[i] << std::endl;
-        // open the stream
-        base_fstream_type* out_file =
-          new base_fstream_type(graph_files[i].c_str(),
-                                std::ios_base::out | std::ios_base::binary);
-        // attach gzip if the file is gzip
-        boost_fstream_type* fout = new boost_fstream_type;
-        // Using gzip filter
-        if (gzip) fout->push(boost::iostreams::gzip_compressor());
-        fout->push(*out_file);
-
-        outstreams.push_back(out_file);
-        booststreams.push_back(fout);
-        // construct the callback for the parallel for
-        typedef distributed_graph<vertex_data_type, edge_data_type> graph_type;
-        vertex_callbacks[i] =
-          boost::bind(&graph_type::template save_vertex_to_stream<boost_fstream_type, Writer>,
-                      this, _1, boost::ref(*fout), boost::ref(writer));
-        edge_callbacks[i] =
-          boost::bind(&graph_type::template save_edge_to_stream<boost_fstream_type, Writer>,
-                      this, _1, boost::ref(*fout), boost::ref(writer));
-      }
-
-      if (save_vertex) parallel_for_vertices(vertex_callbacks);
-      if (save_edge) parallel_for_edges(edge_callbacks);
-
-      // cleanup
-      for(size_t i = 0; i < graph_files.size(); ++i) {
-        booststreams[i]->pop();
-        if (gzip) booststreams[i]->pop();
-        delete booststreams[i];
-        delete outstreams[i];
+        outstreams.push_back(
+            new std::ofstream(graph_files[i].c_str(),
+                              std::ios_base::out | std::ios_base::binary));
       }
-      vertex_callbacks.clear();
-      edge_callbacks.clear();
+      save_to_ostreams(outstreams, writer, gzip, save_vertex, save_edge);
+      // cleanup
+      for(size_t i = 0; i < outstreams.size(); ++i) delete outstreams[i];
       outstreams.clear();
-      booststreams.clear();
       rpc.full_barrier();
     } // end of save to posixfs
 
@@ -1906,17 +2018,11 @@ namespace graphlab {
                       bool save_vertex = true,
                       bool save_edge = true,
                       size_t files_per_machine = 4) {
-      typedef boost::function<void(vertex_type)> vertex_function_type;
-      typedef boost::function<void(edge_type)> edge_function_type;
       typedef graphlab::hdfs::fstream base_fstream_type;
-      typedef boost::iostreams::filtering_stream<boost::iostreams::output>
-        boost_fstream_type;
       rpc.full_barrier();
       finalize();
       // figure out the filenames
       std::vector<std::string> graph_files;
-      std::vector<base_fstream_type*> outstreams;
-      std::vector<boost_fstream_type*> booststreams;
       graph_files.resize(files_per_machine);
       for(size_t i = 0; i < files_per_machine; ++i) {
         graph_files[i] = prefix + "_" + tostr(1 + i + rpc.procid() * files_per_machine)
@@ -1932,49 +2038,15 @@ namespace graphlab {
       }
       hdfs& hdfs = hdfs::get_hdfs();
 
-      // create the vector of callbacks
-
-      std::vector<vertex_function_type> vertex_callbacks(graph_files.size());
-      std::vector<edge_function_type> edge_callbacks(graph_files.size());
-
+      std::vector<std::ostream*> outstreams;
       for(size_t i = 0; i < graph_files.size(); ++i) {
         logstream(LOG_INFO) << "Saving to file: " << graph_files[i] << std::endl;
-        // open the stream
-        base_fstream_type* out_file = new base_fstream_type(hdfs,
-                                                            graph_files[i],
-                                                            true);
-        // attach gzip if the file is gzip
-        boost_fstream_type* fout = new boost_fstream_type;
-        // Using gzip filter
-        if (gzip) fout->push(boost::iostreams::gzip_compressor());
-        fout->push(*out_file);
-
-        outstreams.push_back(out_file);
-        booststreams.push_back(fout);
-        // construct the callback for the parallel for
-        typedef distributed_graph<vertex_data_type, edge_data_type> graph_type;
-        vertex_callbacks[i] =
-          boost::bind(&graph_type::template save_vertex_to_stream<boost_fstream_type, Writer>,
-                      this, _1, boost::ref(*fout), writer);
-        edge_callbacks[i] =
-          boost::bind(&graph_type::template save_edge_to_stream<boost_fstream_type, Writer>,
-                      this, _1, boost::ref(*fout), writer);
-      }
-
-      if (save_vertex) parallel_for_vertices(vertex_callbacks);
-      if (save_edge) parallel_for_edges(edge_callbacks);
-
-      // cleanup
-      for(size_t i = 0; i < graph_files.size(); ++i) {
-        booststreams[i]->pop();
-        if (gzip) booststreams[i]->pop();
-        delete booststreams[i];
-        delete outstreams[i];
+        outstreams.push_back(new base_fstream_type(hdfs, graph_files[i], true));
       }
-      vertex_callbacks.clear();
-      edge_callbacks.clear();
+      save_to_ostreams(outstreams, writer, gzip, save_vertex, save_edge);
+      // cleanup
+      for(size_t i = 0; i < outstreams.size(); ++i) delete outstreams[i];
       outstreams.clear();
-      booststreams.clear();
       rpc.full_barrier();
     } // end of save to hdfs
 
@@ -2013,6 +2085,18 @@ namespace graphlab {
      * constructs a string containing "[source] \\t [target] \\n" and returns
      * the string.
      *
+     * Writers which inherit from \ref graphlab::buffered_writer instead
+     * append directly into a per-thread output buffer, avoiding a temporary
+     * string for every vertex and edge:
+     * \code
+     * struct edge_list_writer: public graphlab::buffered_writer {
+     *   void save_vertex(vertex_type, graphlab::output_buffer& out) { }
+     *   void save_edge(edge_type e, graphlab::output_buffer& out) {
+     *     out << e.source().id() << '\t' << e.target().id() << '\n';
+     *   }
+     * };
+     * \endcode
+     *
      * This can also be used to data in human readable format. For instance,
      * if the vertex data type is a floating point number (say a PageRank
      * value), to save a list of vertices and their corresponding PageRanks,
@@ -2036,9 +2120,11 @@ namespace graphlab {
      * \li [prefix].3_of_16.gz
      * \li etc.
      *
-     * To accelerate the saving process, multiple files are be written
-     * per machine in parallel. If the gzip option is not set, the ".gz" suffix
-     * is not added.
+     * Output is produced by all threads in parallel into per-thread
+     * buffers. Full buffers are written, and compressed if gzip is set, as
+     * independent blocks, so compression also runs on all threads.
+     * Lines from different threads are therefore interleaved in an arbitrary
+     * order. If the gzip option is not set, the ".gz" suffix is not added.
      *
      * For instance, if there are 4 machines, running:
      * \code
@@ -2075,8 +2161,8 @@ namespace graphlab {
      *             appended with the .gz suffix. Defaults to true.
      * \param save_vertex If vertices should be saved. Defaults to true.
      * \param save_edges If edges should be saved. Defaults to true.
-     * \param files_per_machine Number of files to write simultaneously in
-     *                          parallel per machine. Defaults to 4.
+     * \param files_per_machine Number of files to write per machine.
+     *                          Defaults to 4.
      */
     template<typename Writer>
     void save(const std::string& prefix, Writer writer,
@@ -2122,7 +2208,8 @@ namespace graphlab {
      *               If prefix begins with "hdfs://", the output is written to
      *               HDFS.
      * \param format The file format to save in.
-     *               Either "tsv", "snap", "graphjrl" or "bin".
+     *               Either "tsv", "snap", "graphjrl", "bin", "bintsv4"
+     *               or "bincol".
      * \param gzip If gzip compression should be used. If set, all files will be
      *             appended with the .gz suffix. Defaults to true. Ignored
      *             if format == "bin".
@@ -2142,6 +2229,8 @@ namespace graphlab {
          save_binary(prefix);
       } else if (format == "bintsv4") {
          save_direct(prefix, gzip, &graph_type::save_bintsv4_to_stream);
+      } else if (format == "bincol") {
+         save_columnar(prefix, gzip, files_per_machine);
       } else {
         logstream(LOG_FATAL)
           << "Unrecognized Format \"" << format << "\"!" << std::endl;
@@ -2403,6 +2492,180 @@ namespace graphlab {
     } // end of load random powerlaw
 
 
+    /**
+     *  \brief Generates a synthetic R-MAT (Kronecker) graph as in the
+     *  Graph500 benchmark. Must be called on all machines simultaneously.
+     *
+     * The graph has 2^scale vertices and edge_factor * 2^scale edges,
+     * less the self edges which are dropped. Each edge descends the
+     * adjacency matrix one bit of the vertex ids at a time, picking the
+     * top left, top right, bottom left or bottom right quadrant with
+     * probabilities a, b, c and 1 - a - b - c. The ids are then
+     * scrambled by a bijection so that the high degree vertices are not
+     * all small ids. Duplicate edges are kept.
+     *
+     * The edges are cut into blocks which the machines generate in
+     * parallel, each block from its own counter based random stream and
+     * straight into the ingress. The graph therefore only depends on
+     * the arguments, and not on the number of machines or threads.
+     *
+     * \param scale The log2 of the number of vertices
+     * \param edge_factor The number of edges per vertex. Defaults to 16
+     * \param a The probability of the top left quadrant. Defaults to 0.57
+     * \param b The probability of the top right quadrant. Defaults to 0.19
+     * \param c The probability of the bottom left quadrant. Defaults to 0.19
+     * \param seed The seed of the random streams. Defaults to 0
+     */
+    void load_synthetic_rmat(size_t scale, size_t edge_factor = 16,
+                             double a = 0.57, double b = 0.19,
+                             double c = 0.19, size_t seed = 0) {
+      // the id with all bits set is reserved
+      ASSERT_LT(scale, 8 * sizeof(vertex_id_type));
+      ASSERT_LE(a + b + c, 1.0);
+      rpc.full_barrier();
+      const uint64_t nedges = (uint64_t(1) << scale) * edge_factor;
+      const uint64_t nblocks =
+        (nedges + SYNTHETIC_BLOCK_SIZE - 1) / SYNTHETIC_BLOCK_SIZE;
+      const size_t local_blocks = nblocks / rpc.numprocs() +
+        (rpc.procid() < nblocks % rpc.numprocs());
+      // the quadrant thresholds on a 32 bit draw
+      const double SCALE32 = 4294967296.0;
+      const uint32_t a_threshold = uint32_t(std::min(a * SCALE32, SCALE32 - 1));
+      const uint32_t ab_threshold =
+        uint32_t(std::min((a + b) * SCALE32, SCALE32 - 1));
+      const uint32_t abc_threshold =
+        uint32_t(std::min((a + b + c) * SCALE32, SCALE32 - 1));
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+      for (size_t i = 0; i < local_blocks; ++i) {
+        const uint64_t block = rpc.procid() + uint64_t(i) * rpc.numprocs();
+        random::counter_generator rng(seed, block, RMAT_STREAM);
+        const uint64_t end = std::min(nedges, (block + 1) * SYNTHETIC_BLOCK_SIZE);
+        for (uint64_t e = block * SYNTHETIC_BLOCK_SIZE; e < end; ++e) {
+          uint64_t source = 0, target = 0;
+          for (size_t bit = 0; bit < scale; ++bit) {
+            const uint32_t u = rng.next_uint32();
+            const bool bottom = u >= ab_threshold;
+            const bool right = bottom ? u >= abc_threshold : u >= a_threshold;
+            source = (source << 1) | bottom;
+            target = (target << 1) | right;
+          }
+          source = scramble_synthetic_id(source, scale, seed);
+          target = scramble_synthetic_id(target, scale, seed);
+          if (source != target) add_edge(source, target);
+        }
+      }
+      rpc.full_barrier();
+    } // end of load synthetic rmat
+
+
+    /**
+     *  \brief Generates a synthetic graph with planted communities,
+     *  similar to the LFR benchmark (Lancichinetti, Fortunato and
+     *  Radicchi, 2008). Must be called on all machines simultaneously.
+     *
+     * The vertices are cut into ranges of consecutive ids, the
+     * communities, whose sizes follow a power law of exponent
+     * community_alpha between min_community and max_community. The
+     * degree of each vertex follows a power law of exponent
+     * degree_alpha between min_degree and max_degree, and the vertex
+     * adds half of it as out edges. Each edge goes to a uniformly
+     * chosen vertex of the same community with probability 1 - mixing,
+     * and of another community otherwise. Unlike LFR, the degrees and
+     * the mixing are only met in expectation, and there may be
+     * duplicate edges.
+     *
+     * Every vertex draws its edges from its own counter based random
+     * stream, and the machines generate their vertices in parallel
+     * straight into the ingress, so the graph only depends on the
+     * arguments.
+     *
+     * \param nverts Number of vertices to generate
+     * \param min_degree Smallest degree. Defaults to 5
+     * \param max_degree Largest degree. Defaults to 100
+     * \param degree_alpha Exponent of the degrees. Defaults to 2.5
+     * \param min_community Smallest community. Defaults to 20
+     * \param max_community Largest community. Defaults to 1000
+     * \param community_alpha Exponent of the community sizes.
+     *                        Defaults to 1.5
+     * \param mixing The fraction of the edges between communities.
+     *               Defaults to 0.2
+     * \param seed The seed of the random streams. Defaults to 0
+     *
+     * \return The first vertex id of every community, followed by
+     * nverts. The community of vertex v is
+     * std::upper_bound(ret.begin(), ret.end(), v) - ret.begin() - 1.
+     */
+    std::vector<size_t> load_synthetic_lfr(size_t nverts,
+                                           size_t min_degree = 5,
+                                           size_t max_degree = 100,
+                                           double degree_alpha = 2.5,
+                                           size_t min_community = 20,
+                                           size_t max_community = 1000,
+                                           double community_alpha = 1.5,
+                                           double mixing = 0.2,
+                                           size_t seed = 0) {
+      ASSERT_LT(nverts, size_t(vertex_id_type(-1)));
+      ASSERT_GT(min_community, 0);
+      ASSERT_GT(min_degree, 0);
+      ASSERT_LE(min_community, max_community);
+      ASSERT_LE(min_degree, max_degree);
+      rpc.full_barrier();
+      // the same community sizes on every machine
+      std::vector<size_t> communities(1, 0);
+      random::counter_generator community_rng(seed, 0, LFR_COMMUNITY_STREAM);
+      while (communities.back() < nverts) {
+        const size_t size = std::min(max_community,
+          size_t(sample_synthetic_powerlaw(community_rng.rand01(),
+                                           min_community, max_community + 1,
+                                           community_alpha)));
+        communities.push_back(std::min(nverts, communities.back() + size));
+      }
+      // merge a short last community into the one before
+      if (communities.size() > 2 &&
+          nverts - communities[communities.size() - 2] < min_community) {
+        communities.erase(communities.end() - 2);
+      }
+      const size_t local_verts = nverts / rpc.numprocs() +
+        (rpc.procid() < nverts % rpc.numprocs());
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+      for (size_t i = 0; i < local_verts; ++i) {
+        const size_t source = rpc.procid() + i * rpc.numprocs();
+        random::counter_generator rng(seed, source, LFR_EDGE_STREAM);
+        const size_t community =
+          std::upper_bound(communities.begin(), communities.end(), source) -
+          communities.begin() - 1;
+        const size_t begin = communities[community];
+        const size_t size = communities[community + 1] - begin;
+        const size_t degree = std::min(max_degree,
+          size_t(sample_synthetic_powerlaw(rng.rand01(), min_degree,
+                                           max_degree + 1, degree_alpha)));
+        // half of the degree, rounding odd degrees up or down at random
+        const size_t out_degree = degree / 2 + (degree % 2 && rng.bernoulli());
+        for (size_t j = 0; j < out_degree; ++j) {
+          size_t target;
+          if (size > 1 && (size == nverts || rng.rand01() >= mixing)) {
+            // a vertex of the community other than the source
+            target = begin + rng.uniform<size_t>(0, size - 2);
+            if (target >= source) ++target;
+          } else if (size < nverts) {
+            // a vertex outside of the community
+            target = rng.uniform<size_t>(0, nverts - size - 1);
+            if (target >= begin) target += size;
+          } else {
+            continue;
+          }
+          add_edge(source, target);
+        }
+      }
+      rpc.full_barrier();
+      return communities;
+    } // end of load synthetic lfr
+
+
     /**
      *  \brief load a graph with a standard format. Must be called on all
      *  machines simultaneously.
@@ -2428,6 +2691,8 @@ namespace graphlab {
         load(path, line_parser);
       } else if (format == "bintsv4") {
          load_direct(path,&graph_type::load_bintsv4_from_stream);
+      } else if (format == "bincol") {
+         load_direct(path,&graph_type::load_columnar_from_stream);
       } else if (format == "bin") {
          load_binary(path);
       } else {
@@ -2530,7 +2795,7 @@ namespace graphlab {
         #pragma omp for
 #endif
      for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
-       if (lvid2record[i].owner == rpc.procid() &&
+       if (lvid2record.owner(i) == rpc.procid() &&
            vset.l_contains((lvid_type)i)) {
          const vertex_type vtx(l_vertex(i));
          if (select_functor(vtx)) ret.set_lvid(i);
@@ -2544,6 +2809,74 @@ namespace graphlab {
      vset.synchronize_master_to_mirrors(*this, vset_exchange);
    }
 
+   /**
+    * \brief Builds the subgraph induced by a vertex predicate and
+    * filtered by an edge predicate.
+    *
+    * The subgraph contains the vertices on which vertex_predicate
+    * evaluates to true, and the edges between them on which
+    * edge_predicate evaluates to true, with their data. For instance:
+    * \code
+    * bool high_degree(const graph_type::vertex_type& vertex) {
+    *   return vertex.num_in_edges() + vertex.num_out_edges() > 10;
+    * }
+    * bool heavy(const graph_type::edge_type& edge) {
+    *   return edge.data() > 0.5;
+    * }
+    * graph_type subgraph(dc, clopts);
+    * graph.extract_subgraph(subgraph, high_degree, heavy);
+    * \endcode
+    *
+    * The subgraph is built from the local partitions: every edge stays on
+    * the machine which holds it, so only the vertex data and the vertex
+    * records are exchanged. The subgraph must be empty, and is finalized
+    * on return. This function must be called on all machines.
+    *
+    * \param subgraph The empty graph receiving the subgraph
+    * \param vertex_predicate A function/functor which takes a
+    *                         const vertex_type& argument and returns true
+    *                         if the vertex is kept
+    * \param edge_predicate A function/functor which takes a
+    *                       const edge_type& argument and returns true if
+    *                       the edge is kept. Only called on edges between
+    *                       kept vertices.
+    */
+   template <typename VertexPredicate, typename EdgePredicate>
+   void extract_subgraph(distributed_graph& subgraph,
+                         VertexPredicate vertex_predicate,
+                         EdgePredicate edge_predicate) {
+     if(!finalized) {
+       logstream(LOG_FATAL)
+         << "\n\tAttempting to extract a subgraph before calling "
+         << "graph.finalize()." << std::endl;
+     }
+     timer ti; ti.start();
+     const vertex_set kept = select(vertex_predicate);
+     subgraph.set_ingress_method("identity");
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+     for (ssize_t i = 0; i < ssize_t(local_graph.num_vertices()); ++i) {
+       const lvid_type lvid = i;
+       if (!kept.l_contains(lvid)) continue;
+       local_vertex_type lv = l_vertex(lvid);
+       if (lv.owned()) subgraph.add_vertex(lv.global_id(), lv.data());
+       foreach(const local_edge_type& e, lv.out_edges()) {
+         if (kept.l_contains(e.target().id()) && edge_predicate(edge_type(e))) {
+           subgraph.add_edge(lv.global_id(), e.target().global_id(),
+                             e.data());
+         }
+       }
+     }
+     subgraph.finalize();
+     if (rpc.procid() == 0) {
+       logstream(LOG_INFO) << "Extracted a subgraph of "
+                           << subgraph.num_vertices() << " vertices and "
+                           << subgraph.num_edges() << " edges in "
+                           << ti.current_time() << " secs" << std::endl;
+     }
+   }
+
    /**
     * \brief Returns the number of vertices in a vertex set.
     *
@@ -2559,7 +2892,7 @@ namespace graphlab {
    size_t vertex_set_size(const vertex_set& vset) {
      size_t count = 0;
      for (int i = 0; i < (int)local_graph.num_vertices(); ++i) {
-        count += (lvid2record[i].owner == rpc.procid() &&
+        count += (lvid2record.owner(i) == rpc.procid() &&
                   vset.l_contains((lvid_type)i));
      }
      rpc.all_reduce(count);
@@ -2592,57 +2925,10 @@ namespace graphlab {
     /**
      * \internal
      * The vertex record stores information associated with each
-     * vertex on this proc
-     */
-    struct vertex_record {
-      /// The official owning processor for this vertex
-      procid_t owner;
-      /// The local vid of this vertex on this proc
-      vertex_id_type gvid;
-      /// The number of in edges
-      vertex_id_type num_in_edges, num_out_edges;
-      /** The set of proc that mirror this vertex.  The owner should
-          NOT be in this set.*/
-      mirror_type _mirrors;
-      vertex_record() :
-        owner(-1), gvid(-1), num_in_edges(0), num_out_edges(0) { }
-      vertex_record(const vertex_id_type& vid) :
-        owner(-1), gvid(vid), num_in_edges(0), num_out_edges(0) { }
-      procid_t get_owner () const { return owner; }
-      const mirror_type& mirrors() const { return _mirrors; }
-      size_t num_mirrors() const { return _mirrors.popcount(); }
-
-      void clear() {
-        _mirrors.clear();
-      }
-
-      void load(iarchive& arc) {
-        clear();
-        arc >> owner
-            >> gvid
-            >> num_in_edges
-            >> num_out_edges
-            >> _mirrors;
-      }
-
-      void save(oarchive& arc) const {
-        arc << owner
-            << gvid
-            << num_in_edges
-            << num_out_edges
-            << _mirrors;
-      } // end of save
-
-      bool operator==(const vertex_record& other) const {
-        return (
-            (owner == other.owner) &&
-            (gvid == other.gvid)  &&
-            (num_in_edges == other.num_in_edges) &&
-            (num_out_edges == other.num_out_edges) && 
-            (_mirrors == other._mirrors)
-            );
-      }
-    }; // end of vertex_record
+     * vertex on this proc. The records are stored field by field in a
+     * \ref vertex_record_table, so this is a copy.
+     */
+    typedef vertex_record_table::vertex_record vertex_record;
 
 
 
@@ -2675,15 +2961,14 @@ namespace graphlab {
     lvid_type local_vid (const vertex_id_type vid) const {
       // typename boost::unordered_map<vertex_id_type, lvid_type>::
       //   const_iterator iter = vid2lvid.find(vid);
-      typename hopscotch_map_type::const_iterator iter = vid2lvid.find(vid);
-      return iter->second;
+      return vid2lvid.lookup(vid);
     } // end of local_vertex_id
 
     /** \internal
      *\brief Convert a local vid to a global vid */
     vertex_id_type global_vid(const lvid_type lvid) const {
       ASSERT_LT(lvid, lvid2record.size());
-      return lvid2record[lvid].gvid;
+      return lvid2record.gvid(lvid);
     } // end of global_vertex_id
 
 
@@ -2756,28 +3041,54 @@ namespace graphlab {
     /** \internal
      * \brief Returns the internal vertex record of a given global vertex ID
      */
-    const vertex_record& get_vertex_record(vertex_id_type vid) const {
+    vertex_record get_vertex_record(vertex_id_type vid) const {
       // typename boost::unordered_map<vertex_id_type, lvid_type>::
       //   const_iterator iter = vid2lvid.find(vid);
-      typename hopscotch_map_type::const_iterator iter = vid2lvid.find(vid);
+      typename vid2lvid_map_type::const_iterator iter = vid2lvid.find(vid);
       ASSERT_TRUE(iter != vid2lvid.end());
-      return lvid2record[iter->second];
+      return lvid2record.get(iter->second);
     }
 
     /** \internal
      * \brief Returns the internal vertex record of a given local vertex ID
      */
-    vertex_record& l_get_vertex_record(lvid_type lvid) {
+    vertex_record l_get_vertex_record(lvid_type lvid) const {
       ASSERT_LT(lvid, lvid2record.size());
-      return lvid2record[lvid];
+      return lvid2record.get(lvid);
     }
 
     /** \internal
-     * \brief Returns the internal vertex record of a given local vertex ID
+     * \brief Returns the number of in edges of a local vertex ID
+     *        on the global graph
      */
-    const vertex_record& l_get_vertex_record(lvid_type lvid) const {
+    size_t l_global_num_in_edges(lvid_type lvid) const {
       ASSERT_LT(lvid, lvid2record.size());
-      return lvid2record[lvid];
+      return lvid2record.num_in_edges(lvid);
+    }
+
+    /** \internal
+     * \brief Returns the number of out edges of a local vertex ID
+     *        on the global graph
+     */
+    size_t l_global_num_out_edges(lvid_type lvid) const {
+      ASSERT_LT(lvid, lvid2record.size());
+      return lvid2record.num_out_edges(lvid);
+    }
+
+    /** \internal
+     * \brief Returns the procs which mirror a local vertex ID
+     */
+    mirror_list_type l_mirrors(lvid_type lvid) const {
+      ASSERT_LT(lvid, lvid2record.size());
+      return lvid2record.mirrors(lvid);
+    }
+
+    /** \internal
+     * \brief Returns the number of procs which mirror a local vertex ID
+     */
+    size_t l_num_mirrors(lvid_type lvid) const {
+      ASSERT_LT(lvid, lvid2record.size());
+      return lvid2record.num_mirrors(lvid);
     }
 
     /** \internal
@@ -2801,7 +3112,7 @@ namespace graphlab {
      */
     bool l_is_master(lvid_type lvid) const {
       ASSERT_LT(lvid, lvid2record.size());
-      return lvid2record[lvid].owner == rpc.procid();
+      return lvid2record.owner(lvid) == rpc.procid();
     }
 
     /** \internal
@@ -2809,7 +3120,7 @@ namespace graphlab {
      */
     procid_t l_master(lvid_type lvid) const {
       ASSERT_LT(lvid, lvid2record.size());
-      return lvid2record[lvid].owner;
+      return lvid2record.owner(lvid);
     }
 
 
@@ -2846,12 +3157,11 @@ namespace graphlab {
 #endif
       for(lvid_type lvid = 0; lvid < lvid2record.size(); ++lvid) {
         typename buffered_exchange<pair_type>::buffer_type recv_buffer;
-        const vertex_record& record = lvid2record[lvid];
         // if this machine is the owner of a record then send the
         // vertex data to all mirrors
-        if(record.owner == rpc.procid() && vset.l_contains(lvid)) {
-          foreach(size_t proc, record.mirrors()) {
-            const pair_type pair(record.gvid, local_graph.vertex_data(lvid));
+        if(lvid2record.owner(lvid) == rpc.procid() && vset.l_contains(lvid)) {
+          foreach(size_t proc, lvid2record.mirrors(lvid)) {
+            const pair_type pair(lvid2record.gvid(lvid), local_graph.vertex_data(lvid));
 #ifdef _OPENMP
             vertex_exchange.send(proc, pair, omp_get_thread_num());
 #else
@@ -2957,20 +3267,20 @@ namespace graphlab {
       /** \brief Returns the owner of this local vertex
        */
       procid_t owner() const {
-        return graph_ref.l_get_vertex_record(lvid).owner;
+        return graph_ref.l_master(lvid);
       }
 
       /** \brief Returns the owner of this local vertex
        */
       bool owned() const {
-        return graph_ref.l_get_vertex_record(lvid).owner == graph_ref.procid();
+        return graph_ref.l_is_master(lvid);
       }
 
       /** \brief Returns the number of in_edges of this vertex
        *         on the global graph
        */
       size_t global_num_in_edges() const {
-        return graph_ref.l_get_vertex_record(lvid).num_in_edges;
+        return graph_ref.l_global_num_in_edges(lvid);
       }
 
 
@@ -2978,24 +3288,24 @@ namespace graphlab {
        *         on the global graph
        */
       size_t global_num_out_edges() const {
-        return graph_ref.l_get_vertex_record(lvid).num_out_edges;
+        return graph_ref.l_global_num_out_edges(lvid);
       }
 
 
       /** \brief Returns the set of mirrors of this vertex
        */
-      const mirror_type& mirrors() const {
-        return graph_ref.l_get_vertex_record(lvid)._mirrors;
+      mirror_list_type mirrors() const {
+        return graph_ref.l_mirrors(lvid);
       }
 
       size_t num_mirrors() const {
-        return graph_ref.l_get_vertex_record(lvid).num_mirrors();
+        return graph_ref.l_num_mirrors(lvid);
       }
 
-      /** \brief Returns the vertex record of this
+      /** \brief Returns a copy of the vertex record of this
        *         this local vertex
        */
-      vertex_record& get_vertex_record() {
+      vertex_record get_vertex_record() const {
         return graph_ref.l_get_vertex_record(lvid);
       }
     };
@@ -3127,20 +3437,80 @@ namespace graphlab {
     }
 
   private:
+    /**
+     * Switches vid2lvid to a dense representation if the local vertex ids
+     * permit it, and logs the memory used.
+     */
+    void compact_vid2lvid() {
+      const size_t before = vid2lvid.memory_usage();
+      const size_t saved = vid2lvid.compact();
+      logstream(LOG_INFO) << "vid2lvid: " << vid2lvid.size() << " vertices in "
+                          << vid2lvid.mode_name() << " mode using "
+                          << vid2lvid.memory_usage() << " bytes ("
+                          << before << " bytes as hash map, "
+                          << saved << " bytes saved)" << std::endl;
+    }
+
+    void compact_vertex_records() {
+      const size_t saved = lvid2record.compact();
+      const double nverts = std::max<size_t>(lvid2record.size(), 1);
+      logstream(LOG_INFO) << "vertex records: " << lvid2record.size()
+                          << " vertices using "
+                          << lvid2record.memory_usage() / nverts
+                          << " bytes/vertex ("
+                          << lvid2record.hot_memory_usage() / nverts
+                          << " bytes/vertex for owner and gvid, "
+                          << saved << " bytes saved)" << std::endl;
+    }
+
+    // The synthetic generators draw each of their kinds of numbers
+    // from a different iteration of the counter based streams
+    enum { RMAT_STREAM = 1, LFR_COMMUNITY_STREAM = 2, LFR_EDGE_STREAM = 3 };
+    /// The number of edges of a block of load_synthetic_rmat
+    static const uint64_t SYNTHETIC_BLOCK_SIZE = 1 << 16;
+
+    /**
+     * Maps [0, 2^scale) onto itself by a bijection which depends on the
+     * seed: the id is multiplied by an odd constant modulo 2^scale and
+     * xored with its upper half, twice.
+     */
+    static uint64_t scramble_synthetic_id(uint64_t id, size_t scale,
+                                          uint64_t seed) {
+      const uint64_t mask = (uint64_t(1) << scale) - 1;
+      const uint64_t multiplier = (seed * 2 + 0x9E3779B97F4A7C15ULL) | 1;
+      for (size_t round = 0; round < 2; ++round) {
+        id = (id * multiplier) & mask;
+        id ^= id >> ((scale + 1) / 2);
+      }
+      return id;
+    }
+
+    /**
+     * Maps a uniform draw u in [0, 1) to a power law of exponent alpha on
+     * [xmin, xmax) by inverting its cumulative distribution.
+     */
+    static double sample_synthetic_powerlaw(double u, double xmin, double xmax,
+                                            double alpha) {
+      if (alpha == 1) return xmin * std::pow(xmax / xmin, u);
+      const double e = 1 - alpha;
+      const double low = std::pow(xmin, e), high = std::pow(xmax, e);
+      return std::pow(low + u * (high - low), 1 / e);
+    }
+
     bool finalized;
 
     /** The local graph data */
     local_graph_type local_graph;
 
-    /** The map from global vertex ids to vertex records */
-    std::vector<vertex_record>  lvid2record;
+    /** The vertex records, indexed by local vertex id */
+    vertex_record_table lvid2record;
 
     // boost::unordered_map<vertex_id_type, lvid_type> vid2lvid;
     /** The map from global vertex ids back to local vertex ids */
     typedef hopscotch_map<vertex_id_type, lvid_type> hopscotch_map_type;
-    typedef hopscotch_map_type vid2lvid_map_type;
+    typedef vid2lvid_map vid2lvid_map_type;
 
-    hopscotch_map_type vid2lvid;
+    vid2lvid_map_type vid2lvid;
 
 
     /** The global number of vertices and edges */
@@ -3167,6 +3537,28 @@ namespace graphlab {
 
     lock_manager_type lock_manager;
 
+    /** The memory of the local graph reported to memory_info */
+    memory_info::tracked_bytes structure_bytes;
+    memory_info::tracked_bytes vertex_data_bytes;
+    memory_info::tracked_bytes edge_data_bytes;
+
+    /**
+     * Reports the estimated memory of the local graph, the vertex
+     * records and the vid map to memory_info.
+     */
+    void update_memory_accounting() {
+      const size_t vdata = sizeof(VertexData) * local_graph.num_vertices();
+      const size_t edata = sizeof(EdgeData) * local_graph.num_edges();
+      const size_t local_bytes = local_graph.estimate_sizeof();
+      vertex_data_bytes.set(vdata);
+      edge_data_bytes.set(edata);
+      structure_bytes.set((local_bytes > vdata + edata ?
+                             local_bytes - vdata - edata : 0)
+                          + lvid2record.memory_usage()
+                          + vid2lvid.memory_usage());
+      memory_info::log_tagged_usage("Graph Finalized");
+    }
+
     void set_ingress_method(const std::string& method,
         size_t bufsize = 50000, bool usehash = false, bool userecent = false) {
       if(ingress_ptr != NULL) { delete ingress_ptr; ingress_ptr = NULL; }
@@ -3174,6 +3566,9 @@ namespace graphlab {
         if (rpc.procid() == 0) logstream(LOG_EMPH) << "Use oblivious ingress, usehash: " << usehash
           << ", userecent: " << userecent << std::endl;
         ingress_ptr = new distributed_oblivious_ingress<VertexData, EdgeData>(rpc.dc(), *this, usehash, userecent);
+      } else if (method == "identity") {
+        if (rpc.procid() == 0) logstream(LOG_EMPH) << "Use identity ingress" << std::endl;
+        ingress_ptr = new distributed_identity_ingress<VertexData, EdgeData>(rpc.dc(), *this);
       } else if  (method == "random") {
         if (rpc.procid() == 0)logstream(LOG_EMPH) << "Use random ingress" << std::endl;
         ingress_ptr = new distributed_random_ingress<VertexData, EdgeData>(rpc.dc(), *this); 
@@ -3242,17 +3637,277 @@ namespace graphlab {
     } // end of load from stream
 
 
-    template<typename Fstream, typename Writer>
-    void save_vertex_to_stream(vertex_type& vertex, Fstream& fout, Writer writer) {
-      fout << writer.save_vertex(vertex);
-    } // end of save_vertex_to_stream
+    /**
+     * \internal
+     * Saves all owned vertices and all local edges through a Writer into
+     * the given output streams. Every thread formats into its own
+     * output_buffer, and full buffers are handed to a parallel_block_writer
+     * which compresses and writes them as independent blocks.
+     */
+    template<typename Writer>
+    void save_to_ostreams(const std::vector<std::ostream*>& outstreams,
+                          const Writer& writer, bool gzip,
+                          bool save_vertex, bool save_edge) {
+      typedef typename graph_writer_impl::select_writer_adapter<Writer>::type
+          adapter_type;
+      const size_t block_size = parallel_block_writer::DEFAULT_BLOCK_SIZE;
+      timer savetime; savetime.start();
+      parallel_block_writer block_writer(outstreams, gzip);
+      const ssize_t nverts = local_graph.num_vertices();
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+      {
+        Writer local_writer(writer);
+        output_buffer buffer(block_size + block_size / 4);
+        if (save_vertex) {
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 1024)
+#endif
+          for (ssize_t i = 0; i < nverts; ++i) {
+            if (lvid2record.owner(i) == rpc.procid()) {
+              vertex_type vtx(l_vertex(i));
+              adapter_type::save_vertex(local_writer, vtx, buffer);
+              if (buffer.size() >= block_size) {
+                block_writer.write_block(buffer.data(), buffer.size());
+                buffer.clear();
+              }
+            }
+          }
+        }
+        if (save_edge) {
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 1024)
+#endif
+          for (ssize_t i = 0; i < nverts; ++i) {
+            foreach(const local_edge_type& e, l_vertex(i).in_edges()) {
+              edge_type edge(e);
+              adapter_type::save_edge(local_writer, edge, buffer);
+              if (buffer.size() >= block_size) {
+                block_writer.write_block(buffer.data(), buffer.size());
+                buffer.clear();
+              }
+            }
+          }
+        }
+        block_writer.write_block(buffer.data(), buffer.size());
+      }
+      for (size_t i = 0; i < outstreams.size(); ++i) outstreams[i]->flush();
+      const double elapsed = std::max(savetime.current_time(), 1E-6);
+      logstream(LOG_INFO) << "Saved " 
+                          << block_writer.uncompressed_bytes() / (1024 * 1024)
+                          << " MB (" 
+                          << block_writer.written_bytes() / (1024 * 1024)
+                          << " MB written) in " << elapsed << "s: "
+                          << block_writer.uncompressed_bytes() / elapsed 
+                             / (1024 * 1024)
+                          << " MB/s" << std::endl;
+    } // end of save_to_ostreams
+
+
+    /** \internal
+     * Header of a row group in the "bincol" format
+     */
+    struct columnar_header {
+      enum { VERTEX_GROUP = 0, EDGE_GROUP = 1 };
+      /// The largest number of rows in a row group
+      enum { MAX_ROWS = 65536 };
+      uint32_t type;
+      uint32_t id_bytes;
+      uint32_t data_bytes;
+      uint32_t reserved;
+      uint64_t nrows;
+    };
+
+
+    /**
+     * \brief Saves the graph in the columnar binary ("bincol") format.
+     *
+     * Vertices and edges are stored in row groups of up to
+     * columnar_header::MAX_ROWS rows. Each
+     * row group is a \ref columnar_header followed by the columns of the
+     * group: vertex ids and vertex data for a vertex group, source ids,
+     * target ids and edge data for an edge group. The data columns are
+     * the raw bytes of the data, so the vertex and edge data types must be
+     * POD types. Row groups are produced and compressed in parallel. See
+     * \ref graph_formats for details.
+     *
+     * The output files are [prefix].1_of_N.bincol (with a ".gz" suffix if
+     * gzip is set), and can be loaded with load_format(prefix, "bincol").
+     */
+    void save_columnar(const std::string& prefix, bool gzip,
+                       size_t files_per_machine = 4) {
+      if (!gl_is_pod<vertex_data_type>::value ||
+          !gl_is_pod<edge_data_type>::value) {
+        logstream(LOG_FATAL) 
+          << "The bincol format requires POD vertex and edge data" 
+          << std::endl;
+      }
+      rpc.full_barrier();
+      finalize();
+      std::vector<std::ostream*> outstreams;
+      for(size_t i = 0; i < files_per_machine; ++i) {
+        std::string fname = prefix + "." 
+            + tostr(1 + i + rpc.procid() * files_per_machine)
+            + "_of_" + tostr(rpc.numprocs() * files_per_machine) + ".bincol";
+        if (gzip) fname += ".gz";
+        logstream(LOG_INFO) << "Saving to file: " << fname << std::endl;
+        if(boost::starts_with(fname, "hdfs://")) {
+          outstreams.push_back(
+              new graphlab::hdfs::fstream(hdfs::get_hdfs(), fname, true));
+        } else {
+          outstreams.push_back(
+              new std::ofstream(fname.c_str(),
+                                std::ios_base::out | std::ios_base::binary));
+        }
+      }
+      timer savetime; savetime.start();
+      const size_t rows_per_group = columnar_header::MAX_ROWS;
+      parallel_block_writer block_writer(outstreams, gzip);
+      const size_t nverts = local_graph.num_vertices();
+      const size_t ngroups = (nverts + rows_per_group - 1) / rows_per_group;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+      {
+        output_buffer buffer;
+        std::vector<vertex_id_type> ids, ids2;
+        std::vector<const vertex_data_type*> vdata;
+        std::vector<const edge_data_type*> edata;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 1)
+#endif
+        for (size_t g = 0; g < ngroups; ++g) {
+          const size_t begin = g * rows_per_group;
+          const size_t end = std::min(begin + rows_per_group, nverts);
+          ids.clear(); ids2.clear(); vdata.clear(); edata.clear();
+          buffer.clear();
+          for (size_t v = begin; v < end; ++v) {
+            if (lvid2record.owner(v) == rpc.procid()) {
+              ids.push_back(lvid2record.gvid(v));
+              vdata.push_back(&local_graph.vertex_data(v));
+            }
+          }
+          write_columnar_group(buffer, columnar_header::VERTEX_GROUP, ids, 
+                               ids2, vdata);
+          ids.clear();
+          // edges are grouped by target, in the same vertex ranges
+          for (size_t v = begin; v < end; ++v) {
+            foreach(const local_edge_type& e, l_vertex(v).in_edges()) {
+              ids.push_back(e.source().global_id());
+              ids2.push_back(lvid2record.gvid(v));
+              edata.push_back(&e.data());
+              if (ids.size() == rows_per_group) {
+                write_columnar_group(buffer, columnar_header::EDGE_GROUP, ids,
+                                     ids2, edata);
+                ids.clear(); ids2.clear(); edata.clear();
+                if (buffer.size() >= parallel_block_writer::DEFAULT_BLOCK_SIZE) {
+                  block_writer.write_block(buffer.data(), buffer.size());
+                  buffer.clear();
+                }
+              }
+            }
+          }
+          write_columnar_group(buffer, columnar_header::EDGE_GROUP, ids, 
+                               ids2, edata);
+          block_writer.write_block(buffer.data(), buffer.size());
+        }
+      }
+      for(size_t i = 0; i < outstreams.size(); ++i) delete outstreams[i];
+      const double elapsed = std::max(savetime.current_time(), 1E-6);
+      logstream(LOG_INFO) << "Saved bincol graph: "
+                          << block_writer.uncompressed_bytes() / (1024 * 1024)
+                          << " MB in " << elapsed << "s: "
+                          << block_writer.uncompressed_bytes() / elapsed 
+                             / (1024 * 1024)
+                          << " MB/s" << std::endl;
+      rpc.full_barrier();
+    } // end of save_columnar
+
+
+    /** \internal
+     * Appends a row group of the "bincol" format. ids2 is only written
+     * for edge groups.
+     */
+    template <typename DataType>
+    static void write_columnar_group(output_buffer& out, uint32_t type,
+                                     const std::vector<vertex_id_type>& ids,
+                                     const std::vector<vertex_id_type>& ids2,
+                                     const std::vector<const DataType*>& data) {
+      if (ids.empty()) return;
+      columnar_header header;
+      header.type = type;
+      header.id_bytes = sizeof(vertex_id_type);
+      header.data_bytes = sizeof(DataType);
+      header.reserved = 0;
+      header.nrows = ids.size();
+      out.write_pod(header);
+      out.write(reinterpret_cast<const char*>(&ids[0]),
+                ids.size() * sizeof(vertex_id_type));
+      if (type == columnar_header::EDGE_GROUP) {
+        out.write(reinterpret_cast<const char*>(&ids2[0]),
+                  ids2.size() * sizeof(vertex_id_type));
+      }
+      for (size_t i = 0; i < data.size(); ++i) out.write_pod(*(data[i]));
+    }
 
 
-    template<typename Fstream, typename Writer>
-    void save_edge_to_stream(edge_type& edge, Fstream& fout, Writer writer) {
-      std::string ret = writer.save_edge(edge);
-      fout << ret;
-    } // end of save_edge_to_stream
+    /** \internal
+     * Loads a file in the "bincol" format written by save_columnar().
+     */
+    bool load_columnar_from_stream(std::istream& in) {
+      std::vector<vertex_id_type> ids, ids2;
+      std::vector<vertex_data_type> vdata;
+      std::vector<edge_data_type> edata;
+      while(in.good()) {
+        columnar_header header;
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (in.gcount() == 0) break;
+        const bool is_vertex = header.type == columnar_header::VERTEX_GROUP;
+        const size_t data_bytes = is_vertex ? sizeof(vertex_data_type)
+                                            : sizeof(edge_data_type);
+        if (in.fail() ||
+            (!is_vertex && header.type != columnar_header::EDGE_GROUP) ||
+            header.id_bytes != sizeof(vertex_id_type) ||
+            header.data_bytes != data_bytes ||
+            header.reserved != 0 ||
+            header.nrows > columnar_header::MAX_ROWS) {
+          logstream(LOG_ERROR) << "Malformed or incompatible bincol row group"
+                               << " (type " << header.type
+                               << ", id bytes " << header.id_bytes
+                               << ", data bytes " << header.data_bytes
+                               << ", rows " << header.nrows << ")"
+                               << std::endl;
+          return false;
+        }
+        const size_t nrows = header.nrows;
+        if (nrows == 0) continue;
+        ids.resize(nrows);
+        in.read(reinterpret_cast<char*>(&ids[0]),
+                nrows * sizeof(vertex_id_type));
+        if (is_vertex) {
+          vdata.resize(nrows);
+          in.read(reinterpret_cast<char*>(&vdata[0]),
+                  nrows * sizeof(vertex_data_type));
+        } else {
+          ids2.resize(nrows);
+          in.read(reinterpret_cast<char*>(&ids2[0]),
+                  nrows * sizeof(vertex_id_type));
+          edata.resize(nrows);
+          in.read(reinterpret_cast<char*>(&edata[0]),
+                  nrows * sizeof(edge_data_type));
+        }
+        if (in.fail()) {
+          logstream(LOG_ERROR) << "Truncated bincol row group" << std::endl;
+          return false;
+        }
+        for (size_t i = 0; i < nrows; ++i) {
+          if (is_vertex) add_vertex(ids[i], vdata[i]);
+          else add_edge(ids[i], ids2[i], edata[i]);
+        }
+      }
+      return true;
+    }
 
 
     void save_bintsv4_to_stream(std::ostream& out) {
@@ -278,21 +278,26 @@ namespace graphlab {
 #endif
       counting_sort(edge_buffer.target_arr, src_permute, &dest_counting_prefix_sum);
 
-      std::vector< std::pair<lvid_type, edge_id_type> >  csr_values;
-      std::vector< std::pair<lvid_type, edge_id_type> >  csc_values;
-
-      csr_values.reserve(dest_permute.size());
-      edge_id_type begineid = edges.size();
-      for (size_t i = 0; i < dest_permute.size(); ++i) {
-        csr_values.push_back(std::pair<lvid_type, edge_id_type> (edge_buffer.target_arr[dest_permute[i]],
-                                                                 begineid + dest_permute[i]));
-      }
-      csc_values.reserve(src_permute.size());
+      std::vector< std::pair<lvid_type, edge_id_type> >  csr_values(dest_permute.size());
+      std::vector< std::pair<lvid_type, edge_id_type> >  csc_values(src_permute.size());
 
-      for (size_t i = 0; i < src_permute.size(); ++i) {
-        csc_values.push_back(std::pair<lvid_type, edge_id_type> (edge_buffer.source_arr[src_permute[i]],
-                                                                 begineid + src_permute[i]));
+      const edge_id_type begineid = edges.size();
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t i = 0; i < ssize_t(dest_permute.size()); ++i) {
+        csr_values[i].first = edge_buffer.target_arr[dest_permute[i]];
+        csr_values[i].second = begineid + dest_permute[i];
+      }
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t i = 0; i < ssize_t(src_permute.size()); ++i) {
+        csc_values[i].first = edge_buffer.source_arr[src_permute[i]];
+        csc_values[i].second = begineid + src_permute[i];
       }
+      std::vector<edge_id_type>().swap(dest_permute);
+      std::vector<edge_id_type>().swap(src_permute);
       ASSERT_EQ(csc_values.size(), csr_values.size());
 
       // fast path with first time insertion.
@@ -373,6 +378,27 @@ namespace graphlab {
       std::swap(_csc_storage, other._csc_storage);
     } // end of swap
 
+    /**
+     * \brief Replaces this graph by the topology of a finalized graph
+     * with possibly different vertex and edge data types. The vertex and
+     * edge data are default constructed. The local vertex ids and the
+     * edge ids are the same as in the other graph.
+     */
+    template<typename OtherVertexData, typename OtherEdgeData>
+    void copy_topology(const dynamic_local_graph<OtherVertexData,
+                                                 OtherEdgeData>& other) {
+      if (other.edge_buffer.size() > 0) {
+        logstream(LOG_FATAL)
+          << "Attempting to copy the topology of a local_graph which is "
+          << "not finalized." << std::endl;
+      }
+      clear();
+      vertices.resize(other.num_vertices());
+      edges.resize(other.num_edges());
+      _csr_storage = other._csr_storage;
+      _csc_storage = other._csc_storage;
+    } // end of copy_topology
+
 
     /** \brief Load the local_graph from a file */
     void load(const std::string& filename) {
@@ -488,6 +514,18 @@ namespace graphlab {
       return vlist_size + elist_size + ebuffer_size;
     }
 
+    /**
+     * \internal
+     * \brief The dynamic local graph always keeps its edges in memory.
+     */
+    bool is_out_of_core() const { return false; }
+
+    /// \internal \brief Does nothing. See is_out_of_core().
+    void prefetch_edges(lvid_type begin, lvid_type end) const { }
+
+    /// \internal \brief Does nothing. See is_out_of_core().
+    void release_edges(lvid_type begin, lvid_type end) const { }
+
     /** \internal
      * \brief For debug purpose, returns the largest vertex id in the edge_buffer
      */
@@ -535,6 +573,8 @@ namespace graphlab {
     /*                                                                        */
     /**************************************************************************/
     friend class local_graph_test;
+    template <typename OtherVertexData, typename OtherEdgeData>
+    friend class dynamic_local_graph;
   }; // End of class dynamic_local_graph
 
 
@@ -44,8 +44,10 @@ namespace graphlab {
   /**
    * Identifier type of an edge which is only locally
    * consistent. Guaranteed to be integral and consecutive.
+   * This is always 64 bits wide, even with USE_VID32, since a machine
+   * can hold many more edges than vertices.
    */
-  typedef lvid_type edge_id_type;
+  typedef uint64_t edge_id_type;
 
   /**
    * \brief The set of edges that are traversed during gather and scatter
@@ -0,0 +1,451 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_GRAPH_CONTRACTION_HPP
+#define GRAPHLAB_GRAPH_CONTRACTION_HPP
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <graphlab/util/integer_mix.hpp>
+#include <graphlab/util/timer.hpp>
+#include <graphlab/graph/distributed_graph.hpp>
+#include <graphlab/rpc/dc_dist_object.hpp>
+#include <graphlab/rpc/buffered_exchange.hpp>
+#include <graphlab/macros_def.hpp>
+namespace graphlab {
+
+namespace graph_contraction_impl {
+
+  /// Mixes a vertex id down to a well distributed 32 bit hash
+  inline size_t hash_vertex(vertex_id_type vid) {
+    return integer_mix(uint32_t(vid) ^ integer_mix(uint32_t(uint64_t(vid) >> 32)));
+  }
+
+  /// Hashes a (source, target) pair of vertex ids
+  inline size_t hash_edge(const std::pair<vertex_id_type, vertex_id_type>& e) {
+    return hash_vertex(e.first) ^ integer_mix(uint32_t(hash_vertex(e.second))
+                                              + 0x9e3779b9);
+  }
+
+  template <typename Key, typename Value>
+  struct key_comparator {
+    bool operator()(const std::pair<Key, Value>& a,
+                    const std::pair<Key, Value>& b) const {
+      return a.first < b.first;
+    }
+  };
+
+  /**
+   * (key, value) entries split into a number of independent partitions
+   * by the hash of the key. Entries are first staged into per-thread,
+   * per-partition buffers (no locking). combine() then concatenates,
+   * sorts and combines every partition in parallel, leaving one entry
+   * per key.
+   */
+  template <typename Key, typename Value>
+  class keyed_combiner {
+   public:
+    typedef std::pair<Key, Value> entry_type;
+
+   private:
+    size_t nparts, nthreads;
+    std::vector<std::vector<entry_type> > staging;
+    std::vector<std::vector<entry_type> > parts;
+
+   public:
+    keyed_combiner(): nparts(1), nthreads(1) { }
+
+    /// Clears the entries and prepares for staging from nthreads threads
+    void reset(size_t num_parts, size_t num_threads) {
+      nparts = num_parts; nthreads = num_threads;
+      std::vector<std::vector<entry_type> >(nparts * nthreads).swap(staging);
+      std::vector<std::vector<entry_type> >(nparts).swap(parts);
+    }
+
+    size_t num_parts() const { return nparts; }
+
+    /// Stages an entry. Different threads must use different thread ids.
+    void stage(size_t thread_id, size_t hashval, const entry_type& entry) {
+      staging[thread_id * nparts + hashval % nparts].push_back(entry);
+    }
+
+    /**
+     * Combines the values with the same key in all partitions in
+     * parallel, by calling combine_op(value, other) in an unspecified
+     * order.
+     */
+    template <typename CombineOp>
+    void combine(CombineOp combine_op) {
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t p = 0; p < ssize_t(nparts); ++p) {
+        size_t total = 0;
+        for (size_t t = 0; t < nthreads; ++t) {
+          total += staging[t * nparts + p].size();
+        }
+        std::vector<entry_type>& part = parts[p];
+        part.reserve(part.size() + total);
+        for (size_t t = 0; t < nthreads; ++t) {
+          std::vector<entry_type>& stage = staging[t * nparts + p];
+          part.insert(part.end(), stage.begin(), stage.end());
+          std::vector<entry_type>().swap(stage);
+        }
+        std::sort(part.begin(), part.end(), key_comparator<Key, Value>());
+        size_t out = 0;
+        for (size_t i = 0; i < part.size(); ++i) {
+          if (out > 0 && part[out - 1].first == part[i].first) {
+            combine_op(part[out - 1].second, part[i].second);
+          } else {
+            if (out != i) part[out] = part[i];
+            ++out;
+          }
+        }
+        part.resize(out);
+        std::vector<entry_type>(part).swap(part);
+      }
+    }
+
+    /// Returns the entries of a partition
+    std::vector<entry_type>& partition(size_t p) {
+      return parts[p];
+    }
+
+    /// Returns the number of entries
+    size_t size() const {
+      size_t ret = 0;
+      for (size_t p = 0; p < nparts; ++p) ret += parts[p].size();
+      return ret;
+    }
+  };
+
+} // namespace graph_contraction_impl
+
+
+/**
+ * \brief Contracts a graph by merging the vertices with the same label.
+ *
+ * \tparam Graph Type of the graph to contract
+ * \tparam CoarseGraph Type of the contracted graph
+ *
+ * The contraction builds the quotient graph of a finalized graph: every
+ * vertex is given a label, and each label becomes a vertex of the
+ * coarse graph. An edge between two vertices with different labels
+ * becomes an edge between their labels, and the parallel edges between
+ * two labels are merged into one. Edges between vertices with the same
+ * label are dropped since the coarse graph does not permit self edges.
+ * This is the building block of multilevel algorithms, for instance
+ * contracting the output of connected components or label propagation.
+ *
+ * \code
+ * typedef distributed_graph<vdata, edata> graph_type;
+ * typedef distributed_graph<cluster_data, double> coarse_graph_type;
+ * graph_type graph(dc);
+ * coarse_graph_type coarse(dc);
+ * // ... load and finalize graph ...
+ * graph_contraction<graph_type, coarse_graph_type> contraction(dc, graph,
+ *                                                              coarse);
+ * contraction.contract(label, vertex_map, vertex_combine,
+ *                      edge_map, edge_combine);
+ * \endcode
+ * The functions have the following prototypes:
+ * \code
+ * vertex_id_type label(const graph_type::vertex_type& vertex);
+ * cluster_data vertex_map(const graph_type::vertex_type& vertex);
+ * void vertex_combine(cluster_data& acc, const cluster_data& other);
+ * double edge_map(const graph_type::edge_type& edge);
+ * void edge_combine(double& acc, const double& other);
+ * \endcode
+ * The label of a vertex is the id of its coarse vertex. The data of a
+ * coarse vertex is vertex_map() of its vertices, merged with
+ * vertex_combine(), and the data of a coarse edge is edge_map() of its
+ * edges, merged with edge_combine(). The order in which the values are
+ * combined is unspecified.
+ *
+ * The vertex and edge values are combined on the machine which holds
+ * them, then shuffled by label through buffered exchanges to a machine
+ * chosen by hash, combined again and added to the coarse graph, which
+ * is then finalized. All of these steps run in parallel.
+ */
+template <typename Graph, typename CoarseGraph>
+class graph_contraction {
+  public:
+    /// Type of the graph to contract
+    typedef Graph graph_type;
+    /// Type of the contracted graph
+    typedef CoarseGraph coarse_graph_type;
+    /// Vertex data type of the contracted graph
+    typedef typename coarse_graph_type::vertex_data_type coarse_vertex_data_type;
+    /// Edge data type of the contracted graph
+    typedef typename coarse_graph_type::edge_data_type coarse_edge_data_type;
+
+    dc_dist_object<graph_contraction<Graph, CoarseGraph> > rmi;
+
+  private:
+    typedef std::pair<vertex_id_type, vertex_id_type> edge_key_type;
+    typedef graph_contraction_impl::keyed_combiner<vertex_id_type,
+                                                   coarse_vertex_data_type>
+        vertex_combiner_type;
+    typedef graph_contraction_impl::keyed_combiner<edge_key_type,
+                                                   coarse_edge_data_type>
+        edge_combiner_type;
+
+    /// Reference to the graph to contract
+    graph_type& graph;
+    /// Reference to the contracted graph
+    coarse_graph_type& coarse;
+    /// The label of every local vertex, including mirrors
+    std::vector<vertex_id_type> labels;
+
+  public:
+    graph_contraction(distributed_control& dc,
+                      graph_type& graph,
+                      coarse_graph_type& coarse):
+        rmi(dc, this), graph(graph), coarse(coarse) { }
+
+    /**
+     * \brief Builds the contracted graph.
+     *
+     * \param label Returns the coarse vertex id of a vertex. Called once
+     *   on every vertex.
+     * \param vertex_map Returns the coarse vertex data of a vertex.
+     * \param vertex_combine Merges the coarse vertex data of two vertices
+     *   with the same label.
+     * \param edge_map Returns the coarse edge data of an edge.
+     * \param edge_combine Merges the coarse edge data of two edges
+     *   between the same labels.
+     *
+     * The graph must be finalized and the coarse graph must be empty. The
+     * coarse graph is finalized on return. This function must be called
+     * by all machines.
+     */
+    template <typename LabelFn, typename VertexMap, typename VertexCombine,
+              typename EdgeMap, typename EdgeCombine>
+    void contract(LabelFn label, VertexMap vertex_map,
+                  VertexCombine vertex_combine,
+                  EdgeMap edge_map, EdgeCombine edge_combine) {
+      if (!graph.is_finalized()) {
+        logstream(LOG_FATAL)
+          << "\n\tAttempting to contract a graph before calling "
+          << "graph.finalize()." << std::endl;
+      }
+      timer ti; ti.start();
+      compute_labels(label);
+
+      // combine the vertex data by label
+      const size_t nthreads = num_threads();
+      vertex_combiner_type vertices;
+      vertices.reset(nthreads, nthreads);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t v = 0; v < ssize_t(graph.num_local_vertices()); ++v) {
+        typename graph_type::local_vertex_type lv = graph.l_vertex(v);
+        if (lv.owned()) {
+          typename graph_type::vertex_type vtx(lv);
+          vertices.stage(thread_id(),
+                         graph_contraction_impl::hash_vertex(labels[v]),
+                         std::make_pair(labels[v], vertex_map(vtx)));
+        }
+      }
+      vertex_combiner_type coarse_vertices;
+      shuffle_combine(vertices, coarse_vertices,
+                      graph_contraction_impl::hash_vertex, vertex_combine);
+
+      // combine the edge data by pair of labels. Every edge is stored on
+      // exactly one machine.
+      edge_combiner_type edges;
+      edges.reset(nthreads, nthreads);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+      for (ssize_t v = 0; v < ssize_t(graph.num_local_vertices()); ++v) {
+        const size_t thread = thread_id();
+        const vertex_id_type source_label = labels[v];
+        foreach(const typename graph_type::local_edge_type& e,
+                graph.l_vertex(v).out_edges()) {
+          const vertex_id_type target_label = labels[e.target().id()];
+          if (source_label == target_label) continue;
+          const edge_key_type key(source_label, target_label);
+          typename graph_type::edge_type edge(e);
+          edges.stage(thread, graph_contraction_impl::hash_edge(key),
+                      std::make_pair(key, edge_map(edge)));
+        }
+      }
+      edge_combiner_type coarse_edges;
+      shuffle_combine(edges, coarse_edges,
+                      graph_contraction_impl::hash_edge, edge_combine);
+      std::vector<vertex_id_type>().swap(labels);
+
+      // build the coarse graph
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t p = 0; p < ssize_t(coarse_vertices.num_parts()); ++p) {
+        foreach(const typename vertex_combiner_type::entry_type& entry,
+                coarse_vertices.partition(p)) {
+          coarse.add_vertex(entry.first, entry.second);
+        }
+      }
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t p = 0; p < ssize_t(coarse_edges.num_parts()); ++p) {
+        foreach(const typename edge_combiner_type::entry_type& entry,
+                coarse_edges.partition(p)) {
+          coarse.add_edge(entry.first.first, entry.first.second,
+                          entry.second);
+        }
+      }
+      coarse.finalize();
+      const double runtime = std::max(ti.current_time(), 1E-6);
+      if (rmi.procid() == 0) {
+        logstream(LOG_INFO) << "Contracted " << graph.num_vertices()
+                            << " vertices and " << graph.num_edges()
+                            << " edges into " << coarse.num_vertices()
+                            << " vertices and " << coarse.num_edges()
+                            << " edges in " << runtime << "s ("
+                            << graph.num_edges() / runtime << " edges/s)"
+                            << std::endl;
+      }
+    }
+
+  private:
+    static size_t num_threads() {
+#ifdef _OPENMP
+      return omp_get_max_threads();
+#else
+      return 1;
+#endif
+    }
+
+    static size_t thread_id() {
+#ifdef _OPENMP
+      return omp_get_thread_num();
+#else
+      return 0;
+#endif
+    }
+
+    /// The machine responsible for a key with the given hash
+    procid_t home_proc(size_t hashval) const {
+      return hashval % rmi.numprocs();
+    }
+
+    /// The hash used to partition keys within a machine
+    size_t local_hash(size_t hashval) const {
+      return hashval / rmi.numprocs();
+    }
+
+    /**
+     * Labels the owned vertices and sends their labels to the mirrors,
+     * so that the labels of both ends of every local edge are known.
+     */
+    template <typename LabelFn>
+    void compute_labels(LabelFn& label) {
+      typedef std::pair<vertex_id_type, vertex_id_type> label_pair;
+      labels.assign(graph.num_local_vertices(), vertex_id_type(-1));
+      buffered_exchange<label_pair> label_exchange(rmi.dc(), num_threads());
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t v = 0; v < ssize_t(graph.num_local_vertices()); ++v) {
+        typename graph_type::local_vertex_type lv = graph.l_vertex(v);
+        if (lv.owned()) {
+          typename graph_type::vertex_type vtx(lv);
+          labels[v] = label(vtx);
+          foreach(procid_t proc, lv.mirrors()) {
+            label_exchange.send(proc, label_pair(lv.global_id(), labels[v]),
+                                thread_id());
+          }
+        }
+        // drain early to bound the size of the receive queue
+        if (v % 1024 == 0) receive_labels(label_exchange, true);
+      }
+      label_exchange.flush();
+      receive_labels(label_exchange, false);
+    }
+
+    template <typename LabelExchange>
+    void receive_labels(LabelExchange& label_exchange, bool try_lock) {
+      procid_t proc;
+      typename LabelExchange::buffer_type buffer;
+      while(label_exchange.recv(proc, buffer, try_lock)) {
+        for (size_t i = 0; i < buffer.size(); ++i) {
+          labels[graph.local_vid(buffer[i].first)] = buffer[i].second;
+        }
+        buffer.clear();
+      }
+    }
+
+    /**
+     * Combines the entries staged in local, sends every entry to the
+     * machine responsible for its key and combines them again in home.
+     * Combining first keeps one entry per key and machine on the wire.
+     */
+    template <typename Combiner, typename HashFn, typename CombineOp>
+    void shuffle_combine(Combiner& local, Combiner& home, HashFn hash,
+                         CombineOp& combine_op) {
+      typedef typename Combiner::entry_type entry_type;
+      const size_t nthreads = num_threads();
+      local.combine(combine_op);
+      home.reset(nthreads, nthreads);
+      buffered_exchange<entry_type> exchange(rmi.dc(), nthreads);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t p = 0; p < ssize_t(local.num_parts()); ++p) {
+        const size_t thread = thread_id();
+        std::vector<entry_type>& part = local.partition(p);
+        for (size_t i = 0; i < part.size(); ++i) {
+          exchange.send(home_proc(hash(part[i].first)), part[i], thread);
+        }
+        std::vector<entry_type>().swap(part);
+        receive_entries(exchange, home, hash, thread, true);
+      }
+      exchange.flush();
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+      {
+        receive_entries(exchange, home, hash, thread_id(), false);
+      }
+      home.combine(combine_op);
+    }
+
+    template <typename Exchange, typename Combiner, typename HashFn>
+    void receive_entries(Exchange& exchange, Combiner& home, HashFn hash,
+                         size_t thread, bool try_lock) {
+      procid_t proc;
+      typename Exchange::buffer_type buffer;
+      while(exchange.recv(proc, buffer, try_lock)) {
+        for (size_t i = 0; i < buffer.size(); ++i) {
+          home.stage(thread, local_hash(hash(buffer[i].first)), buffer[i]);
+        }
+        buffer.clear();
+      }
+    }
+};
+
+} // namespace graphlab
+#include <graphlab/macros_undef.hpp>
+#endif
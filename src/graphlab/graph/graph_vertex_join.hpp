@@ -23,12 +23,143 @@
 #ifndef GRAPHLAB_GRAPH_JOIN_HPP
 #define GRAPHLAB_GRAPH_JOIN_HPP
 #include <utility>
+#include <vector>
+#include <algorithm>
 #include <boost/unordered_map.hpp>
 #include <graphlab/util/hopscotch_map.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/util/integer_mix.hpp>
+#include <graphlab/util/timer.hpp>
 #include <graphlab/graph/distributed_graph.hpp>
 #include <graphlab/rpc/dc_dist_object.hpp>
+#include <graphlab/rpc/buffered_exchange.hpp>
 namespace graphlab {
 
+namespace graph_vertex_join_impl {
+
+  /// Mixes a 64 bit join key down to a well distributed 32 bit hash
+  inline size_t hash_key(size_t key) {
+    return integer_mix(uint32_t(key) ^ integer_mix(uint32_t(key >> 32)));
+  }
+
+  template <typename T>
+  struct key_comparator {
+    bool operator()(const std::pair<size_t, T>& a,
+                    const std::pair<size_t, T>& b) const {
+      return a.first < b.first;
+    }
+  };
+
+  /// Placeholder combiner used when the join has no combine operation
+  struct no_combine {
+    template <typename T>
+    void operator()(T& a, const T& b) const { }
+  };
+
+  /**
+   * A key -> value multimap split into a number of independent partitions
+   * so that it can be built and probed by many threads at once.
+   * Entries are first staged into per-thread, per-partition buffers (no
+   * locking). build() then concatenates, sorts and indexes every partition
+   * in parallel. Each partition stores its entries sorted by key, together
+   * with a hash table mapping a key to its first entry.
+   */
+  template <typename T>
+  class partitioned_multimap {
+   public:
+    typedef std::pair<size_t, T> entry_type;
+
+   private:
+    size_t nparts, nthreads;
+    std::vector<std::vector<entry_type> > staging;
+    std::vector<std::vector<entry_type> > parts;
+    std::vector<hopscotch_map<size_t, size_t> > offsets;
+
+   public:
+    partitioned_multimap(): nparts(1), nthreads(1) { }
+
+    /// Clears the map and prepares it for staging from nthreads threads
+    void reset(size_t num_parts, size_t num_threads) {
+      nparts = num_parts; nthreads = num_threads;
+      std::vector<std::vector<entry_type> >(nparts * nthreads).swap(staging);
+      std::vector<std::vector<entry_type> >(nparts).swap(parts);
+      std::vector<hopscotch_map<size_t, size_t> >(nparts).swap(offsets);
+    }
+
+    size_t num_parts() const { return nparts; }
+
+    /// Returns the partition a key belongs to given its hash value
+    size_t part_of(size_t hashval) const { return hashval % nparts; }
+
+    /// Stages an entry. Different threads must use different thread ids.
+    void stage(size_t thread_id, size_t hashval, const entry_type& entry) {
+      staging[thread_id * nparts + part_of(hashval)].push_back(entry);
+    }
+
+    /**
+     * Builds all partitions in parallel. Duplicate (key, value) entries are
+     * removed.
+     */
+    void build() {
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (size_t p = 0; p < nparts; ++p) {
+        size_t total = 0;
+        for (size_t t = 0; t < nthreads; ++t) {
+          total += staging[t * nparts + p].size();
+        }
+        std::vector<entry_type>& part = parts[p];
+        part.reserve(total);
+        for (size_t t = 0; t < nthreads; ++t) {
+          std::vector<entry_type>& stage = staging[t * nparts + p];
+          part.insert(part.end(), stage.begin(), stage.end());
+          std::vector<entry_type>().swap(stage);
+        }
+        std::sort(part.begin(), part.end());
+        part.erase(std::unique(part.begin(), part.end()), part.end());
+        std::vector<entry_type>(part).swap(part);
+        for (size_t i = 0; i < part.size(); ++i) {
+          if (i == 0 || part[i].first != part[i - 1].first) {
+            offsets[p].insert(std::make_pair(part[i].first, i));
+          }
+        }
+      }
+      std::vector<std::vector<entry_type> >().swap(staging);
+    }
+
+    /**
+     * Finds the range of entries with the given key. Returns false if
+     * the key is not present. Safe to call concurrently after build().
+     */
+    bool find(size_t key, size_t hashval,
+              const entry_type*& begin, const entry_type*& end) const {
+      const size_t p = part_of(hashval);
+      hopscotch_map<size_t, size_t>::const_iterator iter = offsets[p].find(key);
+      if (iter == offsets[p].end()) return false;
+      const std::vector<entry_type>& part = parts[p];
+      begin = &(part[iter->second]);
+      size_t i = iter->second + 1;
+      while (i < part.size() && part[i].first == key) ++i;
+      end = &(part[0]) + i;
+      return true;
+    }
+
+    /// Returns the entries of a partition, sorted by key
+    const std::vector<entry_type>& partition(size_t p) const {
+      return parts[p];
+    }
+
+    /// Returns the number of distinct keys
+    size_t num_keys() const {
+      size_t ret = 0;
+      for (size_t p = 0; p < nparts; ++p) ret += offsets[p].size();
+      return ret;
+    }
+  };
+
+} // namespace graph_vertex_join_impl
+
 
 /**
  * \brief Provides the ability to pass information between vertices of two 
@@ -166,6 +297,48 @@ namespace graphlab {
  * ## Right Injective Join
  * The right injective join is similar to the left injective join, but
  * with types reversed.
+ *
+ * ## General Join
+ * The general join lifts the uniqueness requirement on keys: any number
+ * of vertices on either graph may emit the same key. It is prepared with
+ * \code
+ * vjoin.prepare_join(left_emit_key, right_emit_key);
+ * \endcode
+ * using the same emit functions as prepare_injective_join().
+ * Keys are hash partitioned across machines and threads, so all of
+ * the preparation and the join itself run in parallel.
+ *
+ * To join the right graph into the left graph:
+ * \code
+ * vjoin.left_join(join_op);
+ * vjoin.left_join(join_op, combine_op);
+ * \endcode
+ * join_op has the same prototype as in left_injective_join(), and is called
+ * exactly once on every left vertex which has a matching right vertex.
+ * Each key may be emitted by several left vertices (a one-to-many join),
+ * and all of them receive the same right vertex data.
+ * If several right vertices may emit the same key, a combine_op
+ * must be provided to merge their data before it is passed to join_op:
+ * \code
+ * void combine_op(graph_2_type::vertex_data_type& accumulator,
+ *                 const graph_2_type::vertex_data_type& other);
+ * \endcode
+ * The order in which right vertices are combined is unspecified.
+ * right_join() is symmetric.
+ *
+ * For instance, to count the sessions (right graph) of each user (left
+ * graph) where every session vertex stores a count of 1 and the user id:
+ * \code
+ * void add_counts(session_data& acc, const session_data& other) {
+ *   acc.count += other.count;
+ * }
+ * void set_count(user_graph_type::vertex_type& user,
+ *                const session_data& sessions) {
+ *   user.data().num_sessions = sessions.count;
+ * }
+ * vjoin.prepare_join(emit_user_id, emit_session_user_id);
+ * vjoin.left_join(set_count, add_counts);
+ * \endcode
  */
 template <typename LeftGraph, typename RightGraph> 
 class graph_vertex_join {
@@ -204,6 +377,26 @@ class graph_vertex_join {
 
     injective_join_index left_inj_index, right_inj_index;
 
+    /// Identifies the two sides of the join in messages and home entries
+    enum { LEFT_SIDE = 0, RIGHT_SIDE = 1 };
+
+    struct join_index {
+      // the key for each vertex. (size_t)(-1) if not participating
+      std::vector<size_t> vtx_to_key;
+      // key -> owned local vertices emitting the key
+      graph_vertex_join_impl::partitioned_multimap<lvid_type> key_to_vtx;
+      // set if a vertex with the same key exists in the opposing graph
+      dense_bitset matched;
+    };
+
+    join_index left_index, right_index;
+
+    /**
+     * For the keys which hash to this machine: key -> the machines holding
+     * a vertex with the key, encoded as (procid * 2 + side).
+     */
+    graph_vertex_join_impl::partitioned_multimap<size_t> home_index;
+
   public:
     graph_vertex_join(distributed_control& dc,
                       left_graph_type& left,
@@ -333,6 +526,159 @@ class graph_vertex_join {
                      join_op);
     }
 
+
+    /**
+      * \brief Initializes a general join by associating each vertex with a
+      * key.
+      *
+      * Like prepare_injective_join(), but keys need not be unique on either
+      * graph. A vertex which emits the key (size_t)(-1) does not participate.
+      * This function must be called by all machines.
+      *
+      * The keys are shuffled to a "home" machine chosen by hash, where
+      * per-thread hash tables recording which machines hold each key are
+      * built in parallel. Each machine is then told which of its keys have
+      * a match in the opposing graph.
+      *
+      * prepare_join() only needs to be called once. After which an
+      * arbitrary number of left_join() and right_join() calls may be made.
+      */
+    template <typename LeftEmitKey, typename RightEmitKey>
+    void prepare_join(LeftEmitKey left_emit_key,
+                      RightEmitKey right_emit_key) {
+      typedef std::pair<size_t, unsigned char> key_side_pair;
+      timer ti; ti.start();
+      const size_t nthreads = num_threads();
+      home_index.reset(nthreads, nthreads);
+
+      buffered_exchange<key_side_pair> key_exchange(rmi.dc(), nthreads);
+      size_t nkeys = 
+          reset_and_fill_join_index(left_index, left_graph, left_emit_key,
+                                    LEFT_SIDE, key_exchange);
+      nkeys += 
+          reset_and_fill_join_index(right_index, right_graph, right_emit_key,
+                                    RIGHT_SIDE, key_exchange);
+      key_exchange.flush();
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+      {
+        receive_home_keys(key_exchange, thread_id());
+      }
+      home_index.build();
+      // tell every machine which of its keys have an opposing match
+      buffered_exchange<key_side_pair> match_exchange(rmi.dc(), nthreads);
+      size_t nmatched = 0;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+ : nmatched)
+#endif
+      for (size_t p = 0; p < home_index.num_parts(); ++p) {
+        const size_t thread = thread_id();
+        const std::vector<std::pair<size_t, size_t> >& part = 
+            home_index.partition(p);
+        size_t i = 0;
+        while (i < part.size()) {
+          size_t j = i;
+          bool has_side[2] = {false, false};
+          while (j < part.size() && part[j].first == part[i].first) {
+            has_side[part[j].second % 2] = true;
+            ++j;
+          }
+          if (has_side[LEFT_SIDE] && has_side[RIGHT_SIDE]) {
+            ++nmatched;
+            for (size_t k = i; k < j; ++k) {
+              match_exchange.send(part[k].second / 2, 
+                                  key_side_pair(part[k].first, 
+                                                part[k].second % 2),
+                                  thread);
+            }
+          }
+          i = j;
+        }
+        receive_matches(match_exchange, true);
+      }
+      match_exchange.flush();
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+      {
+        receive_matches(match_exchange, false);
+      }
+      rmi.all_reduce(nkeys);
+      rmi.all_reduce(nmatched);
+      if (rmi.procid() == 0) {
+        logstream(LOG_INFO) << "Join prepared: " << nkeys << " keys, "
+                            << nmatched << " matched in " 
+                            << ti.current_time() << "s ("
+                            << nkeys / std::max(ti.current_time(), 1E-6)
+                            << " keys/s)" << std::endl;
+      }
+    }
+
+    /**
+     * \brief Performs a general join from the right graph to the left graph.
+     *
+     * \param join_op The joining function. May be a function pointer or a
+     * functor matching the prototype
+     * void join_op(LeftGraph::vertex_type& left_vertex,
+     *              const RightGraph::vertex_data_type right_vertex_data);
+     *
+     * prepare_join() must be called before hand. All machines must call this
+     * function. join_op is called once on every left vertex whose key was
+     * emitted by a right vertex. Each key may be emitted by at most one
+     * right vertex. Use the two argument version to join with keys emitted
+     * by many right vertices.
+     */
+    template <typename JoinOp>
+    void left_join(JoinOp join_op) {
+      hash_join(left_index, left_graph, LEFT_SIDE,
+                right_index, right_graph,
+                join_op, graph_vertex_join_impl::no_combine(), false);
+    }
+
+    /**
+     * \brief Performs a general join from the right graph to the left graph,
+     * combining the data of right vertices which emitted the same key.
+     *
+     * \param join_op The joining function. See left_join(JoinOp).
+     * \param combine_op The combining function. May be a function pointer or
+     * a functor matching the prototype
+     * void combine_op(RightGraph::vertex_data_type& accumulator,
+     *                 const RightGraph::vertex_data_type& other);
+     *
+     * prepare_join() must be called before hand. All machines must call this
+     * function.
+     */
+    template <typename JoinOp, typename CombineOp>
+    void left_join(JoinOp join_op, CombineOp combine_op) {
+      hash_join(left_index, left_graph, LEFT_SIDE,
+                right_index, right_graph,
+                join_op, combine_op, true);
+    }
+
+    /**
+     * \brief Performs a general join from the left graph to the right graph.
+     * See left_join(JoinOp) with the graphs reversed.
+     */
+    template <typename JoinOp>
+    void right_join(JoinOp join_op) {
+      hash_join(right_index, right_graph, RIGHT_SIDE,
+                left_index, left_graph,
+                join_op, graph_vertex_join_impl::no_combine(), false);
+    }
+
+    /**
+     * \brief Performs a general join from the left graph to the right graph,
+     * combining the data of left vertices which emitted the same key.
+     * See left_join(JoinOp, CombineOp) with the graphs reversed.
+     */
+    template <typename JoinOp, typename CombineOp>
+    void right_join(JoinOp join_op, CombineOp combine_op) {
+      hash_join(right_index, right_graph, RIGHT_SIDE,
+                left_index, left_graph,
+                join_op, combine_op, true);
+    }
+
   private:
     template <typename Graph, typename EmitKey>
     void reset_and_fill_injective_index(injective_join_index& idx,
@@ -471,6 +817,260 @@ class graph_vertex_join {
       return procs_with_keys;
     }
 
+    static size_t num_threads() {
+#ifdef _OPENMP
+      return omp_get_max_threads();
+#else
+      return 1;
+#endif
+    }
+
+    static size_t thread_id() {
+#ifdef _OPENMP
+      return omp_get_thread_num();
+#else
+      return 0;
+#endif
+    }
+
+    /// The machine responsible for a key with the given hash
+    procid_t home_proc(size_t hashval) const {
+      return hashval % rmi.numprocs();
+    }
+
+    /// The hash used to partition keys within a machine
+    size_t local_hash(size_t hashval) const {
+      return hashval / rmi.numprocs();
+    }
+
+    // Fills the general join index of one graph, and sends every key
+    // to its home machine. Returns the number of participating vertices.
+    template <typename Graph, typename EmitKey, typename KeyExchange>
+    size_t reset_and_fill_join_index(join_index& idx,
+                                     Graph& graph,
+                                     EmitKey& emit_key,
+                                     unsigned char side,
+                                     KeyExchange& key_exchange) {
+      const size_t nthreads = num_threads();
+      idx.vtx_to_key.assign(graph.num_local_vertices(), (size_t)(-1));
+      idx.key_to_vtx.reset(nthreads, nthreads);
+      idx.matched.resize(graph.num_local_vertices());
+      idx.matched.clear();
+      size_t nkeys = 0;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+ : nkeys)
+#endif
+      for (size_t v = 0; v < graph.num_local_vertices(); ++v) {
+        const size_t thread = thread_id();
+        typename Graph::local_vertex_type lv = graph.l_vertex(v);
+        if (lv.owned()) {
+          typename Graph::vertex_type vtx(lv);
+          const size_t key = emit_key(vtx);
+          idx.vtx_to_key[v] = key;
+          if (key != (size_t)(-1)) {
+            ++nkeys;
+            const size_t hashval = graph_vertex_join_impl::hash_key(key);
+            idx.key_to_vtx.stage(thread, local_hash(hashval),
+                                 std::make_pair(key, lvid_type(v)));
+            key_exchange.send(home_proc(hashval), 
+                              std::make_pair(key, side), thread);
+          }
+        }
+        // drain early to bound the size of the receive queue
+        if (v % 1024 == 0) receive_home_keys(key_exchange, thread, true);
+      }
+      idx.key_to_vtx.build();
+      return nkeys;
+    }
+
+    // Stages received keys into the home index
+    template <typename KeyExchange>
+    void receive_home_keys(KeyExchange& key_exchange, size_t thread,
+                           bool try_lock = false) {
+      procid_t proc;
+      typename KeyExchange::buffer_type buffer;
+      while(key_exchange.recv(proc, buffer, try_lock)) {
+        for (size_t i = 0; i < buffer.size(); ++i) {
+          const size_t hashval = 
+              graph_vertex_join_impl::hash_key(buffer[i].first);
+          home_index.stage(thread, local_hash(hashval),
+                           std::make_pair(buffer[i].first,
+                                          size_t(proc) * 2 + buffer[i].second));
+        }
+        buffer.clear();
+      }
+    }
+
+    // Marks every local vertex whose key was matched by the home machine
+    template <typename MatchExchange>
+    void receive_matches(MatchExchange& match_exchange, bool try_lock) {
+      procid_t proc;
+      typename MatchExchange::buffer_type buffer;
+      while(match_exchange.recv(proc, buffer, try_lock)) {
+        for (size_t i = 0; i < buffer.size(); ++i) {
+          join_index& idx = 
+              buffer[i].second == LEFT_SIDE ? left_index : right_index;
+          const size_t key = buffer[i].first;
+          const std::pair<size_t, lvid_type> *begin, *end;
+          const bool found = idx.key_to_vtx.find(
+              key, local_hash(graph_vertex_join_impl::hash_key(key)),
+              begin, end);
+          ASSERT_TRUE(found);
+          for (; begin != end; ++begin) idx.matched.set_bit(begin->second);
+        }
+        buffer.clear();
+      }
+    }
+
+    template <typename TargetGraph, typename SourceGraph,
+              typename JoinOp, typename CombineOp>
+    void hash_join(join_index& target,
+                   TargetGraph& target_graph,
+                   unsigned char target_side,
+                   join_index& source,
+                   SourceGraph& source_graph,
+                   JoinOp joinop, CombineOp combineop, bool has_combiner) {
+      typedef typename SourceGraph::vertex_data_type source_data_type;
+      typedef std::pair<size_t, source_data_type> key_data_pair;
+      typedef buffered_exchange<key_data_pair> data_exchange_type;
+      timer ti; ti.start();
+      const size_t nthreads = num_threads();
+      const size_t nparts = home_index.num_parts();
+      ASSERT_EQ(source.vtx_to_key.size(), source_graph.num_local_vertices());
+      ASSERT_EQ(target.vtx_to_key.size(), target_graph.num_local_vertices());
+      // shuffle the matched source data to the home machine of each key.
+      data_exchange_type source_exchange(rmi.dc(), nthreads);
+      std::vector<std::vector<key_data_pair> > staged(nthreads * nparts);
+      size_t nsent = 0;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+ : nsent)
+#endif
+      for (size_t v = 0; v < source.vtx_to_key.size(); ++v) {
+        const size_t thread = thread_id();
+        if (source.matched.get(v)) {
+          const size_t key = source.vtx_to_key[v];
+          const size_t hashval = graph_vertex_join_impl::hash_key(key);
+          source_exchange.send(home_proc(hashval), 
+                               key_data_pair(key, source_graph.l_vertex(v).data()),
+                               thread);
+          ++nsent;
+        }
+        if (v % 1024 == 0) {
+          stage_source_data(source_exchange, staged, thread, true);
+        }
+      }
+      source_exchange.flush();
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+      {
+        stage_source_data(source_exchange, staged, thread_id(), false);
+      }
+      // combine the values of each key, and emit to the target machines
+      data_exchange_type target_exchange(rmi.dc(), nthreads);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (size_t p = 0; p < nparts; ++p) {
+        const size_t thread = thread_id();
+        std::vector<key_data_pair> values;
+        for (size_t t = 0; t < nthreads; ++t) {
+          std::vector<key_data_pair>& stage = staged[t * nparts + p];
+          values.insert(values.end(), stage.begin(), stage.end());
+          std::vector<key_data_pair>().swap(stage);
+        }
+        std::sort(values.begin(), values.end(),
+                  graph_vertex_join_impl::key_comparator<source_data_type>());
+        size_t i = 0, ngroups = 0;
+        while (i < values.size()) {
+          size_t j = i + 1;
+          for (; j < values.size() && values[j].first == values[i].first; ++j) {
+            ASSERT_MSG(has_combiner, 
+                       "Duplicate source keys in join require a combiner");
+            combineop(values[i].second, values[j].second);
+          }
+          const size_t key = values[i].first;
+          const std::pair<size_t, size_t> *begin, *end;
+          const bool found = home_index.find(
+              key, local_hash(graph_vertex_join_impl::hash_key(key)),
+              begin, end);
+          ASSERT_TRUE(found);
+          for (; begin != end; ++begin) {
+            if (begin->second % 2 == target_side) {
+              target_exchange.send(begin->second / 2, values[i], thread);
+            }
+          }
+          i = j;
+          if (++ngroups % 1024 == 0) {
+            apply_join_results(target_exchange, target, target_graph, 
+                               joinop, true);
+          }
+        }
+      }
+      target_exchange.flush();
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+      {
+        apply_join_results(target_exchange, target, target_graph, 
+                           joinop, false);
+      }
+      target_graph.synchronize();
+      rmi.all_reduce(nsent);
+      if (rmi.procid() == 0) {
+        logstream(LOG_INFO) << "Join: " << nsent << " source vertices in " 
+                            << ti.current_time() << "s ("
+                            << nsent / std::max(ti.current_time(), 1E-6)
+                            << " keys/s)" << std::endl;
+      }
+    }
+
+    // Moves received source data into the per-thread partition buffers
+    template <typename DataExchange, typename KeyDataPair>
+    void stage_source_data(DataExchange& exchange,
+                           std::vector<std::vector<KeyDataPair> >& staged,
+                           size_t thread, bool try_lock) {
+      const size_t nparts = home_index.num_parts();
+      procid_t proc;
+      typename DataExchange::buffer_type buffer;
+      while(exchange.recv(proc, buffer, try_lock)) {
+        for (size_t i = 0; i < buffer.size(); ++i) {
+          const size_t hashval = 
+              graph_vertex_join_impl::hash_key(buffer[i].first);
+          staged[thread * nparts + home_index.part_of(local_hash(hashval))]
+              .push_back(buffer[i]);
+        }
+        buffer.clear();
+      }
+    }
+
+    // Calls the join operation on every target vertex matching a received key
+    template <typename DataExchange, typename TargetGraph, typename JoinOp>
+    void apply_join_results(DataExchange& exchange,
+                            join_index& target,
+                            TargetGraph& target_graph,
+                            JoinOp& joinop, bool try_lock) {
+      procid_t proc;
+      typename DataExchange::buffer_type buffer;
+      while(exchange.recv(proc, buffer, try_lock)) {
+        for (size_t i = 0; i < buffer.size(); ++i) {
+          const size_t key = buffer[i].first;
+          const std::pair<size_t, lvid_type> *begin, *end;
+          const bool found = target.key_to_vtx.find(
+              key, local_hash(graph_vertex_join_impl::hash_key(key)),
+              begin, end);
+          ASSERT_TRUE(found);
+          for (; begin != end; ++begin) {
+            typename TargetGraph::local_vertex_type 
+                lvtx = target_graph.l_vertex(begin->second);
+            typename TargetGraph::vertex_type vtx(lvtx);
+            joinop(vtx, buffer[i].second);
+          }
+        }
+        buffer.clear();
+      }
+    }
+
     template <typename TargetGraph, typename SourceGraph, typename JoinOp>
     void injective_join(injective_join_index& target,
                         TargetGraph& target_graph,
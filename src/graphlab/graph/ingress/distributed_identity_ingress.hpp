@@ -64,7 +64,11 @@ namespace graphlab {
       typedef typename base_type::edge_buffer_record edge_buffer_record;
       const procid_t owning_proc = base_type::rpc.procid();
       const edge_buffer_record record(source, target, edata);
+#ifdef _OPENMP
+      base_type::edge_exchange.send(owning_proc, record, omp_get_thread_num());
+#else
       base_type::edge_exchange.send(owning_proc, record);
+#endif
     } // end of add edge
   }; // end of distributed_identity_ingress
 }; // end of namespace graphlab
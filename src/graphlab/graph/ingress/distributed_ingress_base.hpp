@@ -249,6 +249,11 @@ namespace graphlab {
       if(rpc.procid() == 0)       
         memory_info::log_usage("Post Flush");
 
+      // The new vertices are merged into vid2lvid at the end. Convert a
+      // compacted map back to a hash map here, serially, so that nothing
+      // below converts it while other threads read it.
+      graph.vid2lvid.expand();
+
      
       /**************************************************************************/
       /*                                                                        */
@@ -264,8 +269,8 @@ namespace graphlab {
         while(edge_exchange.recv(proc, edge_buffer)) {
           foreach(const edge_buffer_record& rec, edge_buffer) {
             // Get the source_vlid;
-            lvid_type source_lvid(-1);
-            if(graph.vid2lvid.find(rec.source) == graph.vid2lvid.end()) {
+            lvid_type source_lvid = graph.vid2lvid.lookup(rec.source);
+            if(source_lvid == lvid_type(-1)) {
               if (vid2lvid_buffer.find(rec.source) == vid2lvid_buffer.end()) {
                 source_lvid = lvid_start + vid2lvid_buffer.size();
                 vid2lvid_buffer[rec.source] = source_lvid;
@@ -273,12 +278,11 @@ namespace graphlab {
                 source_lvid = vid2lvid_buffer[rec.source];
               }
             } else {
-              source_lvid = graph.vid2lvid[rec.source];
               updated_lvids.set_bit(source_lvid);
             }
             // Get the target_lvid;
-            lvid_type target_lvid(-1);
-            if(graph.vid2lvid.find(rec.target) == graph.vid2lvid.end()) {
+            lvid_type target_lvid = graph.vid2lvid.lookup(rec.target);
+            if(target_lvid == lvid_type(-1)) {
               if (vid2lvid_buffer.find(rec.target) == vid2lvid_buffer.end()) {
                 target_lvid = lvid_start + vid2lvid_buffer.size();
                 vid2lvid_buffer[rec.target] = target_lvid;
@@ -286,7 +290,6 @@ namespace graphlab {
                 target_lvid = vid2lvid_buffer[rec.target];
               }
             } else {
-              target_lvid = graph.vid2lvid[rec.target];
               updated_lvids.set_bit(target_lvid);
             }
             graph.local_graph.add_edge(source_lvid, target_lvid, rec.edata);
@@ -327,8 +330,8 @@ namespace graphlab {
         vertex_buffer_type vertex_buffer; procid_t sending_proc(-1);
         while(vertex_exchange.recv(sending_proc, vertex_buffer)) {
           foreach(const vertex_buffer_record& rec, vertex_buffer) {
-            lvid_type lvid(-1);
-            if (graph.vid2lvid.find(rec.vid) == graph.vid2lvid.end()) {
+            lvid_type lvid = graph.vid2lvid.lookup(rec.vid);
+            if (lvid == lvid_type(-1)) {
               if (vid2lvid_buffer.find(rec.vid) == vid2lvid_buffer.end()) {
                 lvid = lvid_start + vid2lvid_buffer.size();
                 vid2lvid_buffer[rec.vid] = lvid;
@@ -336,7 +339,6 @@ namespace graphlab {
                 lvid = vid2lvid_buffer[rec.vid];
               }
             } else {
-              lvid = graph.vid2lvid[rec.vid];
               updated_lvids.set_bit(lvid);
             }
             if (vertex_combine_strategy && lvid < graph.num_local_vertices()) {
@@ -364,9 +366,9 @@ namespace graphlab {
         graph.lvid2record.resize(local_nverts);
         graph.local_graph.resize(local_nverts);
         foreach(const vid2lvid_pair_type& pair, vid2lvid_buffer) {
-            vertex_record& vrec = graph.lvid2record[pair.second];
-            vrec.gvid = pair.first;
-            vrec.owner = graph_hash::hash_vertex(pair.first) % rpc.numprocs();
+            graph.lvid2record.gvid(pair.second) = pair.first;
+            graph.lvid2record.owner(pair.second) =
+                graph_hash::hash_vertex(pair.first) % rpc.numprocs();
         }
         ASSERT_EQ(local_nverts, graph.local_graph.num_vertices());
         ASSERT_EQ(graph.lvid2record.size(), graph.local_graph.num_vertices());
@@ -391,12 +393,12 @@ namespace graphlab {
 #endif
         // send not owned vids to their master
         for (lvid_type i = lvid_start; i < graph.lvid2record.size(); ++i) {
-          procid_t master = graph.lvid2record[i].owner;
+          procid_t master = graph.lvid2record.owner(i);
           if (master != rpc.procid())
 #ifdef _OPENMP
-            vid_buffer.send(master, graph.lvid2record[i].gvid, omp_get_thread_num());
+            vid_buffer.send(master, graph.lvid2record.gvid(i), omp_get_thread_num());
 #else
-            vid_buffer.send(master, graph.lvid2record[i].gvid);
+            vid_buffer.send(master, graph.lvid2record.gvid(i));
 #endif
         }
         vid_buffer.flush();
@@ -413,19 +415,21 @@ namespace graphlab {
           procid_t recvid;
           while(vid_buffer.recv(recvid, buffer)) {
             foreach(const vertex_id_type vid, buffer) {
-              if (graph.vid2lvid.find(vid) == graph.vid2lvid.end()) {
-                if (vid2lvid_buffer.find(vid) == vid2lvid_buffer.end()) {
+              lvid_type lvid = graph.vid2lvid.lookup(vid);
+              if (lvid == lvid_type(-1)) {
+                typename vid2lvid_map_type::iterator iter =
+                    vid2lvid_buffer.find(vid);
+                if (iter == vid2lvid_buffer.end()) {
                   flying_vids_lock.lock();
                   mirror_type& mirrors = flying_vids[vid];
                   flying_vids_lock.unlock();
                   mirrors.set_bit(recvid);
                 } else {
-                  lvid_type lvid = vid2lvid_buffer[vid];
-                  graph.lvid2record[lvid]._mirrors.set_bit(recvid);
+                  lvid = iter->second;
+                  graph.lvid2record.mutable_mirrors(lvid).set_bit(recvid);
                 }
               } else {
-                lvid_type lvid = graph.vid2lvid[vid];
-                graph.lvid2record[lvid]._mirrors.set_bit(recvid);
+                graph.lvid2record.mutable_mirrors(lvid).set_bit(recvid);
                 updated_lvids.set_bit(lvid);
               }
             }
@@ -442,9 +446,9 @@ namespace graphlab {
              it != flying_vids.end(); ++it) {
           lvid_type lvid = lvid_start + vid2lvid_buffer.size();
           vertex_id_type gvid = it->first; 
-          graph.lvid2record[lvid].owner = rpc.procid();
-          graph.lvid2record[lvid].gvid = gvid;
-          graph.lvid2record[lvid]._mirrors= it->second;
+          graph.lvid2record.owner(lvid) = rpc.procid();
+          graph.lvid2record.gvid(lvid) = gvid;
+          graph.lvid2record.mutable_mirrors(lvid) = it->second;
           vid2lvid_buffer[gvid] = lvid;
           // std::cout << "proc " << rpc.procid() << " recevies flying vertex " << gvid << std::endl;
         }
@@ -459,11 +463,10 @@ namespace graphlab {
         if (graph.vid2lvid.size() == 0) {
           graph.vid2lvid.swap(vid2lvid_buffer);
         } else {
-          graph.vid2lvid.rehash(graph.vid2lvid.size() + vid2lvid_buffer.size());
-          foreach (const typename vid2lvid_map_type::value_type& pair, vid2lvid_buffer) {
-            graph.vid2lvid.insert(pair);
-          }
+          std::vector<typename vid2lvid_map_type::value_type> 
+              new_pairs(vid2lvid_buffer.begin(), vid2lvid_buffer.end());
           vid2lvid_buffer.clear();
+          graph.vid2lvid.bulk_insert(new_pairs.begin(), new_pairs.end());
           // vid2lvid_buffer.swap(vid2lvid_map_type(-1));
         }
       }
@@ -514,8 +517,8 @@ namespace graphlab {
     void exchange_global_info () {
       // Count the number of vertices owned locally
       graph.local_own_nverts = 0;
-      foreach(const vertex_record& record, graph.lvid2record)
-        if(record.owner == rpc.procid()) ++graph.local_own_nverts;
+      for (lvid_type i = 0; i < graph.lvid2record.size(); ++i)
+        if(graph.lvid2record.owner(i) == rpc.procid()) ++graph.local_own_nverts;
 
       // Finalize global graph statistics. 
       logstream(LOG_INFO)
@@ -566,7 +569,7 @@ namespace graphlab {
         if (graph.l_is_master(lvid)) {
           accum.has_data = true;
           accum.vdata = graph.l_vertex(lvid).data();
-          accum.mirrors = graph.lvid2record[lvid]._mirrors;
+          accum.mirrors = graph.lvid2record.get(lvid)._mirrors;
         } 
         return accum;
     }
@@ -575,11 +578,10 @@ namespace graphlab {
      * \brief Update the vertex datastructures with the gathered vertex metadata.  
      */
     void finalize_apply(lvid_type lvid, const vertex_negotiator_record& accum, graph_type& graph) {
-        typename graph_type::vertex_record& vrec = graph.lvid2record[lvid];
-        vrec.num_in_edges = accum.num_in_edges;
-        vrec.num_out_edges = accum.num_out_edges;
+        graph.lvid2record.num_in_edges(lvid) = accum.num_in_edges;
+        graph.lvid2record.num_out_edges(lvid) = accum.num_out_edges;
         graph.l_vertex(lvid).data() = accum.vdata;
-        vrec._mirrors = accum.mirrors;
+        graph.lvid2record.mutable_mirrors(lvid) = accum.mirrors;
     }
   }; // end of distributed_ingress_base
 }; // end of namespace graphlab
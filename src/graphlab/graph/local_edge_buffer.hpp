@@ -25,17 +25,29 @@
 #define GRAPHLAB_LOCAL_EDGE_BUFFER
 
 #include <vector>
+#include <boost/type_traits/is_same.hpp>
+#include <boost/mpl/if.hpp>
 #include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/util/empty.hpp>
 
 namespace graphlab {    
 
-    template<typename VertexData, typename EdgeData>
+    template<typename VertexData, typename EdgeData,
+             typename EdgeAllocator = std::allocator<EdgeData> >
     // Edge class for temporary storage. Will be finalized into the CSR+CSC form.
+    // The arrays are allocated with (a rebind of) EdgeAllocator, except
+    // graphlab::empty data which std::vector<empty> only counts.
     class local_edge_buffer {
     public:
-      std::vector<EdgeData> data;
-      std::vector<lvid_type> source_arr;
-      std::vector<lvid_type> target_arr;
+      typedef typename boost::mpl::if_<
+          boost::is_same<EdgeData, graphlab::empty>,
+          std::vector<EdgeData>,
+          std::vector<EdgeData, EdgeAllocator> >::type edge_data_vector_type;
+      typedef std::vector<lvid_type, typename EdgeAllocator::
+                          template rebind<lvid_type>::other> lvid_vector_type;
+      edge_data_vector_type data;
+      lvid_vector_type source_arr;
+      lvid_vector_type target_arr;
     public:
       local_edge_buffer() {}
       void reserve_edge_space(size_t n) {
@@ -59,9 +71,9 @@ namespace graphlab {
       }
       // \brief Remove all contents in the storage. 
       void clear() {
-        std::vector<EdgeData>().swap(data);
-        std::vector<lvid_type>().swap(source_arr);
-        std::vector<lvid_type>().swap(target_arr);
+        edge_data_vector_type().swap(data);
+        lvid_vector_type().swap(source_arr);
+        lvid_vector_type().swap(target_arr);
       }
       // \brief Return the size of the storage.
       size_t size() const {
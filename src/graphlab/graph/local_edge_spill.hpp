@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_LOCAL_EDGE_SPILL
+#define GRAPHLAB_LOCAL_EDGE_SPILL
+
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <queue>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/serialization/iarchive.hpp>
+#include <graphlab/serialization/oarchive.hpp>
+#include <graphlab/util/out_of_core.hpp>
+
+namespace graphlab {
+
+  /**
+   * \internal
+   * Sorted runs of edges written to temporary files, used to bound the
+   * memory of the local_edge_buffer while the local graph is loaded.
+   *
+   * write_run() sorts the edges of a buffer by source, then target, and
+   * writes them to a new file. merge() reads the runs back in that order,
+   * which is the order of the csr storage, so the edges go straight
+   * into the final arrays. The files are placed in the out of core
+   * directory if one is set, otherwise in TMPDIR or /tmp, and are
+   * removed when they are merged or cleared.
+   */
+  template<typename EdgeData>
+  class local_edge_spill {
+  public:
+    local_edge_spill(): nedges(0) { }
+
+    ~local_edge_spill() { clear(); }
+
+    /// The number of runs written since the last merge
+    size_t num_runs() const { return runs.size(); }
+
+    /// The number of edges in the runs
+    size_t num_edges() const { return nedges; }
+
+    /**
+     * Sorts the edges of the buffer and writes them as a new run. The
+     * buffer is emptied, but keeps its capacity for the next run.
+     */
+    template <typename EdgeBuffer>
+    void write_run(EdgeBuffer& buffer) {
+      const size_t len = buffer.size();
+      if (len == 0) return;
+      std::vector<size_t> order(len);
+      for (size_t i = 0; i < len; ++i) order[i] = i;
+      std::sort(order.begin(), order.end(),
+                edge_less<EdgeBuffer>(buffer));
+
+      const std::string path = make_file();
+      {
+        std::vector<char> iobuf(IO_BUFFER_SIZE);
+        std::ofstream fout;
+        fout.rdbuf()->pubsetbuf(&(iobuf[0]), iobuf.size());
+        fout.open(path.c_str(), std::ios::binary);
+        oarchive oarc(fout);
+        for (size_t i = 0; i < len; ++i) {
+          const size_t j = order[i];
+          oarc << buffer.source_arr[j] << buffer.target_arr[j]
+               << buffer.data[j];
+        }
+        fout.flush();
+        if (fout.fail()) {
+          logstream(LOG_FATAL) << "Unable to write the edge run " << path
+                               << std::endl;
+        }
+      }
+      runs.push_back(run_info(path, len));
+      nedges += len;
+      buffer.source_arr.clear();
+      buffer.target_arr.clear();
+      buffer.data.clear();
+    }
+
+    /**
+     * Merges the runs into the csr layout and removes them. targets and
+     * data are resized to num_edges() and filled in (source, target)
+     * order. As in counting_sort, src_prefix[v] is set to the position of
+     * the first edge of source v and does not cover the trailing sources
+     * without edges.
+     */
+    template <typename TargetVector, typename DataVector, typename sizetype>
+    void merge(TargetVector& targets, DataVector& data,
+               std::vector<sizetype>& src_prefix) {
+      targets.resize(nedges);
+      data.resize(nedges);
+      src_prefix.clear();
+
+      std::vector<run_reader*> readers(runs.size());
+      // the smallest edge on top, the earlier run on ties
+      std::priority_queue<head_type, std::vector<head_type>,
+                          std::greater<head_type> > heads;
+      for (size_t r = 0; r < runs.size(); ++r) {
+        readers[r] = new run_reader(runs[r]);
+        if (readers[r]->next()) heads.push(readers[r]->head(r));
+      }
+      size_t pos = 0;
+      while (!heads.empty()) {
+        const size_t r = heads.top().second;
+        heads.pop();
+        run_reader& reader = *readers[r];
+        while (src_prefix.size() <= reader.source) src_prefix.push_back(pos);
+        targets[pos] = reader.target;
+        data[pos] = reader.data;
+        ++pos;
+        if (reader.next()) heads.push(reader.head(r));
+      }
+      ASSERT_EQ(pos, nedges);
+      for (size_t r = 0; r < readers.size(); ++r) delete readers[r];
+      clear();
+    }
+
+    void swap(local_edge_spill& other) {
+      runs.swap(other.runs);
+      std::swap(nedges, other.nedges);
+    }
+
+    /// Removes all runs
+    void clear() {
+      for (size_t r = 0; r < runs.size(); ++r) unlink(runs[r].path.c_str());
+      runs.clear();
+      nedges = 0;
+    }
+
+  private:
+    struct run_info {
+      std::string path;
+      size_t len;
+      run_info(const std::string& path, size_t len): path(path), len(len) { }
+    };
+
+    /// (source, target) of the next edge of a run, and the run
+    typedef std::pair<std::pair<lvid_type, lvid_type>, size_t> head_type;
+
+    /// Bytes of stream buffer for each run file
+    static const size_t IO_BUFFER_SIZE = 1 << 20;
+
+    /// Reads the edges of a run in order
+    struct run_reader {
+      std::vector<char> iobuf;
+      std::ifstream fin;
+      iarchive iarc;
+      size_t remaining;
+      lvid_type source, target;
+      EdgeData data;
+      run_reader(const run_info& run):
+          iobuf(IO_BUFFER_SIZE), iarc(fin), remaining(run.len) {
+        fin.rdbuf()->pubsetbuf(&(iobuf[0]), iobuf.size());
+        fin.open(run.path.c_str(), std::ios::binary);
+        if (!fin.good()) {
+          logstream(LOG_FATAL) << "Unable to read the edge run " << run.path
+                               << std::endl;
+        }
+      }
+      bool next() {
+        if (remaining == 0) return false;
+        --remaining;
+        iarc >> source >> target >> data;
+        return true;
+      }
+      head_type head(size_t r) const {
+        return head_type(std::make_pair(source, target), r);
+      }
+    };
+
+    /// Orders the edges of a buffer by source, then target, then position
+    template <typename EdgeBuffer>
+    struct edge_less {
+      const EdgeBuffer& buffer;
+      edge_less(const EdgeBuffer& buffer): buffer(buffer) { }
+      bool operator()(size_t a, size_t b) const {
+        if (buffer.source_arr[a] != buffer.source_arr[b])
+          return buffer.source_arr[a] < buffer.source_arr[b];
+        if (buffer.target_arr[a] != buffer.target_arr[b])
+          return buffer.target_arr[a] < buffer.target_arr[b];
+        return a < b;
+      }
+    };
+
+    /// Creates a new empty file for a run and returns its path
+    static std::string make_file() {
+      std::string dir = out_of_core::directory();
+      if (dir.empty()) {
+        const char* tmpdir = getenv("TMPDIR");
+        dir = tmpdir != NULL ? tmpdir : "/tmp";
+      }
+      std::string path = dir + "/graphlab_edges_XXXXXX";
+      std::vector<char> name(path.begin(), path.end());
+      name.push_back('\0');
+      const int fd = mkstemp(&(name[0]));
+      if (fd < 0) {
+        logstream(LOG_FATAL) << "Unable to create an edge run in " << dir
+                             << std::endl;
+      }
+      close(fd);
+      return std::string(&(name[0]));
+    }
+
+    std::vector<run_info> runs;
+    size_t nedges;
+
+    /** Not copyable: the destructor removes the run files */
+    local_edge_spill(const local_edge_spill&);
+    void operator=(const local_edge_spill&);
+  }; // end of class local_edge_spill
+} // end of namespace graphlab
+#endif
@@ -44,14 +44,19 @@
 #include <boost/iterator/counting_iterator.hpp>
 #include <boost/iterator/zip_iterator.hpp>
 #include <boost/range/iterator_range.hpp>
+#include <boost/mpl/if.hpp>
 
 #include <graphlab/graph/graph_basic_types.hpp>
 #include <graphlab/graph/local_edge_buffer.hpp>
+#include <graphlab/graph/local_edge_spill.hpp>
 #include <graphlab/util/random.hpp>
 #include <graphlab/util/generics/shuffle.hpp>
 #include <graphlab/util/generics/counting_sort.hpp>
 #include <graphlab/util/generics/vector_zip.hpp>
 #include <graphlab/util/generics/csr_storage.hpp>
+#include <graphlab/util/generics/compressed_csr_storage.hpp>
+#include <graphlab/util/out_of_core.hpp>
+#include <graphlab/util/empty.hpp>
 #include <graphlab/parallel/atomic.hpp>
 
 #include <graphlab/logger/logger.hpp>
@@ -65,6 +70,69 @@
 
 namespace graphlab { 
 
+  /**
+   * \internal
+   * The edge ids of the in lists of a local_graph, parallel to the csc
+   * values. Only the low 32 bits are stored unless there are more than
+   * 2^32 local edges, in which case the high bits are kept in a second
+   * array.
+   */
+  class in_edge_id_vector {
+   public:
+    typedef std::vector<uint32_t, out_of_core_allocator<uint32_t> >
+        word_vector_type;
+
+    edge_id_type operator[](size_t i) const {
+      if (high.empty()) return low[i];
+      return (edge_id_type(high[i]) << 32) | low[i];
+    }
+
+    template <typename EdgeIdVector>
+    void assign(const EdgeIdVector& eids) {
+      clear();
+      low.resize(eids.size());
+      bool wide = false;
+      for (size_t i = 0; i < eids.size(); ++i) {
+        low[i] = uint32_t(eids[i]);
+        wide |= (eids[i] >> 32) != 0;
+      }
+      if (wide) {
+        high.resize(eids.size());
+        for (size_t i = 0; i < eids.size(); ++i) {
+          high[i] = uint32_t(eids[i] >> 32);
+        }
+      }
+    }
+
+    size_t size() const { return low.size(); }
+
+    void clear() {
+      word_vector_type().swap(low);
+      word_vector_type().swap(high);
+    }
+
+    void swap(in_edge_id_vector& other) {
+      low.swap(other.low);
+      high.swap(other.high);
+    }
+
+    size_t estimate_sizeof() const {
+      return sizeof(uint32_t) * (low.capacity() + high.capacity());
+    }
+
+    /// Issues an out of core hint for the ids in [begin, end)
+    void advise(size_t begin, size_t end,
+                void (*fn)(const void*, size_t)) const {
+      fn(&low[begin], (end - begin) * sizeof(uint32_t));
+      if (!high.empty()) fn(&high[begin], (end - begin) * sizeof(uint32_t));
+    }
+
+   private:
+    word_vector_type low;
+    word_vector_type high;
+  }; // end of in_edge_id_vector
+
+
   template<typename VertexData, typename EdgeData>
   class local_graph {
   public:
@@ -78,6 +146,13 @@ namespace graphlab {
     typedef graphlab::vertex_id_type vertex_id_type;
     typedef graphlab::edge_id_type edge_id_type;
 
+    /**
+     * False if EdgeData is graphlab::empty. The in edges then store only
+     * their source, and the edge data vector only counts the edges.
+     */
+    static const bool has_edge_data =
+        !boost::is_same<EdgeData, graphlab::empty>::value;
+
     class edge_type;
     class vertex_type;
 
@@ -136,11 +211,11 @@ namespace graphlab {
 
       /// \brief Returns a constant reference to the data on the edge.
       const edge_data_type& data() const {
-        return lgraph_ref.edge_data(_eid);
+        return lgraph_ref.edge_data(has_edge_data ? _eid : 0);
       }
       /// \brief Returns a reference to the data on the edge.
       edge_data_type& data() {
-        return lgraph_ref.edge_data(_eid);
+        return lgraph_ref.edge_data(has_edge_data ? _eid : 0);
       }
       /// \brief Returns the source vertex of the edge.
       vertex_type source() const {
@@ -150,8 +225,15 @@ namespace graphlab {
       vertex_type target() const {
         return vertex_type(lgraph_ref, _target);
       }
-      /// \brief Returns the internal ID of this edge
-      edge_id_type id() const { return _eid; }
+      /**
+       * \brief Returns the internal ID of this edge. The in edges of a
+       * graph without edge data look their ID up in the out edges of
+       * the source.
+       */
+      edge_id_type id() const {
+        return (_eid & IN_EDGE_POSITION) == 0 ? _eid :
+            lgraph_ref.in_edge_id(_source, _target, _eid & ~IN_EDGE_POSITION);
+      }
 
      private:
       local_graph& lgraph_ref;
@@ -165,12 +247,13 @@ namespace graphlab {
     // CONSTRUCTORS ============================================================>
     
     /** Create an empty local_graph. */
-    local_graph() : finalized(false) { }
+    local_graph() : edge_buffer_limit(0), finalized(false),
+                    compressed(false) { }
 
     /** Create a local_graph with nverts vertices. */
     local_graph(size_t nverts) :
       vertices(nverts),
-      finalized(false) { }
+      edge_buffer_limit(0), finalized(false), compressed(false) { }
 
     // METHODS =================================================================>
     
@@ -178,6 +261,50 @@ namespace graphlab {
       return false;
     }
 
+    /**
+     * \brief Selects the compressed adjacency layout. Must be called 
+     * before finalize().
+     *
+     * The compressed layout sorts the neighbors of each vertex and stores
+     * them as variable length gaps. The out edge ids stay implicit, the in
+     * edge ids are stored as gaps. The edge lists are decoded on the fly,
+     * so the lists are best traversed sequentially. This typically takes
+     * 3 to 5 bytes of structure per edge instead of 3 * sizeof(lvid_type).
+     * The setting is kept by clear().
+     */
+    void set_compressed_adjacency(bool compress) {
+      if (finalized && compress != compressed) {
+        logstream(LOG_FATAL) 
+          << "The adjacency layout cannot be changed after finalize." 
+          << std::endl;
+      }
+      compressed = compress;
+    }
+
+    /// \brief Returns true if the compressed adjacency layout is used.
+    bool is_compressed_adjacency() const {
+      return compressed;
+    }
+
+    /**
+     * \brief Bounds the memory taken by the edges added before finalize()
+     * to about the given number of bytes. 0, the default, keeps all the
+     * edges in memory.
+     *
+     * When the edge buffer is full, its edges are sorted and written to
+     * a temporary file. finalize() merges the files directly into the csr
+     * and csc storage, so the buffer and the final adjacency are never
+     * held together. The files are placed in the out of core directory
+     * if one is set, otherwise in TMPDIR or /tmp. The setting is kept by
+     * clear(). Each buffered edge is charged for its endpoints, its data
+     * and the index the run sort allocates.
+     */
+    void set_edge_buffer_limit(size_t bytes) {
+      edge_buffer_limit = bytes / (sizeof(EdgeData) + 2 * sizeof(lvid_type)
+                                   + sizeof(size_t));
+      if (bytes > 0) edge_buffer_limit = std::max<size_t>(edge_buffer_limit, 1);
+    }
+
     /**
      * \brief Resets the local_graph state.
      */
@@ -186,10 +313,14 @@ namespace graphlab {
       vertices.clear();
       edges.clear();
       _csc_storage.clear();
+      _csc_edge_ids.clear();
       _csr_storage.clear();
+      _compressed_out.clear();
+      _compressed_in.clear();
       std::vector<VertexData>().swap(vertices);
-      std::vector<EdgeData>().swap(edges);
+      edge_vector_type().swap(edges);
       edge_buffer.clear();
+      spill.clear();
     }
 
     /**
@@ -206,77 +337,27 @@ namespace graphlab {
 #ifdef DEBUG_GRAPH
       logstream(LOG_DEBUG) << "Graph2 finalize starts." << std::endl;
 #endif
-      std::vector<edge_id_type> permute;
-      std::vector<edge_id_type> src_counting_prefix_sum;
-      std::vector<edge_id_type> dest_counting_prefix_sum;
-           
-#ifdef DEBUG_GRAPH
-      logstream(LOG_DEBUG) << "Graph2 finalize: Sort by source vertex" << std::endl;
-#endif
-      // Sort edges by source;
-      // Begin of counting sort.
-      counting_sort(edge_buffer.source_arr, permute, &src_counting_prefix_sum);
-
-      // Inplace permute of edge_data, edge_src, edge_target array.
-#ifdef DEBUG_GRAPH
-      logstream(LOG_DEBUG) << "Graph2 finalize: Inplace permute by source id" << std::endl;
-#endif
-      lvid_type swap_src; lvid_type swap_target; EdgeData  swap_data;
-      for (size_t i = 0; i < permute.size(); ++i) {
-        if (i != permute[i]) {
-          // Reserve the ith entry;
-          size_t j = i;
-          swap_data = edge_buffer.data[i];
-          swap_src = edge_buffer.source_arr[i];
-          swap_target = edge_buffer.target_arr[i];
-          // Begin swap cycle:
-          while (j != permute[j]) {
-            size_t next = permute[j];
-            if (next != i) {
-              edge_buffer.data[j] = edge_buffer.data[next];
-              edge_buffer.source_arr[j] = edge_buffer.source_arr[next];
-              edge_buffer.target_arr[j] = edge_buffer.target_arr[next];
-              permute[j] = j;
-              j = next;
-            } else {
-              // end of cycle
-              edge_buffer.data[j] = swap_data;
-              edge_buffer.source_arr[j] = swap_src;
-              edge_buffer.target_arr[j] = swap_target;
-              permute[j] = j;
-              break;
-            }
-          }
-        }
+      if (spill.num_runs() > 0) {
+        spill.write_run(edge_buffer);
+        logstream(LOG_INFO) << "Merging " << spill.num_edges() << " edges from "
+                            << spill.num_runs() << " sorted runs" << std::endl;
       }
-#ifdef DEBUG_GRAPH
-      logstream(LOG_DEBUG) << "Graph2 finalize: Sort by dest id" << std::endl;
-#endif
-      counting_sort(edge_buffer.target_arr, permute, &dest_counting_prefix_sum); 
-      // Shuffle source array
-#ifdef DEBUG_GRAPH
-      logstream(LOG_DEBUG) << "Graph2 finalize: Outofplace permute by dest id" << std::endl;
-#endif
-
-      outofplace_shuffle(edge_buffer.source_arr, permute);
-      // Use inplace shuffle to reduce peak memory footprint:
-      // inplace_shuffle(edge_buffer.source_arr, permute);
-      // counting_sort(edge_buffer.target_arr, permute);
-
-      // warp into csr csc storage.
-      _csr_storage.wrap(src_counting_prefix_sum, edge_buffer.target_arr);
-      std::vector<std::pair<lvid_type, edge_id_type> > csc_value = vector_zip(edge_buffer.source_arr, permute);
-      //ASSERT_EQ(csc_value.size(), edge_buffer.size());
-      _csc_storage.wrap(dest_counting_prefix_sum, csc_value); 
-      edges.swap(edge_buffer.data);
+      build_adjacency(boost::integral_constant<bool, has_edge_data>());
       ASSERT_EQ(_csr_storage.num_values(), _csc_storage.num_values());
       ASSERT_EQ(_csr_storage.num_values(), edges.size());
+      if (compressed) compress_adjacency();
 #ifdef DEBGU_GRAPH
       logstream(LOG_DEBUG) << "End of finalize." << std::endl;
 #endif
 
       logstream(LOG_INFO) << "Graph finalized in " << mytimer.current_time() 
-                          << " secs" << std::endl;
+                          << " secs. Adjacency: "
+                          << (compressed ? "compressed, " : "csr, ")
+                          << double(adjacency_sizeof()) / 
+                             std::max<size_t>(edges.size(), 1)
+                          << " bytes per edge"
+                          << (is_out_of_core() ? ", out of core" : "")
+                          << std::endl;
       finalized = true;
     } // End of finalize
 
@@ -324,6 +405,7 @@ namespace graphlab {
     } // End of resize
 
     void reserve_edge_space(size_t n) {
+      if (edge_buffer_limit > 0) n = std::min(n, edge_buffer_limit);
       edge_buffer.reserve_edge_space(n);
     }
     /**
@@ -350,6 +432,9 @@ namespace graphlab {
 
       // Add the edge to the set of edge data (this copies the edata)
       edge_buffer.add_edge(source, target, edata);
+      if (edge_buffer_limit > 0 && edge_buffer.size() >= edge_buffer_limit) {
+        spill.write_run(edge_buffer);
+      }
 
       // This is not the final edge_id, so we always return 0. 
       return 0;
@@ -390,6 +475,9 @@ namespace graphlab {
         }
       }
       edge_buffer.add_block_edges(src_arr, dst_arr, edata_arr);
+      if (edge_buffer_limit > 0 && edge_buffer.size() >= edge_buffer_limit) {
+        spill.write_run(edge_buffer);
+      }
     } // End of add block edges
 
 
@@ -423,19 +511,23 @@ namespace graphlab {
       // read the vertices
       arc >> vertices
           >> edges 
-          >> _csr_storage
-          >> _csc_storage
-          >> finalized;
+          >> _csr_storage;
+      load_in_edges(arc, boost::integral_constant<bool, has_edge_data>());
+      arc >> finalized;
+      if (compressed && finalized) compress_adjacency();
     } // end of load
 
     /** \brief Save the local_graph to an archive */
     void save(oarchive& arc) const {
       // Write the number of edges and vertices
       arc << vertices
-          << edges
-          << _csr_storage  
-          << _csc_storage
-          << finalized;
+          << edges;
+      // the archive format is always the uncompressed layout with the
+      // in edge ids stored next to the sources
+      csr_type csr; archive_csc_type csc;
+      archive_adjacency(csr, csc);
+      arc << csr << csc;
+      arc << finalized;
     } // end of save
     
     /** swap two graphs */
@@ -445,9 +537,61 @@ namespace graphlab {
       std::swap(edges, other.edges);
       std::swap(_csr_storage, other._csr_storage);
       std::swap(_csc_storage, other._csc_storage);
+      _csc_edge_ids.swap(other._csc_edge_ids);
+      _compressed_out.swap(other._compressed_out);
+      _compressed_in.swap(other._compressed_in);
+      std::swap(compressed, other.compressed);
       std::swap(finalized, other.finalized);
+      std::swap(edge_buffer_limit, other.edge_buffer_limit);
+      spill.swap(other.spill);
     } // end of swap
 
+    /**
+     * \brief Replaces this graph by the topology of a finalized graph
+     * with possibly different vertex and edge data types. The vertex and
+     * edge data are default constructed, and the local vertex ids are
+     * the same as in the other graph.
+     *
+     * The adjacency is copied as is when both graphs use the same layout
+     * and both store, or both omit, edge data. The edge ids are then
+     * the same as well. Otherwise the out edges are added again and the
+     * graph is finalized. With edge data this keeps the order of each
+     * out list and the edge ids. Without edge data the out lists are
+     * sorted by target, so the order and the ids of the out edges of a
+     * vertex may change.
+     */
+    template<typename OtherVertexData, typename OtherEdgeData>
+    void copy_topology(const local_graph<OtherVertexData,
+                                         OtherEdgeData>& other) {
+      typedef local_graph<OtherVertexData, OtherEdgeData> other_type;
+      if (!other.finalized) {
+        logstream(LOG_FATAL)
+          << "Attempting to copy the topology of a local_graph which is "
+          << "not finalized." << std::endl;
+      }
+      clear();
+      vertices.resize(other.num_vertices());
+      if (other.compressed == compressed &&
+          other_type::has_edge_data == has_edge_data) {
+        copy_adjacency(other, boost::integral_constant<bool,
+                       other_type::has_edge_data == has_edge_data>());
+        edges.resize(other.num_edges());
+        finalized = true;
+      } else {
+        std::vector<edge_id_type> ptrs;
+        std::vector<lvid_type> targets;
+        other.out_adjacency(ptrs, targets);
+        edge_buffer.reserve_edge_space(targets.size());
+        for (size_t k = 0; k < ptrs.size(); ++k) {
+          const size_t end = k + 1 < ptrs.size() ? ptrs[k + 1] : targets.size();
+          for (size_t i = ptrs[k]; i < end; ++i) {
+            edge_buffer.add_edge(lvid_type(k), targets[i], EdgeData());
+          }
+        }
+        finalize();
+      }
+    } // end of copy_topology
+
 
     /** \brief Load the local_graph from a file */
     void load(const std::string& filename) {
@@ -502,6 +646,9 @@ namespace graphlab {
      * \brief Returns the number of in edges of the vertex with the given id. */
     size_t num_in_edges(const lvid_type v) const {
       ASSERT_TRUE(finalized);
+      if (compressed) {
+        return _compressed_in.end_index(v) - _compressed_in.begin_index(v);
+      }
       return (_csc_storage.end(v) - _csc_storage.begin(v));
     }
 
@@ -510,6 +657,9 @@ namespace graphlab {
      * \brief Returns the number of in edges of the vertex with the given id. */
     size_t num_out_edges(const lvid_type v) const {
       ASSERT_TRUE(finalized);
+      if (compressed) {
+        return _compressed_out.end_index(v) - _compressed_out.begin_index(v);
+      }
       return (_csr_storage.end(v) - _csr_storage.begin(v));
     }
 
@@ -517,8 +667,25 @@ namespace graphlab {
      * \internal
      * \brief Returns a list of in edges of the vertex with the given id. */
     edge_list_type in_edges(lvid_type v) {
-      edge_iterator begin = edge_iterator(*this, _csc_storage.begin(v), v);
-      edge_iterator end = edge_iterator(*this, _csc_storage.end(v), v);
+      if (compressed) {
+        return boost::make_iterator_range(
+            edge_iterator(*this, _compressed_in.begin(v), v, false),
+            edge_iterator(*this, _compressed_in.end(v), v, false));
+      }
+      // the iterator carries the position in the csc values, which
+      // indexes the in edge ids
+      csc_type::iterator base_begin = _csc_storage.begin(v);
+      csc_type::iterator base_end = _csc_storage.end(v);
+      boost::counting_iterator<edge_id_type>
+          counter_begin(base_begin - _csc_storage.begin(0));
+      boost::counting_iterator<edge_id_type>
+          counter_end(base_end - _csc_storage.begin(0));
+      edge_iterator begin = edge_iterator(*this,
+          csc_edge_iterator(csr_iterator_tuple(base_begin, counter_begin)), v,
+          false);
+      edge_iterator end = edge_iterator(*this,
+          csc_edge_iterator(csr_iterator_tuple(base_end, counter_end)), v,
+          false);
       return boost::make_iterator_range(begin, end);
     }
 
@@ -526,6 +693,11 @@ namespace graphlab {
      * \internal
      * \brief Returns a list of out edges of the vertex with the given id. */
     edge_list_type out_edges(lvid_type v) {
+      if (compressed) {
+        return boost::make_iterator_range(
+            edge_iterator(*this, _compressed_out.begin(v), v, true),
+            edge_iterator(*this, _compressed_out.end(v), v, true));
+      }
 
       csr_type::iterator base_begin = _csr_storage.begin(v);
       csr_type::iterator base_end = _csr_storage.end(v);
@@ -570,8 +742,7 @@ namespace graphlab {
     size_t estimate_sizeof() const {
       const size_t vlist_size = sizeof(vertices) + 
         sizeof(VertexData) * vertices.capacity();
-      size_t elist_size = _csr_storage.estimate_sizeof() 
-          + _csc_storage.estimate_sizeof()
+      size_t elist_size = adjacency_sizeof()
           + sizeof(edges) + sizeof(EdgeData)*edges.capacity();
       size_t ebuffer_size = edge_buffer.estimate_sizeof();
       // std::cerr << "local_graph: tmplist size: " << (double)elist_size/(1024*1024)
@@ -582,6 +753,93 @@ namespace graphlab {
     }
 
 
+    /** 
+     * \internal
+     * \brief Returns the memory used by the adjacency structure. */
+    size_t adjacency_sizeof() const {
+      return _csr_storage.estimate_sizeof() 
+          + _csc_storage.estimate_sizeof()
+          + _csc_edge_ids.estimate_sizeof()
+          + _compressed_out.estimate_sizeof()
+          + _compressed_in.estimate_sizeof();
+    }
+
+    /**
+     * \internal
+     * \brief Returns true if the edges are stored in files. See
+     * out_of_core::set_directory().
+     */
+    bool is_out_of_core() const {
+      if (!has_edge_data) {
+        return _csr_storage.num_values() > 0 &&
+            out_of_core::is_file_backed(&(_csr_storage.get_value_vector()[0]));
+      }
+      return !edges.empty() && out_of_core::is_file_backed(&edges[0]);
+    }
+
+    /**
+     * \internal
+     * \brief Returns the id of the first edge from source to target,
+     * which must exist. This searches the out edges of the source.
+     */
+    edge_id_type find_edge_id(lvid_type source, lvid_type target) const {
+      if (compressed) {
+        compressed_edge_iterator iter = _compressed_out.begin(source);
+        const compressed_edge_iterator end = _compressed_out.end(source);
+        while (iter != end && iter->first != target) ++iter;
+        ASSERT_TRUE(iter != end);
+        return iter.index();
+      }
+      const csr_type::const_iterator begin = _csr_storage.begin(source);
+      const csr_type::const_iterator end = _csr_storage.end(source);
+      csr_type::const_iterator iter = has_edge_data ?
+          std::find(begin, end, target) : std::lower_bound(begin, end, target);
+      ASSERT_TRUE(iter != end && *iter == target);
+      return iter - _csr_storage.get_value_vector().begin();
+    }
+
+    /**
+     * \internal
+     * \brief Returns the id of the in edge of target from source at
+     * position pos of the in lists, in a graph without edge data. The
+     * k-th of several parallel in edges from the same source is the
+     * k-th out edge of the source to the target. They are adjacent in
+     * the in list, which is sorted when the graph has parallel edges.
+     * The compressed in lists of such a graph store the ids instead.
+     */
+    edge_id_type in_edge_id(lvid_type source, lvid_type target,
+                            size_t pos) const {
+      edge_id_type eid = find_edge_id(source, target);
+      if (!compressed) {
+        const csc_type::value_vector_type& sources =
+            _csc_storage.get_value_vector();
+        const size_t begin = _csc_storage.begin_index(target);
+        for (; pos > begin && sources[pos - 1] == source; --pos) ++eid;
+      }
+      return eid;
+    }
+
+    /**
+     * \internal
+     * \brief Starts reading the adjacency of the vertices in
+     * [begin, end), and the data of their out edges, if the edges are
+     * out of core. The data of the in edges is not contiguous and is
+     * read on demand.
+     */
+    void prefetch_edges(lvid_type begin, lvid_type end) const {
+      advise_edges(begin, end, true);
+    }
+
+    /**
+     * \internal
+     * \brief Releases the memory holding the edges of the vertices in
+     * [begin, end) if the edges are out of core. They are read back
+     * on the next access.
+     */
+    void release_edges(lvid_type begin, lvid_type end) const {
+      advise_edges(begin, end, false);
+    }
+
     /** \internal
      * \brief For debug purpose, returns the largest vertex id in the edge_buffer
      */ 
@@ -603,15 +861,435 @@ namespace graphlab {
      * \internal
      * CSR/CSC storage types
      */
-    typedef csr_storage<lvid_type, edge_id_type> csr_type;
-    typedef csr_storage<std::pair<lvid_type, edge_id_type>, edge_id_type> csc_type; 
+    typedef csr_storage<lvid_type, edge_id_type, 
+                        out_of_core_allocator<lvid_type> > csr_type;
+    /** The in lists store the sources only. The edge ids, if there is
+        edge data, are kept apart in an in_edge_id_vector. */
+    typedef csr_type csc_type;
+    typedef typename local_edge_buffer<VertexData, EdgeData,
+                                       out_of_core_allocator<EdgeData>
+                                       >::edge_data_vector_type edge_vector_type;
+    /** The in edges are always archived with their edge ids */
+    typedef csr_storage<std::pair<lvid_type, edge_id_type>, edge_id_type>
+        archive_csc_type;
+
+    /** Marks the in edges which do not store their id. The low bits
+        hold the position of the edge in the in lists, see in_edge_id() */
+    static const edge_id_type IN_EDGE_POSITION = edge_id_type(1) << 63;
 
     typedef boost::tuple<csr_type::iterator,
                          boost::counting_iterator<edge_id_type>
                          > csr_iterator_tuple;
 
     typedef boost::zip_iterator<csr_iterator_tuple> csr_edge_iterator;
-    typedef csc_type::iterator csc_edge_iterator;
+    typedef csr_edge_iterator csc_edge_iterator;
+
+    typedef compressed_csr_storage<lvid_type, edge_id_type> compressed_type;
+    typedef compressed_type::const_iterator compressed_edge_iterator;
+
+    /**
+     * Sorts the edge buffer by source, then by target, and moves it into
+     * the csr and csc storage. Both counting sorts are stable, so the
+     * sources of each in list come out sorted. If edges were spilled, the
+     * runs are merged in source order instead of the first sort.
+     */
+    void build_adjacency(const boost::true_type&) {
+      std::vector<edge_id_type> permute;
+      std::vector<edge_id_type> src_counting_prefix_sum;
+      std::vector<edge_id_type> dest_counting_prefix_sum;
+
+      if (spill.num_runs() > 0) {
+        spill.merge(edge_buffer.target_arr, edge_buffer.data,
+                    src_counting_prefix_sum);
+        edge_buffer.source_arr.resize(edge_buffer.target_arr.size());
+      } else {
+#ifdef DEBUG_GRAPH
+        logstream(LOG_DEBUG) << "Graph2 finalize: Sort by source vertex" << std::endl;
+#endif
+        counting_sort(edge_buffer.source_arr, permute, &src_counting_prefix_sum);
+#ifdef DEBUG_GRAPH
+        logstream(LOG_DEBUG) << "Graph2 finalize: Outofplace permute by source id" << std::endl;
+#endif
+        outofplace_shuffle(edge_buffer.data, permute);
+        outofplace_shuffle(edge_buffer.target_arr, permute);
+      }
+      // The sorted sources follow from the prefix sums.
+      const size_t nsources = src_counting_prefix_sum.size();
+      const size_t nedges = edge_buffer.target_arr.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+      for (ssize_t v = 0; v < ssize_t(nsources); ++v) {
+        const size_t end = size_t(v + 1) < nsources ?
+            src_counting_prefix_sum[v + 1] : nedges;
+        for (size_t i = src_counting_prefix_sum[v]; i < end; ++i) {
+          edge_buffer.source_arr[i] = v;
+        }
+      }
+      // The compressed layout keeps out edge ids implicit, so the
+      // targets of each source, and their edge data, are sorted here.
+      if (compressed) sort_out_edges(src_counting_prefix_sum);
+#ifdef DEBUG_GRAPH
+      logstream(LOG_DEBUG) << "Graph2 finalize: Sort by dest id" << std::endl;
+#endif
+      counting_sort(edge_buffer.target_arr, permute, &dest_counting_prefix_sum);
+      // Read the in lists through the permutation, without shuffling
+      // the sources first.
+      csc_type::value_vector_type csc_value(nedges);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t i = 0; i < ssize_t(nedges); ++i) {
+        csc_value[i] = edge_buffer.source_arr[permute[i]];
+      }
+      _csc_edge_ids.assign(permute);
+      std::vector<edge_id_type>().swap(permute);
+
+      // warp into csr csc storage.
+      _csr_storage.wrap(src_counting_prefix_sum, edge_buffer.target_arr);
+      _csc_storage.wrap(dest_counting_prefix_sum, csc_value);
+      edges.swap(edge_buffer.data);
+      edge_buffer.clear();
+    }
+
+    /**
+     * Moves an edge buffer without edge data into the csr and csc storage.
+     * The sources are placed directly in the lists of their targets, and
+     * the out lists are filled by traversing the in lists in target
+     * order. No permutation is built and the targets of each source are
+     * sorted, which find_edge_id() relies on. Spilled runs merge into the
+     * out lists, and the in lists are built from them the same way.
+     * The in lists are sorted as well if there are parallel edges.
+     */
+    void build_adjacency(const boost::false_type&) {
+      std::vector<edge_id_type> src_prefix, dest_prefix;
+      csc_type::value_vector_type sources;
+      csr_type::value_vector_type targets;
+      if (spill.num_runs() > 0) {
+        spill.merge(targets, edge_buffer.data, src_prefix);
+        edge_buffer.clear();
+        transpose_adjacency(src_prefix, targets, dest_prefix, sources);
+      } else {
+        counting_sort_values(edge_buffer.target_arr, edge_buffer.source_arr,
+                             sources, &dest_prefix);
+        edge_buffer.clear();
+        transpose_adjacency(dest_prefix, sources, src_prefix, targets);
+        // in_edge_id() needs parallel edges adjacent in the in lists
+        if (has_parallel_edges(src_prefix, targets)) {
+          sort_lists(dest_prefix, sources);
+        }
+      }
+      edges.resize(targets.size());
+      _csr_storage.wrap(src_prefix, targets);
+      _csc_storage.wrap(dest_prefix, sources);
+    }
+
+    /**
+     * Builds the out lists of a csr layout from its in lists or the
+     * other way around: key k holding value v in (ptrs, values) becomes
+     * key v holding k in (out_ptrs, out_values). Each output list is
+     * sorted. As in counting_sort, out_ptrs does not cover the trailing
+     * keys without values.
+     */
+    template <typename InVector, typename OutVector>
+    static void transpose_adjacency(const std::vector<edge_id_type>& ptrs,
+                                    const InVector& values,
+                                    std::vector<edge_id_type>& out_ptrs,
+                                    OutVector& out_values) {
+      out_ptrs.clear();
+      out_values.resize(values.size());
+      if (values.empty()) return;
+      // the key of each value. The stable sort by value keeps the keys of
+      // each output list in ascending order.
+      std::vector<typename OutVector::value_type> keys(values.size());
+      const size_t nkeys = ptrs.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+      for (ssize_t k = 0; k < ssize_t(nkeys); ++k) {
+        const size_t end = size_t(k + 1) < nkeys ? ptrs[k + 1] : values.size();
+        for (size_t i = ptrs[k]; i < end; ++i) keys[i] = lvid_type(k);
+      }
+      counting_sort_values(values, keys, out_values, &out_ptrs);
+    }
+
+    /// True if a list of (ptrs, values), each sorted, repeats a value
+    template <typename ValueVector>
+    static bool has_parallel_edges(const std::vector<edge_id_type>& ptrs,
+                                   const ValueVector& values) {
+      const size_t nkeys = ptrs.size();
+      size_t nrepeated = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024) reduction(+ : nrepeated)
+#endif
+      for (ssize_t k = 0; k < ssize_t(nkeys); ++k) {
+        const size_t end = size_t(k + 1) < nkeys ? ptrs[k + 1] : values.size();
+        for (size_t i = ptrs[k] + 1; i < end; ++i) {
+          nrepeated += values[i] == values[i - 1];
+        }
+      }
+      return nrepeated > 0;
+    }
+
+    /// Sorts each list of (ptrs, values)
+    template <typename ValueVector>
+    static void sort_lists(const std::vector<edge_id_type>& ptrs,
+                           ValueVector& values) {
+      const size_t nkeys = ptrs.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+      for (ssize_t k = 0; k < ssize_t(nkeys); ++k) {
+        const size_t end = size_t(k + 1) < nkeys ? ptrs[k + 1] : values.size();
+        std::sort(values.begin() + ptrs[k], values.begin() + end);
+      }
+    }
+
+    /**
+     * Sorts the targets of each source, and the matching edge data, in the
+     * edge buffer. The buffer must be sorted by source, with the edges of
+     * source v starting at src_prefix[v].
+     */
+    void sort_out_edges(const std::vector<edge_id_type>& src_prefix) {
+      const size_t nkeys = src_prefix.size();
+      const size_t nedges = edge_buffer.target_arr.size();
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+      {
+        std::vector<std::pair<lvid_type, size_t> > order;
+        std::vector<EdgeData> data_copy;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 1024)
+#endif
+        for (ssize_t v = 0; v < ssize_t(nkeys); ++v) {
+          const size_t begin = src_prefix[v];
+          const size_t end = size_t(v + 1) < nkeys ? src_prefix[v + 1] : nedges;
+          bool sorted = true;
+          for (size_t i = begin + 1; i < end && sorted; ++i) {
+            sorted = edge_buffer.target_arr[i - 1] <= edge_buffer.target_arr[i];
+          }
+          if (sorted) continue;
+          order.clear();
+          data_copy.clear();
+          for (size_t i = begin; i < end; ++i) {
+            order.push_back(std::make_pair(edge_buffer.target_arr[i], i));
+            data_copy.push_back(edge_buffer.data[i]);
+          }
+          std::sort(order.begin(), order.end());
+          for (size_t i = begin; i < end; ++i) {
+            edge_buffer.target_arr[i] = order[i - begin].first;
+            edge_buffer.data[i] = data_copy[order[i - begin].second - begin];
+          }
+        }
+      }
+    }
+
+    /**
+     * Converts the csr and csc storage into the compressed layout and
+     * releases them. The out lists must be sorted by target.
+     */
+    void compress_adjacency() {
+      const size_t nverts = vertices.size();
+      // without edge data the in edge ids are only stored if there are
+      // parallel edges, see in_edge_id()
+      const bool in_ids = has_edge_data ||
+          has_parallel_edges(_csr_storage.get_index(),
+                             _csr_storage.get_value_vector());
+      {
+        std::vector<edge_id_type> ptrs = _csc_storage.get_index();
+        const csc_type::value_vector_type& sources =
+            _csc_storage.get_value_vector();
+        const size_t nkeys = ptrs.size();
+        std::vector<std::pair<lvid_type, edge_id_type> >
+            csc_values(sources.size());
+        for (size_t i = 0; i < sources.size(); ++i) {
+          csc_values[i].first = sources[i];
+          csc_values[i].second = has_edge_data ? _csc_edge_ids[i] : 0;
+        }
+        if (!has_edge_data && in_ids) {
+          // the in lists are sorted, and parallel edges adjacent
+          const csr_type::value_vector_type& targets =
+              _csr_storage.get_value_vector();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+          for (ssize_t v = 0; v < ssize_t(nkeys); ++v) {
+            const size_t begin = ptrs[v];
+            const size_t end = size_t(v + 1) < nkeys ?
+                ptrs[v + 1] : csc_values.size();
+            for (size_t i = begin; i < end; ++i) {
+              const lvid_type source = csc_values[i].first;
+              csc_values[i].second =
+                  i > begin && csc_values[i - 1].first == source ?
+                  csc_values[i - 1].second + 1 :
+                  std::lower_bound(_csr_storage.begin(source),
+                                   _csr_storage.end(source), lvid_type(v))
+                  - targets.begin();
+            }
+          }
+        }
+        _csc_storage.clear();
+        _csc_edge_ids.clear();
+        // finalize() sorts each in list by source, but the lists without
+        // edge data or from an archive may need sorting
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+        for (ssize_t v = 0; v < ssize_t(nkeys); ++v) {
+          const size_t end = size_t(v + 1) < nkeys ?
+              ptrs[v + 1] : csc_values.size();
+          bool sorted = true;
+          for (size_t i = ptrs[v] + 1; i < end && sorted; ++i) {
+            sorted = !(csc_values[i] < csc_values[i - 1]);
+          }
+          if (!sorted) {
+            std::sort(csc_values.begin() + ptrs[v], csc_values.begin() + end);
+          }
+        }
+        std::vector<lvid_type> in_sources(csc_values.size());
+        std::vector<edge_id_type> eids(in_ids ? csc_values.size() : 0);
+        for (size_t i = 0; i < csc_values.size(); ++i) {
+          in_sources[i] = csc_values[i].first;
+          if (in_ids) eids[i] = csc_values[i].second;
+        }
+        std::vector<std::pair<lvid_type, edge_id_type> >().swap(csc_values);
+        _compressed_in.build(ptrs, in_sources, in_ids ? &eids : NULL,
+                             nverts);
+      }
+      {
+        std::vector<edge_id_type> ptrs = _csr_storage.get_index();
+        std::vector<lvid_type> targets = _csr_storage.get_values();
+        _csr_storage.clear();
+        _compressed_out.build(ptrs, targets, NULL, nverts);
+      }
+    }
+
+    void advise_edges(lvid_type begin, lvid_type end, bool will_need) const {
+      end = std::min<size_t>(end, vertices.size());
+      if (begin >= end || !is_out_of_core()) return;
+      void (*advise)(const void*, size_t) =
+          will_need ? out_of_core::will_need : out_of_core::dont_need;
+      const size_t out_begin = _csr_storage.begin_index(begin);
+      const size_t out_end = _csr_storage.begin_index(end);
+      if (out_begin < out_end) {
+        advise(&(_csr_storage.get_value_vector()[out_begin]),
+               (out_end - out_begin) * sizeof(lvid_type));
+        if (has_edge_data) {
+          advise(&(edges[out_begin]), (out_end - out_begin) * sizeof(EdgeData));
+        }
+      }
+      const size_t in_begin = _csc_storage.begin_index(begin);
+      const size_t in_end = _csc_storage.begin_index(end);
+      if (in_begin < in_end) {
+        advise(&(_csc_storage.get_value_vector()[in_begin]),
+               (in_end - in_begin) * sizeof(lvid_type));
+        if (has_edge_data) _csc_edge_ids.advise(in_begin, in_end, advise);
+      }
+    }
+
+    /**
+     * Rebuilds the csr and csc storage of the archive format from the
+     * compressed layout, or from in lists which do not store edge ids.
+     */
+    void archive_adjacency(csr_type& csr, archive_csc_type& csc) const {
+      std::vector<edge_id_type> ptrs, eids;
+      std::vector<lvid_type> neighbors;
+      if (compressed) {
+        _compressed_out.decompress(ptrs, neighbors, eids);
+        csr.wrap(ptrs, neighbors);
+        _compressed_in.decompress(ptrs, neighbors, eids);
+      } else {
+        ptrs = _csr_storage.get_index();
+        neighbors = _csr_storage.get_values();
+        csr.wrap(ptrs, neighbors);
+        ptrs = _csc_storage.get_index();
+        neighbors = _csc_storage.get_values();
+        if (has_edge_data) {
+          eids.resize(neighbors.size());
+          for (size_t i = 0; i < eids.size(); ++i) eids[i] = _csc_edge_ids[i];
+        }
+      }
+      if (!has_edge_data && eids.empty()) {
+        eids.resize(neighbors.size());
+        for (size_t k = 0; k < ptrs.size(); ++k) {
+          const size_t end = k + 1 < ptrs.size() ? ptrs[k + 1] : neighbors.size();
+          for (size_t i = ptrs[k]; i < end; ++i) {
+            eids[i] = in_edge_id(neighbors[i], lvid_type(k), i);
+          }
+        }
+      }
+      std::vector<std::pair<lvid_type, edge_id_type> > csc_values = 
+          vector_zip(neighbors, eids);
+      csc.wrap(ptrs, csc_values);
+    }
+
+    /**
+     * Returns the out lists in the csr format, with the edge ids as
+     * positions.
+     */
+    void out_adjacency(std::vector<edge_id_type>& ptrs,
+                       std::vector<lvid_type>& targets) const {
+      if (compressed) {
+        std::vector<edge_id_type> eids;
+        _compressed_out.decompress(ptrs, targets, eids);
+      } else {
+        ptrs = _csr_storage.get_index();
+        targets.assign(_csr_storage.get_value_vector().begin(),
+                       _csr_storage.get_value_vector().end());
+      }
+    }
+
+    /// Copies the adjacency of a graph with the same layout
+    template <typename OtherGraph>
+    void copy_adjacency(const OtherGraph& other, const boost::true_type&) {
+      _csr_storage = other._csr_storage;
+      _csc_storage = other._csc_storage;
+      _csc_edge_ids = other._csc_edge_ids;
+      _compressed_out = other._compressed_out;
+      _compressed_in = other._compressed_in;
+    }
+
+    template <typename OtherGraph>
+    void copy_adjacency(const OtherGraph&, const boost::false_type&) { }
+
+    /// Loads the in lists of the archive format
+    void load_in_edges(iarchive& arc, const boost::true_type&) {
+      archive_csc_type csc;
+      arc >> csc;
+      const archive_csc_type::value_vector_type& values =
+          csc.get_value_vector();
+      csc_type::value_vector_type sources(values.size());
+      std::vector<edge_id_type> eids(values.size());
+      for (size_t i = 0; i < values.size(); ++i) {
+        sources[i] = values[i].first;
+        eids[i] = values[i].second;
+      }
+      std::vector<edge_id_type> ptrs = csc.get_index();
+      csc.clear();
+      _csc_storage.wrap(ptrs, sources);
+      _csc_edge_ids.assign(eids);
+    }
+
+    /**
+     * Skips the archived in lists and rebuilds them without edge ids
+     * from the loaded out lists, sorting the out lists on the way for
+     * find_edge_id().
+     */
+    void load_in_edges(iarchive& arc, const boost::false_type&) {
+      archive_csc_type unused;
+      arc >> unused;
+      unused.clear();
+      std::vector<edge_id_type> out_ptrs = _csr_storage.get_index();
+      std::vector<edge_id_type> in_ptrs;
+      csr_type::value_vector_type targets =
+          _csr_storage.get_value_vector();
+      csc_type::value_vector_type sources;
+      transpose_adjacency(out_ptrs, targets, in_ptrs, sources);
+      transpose_adjacency(in_ptrs, sources, out_ptrs, targets);
+      _csr_storage.wrap(out_ptrs, targets);
+      _csc_storage.wrap(in_ptrs, sources);
+    }
 
     class edge_iterator : 
         public boost::iterator_facade <
@@ -620,20 +1298,27 @@ namespace graphlab {
         boost::random_access_traversal_tag,
         edge_type> {
          public:
-           edge_iterator(local_graph& lgraph_ref, 
-                         csc_edge_iterator iter, lvid_type sourceid) 
-               : lgraph_ref(lgraph_ref), _type(CSC), csc_iter(iter), vid(sourceid) {}
            edge_iterator(local_graph& lgraph_ref,
-                         csr_edge_iterator iter, lvid_type destid) 
-               : lgraph_ref(lgraph_ref), _type(CSR), csr_iter(iter), vid(destid) {}
+                         csr_edge_iterator iter, lvid_type vid,
+                         bool is_out = true)
+               : lgraph_ref(lgraph_ref), _type(is_out ? CSR : CSC),
+                 csr_iter(iter), vid(vid) {}
+           edge_iterator(local_graph& lgraph_ref,
+                         compressed_edge_iterator iter, lvid_type vid,
+                         bool is_out) 
+               : lgraph_ref(lgraph_ref), 
+                 _type(is_out ? COMPRESSED_OUT : COMPRESSED_IN),
+                 compressed_iter(iter), vid(vid) {}
 
          private:
            friend class boost::iterator_core_access;
 
            void increment() {
              switch (_type) {
-              case CSC: ++csc_iter; break;
+              case CSC:
               case CSR: ++csr_iter; break;
+              case COMPRESSED_OUT: 
+              case COMPRESSED_IN: ++compressed_iter; break;
               default: return;
              }
            }
@@ -641,8 +1326,11 @@ namespace graphlab {
            {
              ASSERT_EQ(_type, other._type);
              switch (_type) {
-              case CSC: return csc_iter == other.csc_iter;
+              case CSC:
               case CSR: return csr_iter == other.csr_iter;
+              case COMPRESSED_OUT: 
+              case COMPRESSED_IN: 
+                return compressed_iter == other.compressed_iter;
               default: return true;
              }
            }
@@ -651,22 +1339,29 @@ namespace graphlab {
            }
            void decrement() {
              switch (_type) {
-              case CSC: --csc_iter; break;
+              case CSC:
               case CSR: --csr_iter; break;
+              case COMPRESSED_OUT: 
+              case COMPRESSED_IN: compressed_iter.advance(-1); break;
               default: return;
              }
            }
            void advance(int n) {
              switch (_type) {
-              case CSC: csc_iter+=n; break;
+              case CSC:
               case CSR: csr_iter+=n; break;
+              case COMPRESSED_OUT: 
+              case COMPRESSED_IN: compressed_iter.advance(n); break;
               default: return;
              }
            } 
            ptrdiff_t distance_to(const edge_iterator& other) const {
              switch (_type) {
-              case CSC: return other.csc_iter - csc_iter;
+              case CSC:
               case CSR: return other.csr_iter - csr_iter;
+              case COMPRESSED_OUT: 
+              case COMPRESSED_IN: 
+                return compressed_iter.distance_to(other.compressed_iter);
               default: return 0;
              }
            }
@@ -674,9 +1369,12 @@ namespace graphlab {
            edge_type make_value() const {
              switch (_type) {
               case CSC: {
-                typename csc_edge_iterator::reference val
-                    = *csc_iter;
-                return edge_type(lgraph_ref, val.first, vid, val.second);
+                typename csr_edge_iterator::reference val
+                    = *csr_iter;
+                return edge_type(lgraph_ref, val.template get<0>(), vid,
+                                 has_edge_data ?
+                                 lgraph_ref._csc_edge_ids[val.template get<1>()]
+                                 : IN_EDGE_POSITION | val.template get<1>());
               }
               case CSR: {
                 typename csr_edge_iterator::reference val
@@ -686,14 +1384,23 @@ namespace graphlab {
                                  val.template get<0>(),
                                  val.template get<1>());
               }
+              case COMPRESSED_OUT: 
+                return edge_type(lgraph_ref, vid, compressed_iter->first,
+                                 compressed_iter->second);
+              case COMPRESSED_IN: 
+                return edge_type(lgraph_ref, compressed_iter->first, vid,
+                                 has_edge_data ||
+                                 lgraph_ref._compressed_in.has_explicit_ids() ?
+                                 compressed_iter->second :
+                                 IN_EDGE_POSITION | compressed_iter.index());
               default: return edge_type(lgraph_ref, -1, -1, -1);
              }
            }
-           enum list_type {CSR, CSC}; 
+           enum list_type {CSR, CSC, COMPRESSED_OUT, COMPRESSED_IN}; 
            local_graph& lgraph_ref;
            const list_type _type;
-           csc_edge_iterator csc_iter;
            csr_edge_iterator csr_iter;
+           compressed_edge_iterator compressed_iter;
            const lvid_type vid;
         }; // end of edge_iterator
 
@@ -709,19 +1416,35 @@ namespace graphlab {
     /** Stores the edge data and edge relationships. */
     csr_type _csr_storage;
     csc_type _csc_storage;
-    std::vector<EdgeData> edges;
+    in_edge_id_vector _csc_edge_ids;
+    edge_vector_type edges;
+
+    /** The compressed layout. Replaces the csr and csc storage when
+        compressed is set. */
+    compressed_type _compressed_out;
+    compressed_type _compressed_in;
 
     /** The edge data is a vector of edges where each edge stores its
         source, destination, and data. Used for temporary storage. The
         data is transferred into CSR+CSC representation in
         Finalize. This will be cleared after finalized.*/
-    local_edge_buffer<VertexData, EdgeData> edge_buffer;
+    local_edge_buffer<VertexData, EdgeData, 
+                      out_of_core_allocator<EdgeData> > edge_buffer;
+
+    /** The sorted runs of edges spilled from the edge buffer, and the
+        number of edges the buffer holds before it is spilled. 0 if it
+        is never spilled. */
+    local_edge_spill<EdgeData> spill;
+    size_t edge_buffer_limit;
    
     /** Mark whether the local_graph is finalized.  Graph finalization is a
         costly procedure but it can also dramatically improve
         performance. */
     bool finalized;
 
+    /** Whether finalize() builds the compressed adjacency layout. */
+    bool compressed;
+
 
     /**************************************************************************/
     /*                                                                        */
@@ -729,6 +1452,8 @@ namespace graphlab {
     /*                                                                        */
     /**************************************************************************/
     friend class local_graph_test; 
+    template <typename OtherVertexData, typename OtherEdgeData>
+    friend class local_graph;
   }; // End of class local_graph
 
 
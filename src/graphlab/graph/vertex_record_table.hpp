@@ -0,0 +1,428 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+#ifndef GRAPHLAB_VERTEX_RECORD_TABLE_HPP
+#define GRAPHLAB_VERTEX_RECORD_TABLE_HPP
+
+#include <vector>
+#include <iterator>
+#include <algorithm>
+
+#ifndef __NO_OPENMP__
+#include <omp.h>
+#endif
+
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/rpc/dc_types.hpp>
+#include <graphlab/rpc/dc_compile_parameters.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/serialization/iarchive.hpp>
+#include <graphlab/serialization/oarchive.hpp>
+
+namespace graphlab {
+
+  /**
+   * \internal
+   * Stores the vertex records of all the local vertices of a
+   * distributed graph, indexed by local vertex id.
+   *
+   * The fields of the records are kept in separate arrays. The owner
+   * and the global id, which the engines read in their inner loops,
+   * are packed together away from the global degrees and mirror sets.
+   *
+   * While the graph is being built, the mirror sets are fixed size
+   * bitsets which can be modified in place. compact() moves them into
+   * a single pool of sorted proc lists, so a vertex costs one offset
+   * plus one procid_t per mirror instead of a bitset of RPC_MAX_N_PROCS
+   * bits. Modifying a mirror set switches back to the bitsets.
+   */
+  class vertex_record_table {
+   public:
+    typedef fixed_dense_bitset<RPC_MAX_N_PROCS> mirror_type;
+
+    /**
+     * A copy of all the information associated with a vertex on
+     * this proc.
+     */
+    struct vertex_record {
+      /// The official owning processor for this vertex
+      procid_t owner;
+      /// The local vid of this vertex on this proc
+      vertex_id_type gvid;
+      /// The number of in edges
+      vertex_id_type num_in_edges, num_out_edges;
+      /** The set of proc that mirror this vertex.  The owner should
+          NOT be in this set.*/
+      mirror_type _mirrors;
+      vertex_record() :
+        owner(-1), gvid(-1), num_in_edges(0), num_out_edges(0) { }
+      vertex_record(const vertex_id_type& vid) :
+        owner(-1), gvid(vid), num_in_edges(0), num_out_edges(0) { }
+      procid_t get_owner () const { return owner; }
+      const mirror_type& mirrors() const { return _mirrors; }
+      size_t num_mirrors() const { return _mirrors.popcount(); }
+
+      void clear() {
+        _mirrors.clear();
+      }
+
+      void load(iarchive& arc) {
+        clear();
+        arc >> owner
+            >> gvid
+            >> num_in_edges
+            >> num_out_edges
+            >> _mirrors;
+      }
+
+      void save(oarchive& arc) const {
+        arc << owner
+            << gvid
+            << num_in_edges
+            << num_out_edges
+            << _mirrors;
+      } // end of save
+
+      bool operator==(const vertex_record& other) const {
+        return (
+            (owner == other.owner) &&
+            (gvid == other.gvid)  &&
+            (num_in_edges == other.num_in_edges) &&
+            (num_out_edges == other.num_out_edges) &&
+            (_mirrors == other._mirrors)
+            );
+      }
+    }; // end of vertex_record
+
+
+    /**
+     * A read only range over the mirrors of one vertex, in increasing
+     * order of procid. It is invalidated by any change to the table.
+     */
+    class mirror_list {
+     public:
+      class const_iterator {
+       public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef procid_t value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const procid_t* pointer;
+        typedef procid_t reference;
+
+        const_iterator(): ptr(NULL), dense(false) { }
+        const_iterator(const procid_t* ptr): ptr(ptr), dense(false) { }
+        const_iterator(mirror_type::const_iterator bit):
+            ptr(NULL), bit(bit), dense(true) { }
+
+        procid_t operator*() const { return dense ? procid_t(*bit) : *ptr; }
+
+        const_iterator& operator++() {
+          if (dense) ++bit;
+          else ++ptr;
+          return *this;
+        }
+
+        const_iterator operator++(int) {
+          const_iterator ret = *this;
+          ++(*this);
+          return ret;
+        }
+
+        bool operator==(const const_iterator& other) const {
+          return dense ? bit == other.bit : ptr == other.ptr;
+        }
+
+        bool operator!=(const const_iterator& other) const {
+          return !(*this == other);
+        }
+
+       private:
+        const procid_t* ptr;
+        mirror_type::const_iterator bit;
+        bool dense;
+      };
+      typedef const_iterator iterator;
+      typedef procid_t value_type;
+
+      mirror_list(const procid_t* b, const procid_t* e):
+          list_begin(b), list_end(e), bits(NULL) { }
+      mirror_list(const mirror_type* bits):
+          list_begin(NULL), list_end(NULL), bits(bits) { }
+
+      const_iterator begin() const {
+        return bits ? const_iterator(bits->begin()) : const_iterator(list_begin);
+      }
+
+      const_iterator end() const {
+        return bits ? const_iterator(bits->end()) : const_iterator(list_end);
+      }
+
+      size_t size() const {
+        return bits ? bits->popcount() : size_t(list_end - list_begin);
+      }
+
+      bool empty() const { return size() == 0; }
+
+      /// Returns true if proc is in the list
+      bool contains(procid_t proc) const {
+        if (bits) return bits->get(proc);
+        return std::binary_search(list_begin, list_end, proc);
+      }
+
+     private:
+      const procid_t* list_begin;
+      const procid_t* list_end;
+      const mirror_type* bits;
+    }; // end of mirror_list
+
+   public:
+    vertex_record_table(): compacted(false) { }
+
+    /// The number of vertex records
+    size_t size() const { return owners.size(); }
+
+    bool empty() const { return owners.empty(); }
+
+    /// True if the mirror sets are in the compact pool
+    bool is_compact() const { return compacted; }
+
+    void reserve(size_t n) {
+      expand();
+      owners.reserve(n); gvids.reserve(n);
+      in_degrees.reserve(n); out_degrees.reserve(n);
+      dense_mirrors.reserve(n);
+    }
+
+    /// Resizes the table. New records are default constructed.
+    void resize(size_t n) {
+      expand();
+      owners.resize(n, procid_t(-1));
+      gvids.resize(n, vertex_id_type(-1));
+      in_degrees.resize(n, 0);
+      out_degrees.resize(n, 0);
+      dense_mirrors.resize(n);
+    }
+
+    void push_back(const vertex_record& rec) {
+      expand();
+      owners.push_back(rec.owner);
+      gvids.push_back(rec.gvid);
+      in_degrees.push_back(rec.num_in_edges);
+      out_degrees.push_back(rec.num_out_edges);
+      dense_mirrors.push_back(rec._mirrors);
+    }
+
+    /// Releases all memory.
+    void clear() {
+      std::vector<procid_t>().swap(owners);
+      std::vector<vertex_id_type>().swap(gvids);
+      std::vector<vertex_id_type>().swap(in_degrees);
+      std::vector<vertex_id_type>().swap(out_degrees);
+      std::vector<mirror_type>().swap(dense_mirrors);
+      std::vector<size_t>().swap(mirror_ptrs);
+      std::vector<procid_t>().swap(mirror_pool);
+      compacted = false;
+    }
+
+    procid_t owner(lvid_type lvid) const { return owners[lvid]; }
+    procid_t& owner(lvid_type lvid) { return owners[lvid]; }
+
+    vertex_id_type gvid(lvid_type lvid) const { return gvids[lvid]; }
+    vertex_id_type& gvid(lvid_type lvid) { return gvids[lvid]; }
+
+    /// The number of in edges of the vertex in the global graph
+    vertex_id_type num_in_edges(lvid_type lvid) const { return in_degrees[lvid]; }
+    vertex_id_type& num_in_edges(lvid_type lvid) { return in_degrees[lvid]; }
+
+    /// The number of out edges of the vertex in the global graph
+    vertex_id_type num_out_edges(lvid_type lvid) const { return out_degrees[lvid]; }
+    vertex_id_type& num_out_edges(lvid_type lvid) { return out_degrees[lvid]; }
+
+    mirror_list mirrors(lvid_type lvid) const {
+      if (compacted) {
+        return mirror_list(pool_ptr(mirror_ptrs[lvid]),
+                           pool_ptr(mirror_ptrs[lvid + 1]));
+      } else {
+        return mirror_list(&(dense_mirrors[lvid]));
+      }
+    }
+
+    size_t num_mirrors(lvid_type lvid) const {
+      if (compacted) return mirror_ptrs[lvid + 1] - mirror_ptrs[lvid];
+      else return dense_mirrors[lvid].popcount();
+    }
+
+    /**
+     * Returns the mirror set of the vertex for modification. This
+     * switches the table back to bitsets if it is compact, and is
+     * therefore only thread safe on a table which is not compact.
+     */
+    mirror_type& mutable_mirrors(lvid_type lvid) {
+      expand();
+      return dense_mirrors[lvid];
+    }
+
+    /// Returns a copy of the record of the vertex
+    vertex_record get(lvid_type lvid) const {
+      vertex_record rec(gvids[lvid]);
+      rec.owner = owners[lvid];
+      rec.num_in_edges = in_degrees[lvid];
+      rec.num_out_edges = out_degrees[lvid];
+      if (compacted) {
+        for (size_t i = mirror_ptrs[lvid]; i < mirror_ptrs[lvid + 1]; ++i) {
+          rec._mirrors.set_bit(mirror_pool[i]);
+        }
+      } else {
+        rec._mirrors = dense_mirrors[lvid];
+      }
+      return rec;
+    }
+
+    /// Overwrites the record of the vertex
+    void set(lvid_type lvid, const vertex_record& rec) {
+      owners[lvid] = rec.owner;
+      gvids[lvid] = rec.gvid;
+      in_degrees[lvid] = rec.num_in_edges;
+      out_degrees[lvid] = rec.num_out_edges;
+      mutable_mirrors(lvid) = rec._mirrors;
+    }
+
+    /**
+     * Moves the mirror sets into the compact pool if that uses less
+     * memory than the bitsets, which is the case unless vertices have
+     * many mirrors. Returns the number of bytes saved.
+     */
+    size_t compact() {
+      if (compacted) return 0;
+      const size_t before = memory_usage();
+      const size_t n = size();
+      std::vector<size_t> ptrs(n + 1, 0);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t i = 0; i < ssize_t(n); ++i) {
+        ptrs[i + 1] = dense_mirrors[i].popcount();
+      }
+      for (size_t i = 0; i < n; ++i) ptrs[i + 1] += ptrs[i];
+      if ((n + 1) * sizeof(size_t) + ptrs[n] * sizeof(procid_t) >=
+          n * sizeof(mirror_type)) {
+        return 0;
+      }
+      std::vector<procid_t> pool(ptrs[n]);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t i = 0; i < ssize_t(n); ++i) {
+        // the bits are visited in increasing order so lists are sorted
+        size_t pos = ptrs[i];
+        const mirror_type& bits = dense_mirrors[i];
+        for (mirror_type::const_iterator it = bits.begin();
+             it != bits.end(); ++it) {
+          pool[pos++] = procid_t(*it);
+        }
+      }
+      mirror_ptrs.swap(ptrs);
+      mirror_pool.swap(pool);
+      std::vector<mirror_type>().swap(dense_mirrors);
+      compacted = true;
+      const size_t after = memory_usage();
+      return before > after ? before - after : 0;
+    }
+
+    /// Moves the mirror sets back into bitsets
+    void expand() {
+      if (!compacted) return;
+      const size_t n = size();
+      std::vector<mirror_type>(n).swap(dense_mirrors);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t i = 0; i < ssize_t(n); ++i) {
+        for (size_t j = mirror_ptrs[i]; j < mirror_ptrs[i + 1]; ++j) {
+          dense_mirrors[i].set_bit(mirror_pool[j]);
+        }
+      }
+      std::vector<size_t>().swap(mirror_ptrs);
+      std::vector<procid_t>().swap(mirror_pool);
+      compacted = false;
+    }
+
+    /// Bytes allocated by the owner and global id arrays
+    size_t hot_memory_usage() const {
+      return owners.capacity() * sizeof(procid_t) +
+          gvids.capacity() * sizeof(vertex_id_type);
+    }
+
+    /// Bytes allocated by the whole table
+    size_t memory_usage() const {
+      return hot_memory_usage() +
+          (in_degrees.capacity() + out_degrees.capacity()) *
+          sizeof(vertex_id_type) +
+          dense_mirrors.capacity() * sizeof(mirror_type) +
+          mirror_ptrs.capacity() * sizeof(size_t) +
+          mirror_pool.capacity() * sizeof(procid_t);
+    }
+
+    /**
+     * Same format as a std::vector<vertex_record>, which stores the
+     * length once for the vector and once for its elements.
+     */
+    void save(oarchive& oarc) const {
+      oarc << size_t(size()) << size_t(size());
+      for (size_t i = 0; i < size(); ++i) oarc << get(i);
+    }
+
+    void load(iarchive& iarc) {
+      clear();
+      size_t len;
+      iarc >> len >> len;
+      reserve(len);
+      for (size_t i = 0; i < len; ++i) {
+        vertex_record rec;
+        iarc >> rec;
+        push_back(rec);
+      }
+    }
+
+   private:
+    const procid_t* pool_ptr(size_t pos) const {
+      return mirror_pool.empty() ? NULL : &(mirror_pool[0]) + pos;
+    }
+
+    /// hot fields
+    std::vector<procid_t> owners;
+    std::vector<vertex_id_type> gvids;
+
+    /// cold fields
+    std::vector<vertex_id_type> in_degrees;
+    std::vector<vertex_id_type> out_degrees;
+    /// the mirror sets if the table is not compact
+    std::vector<mirror_type> dense_mirrors;
+    /// mirror_pool[mirror_ptrs[i]...mirror_ptrs[i+1]] are the mirrors of i
+    std::vector<size_t> mirror_ptrs;
+    std::vector<procid_t> mirror_pool;
+    bool compacted;
+  }; // end of vertex_record_table
+
+} // end of namespace graphlab
+
+#endif
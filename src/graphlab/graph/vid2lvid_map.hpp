@@ -0,0 +1,380 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_GRAPH_VID2LVID_MAP_HPP
+#define GRAPHLAB_GRAPH_VID2LVID_MAP_HPP
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdint.h>
+
+#ifndef __NO_OPENMP__
+#include <omp.h>
+#endif
+
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/util/hopscotch_map.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+
+namespace graphlab {
+
+  /**
+   * \internal
+   * The map from global vertex ids to local vertex ids used by the
+   * distributed_graph.
+   *
+   * While the graph is being built the map is a hopscotch_map. Once the
+   * graph is finalized, compact() inspects the range of the ids on this
+   * machine and, if it is cheaper, switches to one of two dense
+   * representations:
+   * \li OFFSET_MODE: an array of lvids indexed by vid - min_vid. Used when
+   *     nearly every id in the range is present. A lookup is one load.
+   * \li RANK_MODE: a bitset over [min_vid, max_vid] marking the present ids
+   *     with a rank directory, and an array of lvids indexed by rank.
+   *     Costs about 1.1 bits per id in the range plus one lvid per vertex.
+   * Otherwise the hash map is kept.
+   *
+   * Any modification switches the map back to the hash map.
+   * The iterators returned by find() are read-only and cannot be
+   * incremented. Use lookup() to translate an id without the iterator.
+   */
+  class vid2lvid_map {
+  public:
+    typedef hopscotch_map<vertex_id_type, lvid_type> hash_map_type;
+    typedef hash_map_type::value_type value_type;
+    typedef vertex_id_type key_type;
+    typedef lvid_type mapped_type;
+
+    enum storage_mode { HASH_MODE, OFFSET_MODE, RANK_MODE };
+
+    /// The result of find(). Holds a copy of the (vid, lvid) pair.
+    class const_iterator {
+    public:
+      const_iterator(): valid(false) { }
+      const value_type& operator*() const { return val; }
+      const value_type* operator->() const { return &val; }
+      bool operator==(const const_iterator& other) const {
+        return valid == other.valid && (!valid || val.first == other.val.first);
+      }
+      bool operator!=(const const_iterator& other) const {
+        return !((*this) == other);
+      }
+    private:
+      friend class vid2lvid_map;
+      const_iterator(vertex_id_type vid, lvid_type lvid):
+          val(vid, lvid), valid(true) { }
+      value_type val;
+      bool valid;
+    };
+    typedef const_iterator iterator;
+
+  private:
+    /// An lvid which is never assigned. Marks holes in OFFSET_MODE
+    static lvid_type no_lvid() { return lvid_type(-1); }
+
+    /// Number of 64-bit words covered by one rank directory entry
+    static const size_t WORDS_PER_RANK = 4;
+
+    storage_mode mode;
+    hash_map_type hash;
+
+    /// The smallest id in the dense modes
+    vertex_id_type base;
+    /// Number of ids in [base, max_vid] in the dense modes
+    size_t range;
+    /// Number of entries in the dense modes
+    size_t numel;
+    /// OFFSET_MODE: lvid per offset. RANK_MODE: lvid per rank
+    std::vector<lvid_type> lvids;
+    /// RANK_MODE: presence bit per offset
+    std::vector<uint64_t> bits;
+    /// RANK_MODE: number of bits set before each group of WORDS_PER_RANK
+    std::vector<lvid_type> block_rank;
+
+    size_t rank(size_t offset) const {
+      const size_t word = offset / 64;
+      size_t r = block_rank[word / WORDS_PER_RANK];
+      for (size_t w = word - word % WORDS_PER_RANK; w < word; ++w) {
+        r += __builtin_popcountll(bits[w]);
+      }
+      return r + __builtin_popcountll(bits[word] &
+                                      ((uint64_t(1) << (offset % 64)) - 1));
+    }
+
+    static size_t num_threads() {
+#ifdef _OPENMP
+      return omp_get_max_threads();
+#else
+      return 1;
+#endif
+    }
+
+    /// Returns all the pairs in the map
+    void get_pairs(std::vector<value_type>& pairs) const {
+      pairs.clear();
+      pairs.reserve(size());
+      if (mode == HASH_MODE) {
+        for (hash_map_type::const_iterator iter = hash.begin();
+             iter != hash.end(); ++iter) {
+          pairs.push_back(*iter);
+        }
+      } else {
+        for (size_t offset = 0; offset < range; ++offset) {
+          const_iterator iter = find_offset(offset);
+          if (iter.valid) pairs.push_back(*iter);
+        }
+      }
+    }
+
+    const_iterator find_offset(size_t offset) const {
+      if (mode == OFFSET_MODE) {
+        if (lvids[offset] != no_lvid()) {
+          return const_iterator(base + offset, lvids[offset]);
+        }
+      } else if (bits[offset / 64] & (uint64_t(1) << (offset % 64))) {
+        return const_iterator(base + offset, lvids[rank(offset)]);
+      }
+      return const_iterator();
+    }
+
+    void release_dense() {
+      mode = HASH_MODE;
+      base = 0; range = 0; numel = 0;
+      std::vector<lvid_type>().swap(lvids);
+      std::vector<uint64_t>().swap(bits);
+      std::vector<lvid_type>().swap(block_rank);
+    }
+
+  public:
+    vid2lvid_map(): mode(HASH_MODE), base(0), range(0), numel(0) { }
+
+    /// Returns the current representation
+    storage_mode get_mode() const { return mode; }
+
+    /// Returns a readable name of the current representation
+    const char* mode_name() const {
+      return mode == HASH_MODE ? "hash" :
+             (mode == OFFSET_MODE ? "offset array" : "rank bitset");
+    }
+
+    size_t size() const {
+      return mode == HASH_MODE ? hash.size() : numel;
+    }
+
+    /**
+     * Returns the local id of a vertex, or lvid_type(-1) if the vertex is
+     * not on this machine.
+     */
+    lvid_type lookup(vertex_id_type vid) const {
+      if (mode == HASH_MODE) {
+        hash_map_type::const_iterator iter = hash.find(vid);
+        return iter == hash.end() ? no_lvid() : iter->second;
+      }
+      const size_t offset = size_t(vid - base);
+      if (vid < base || offset >= range) return no_lvid();
+      if (mode == OFFSET_MODE) return lvids[offset];
+      if (bits[offset / 64] & (uint64_t(1) << (offset % 64))) {
+        return lvids[rank(offset)];
+      }
+      return no_lvid();
+    }
+
+    const_iterator find(vertex_id_type vid) const {
+      const lvid_type lvid = lookup(vid);
+      if (lvid == no_lvid()) return end();
+      return const_iterator(vid, lvid);
+    }
+
+    const_iterator end() const {
+      return const_iterator();
+    }
+
+    size_t count(vertex_id_type vid) const {
+      return lookup(vid) != no_lvid();
+    }
+
+    /**
+     * Switches back to the hash map. Called by every modification. Not
+     * thread safe: call it once before modifying the map from several
+     * threads.
+     */
+    void expand() {
+      if (mode == HASH_MODE) return;
+      std::vector<value_type> pairs;
+      get_pairs(pairs);
+      release_dense();
+      hash.clear();
+      hash.bulk_insert(pairs.begin(), pairs.end());
+    }
+
+    lvid_type& operator[](vertex_id_type vid) {
+      expand();
+      return hash[vid];
+    }
+
+    std::pair<const_iterator, bool> insert(const value_type& v) {
+      expand();
+      std::pair<hash_map_type::iterator, bool> ret = hash.insert(v);
+      return std::make_pair(const_iterator(ret.first->first,
+                                           ret.first->second),
+                            ret.second);
+    }
+
+    template <typename RandomIterator>
+    void bulk_insert(RandomIterator first, RandomIterator last) {
+      expand();
+      hash.bulk_insert(first, last);
+    }
+
+    void rehash(size_t s) {
+      expand();
+      hash.rehash(s);
+    }
+
+    /// Swaps contents with a hash map, leaving this map in HASH_MODE
+    void swap(hash_map_type& other) {
+      expand();
+      hash.swap(other);
+    }
+
+    void swap(vid2lvid_map& other) {
+      std::swap(mode, other.mode);
+      hash.swap(other.hash);
+      std::swap(base, other.base);
+      std::swap(range, other.range);
+      std::swap(numel, other.numel);
+      lvids.swap(other.lvids);
+      bits.swap(other.bits);
+      block_rank.swap(other.block_rank);
+    }
+
+    void clear() {
+      release_dense();
+      hash.clear();
+    }
+
+    /// Returns the number of bytes used by the map
+    size_t memory_usage() const {
+      if (mode == HASH_MODE) return hash_memory_usage(hash.capacity());
+      return lvids.capacity() * sizeof(lvid_type) +
+          bits.capacity() * sizeof(uint64_t) +
+          block_rank.capacity() * sizeof(lvid_type);
+    }
+
+    /**
+     * An estimate of the number of bytes used by a hash map with the given
+     * capacity. Each entry holds the pair and a 32-bit hop field.
+     */
+    static size_t hash_memory_usage(size_t capacity) {
+      const size_t entry = (sizeof(value_type) + sizeof(uint32_t) +
+                            sizeof(vertex_id_type) - 1) /
+                           sizeof(vertex_id_type) * sizeof(vertex_id_type);
+      return capacity * entry;
+    }
+
+    /**
+     * Chooses the smallest of the hash map and the dense representations
+     * for the current contents. Returns the number of bytes saved.
+     */
+    size_t compact() {
+      if (mode != HASH_MODE || hash.size() == 0) return 0;
+      std::vector<value_type> pairs;
+      get_pairs(pairs);
+      vertex_id_type minvid = pairs[0].first, maxvid = pairs[0].first;
+      for (size_t i = 1; i < pairs.size(); ++i) {
+        minvid = std::min(minvid, pairs[i].first);
+        maxvid = std::max(maxvid, pairs[i].first);
+      }
+      const size_t n = pairs.size();
+      const size_t hash_bytes = memory_usage();
+      // the range may not be representable at all
+      if (uint64_t(maxvid - minvid) >= uint64_t(size_t(-1) / 64)) return 0;
+      const size_t nrange = size_t(maxvid - minvid) + 1;
+      const size_t nwords = (nrange + 63) / 64;
+      const size_t offset_bytes = nrange * sizeof(lvid_type);
+      const size_t rank_bytes = nwords * sizeof(uint64_t) +
+          (nwords + WORDS_PER_RANK - 1) / WORDS_PER_RANK * sizeof(lvid_type) +
+          n * sizeof(lvid_type);
+      if (std::min(offset_bytes, rank_bytes) >= hash_bytes) return 0;
+
+      hash_map_type().swap(hash);
+      base = minvid;
+      range = nrange;
+      numel = n;
+      if (offset_bytes <= rank_bytes) {
+        mode = OFFSET_MODE;
+        lvids.assign(range, no_lvid());
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(num_threads())
+#endif
+        for (ptrdiff_t i = 0; i < (ptrdiff_t)n; ++i) {
+          lvids[pairs[i].first - base] = pairs[i].second;
+        }
+      } else {
+        mode = RANK_MODE;
+        bits.assign(nwords, 0);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(num_threads())
+#endif
+        for (ptrdiff_t i = 0; i < (ptrdiff_t)n; ++i) {
+          const size_t offset = pairs[i].first - base;
+          __sync_fetch_and_or(&bits[offset / 64], uint64_t(1) << (offset % 64));
+        }
+        block_rank.resize((nwords + WORDS_PER_RANK - 1) / WORDS_PER_RANK);
+        size_t total = 0;
+        for (size_t w = 0; w < nwords; ++w) {
+          if (w % WORDS_PER_RANK == 0) block_rank[w / WORDS_PER_RANK] = total;
+          total += __builtin_popcountll(bits[w]);
+        }
+        lvids.resize(n);
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(num_threads())
+#endif
+        for (ptrdiff_t i = 0; i < (ptrdiff_t)n; ++i) {
+          lvids[rank(pairs[i].first - base)] = pairs[i].second;
+        }
+      }
+      return hash_bytes - memory_usage();
+    }
+
+    /// Serializes in the same format as a hopscotch_map
+    void save(oarchive& oarc) const {
+      if (mode == HASH_MODE) {
+        oarc << hash;
+      } else {
+        std::vector<value_type> pairs;
+        get_pairs(pairs);
+        oarc << pairs.size() << pairs.size() * 2;
+        for (size_t i = 0; i < pairs.size(); ++i) oarc << pairs[i];
+      }
+    }
+
+    void load(iarchive& iarc) {
+      release_dense();
+      iarc >> hash;
+    }
+  };
+
+} // end of namespace graphlab
+
+#endif
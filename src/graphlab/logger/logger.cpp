@@ -22,14 +22,67 @@
 
 
 #include <graphlab/logger/logger.hpp>
+#include <sched.h>
+#include <sys/time.h>
 #include <cstdarg>
+#include <cstddef>
 #include <cstdio>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <vector>
 #include <pthread.h>
 #include <graphlab/logger/backtrace.hpp>
 
+namespace logger_impl {
+
+int log_level_cache = LOG_EMPH;
+
+/**
+ * A single producer, single consumer ring of log records. The owning
+ * thread appends records at head, and the thread holding the drain lock
+ * of the logger consumes them from tail. Each record is a record_header
+ * followed by len bytes.
+ */
+struct log_ring {
+  enum {CAPACITY = 1 << 18};
+  char data[CAPACITY];
+  /// bytes appended, only advanced by the owning thread
+  volatile size_t head;
+  /// bytes consumed, only advanced by the drainer
+  volatile size_t tail;
+  /// set when the owning thread exits, the drainer then frees the ring
+  volatile bool orphaned;
+  log_ring* next;
+
+  log_ring(): head(0), tail(0), orphaned(false), next(NULL) { }
+
+  void copy_in(size_t pos, const void* src, size_t len) {
+    const char* s = reinterpret_cast<const char*>(src);
+    pos %= CAPACITY;
+    const size_t first = std::min(len, CAPACITY - pos);
+    memcpy(data + pos, s, first);
+    memcpy(data, s + first, len - first);
+  }
+
+  void copy_out(size_t pos, void* dst, size_t len) const {
+    char* d = reinterpret_cast<char*>(dst);
+    pos %= CAPACITY;
+    const size_t first = std::min(len, CAPACITY - pos);
+    memcpy(d, data + pos, first);
+    memcpy(d + first, data, len - first);
+  }
+};
+
+struct record_header {
+  enum {TEXT, FIELDS};
+  size_t len;
+  int kind;
+  int level;
+};
+
+}
+
 file_logger& global_logger() {
   static file_logger l;
   return l;
@@ -44,6 +97,13 @@ void streambuffdestructor(void* v){
   delete t;
 }
 
+void ringdestructor(void* v){
+  logger_impl::log_ring* r = reinterpret_cast<logger_impl::log_ring*>(v);
+  // the records written before are drained before the ring is freed
+  __sync_synchronize();
+  r->orphaned = true;
+}
+
 const char* messages[] = {  "DEBUG:    ",
                             "DEBUG:    ",
                             "INFO:     ",
@@ -57,20 +117,40 @@ file_logger::file_logger() {
   log_file = "";
   log_to_console = true;
   log_level = LOG_EMPH;
+  async_enabled = false;
+  flusher_stop = false;
+  rings = NULL;
   pthread_mutex_init(&mut, NULL);
+  pthread_mutex_init(&ring_mut, NULL);
+  pthread_mutex_init(&drain_mut, NULL);
+  pthread_cond_init(&ring_cond, NULL);
   pthread_key_create(&streambuffkey, streambuffdestructor);
+  pthread_key_create(&ringkey, ringdestructor);
 }
 
 file_logger::~file_logger() {
+  set_async(false);
+  flush();
+  // exiting threads must not touch the rings after this point
+  pthread_key_delete(ringkey);
+  while (rings != NULL) {
+    logger_impl::log_ring* next = rings->next;
+    delete rings;
+    rings = next;
+  }
   if (fout.good()) {
     fout.flush();
     fout.close();
   }
 
+  pthread_cond_destroy(&ring_cond);
+  pthread_mutex_destroy(&drain_mut);
+  pthread_mutex_destroy(&ring_mut);
   pthread_mutex_destroy(&mut);
 }
 
 bool file_logger::set_log_file(std::string file) {
+  flush();
   // close the file if it is open
   if (fout.good()) {
     fout.flush();
@@ -142,6 +222,10 @@ void file_logger::_log(int lineloglevel,const char* file,const char* function,
 
     str[byteswritten] = '\n';
     str[byteswritten+1] = 0;
+    if (async_enabled) {
+      _lograw(lineloglevel, str, byteswritten + 1);
+      return;
+    }
     // write the output
     if (fout.good()) {
       pthread_mutex_lock(&mut);
@@ -202,6 +286,18 @@ void file_logger::_logbuf(int lineloglevel,const char* file,const char* function
 }
 
 void file_logger::_lograw(int lineloglevel, const char* buf, int len) {
+  if (async_enabled) {
+    if (lineloglevel != LOG_FATAL &&
+        async_push(logger_impl::record_header::TEXT, lineloglevel, buf, len)) {
+      return;
+    }
+    // written synchronously, after the pending messages
+    flush();
+  }
+  write_raw(lineloglevel, buf, len);
+}
+
+void file_logger::write_raw(int lineloglevel, const char* buf, int len) {
   if (fout.good()) {
     pthread_mutex_lock(&mut);
     fout.write(buf,len);
@@ -271,3 +367,226 @@ file_logger& file_logger::start_stream(int lineloglevel,const char* file,
   return *this;
 }
 
+
+
+
+/**
+ * Formats a logfields() message as
+ * "LEVEL: file(function:line): message name=value name=value"
+ */
+static std::string format_fields(const logger_impl::fields_record& record) {
+  const char* file = record.file;
+  file = ((strrchr(file, '/') ? : file- 1) + 1);
+  std::stringstream strm;
+  strm << messages[record.level] << file
+       << "(" << record.function << ":" << record.line << "): "
+       << record.message;
+  for (size_t i = 0; i < record.nfields; ++i) {
+    const logger_impl::log_field& f = record.fields[i];
+    strm << " " << f.name << "=";
+    switch(f.type) {
+      case logger_impl::log_field::INTEGER: strm << f.value.i; break;
+      case logger_impl::log_field::UNSIGNED: strm << f.value.u; break;
+      case logger_impl::log_field::REAL: strm << f.value.d; break;
+      case logger_impl::log_field::STRING: strm << f.value.s; break;
+    }
+  }
+  strm << "\n";
+  return strm.str();
+}
+
+void file_logger::_logfields(const logger_impl::fields_record& record) {
+  if (record.level < log_level) return;
+  if (async_enabled) {
+    // only the used fields are copied
+    const size_t len = offsetof(logger_impl::fields_record, fields) +
+                       record.nfields * sizeof(logger_impl::log_field);
+    if (record.level != LOG_FATAL &&
+        async_push(logger_impl::record_header::FIELDS, record.level,
+                   &record, len)) {
+      return;
+    }
+    flush();
+  }
+  const std::string str = format_fields(record);
+  write_raw(record.level, str.c_str(), (int)str.length());
+}
+
+
+logger_impl::log_ring* file_logger::thread_ring() {
+  logger_impl::log_ring* ring =
+    reinterpret_cast<logger_impl::log_ring*>(pthread_getspecific(ringkey));
+  if (ring == NULL) {
+    ring = new logger_impl::log_ring;
+    pthread_mutex_lock(&ring_mut);
+    ring->next = rings;
+    rings = ring;
+    pthread_mutex_unlock(&ring_mut);
+    pthread_setspecific(ringkey, ring);
+  }
+  return ring;
+}
+
+
+bool file_logger::async_push(int kind, int loglevel,
+                             const void* buf, size_t len) {
+  typedef logger_impl::log_ring log_ring;
+  const logger_impl::record_header header = {len, kind, loglevel};
+  const size_t total = sizeof(header) + len;
+  // large messages are written synchronously
+  if (total > log_ring::CAPACITY / 2) return false;
+  log_ring* ring = thread_ring();
+  while (log_ring::CAPACITY - (ring->head - ring->tail) < total) {
+    // the ring is full: wake up the flusher, or drain it ourselves if
+    // the flusher was stopped in between
+    if (async_enabled) {
+      pthread_cond_signal(&ring_cond);
+      sched_yield();
+    } else {
+      flush();
+    }
+  }
+  const size_t head = ring->head;
+  ring->copy_in(head, &header, sizeof(header));
+  ring->copy_in(head + sizeof(header), buf, len);
+  // publish the record after its content
+  __sync_synchronize();
+  ring->head = head + total;
+  if (ring->head - ring->tail > log_ring::CAPACITY / 2) {
+    pthread_cond_signal(&ring_cond);
+  }
+  return true;
+}
+
+
+void file_logger::drain() {
+  typedef logger_impl::log_ring log_ring;
+  std::vector<char> buf;
+  // Rings are only inserted at the front of the list and only removed
+  // here, under drain_mut, so the rings after the current front can be
+  // walked without ring_mut. Threads registering a new ring then never
+  // wait behind the writes; their rings are drained on the next call.
+  pthread_mutex_lock(&ring_mut);
+  log_ring* first = rings;
+  pthread_mutex_unlock(&ring_mut);
+  std::vector<log_ring*> finished;
+  for (log_ring* ring = first; ring != NULL; ring = ring->next) {
+    const bool orphaned = ring->orphaned;
+    __sync_synchronize();
+    const size_t head = ring->head;
+    __sync_synchronize();
+    size_t pos = ring->tail;
+    while (pos != head) {
+      logger_impl::record_header header;
+      ring->copy_out(pos, &header, sizeof(header));
+      pos += sizeof(header);
+      if (header.kind == logger_impl::record_header::TEXT) {
+        buf.resize(header.len + 1);
+        ring->copy_out(pos, &(buf[0]), header.len);
+        write_raw(header.level, &(buf[0]), (int)header.len);
+      } else {
+        logger_impl::fields_record record;
+        ring->copy_out(pos, &record, header.len);
+        const std::string str = format_fields(record);
+        write_raw(header.level, str.c_str(), (int)str.length());
+      }
+      pos += header.len;
+    }
+    // the space is released after the records are read
+    __sync_synchronize();
+    ring->tail = pos;
+    if (orphaned) finished.push_back(ring);
+  }
+  if (finished.empty()) return;
+  // the rings of exited threads are empty now and can be unlinked
+  pthread_mutex_lock(&ring_mut);
+  for (size_t i = 0; i < finished.size(); ++i) {
+    log_ring** link = &rings;
+    while (*link != finished[i]) link = &((*link)->next);
+    *link = finished[i]->next;
+  }
+  pthread_mutex_unlock(&ring_mut);
+  for (size_t i = 0; i < finished.size(); ++i) delete finished[i];
+}
+
+
+void file_logger::flush() {
+  pthread_mutex_lock(&drain_mut);
+  drain();
+  pthread_mutex_unlock(&drain_mut);
+  pthread_mutex_lock(&mut);
+  if (fout.good()) fout.flush();
+  pthread_mutex_unlock(&mut);
+}
+
+
+void* file_logger::flusher_main(void* logger) {
+  file_logger& l = *reinterpret_cast<file_logger*>(logger);
+  pthread_mutex_lock(&l.ring_mut);
+  while (!l.flusher_stop) {
+    // wake up every 10ms, or earlier when a ring is half full
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    struct timespec deadline;
+    deadline.tv_sec = now.tv_sec;
+    deadline.tv_nsec = now.tv_usec * 1000 + 10000000;
+    if (deadline.tv_nsec >= 1000000000) {
+      deadline.tv_sec += 1;
+      deadline.tv_nsec -= 1000000000;
+    }
+    pthread_cond_timedwait(&l.ring_cond, &l.ring_mut, &deadline);
+    pthread_mutex_unlock(&l.ring_mut);
+    pthread_mutex_lock(&l.drain_mut);
+    l.drain();
+    pthread_mutex_unlock(&l.drain_mut);
+    pthread_mutex_lock(&l.ring_mut);
+  }
+  pthread_mutex_unlock(&l.ring_mut);
+  return NULL;
+}
+
+
+void file_logger::set_async(bool async) {
+  if (async == async_enabled) return;
+  if (async) {
+    flusher_stop = false;
+    if (pthread_create(&flusher, NULL, flusher_main, this) != 0) {
+      std::cerr << "Unable to start the log flusher thread" << std::endl;
+      return;
+    }
+    async_enabled = true;
+  } else {
+    async_enabled = false;
+    pthread_mutex_lock(&ring_mut);
+    flusher_stop = true;
+    pthread_cond_signal(&ring_cond);
+    pthread_mutex_unlock(&ring_mut);
+    pthread_join(flusher, NULL);
+    flush();
+  }
+}
+
+
+bool logger_impl::rate_limiter::allow(size_t max_per_sec, int lvl,
+                                      const char* file,
+                                      const char* function, int line) {
+  const size_t now = graphlab::timer::approx_time_millis() / 1000;
+  if (now != window) {
+    // a new second. Concurrent callers may both reset the count, which
+    // only lets a few more messages through.
+    window = now;
+    count = 0;
+    const size_t dropped = __sync_lock_test_and_set(&suppressed, 0);
+    if (dropped > 0) {
+      file = ((strrchr(file, '/') ? : file- 1) + 1);
+      char str[1024];
+      const int len = snprintf(str, 1024, "%s%s(%s:%d): %lu messages suppressed\n",
+                               messages[lvl], file, function, line,
+                               (unsigned long)dropped);
+      global_logger()._lograw(lvl, str, std::min(len, 1023));
+    }
+  }
+  if (__sync_add_and_fetch(&count, 1) <= max_per_sec) return true;
+  __sync_fetch_and_add(&suppressed, 1);
+  return false;
+}
@@ -35,7 +35,24 @@
  *
  * The difference between the hard level and the soft level is that the
  * soft level can be changed at runtime, while the hard level optimizes away
- * logging calls at compile time.
+ * logging calls at compile time. A call below the soft level costs one
+ * comparison against a cached copy of the level.
+ *
+ * Besides logger() and logstream(), logfields() records a message with
+ * named values whose formatting is deferred, and logger_ratelimit() /
+ * logstream_ratelimit() bound the number of messages per second of a
+ * call site:
+ * \code
+ * logfields(LOG_INFO, "iteration done")("iteration", i)("active", nactive);
+ * logstream_ratelimit(LOG_DEBUG, 10) << "vertex " << vid << std::endl;
+ * \endcode
+ *
+ * By default messages are written synchronously. After
+ * global_logger().set_async(true), each thread appends its messages to
+ * its own lock free ring buffer and a background thread formats and
+ * writes them, so logging threads never wait on each other. Messages of
+ * one thread keep their order. LOG_FATAL messages are always written
+ * synchronously after the pending messages.
  */
 
 #ifndef GRAPHLAB_LOG_LOG_HPP
@@ -114,10 +131,16 @@
 #define logger_ontick(sec,lvl,fmt,...)
 #define logstream_ontick(sec, lvl) if(0) null_stream()
 
+#define logfields(lvl,msg) if(0) null_fields()
+
+#define logger_ratelimit(lvl,max_per_sec,fmt,...)
+#define logstream_ratelimit(lvl,max_per_sec) if(0) null_stream()
+
 #else
 
 #define logger(lvl,fmt,...)                 \
-    (log_dispatch<(lvl >= OUTPUTLEVEL)>::exec(lvl,__FILE__, __func__ ,__LINE__,fmt,##__VA_ARGS__))
+    ((lvl == LOG_FATAL || lvl >= logger_impl::log_level_cache) ?       \
+     log_dispatch<(lvl >= OUTPUTLEVEL)>::exec(lvl,__FILE__, __func__ ,__LINE__,fmt,##__VA_ARGS__) : (void)0)
 
 
 #define logbuf(lvl,buf,len)                 \
@@ -125,7 +148,38 @@
                         __func__ ,__LINE__,buf,len))
 
 #define logstream(lvl)                      \
-    if(lvl >= global_logger().get_log_level()) (log_stream_dispatch<(lvl >= OUTPUTLEVEL)>::exec(lvl,__FILE__, __func__ ,__LINE__) )
+    if(lvl >= logger_impl::log_level_cache) (log_stream_dispatch<(lvl >= OUTPUTLEVEL)>::exec(lvl,__FILE__, __func__ ,__LINE__) )
+
+/**
+ * \def logfields(lvl,msg)
+ *    Logs msg followed by "name=value" pairs appended with
+ *    (name, value). The values are copied and formatted later, by
+ *    the writer. The message, the names and string values must be
+ *    string literals or otherwise outlive the logger.
+ */
+#define logfields(lvl,msg)                  \
+    if(lvl >= OUTPUTLEVEL && lvl >= logger_impl::log_level_cache) ::log_fields(lvl,__FILE__, __func__ ,__LINE__,msg)
+
+/**
+ * \def logger_ratelimit(lvl,max_per_sec,fmt,...)
+ * \def logstream_ratelimit(lvl,max_per_sec)
+ *    As logger and logstream, but at most max_per_sec messages of this
+ *    call site are written each second. The number of dropped messages is
+ *    reported when the call site is allowed to log again.
+ */
+#define logger_ratelimit(lvl,max_per_sec,fmt,...)                 \
+{    \
+  static logger_impl::rate_limiter __limiter__ = {0, 0, 0};    \
+  if (lvl >= logger_impl::log_level_cache &&                   \
+      __limiter__.allow(max_per_sec, lvl, __FILE__, __func__, __LINE__)) {  \
+    (log_dispatch<(lvl >= OUTPUTLEVEL)>::exec(lvl,__FILE__, __func__ ,__LINE__,fmt,##__VA_ARGS__)); \
+  }  \
+}
+
+#define logstream_ratelimit(lvl,max_per_sec)                      \
+    if(lvl >= logger_impl::log_level_cache)                       \
+      (log_stream_dispatch<(lvl >= OUTPUTLEVEL)>::exec(lvl,__FILE__, __func__ ,__LINE__, \
+        logger_impl::site_rate_limiter<__LINE__>::limiter.allow(max_per_sec, lvl, __FILE__, __func__, __LINE__)) )
 
 #define logger_once(lvl,fmt,...)                 \
 {    \
@@ -174,11 +228,72 @@ struct streambuff_tls_entry {
   std::stringstream streambuffer;
   bool streamactive;
 };
+
+/// The log level of global_logger(), read by the logging macros
+extern int log_level_cache;
+
+/// A named value of a logfields() message
+struct log_field {
+  enum field_type {INTEGER, UNSIGNED, REAL, STRING};
+  const char* name;
+  field_type type;
+  union {
+    long long i;
+    unsigned long long u;
+    double d;
+    const char* s;
+  } value;
+};
+
+/// A logfields() message, copied as is into the asynchronous buffers
+struct fields_record {
+  enum {MAX_FIELDS = 8};
+  int level;
+  const char* file;
+  const char* function;
+  int line;
+  const char* message;
+  size_t nfields;
+  log_field fields[MAX_FIELDS];
+};
+
+/**
+ * Counts the messages of a call site in the current second. This is a
+ * POD so that the static instance of each call site is initialized
+ * without a guard.
+ */
+struct rate_limiter {
+  volatile size_t window;
+  volatile size_t count;
+  volatile size_t suppressed;
+  bool allow(size_t max_per_sec, int lvl, const char* file,
+             const char* function, int line);
+};
+
+/// The buffer of a thread in asynchronous mode
+struct log_ring;
+
+namespace {
+/**
+ * The rate_limiter of the logstream_ratelimit() call sites of a line.
+ * The unnamed namespace gives each translation unit its own.
+ */
+template <int Line>
+struct site_rate_limiter {
+  static rate_limiter limiter;
+};
+
+template <int Line>
+rate_limiter site_rate_limiter<Line>::limiter = {0, 0, 0};
+}
 }
 
 
 extern void __print_back_trace();
 
+class file_logger;
+file_logger& global_logger();
+
 /**
   logging class.
   This writes to a file, and/or the system console.
@@ -200,6 +315,21 @@ class file_logger{
   */
   bool set_log_file(std::string file);
 
+  /**
+    If async is true, subsequent messages are appended to a buffer of
+    the calling thread and written by a background thread. If false,
+    the background thread is stopped after writing all pending messages.
+  */
+  void set_async(bool async);
+
+  /// Returns true if messages are written by the background thread
+  bool get_async() const {
+    return async_enabled;
+  }
+
+  /// Writes all pending asynchronous messages
+  void flush();
+
   /// If consolelog is true, subsequent logger output will be written to stderr
   void set_log_to_console(bool consolelog) {
     log_to_console = consolelog;
@@ -283,6 +413,7 @@ class file_logger{
       logger level will not be written. */
   void set_log_level(int new_log_level) {
     log_level = new_log_level;
+    if (this == &global_logger()) logger_impl::log_level_cache = new_log_level;
   }
 
   /**
@@ -305,6 +436,8 @@ class file_logger{
 
   void _lograw(int loglevel, const char* buf, int len);
 
+  void _logfields(const logger_impl::fields_record& record);
+
   inline void stream_flush() {
     // get the stream buffer
     logger_impl::streambuff_tls_entry* streambufentry = reinterpret_cast<logger_impl::streambuff_tls_entry*>(
@@ -331,10 +464,26 @@ class file_logger{
   bool log_to_console;
   int log_level;
 
-};
-
+  // asynchronous mode
+  volatile bool async_enabled;
+  volatile bool flusher_stop;
+  pthread_t flusher;
+  pthread_key_t ringkey;
+  /// protects rings and the flusher state
+  pthread_mutex_t ring_mut;
+  pthread_cond_t ring_cond;
+  /// held while the rings are drained, so there is one reader at a time
+  pthread_mutex_t drain_mut;
+  /// all thread buffers, linked through log_ring::next
+  logger_impl::log_ring* rings;
+
+  void write_raw(int loglevel, const char* buf, int len);
+  bool async_push(int kind, int loglevel, const void* buf, size_t len);
+  logger_impl::log_ring* thread_ring();
+  void drain();
+  static void* flusher_main(void* logger);
 
-file_logger& global_logger();
+};
 
 /**
 Wrapper to generate 0 code if the output level is lower than the log level
@@ -372,6 +521,86 @@ struct null_stream {
 };
 
 
+struct null_fields {
+  template<typename T>
+  inline null_fields operator()(const char* name, T t) { return null_fields(); }
+};
+
+
+/**
+  Collects the fields of a logfields() message, which is logged when
+  the object is destroyed at the end of the statement.
+*/
+class log_fields {
+ public:
+  log_fields(int loglevel, const char* file, const char* function,
+             int line, const char* message) {
+    record.level = loglevel;
+    record.file = file;
+    record.function = function;
+    record.line = line;
+    record.message = message;
+    record.nfields = 0;
+  }
+
+  ~log_fields() {
+    global_logger()._logfields(record);
+    if(record.level == LOG_FATAL) {
+      __print_back_trace();
+      GRAPHLAB_LOGGER_FAIL_METHOD("LOG_FATAL encountered");
+    }
+  }
+
+  log_fields& operator()(const char* name, int v) { return integer(name, v); }
+  log_fields& operator()(const char* name, long v) { return integer(name, v); }
+  log_fields& operator()(const char* name, long long v) {
+    return integer(name, v);
+  }
+  log_fields& operator()(const char* name, unsigned int v) {
+    return unsigned_integer(name, v);
+  }
+  log_fields& operator()(const char* name, unsigned long v) {
+    return unsigned_integer(name, v);
+  }
+  log_fields& operator()(const char* name, unsigned long long v) {
+    return unsigned_integer(name, v);
+  }
+  log_fields& operator()(const char* name, double v) {
+    logger_impl::log_field* f = next(name, logger_impl::log_field::REAL);
+    if (f != NULL) f->value.d = v;
+    return *this;
+  }
+  log_fields& operator()(const char* name, const char* v) {
+    logger_impl::log_field* f = next(name, logger_impl::log_field::STRING);
+    if (f != NULL) f->value.s = v;
+    return *this;
+  }
+
+ private:
+  logger_impl::fields_record record;
+
+  /// Returns the next free field, or NULL if all are used
+  logger_impl::log_field* next(const char* name,
+                               logger_impl::log_field::field_type type) {
+    if (record.nfields == logger_impl::fields_record::MAX_FIELDS) return NULL;
+    logger_impl::log_field* f = &(record.fields[record.nfields++]);
+    f->name = name;
+    f->type = type;
+    return f;
+  }
+  log_fields& integer(const char* name, long long v) {
+    logger_impl::log_field* f = next(name, logger_impl::log_field::INTEGER);
+    if (f != NULL) f->value.i = v;
+    return *this;
+  }
+  log_fields& unsigned_integer(const char* name, unsigned long long v) {
+    logger_impl::log_field* f = next(name, logger_impl::log_field::UNSIGNED);
+    if (f != NULL) f->value.u = v;
+    return *this;
+  }
+};
+
+
 template <bool dostuff>
 struct log_stream_dispatch {};
 
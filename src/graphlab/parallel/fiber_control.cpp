@@ -26,6 +26,7 @@
 #include <graphlab/parallel/fiber_control.hpp>
 #include <graphlab/logger/assertions.hpp>
 #include <graphlab/rpc/dc.hpp>
+#include <graphlab/util/memory_info.hpp>
 #include <graphlab/macros_def.hpp>
 //#include <valgrind/valgrind.h>
 namespace graphlab {
@@ -273,6 +274,8 @@ size_t fiber_control::launch(boost::function<void(void)> fn,
   fiber* fib = new fiber;
   fib->parent = this;
   fib->stack = malloc(stacksize);
+  fib->stacksize = stacksize;
+  memory_info::add_tagged_bytes(memory_info::FIBER_STACKS, stacksize);
   fib->id = fiber_id_counter.inc();
   foreach(size_t b, affinity) {
     if (b < nworkers) fib->affinity_array.push_back((unsigned char)b);
@@ -405,6 +408,7 @@ void fiber_control::reschedule_fiber(size_t workerid, fiber* fib) {
     fib->lock.unlock();
     // previous fiber is dead. destroy it
     free(fib->stack);
+    memory_info::sub_tagged_bytes(memory_info::FIBER_STACKS, fib->stacksize);
     //VALGRIND_STACK_DEREGISTER(fib->stack);
     // delete the fiber local storage if any
     if (fib->fls && flsdeleter) flsdeleter(fib->fls);
@@ -49,6 +49,7 @@ class fiber_control {
     fiber_control* parent;
     boost::context::fcontext_t* context;
     void* stack;
+    size_t stacksize;
     size_t id;
     affinity_type affinity;
     std::vector<unsigned char> affinity_array;
@@ -29,6 +29,7 @@
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/rpc/dc_dist_object.hpp>
 #include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/util/memory_info.hpp>
 
 
 #include <graphlab/macros_def.hpp>
@@ -137,6 +138,11 @@ namespace graphlab {
       for (size_t i = 0;i < send_buffers.size(); ++i) {
         rpc.split_call_cancel(send_buffers[i].oarc);
       }
+      // release the accounting of values which were never received
+      foreach(const buffer_record& rec, recv_buffers) {
+        memory_info::sub_tagged_bytes(memory_info::EXCHANGE_BUFFERS,
+                                      rec.buffer.size() * sizeof(T));
+      }
     }
     // buffered_exchange(distributed_control& dc, handler_type recv_handler,
     //                   size_t buffer_size = 1000) :
@@ -147,6 +153,13 @@ namespace graphlab {
     /**
      * Sends a value to a target machine.
      * Use the send buffer owned by thread_id.
+     * While the memory budget is exceeded, smaller buffers are sent and
+     * flushed at once. A sender running in a fiber then yields to the
+     * other fibers of its worker, which may drain the received values.
+     * Any other thread, such as an OpenMP ingress thread, only gives up
+     * its CPU to the communication threads. send() never waits for the
+     * memory to be released: the received values of an ingress are only
+     * drained by finalize(), so waiting could deadlock.
      */
     void send(const procid_t proc, const T& value, const size_t thread_id = 0) {
       ASSERT_LT(proc, rpc.numprocs());
@@ -158,11 +171,20 @@ namespace graphlab {
       (*(send_buffers[index].oarc)) << value;
       ++send_buffers[index].numinserts;
 
-      if(send_buffers[index].oarc->off >= max_buffer_size) {
+      const bool over_budget = memory_info::over_budget();
+      const size_t buffer_limit = over_budget ?
+          std::min<size_t>(max_buffer_size, OVER_BUDGET_BUFFERED_EXCHANGE_SIZE) :
+          max_buffer_size;
+      if(send_buffers[index].oarc->off >= buffer_limit) {
         oarchive* prevarc = swap_buffer(index);
         send_locks[index].unlock();
         // complete the send
         rpc.split_call_end(proc, prevarc);
+        if (over_budget) {
+          rpc.dc().flush_soon(proc);
+          if (fiber_control::in_fiber()) fiber_control::yield();
+          else sched_yield();
+        }
       } else {
         send_locks[index].unlock();
       }
@@ -243,6 +265,8 @@ namespace graphlab {
           ret_buffer.swap(rec.buffer);
           ASSERT_LT(ret_proc, rpc.numprocs());
           recv_buffers.pop_front();
+          memory_info::sub_tagged_bytes(memory_info::EXCHANGE_BUFFERS,
+                                        ret_buffer.size() * sizeof(T));
         }
         recv_lock.unlock();
       }
@@ -293,6 +317,8 @@ namespace graphlab {
         iarc >> tmp[i];
       }
 
+      memory_info::add_tagged_bytes(memory_info::EXCHANGE_BUFFERS,
+                                    numel * sizeof(T));
       recv_lock.lock();
       recv_buffers.push_back(buffer_record());
       buffer_record& rec = recv_buffers.back();
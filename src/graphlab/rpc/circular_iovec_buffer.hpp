@@ -25,6 +25,7 @@
 #define GRAPHLAB_RPC_CIRCULAR_IOVEC_BUFFER_HPP
 #include <vector>
 #include <sys/socket.h>
+#include <graphlab/util/memory_info.hpp>
 
 namespace graphlab{
 namespace dc_impl {
@@ -83,6 +84,7 @@ struct circular_iovec_buffer {
       v[tail] = other[i];
       parallel_v[tail] = other[i];
       tail = (tail + 1) & (v.size() - 1);
+      memory_info::add_tagged_bytes(memory_info::RPC_BUFFERS, other[i].iov_len);
     }
     numel += nwrite;
 
@@ -100,6 +102,7 @@ struct circular_iovec_buffer {
     v[tail] = entry;
     parallel_v[tail] = entry;
     tail = (tail + 1) & (v.size() - 1); ++numel;
+    memory_info::add_tagged_bytes(memory_info::RPC_BUFFERS, entry.iov_len);
   }
 
 
@@ -118,6 +121,8 @@ struct circular_iovec_buffer {
     v[tail] = actual_ptr_entry;
     parallel_v[tail] = entry;
     tail = (tail + 1) & (v.size() - 1); ++numel;
+    memory_info::add_tagged_bytes(memory_info::RPC_BUFFERS,
+                                  actual_ptr_entry.iov_len);
   }
 
 
@@ -126,6 +131,7 @@ struct circular_iovec_buffer {
    */
   inline void erase_from_head_and_free() {
     free(v[head].iov_base);
+    memory_info::sub_tagged_bytes(memory_info::RPC_BUFFERS, v[head].iov_len);
     head = (head + 1) & (v.size() - 1);
     --numel;
   }
@@ -39,6 +39,7 @@
 #include <graphlab/util/stl_util.hpp>
 #include <graphlab/util/net_util.hpp>
 #include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/util/memory_info.hpp>
 
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/rpc/dc_tcp_comm.hpp>
@@ -158,6 +159,11 @@ distributed_control::distributed_control(dc_init_param initparam) {
 }
 
 
+/// The bytes of a memory tag in KB, for the memory events
+static double tagged_kilobytes(memory_info::memory_tag tag) {
+  return double(memory_info::tagged_bytes(tag)) / 1024;
+}
+
 distributed_control::~distributed_control() {
   // detach the instance
   last_dc = NULL;
@@ -166,6 +172,12 @@ distributed_control::~distributed_control() {
   logstream(LOG_INFO) << "Shutting down distributed control " << std::endl;
   FREE_CALLBACK_EVENT(EVENT_NETWORK_BYTES);
   FREE_CALLBACK_EVENT(EVENT_RPC_CALLS);
+  for (size_t i = 0; i < EVENT_PEER_BYTES.size(); ++i) {
+    FREE_CALLBACK_EVENT(EVENT_PEER_BYTES[i]);
+  }
+  for (size_t i = 0; i < EVENT_TAGGED_MEMORY.size(); ++i) {
+    FREE_CALLBACK_EVENT(EVENT_TAGGED_MEMORY[i]);
+  }
   // call all deletion callbacks
   for (size_t i = 0; i < deletion_callbacks.size(); ++i) {
     deletion_callbacks[i]();
@@ -615,6 +627,21 @@ void distributed_control::init(const std::vector<std::string> &machines,
       "MB", boost::bind(&distributed_control::network_megabytes_sent, this));
   ADD_CUMULATIVE_CALLBACK_EVENT(EVENT_RPC_CALLS, "RPC Calls",
       "Calls", boost::bind(&distributed_control::calls_sent, this));
+  // the per machine traffic. Capped since every machine costs a log entry
+  const procid_t MAX_PEER_EVENTS = 32;
+  EVENT_PEER_BYTES.resize(std::min(numprocs(), MAX_PEER_EVENTS));
+  for (procid_t i = 0; i < EVENT_PEER_BYTES.size(); ++i) {
+    ADD_GROUPED_CUMULATIVE_CALLBACK_EVENT(EVENT_PEER_BYTES[i],
+        "Bytes Sent Per Machine", "Sent To Machine " + tostr(i),
+        "MB", boost::bind(&distributed_control::megabytes_sent_to, this, i));
+  }
+  EVENT_TAGGED_MEMORY.resize(memory_info::NUM_MEMORY_TAGS);
+  for (size_t i = 0; i < EVENT_TAGGED_MEMORY.size(); ++i) {
+    memory_info::memory_tag tag = memory_info::memory_tag(i);
+    ADD_GROUPED_INSTANTANEOUS_CALLBACK_EVENT(EVENT_TAGGED_MEMORY[i],
+        "Memory Per Subsystem", memory_info::tag_name(tag),
+        "KB", boost::bind(&tagged_kilobytes, tag));
+  }
 }
 
 
@@ -290,6 +290,10 @@ class distributed_control{
 
   DECLARE_EVENT(EVENT_NETWORK_BYTES);
   DECLARE_EVENT(EVENT_RPC_CALLS);
+  /// One "bytes sent to" event for each of the first MAX_PEER_EVENTS machines
+  std::vector<size_t> EVENT_PEER_BYTES;
+  /// One event for each memory_info::memory_tag
+  std::vector<size_t> EVENT_TAGGED_MEMORY;
  public:
 
   /**
@@ -915,6 +919,13 @@ class distributed_control{
     return ret;
   }
 
+  /** \brief Returns the number of megabytes sent to a machine excluding
+   * headers and other control overhead. Also see bytes_sent()
+   */
+  inline double megabytes_sent_to(procid_t target) const {
+    return double(senders[target]->bytes_sent()) / (1024 * 1024);
+  }
+
   /** \brief Returns the total number of bytes sent including all headers
    * and other control overhead. Also see bytes_sent()
    */
@@ -145,5 +145,13 @@
  */
 #define DEFAULT_BUFFERED_EXCHANGE_SIZE FULL_BUFFER_SIZE_LIMIT
 
+/**
+ * \ingroup RPC
+ * \def OVER_BUDGET_BUFFERED_EXCHANGE_SIZE
+ * maximum size of each buffer in the buffer exchange while the memory
+ * budget is exceeded (see memory_info::over_budget()).
+ */
+#define OVER_BUDGET_BUFFERED_EXCHANGE_SIZE (DEFAULT_BUFFERED_EXCHANGE_SIZE / 16)
+
 
 #endif
@@ -24,6 +24,7 @@
 
 #include <pthread.h>
 #include <string>
+#include <map>
 #include <limits>
 #include <cfloat>
 #include <graphlab/rpc/dc.hpp>
@@ -34,7 +35,6 @@
 #include <graphlab/util/dense_bitset.hpp>
 #include <graphlab/ui/metrics_server.hpp>
 #include <graphlab/macros_def.hpp>
-#define DISABLE_DISTRIBUTED_EVENT_LOG
 namespace graphlab {
 
 
@@ -48,6 +48,9 @@ metric_aggregate_json(std::map<std::string, std::string>& vars);
 static std::pair<std::string, std::string> 
 metric_by_machine_json(std::map<std::string, std::string>& vars);
 
+static std::pair<std::string, std::string> 
+metric_dashboard_html(std::map<std::string, std::string>& vars);
+
 
 static size_t time_to_index(double t) {
   return std::floor(t / 5);
@@ -57,6 +60,27 @@ static double index_to_time(size_t t) {
   return 5 * t;
 }
 
+/*
+ * The latest value of a log: the rate over the last record for
+ * a cumulative log, and the last value for an instantaneous log.
+ * The log lock must be held.
+ */
+static double latest_rate(const log_group* group) {
+  size_t len = group->aggregate.size();
+  if (len == 0) return 0;
+  double logtime = index_to_time(len - 1);
+  double logval = group->aggregate[len - 1].value;
+  if (group->logtype != log_type::CUMULATIVE) return logval;
+  double prevtime = 0;
+  double prevval = 0;
+  if (len >= 2) {
+    prevtime = index_to_time(len - 2);
+    prevval = group->aggregate[len - 2].value;
+  }
+  if (logtime <= prevtime) return 0;
+  return (logval - prevval) / (logtime - prevtime);
+}
+
 
 size_t distributed_event_logger::allocate_log_entry(log_group* group) {
   log_entry_lock.lock();
@@ -72,6 +96,33 @@ size_t distributed_event_logger::allocate_log_entry(log_group* group) {
   return id;
 }
 
+size_t distributed_event_logger::allocate_log_range(
+    const std::vector<log_group*>& groups) {
+  log_entry_lock.lock();
+  size_t id = 0;
+  size_t len = 0;
+  // find the first run of groups.size() free entries
+  while (len < groups.size() && id + len < MAX_LOG_SIZE) {
+    if (has_log_entry.get(id + len)) {
+      id = id + len + 1;
+      len = 0;
+    } else {
+      ++len;
+    }
+  }
+  if (len < groups.size()) {
+    logger(LOG_FATAL, "More than 256 Log entries created. "
+        "New log entries cannot be created");
+    // does not return
+  }
+  for (size_t i = 0; i < groups.size(); ++i) {
+    logs[id + i] = groups[i];
+    has_log_entry.set_bit(id + i);
+  }
+  log_entry_lock.unlock();
+  return id;
+}
+
 event_log_thread_local_type* distributed_event_logger::get_thread_counter_ref() {
   void* v = pthread_getspecific(key);
   if (v == NULL) {
@@ -142,9 +193,7 @@ void distributed_event_logger::collect_instantaneous_log() {
       }
       else {
         // sum it across all the threads
-        foreach(size_t thr, thread_local_count_slots) {
-          logs[log]->sum_of_instantaneous_entries += thread_local_count[thr]->values[log];
-        }
+        logs[log]->sum_of_instantaneous_entries += sum_thread_counts(log);
         ++logs[log]->count_of_instantaneous_entries;
       }
       logs[log]->lock.unlock();
@@ -170,10 +219,7 @@ void distributed_event_logger::local_collect_log(size_t record_ctr) {
       if (logs[log]->is_callback_entry) {
         combined_counts[log] = logs[log]->callback();
       } else {
-        foreach(size_t thr, thread_local_count_slots) {
-          size_t* current_thread_counts = thread_local_count[thr]->values;
-          combined_counts[log] += current_thread_counts[log];
-        }
+        combined_counts[log] = sum_thread_counts(log);
       }
     }
     else {
@@ -251,15 +297,15 @@ void distributed_event_logger::periodic_timer() {
   periodic_timer_lock.lock();
   timer ti; ti.start();
   int tick_ctr = 0;
-  int record_ctr = 0;
 
   int ticks_per_record = RECORD_FREQUENCY / TICK_FREQUENCY;
 
   while (!periodic_timer_stop){ 
     collect_instantaneous_log();
     if (tick_ctr % ticks_per_record == 0) {
-      local_collect_log(record_ctr);
-      ++record_ctr;
+      // records are indexed by the time since set_dc() so that the records
+      // of machines which started sampling at different times line up
+      local_collect_log(time_to_index(get_current_time()));
       if (rmi->procid() == 0)  build_aggregate_log();
     }
     // when is the next tick
@@ -279,16 +325,16 @@ distributed_event_logger::distributed_event_logger():rmi(NULL) {
   has_log_entry.clear();
   thread_local_count_slots.clear();
   periodic_timer_stop = false;
+  sampling = false;
 }
 
 void distributed_event_logger::destroy_event_logger() {
   // kill the tick thread
   bool thread_was_started = false;
   periodic_timer_lock.lock();
-  // if periodic_timer_stop is false, then
-  // thread was started. signal it and wait for it later to 
+  // if the thread was started, signal it and wait for it later to
   // join
-  if (periodic_timer_stop == false) {
+  if (sampling && periodic_timer_stop == false) {
     periodic_timer_stop = true;
     thread_was_started = true;
     periodic_timer_cond.signal();
@@ -330,21 +376,54 @@ void distributed_event_logger::set_dc(distributed_control& dc) {
       timer::sleep_ms(200);
     }
     periodic_timer_stop = false;
-    // spawn a thread for the tick
-#ifndef DISABLE_DISTRIBUTED_EVENT_LOG
-    tick_thread.launch(boost::bind(&distributed_event_logger::periodic_timer,
-          this));
-#endif
     // register the metric server callbacks
     add_metric_server_callback("names.json", metric_names_json);
     add_metric_server_callback("metrics_aggregate.json", metric_aggregate_json);
     add_metric_server_callback("metrics_by_machine.json", metric_by_machine_json);
+    add_metric_server_callback("dashboard.html", metric_dashboard_html);
   }
 }
+
+void distributed_event_logger::start_sampling() {
+  if (rmi == NULL) return;
+  periodic_timer_lock.lock();
+  bool launch = (sampling == false && periodic_timer_stop == false);
+  sampling = true;
+  periodic_timer_lock.unlock();
+  // spawn a thread for the tick
+  if (launch) {
+    tick_thread.launch(boost::bind(&distributed_event_logger::periodic_timer,
+          this));
+  }
+}
+
+log_group* distributed_event_logger::new_log_group(std::string name,
+                                                  std::string units,
+                                                  std::string group,
+                                                  log_type::log_type_enum logtype) {
+  log_group* ret = new log_group;
+  ret->logtype = logtype;
+  ret->name = name;
+  ret->units = units;
+  ret->group = group;
+  ret->callback = NULL;
+  ret->is_callback_entry = false;
+  ret->earliest_modified_log = 1;
+  ret->machine_log_modified = false;
+  ret->sum_of_instantaneous_entries = 0.0;
+  ret->count_of_instantaneous_entries = 0;
+  // only allocate the machine vector on the root machine.
+  // no one else needs it 
+  if (rmi->procid() == 0) {
+    ret->machine.resize(rmi->numprocs());
+  } 
+  return ret;
+}
     
 size_t distributed_event_logger::create_log_entry(std::string name, 
                                             std::string units,
-                                            log_type::log_type_enum logtype) {
+                                            log_type::log_type_enum logtype,
+                                            std::string group) {
   // look for an entry with the same name
   bool has_existing = false;
   size_t existingid = 0;
@@ -361,23 +440,8 @@ size_t distributed_event_logger::create_log_entry(std::string name,
   log_entry_lock.unlock();
   if (has_existing) return existingid;
 
-  log_group* group = new log_group;
-  group->logtype = logtype;
-  group->name = name;
-  group->units = units;
-  group->callback = NULL;
-  group->is_callback_entry = false;
-  group->earliest_modified_log = 1;
-  group->machine_log_modified = false;
-  group->sum_of_instantaneous_entries = 0.0;
-  group->count_of_instantaneous_entries = 0;
-  // only allocate the machine vector on the root machine.
-  // no one else needs it 
-  if (rmi->procid() == 0) {
-    group->machine.resize(rmi->numprocs());
-  } 
   // ok. get an ID
-  size_t id = allocate_log_entry(group);
+  size_t id = allocate_log_entry(new_log_group(name, units, group, logtype));
   // enforce that all machines are running this at the same time 
   rmi->barrier();
   return id;
@@ -386,7 +450,8 @@ size_t distributed_event_logger::create_log_entry(std::string name,
 size_t distributed_event_logger::create_callback_entry(std::string name, 
               std::string units,
               boost::function<double(void)> callback,
-              log_type::log_type_enum logtype) {
+              log_type::log_type_enum logtype,
+              std::string group) {
   bool has_existing = false;
   size_t existingid = 0;
   log_entry_lock.lock();
@@ -413,24 +478,51 @@ size_t distributed_event_logger::create_callback_entry(std::string name,
     return existingid;
   }
 
-  log_group* group = new log_group;
-  group->logtype = logtype;
-  group->name = name;
-  group->units = units;
-  group->earliest_modified_log = 0;
-  group->machine_log_modified = false;
-  group->callback = callback;
-  group->is_callback_entry = true;
-  group->sum_of_instantaneous_entries = 0.0;
-  group->count_of_instantaneous_entries = 0;
-
-  // only allocate the machine vector on the root machine.
-  // no one else needs it 
-  if (rmi->procid() == 0) {
-    group->machine.resize(rmi->numprocs());
-  } 
+  log_group* newgroup = new_log_group(name, units, group, logtype);
+  newgroup->earliest_modified_log = 0;
+  newgroup->callback = callback;
+  newgroup->is_callback_entry = true;
   // ok. get an ID
-  size_t id = allocate_log_entry(group);
+  size_t id = allocate_log_entry(newgroup);
+  // enforce that all machines are running this at the same time 
+  rmi->barrier();
+  return id;
+}
+
+size_t distributed_event_logger::create_histogram_entry(std::string name,
+                                                       std::string units) {
+  std::vector<std::string> bucket_names(HISTOGRAM_BUCKETS);
+  for (size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+    std::stringstream strm;
+    strm << name << " ";
+    if (b == 0) strm << "0";
+    else if (b == HISTOGRAM_BUCKETS - 1) strm << ">= " << (size_t(1) << (b - 1));
+    else strm << (size_t(1) << (b - 1)) << "-" << (size_t(1) << b) - 1;
+    strm << " " << units;
+    bucket_names[b] = strm.str();
+  }
+  // look for an existing histogram with the same name
+  bool has_existing = false;
+  size_t existingid = 0;
+  log_entry_lock.lock();
+  foreach(size_t log, has_log_entry) {
+    if (logs[log]->name == bucket_names[0]) {
+      ASSERT_MSG(logs[log]->group == name,
+                 "Cannot convert log %s to a histogram", name.c_str());
+      has_existing = true;
+      existingid = log;
+      break;
+    }
+  }
+  log_entry_lock.unlock();
+  if (has_existing) return existingid;
+
+  std::vector<log_group*> groups(HISTOGRAM_BUCKETS);
+  for (size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+    groups[b] = new_log_group(bucket_names[b], "Samples", name,
+                              log_type::CUMULATIVE);
+  }
+  size_t id = allocate_log_range(groups);
   // enforce that all machines are running this at the same time 
   rmi->barrier();
   return id;
@@ -453,6 +545,15 @@ void distributed_event_logger::thr_dec_log_entry(size_t entry, size_t value) {
 }
 
 
+double distributed_event_logger::sum_thread_counts(size_t entry) {
+  ASSERT_LT(entry, MAX_LOG_SIZE);
+  size_t total = 0;
+  foreach(size_t thr, thread_local_count_slots) {
+    total += thread_local_count[thr]->values[entry];
+  }
+  return (double)(ssize_t)total;
+}
+
 void distributed_event_logger::free_callback_entry(size_t entry) {
   ASSERT_LT(entry, MAX_LOG_SIZE);
   // does not work for cumulative logs
@@ -497,28 +598,12 @@ static metric_names_json(std::map<std::string, std::string>& vars) {
   foreach(size_t log, has_log_entry) {
 
     logs[log]->lock.lock();
-    double rate_val = 0;
-    size_t len = logs[log]->aggregate.size();
-    if (len >= 1) { 
-      double logtime = index_to_time(logs[log]->aggregate.size() - 1);
-      double logval = logs[log]->aggregate.rbegin()->value;
-      double prevtime = 0;
-      double prevval = 0;
-      if (logs[log]->aggregate.size() >= 2) {
-        prevtime = index_to_time(logs[log]->aggregate.size() - 2);
-        prevval = logs[log]->aggregate[len - 2].value;
-      }
-      if (logs[log]->logtype == log_type::CUMULATIVE) {
-        rate_val = (logval - prevval) / (logtime - prevtime);
-      }
-      else {
-        rate_val = logval;
-      }
-    }
+    double rate_val = latest_rate(logs[log]);
 
     strm << "    {\n"
          << "      \"id\":" << log << ",\n"
          << "      \"name\": \"" << logs[log]->name << "\",\n"
+         << "      \"group\": \"" << logs[log]->group << "\",\n"
          << "      \"units\": \"" << logs[log]->units << "\",\n"
          << "      \"cumulative\": " << (int)(logs[log]->logtype) << ",\n"
          << "      \"rate_val\": " << rate_val << ",\n"
@@ -794,5 +879,89 @@ static metric_by_machine_json(std::map<std::string, std::string>& vars) {
 
 
 
+/*
+   Used to process the dashboard.html request. A page which reloads
+   itself every record, listing the latest value of every log, with the
+   logs of a group (such as the buckets of a histogram) drawn as bars.
+*/
+std::pair<std::string, std::string> 
+static metric_dashboard_html(std::map<std::string, std::string>& vars) {
+  distributed_event_logger& evlog = get_event_log();
+  log_group** logs = evlog.get_logs_ptr();
+  fixed_dense_bitset<MAX_LOG_SIZE>& has_log_entry = evlog.get_logs_bitset();
+
+  std::stringstream strm;
+  strm << "<html>\n<head>\n"
+       << "<meta http-equiv=\"refresh\" content=\"" << RECORD_FREQUENCY
+       << "\">\n<title>GraphLab Dashboard</title>\n</head>\n<body>\n"
+       << "<h3>Time: " << evlog.get_current_time() << " s</h3>\n";
+  if (!evlog.is_sampling()) {
+    strm << "<p>Sampling is off. Call launch_metric_server() on all "
+         << "machines to start it.</p>\n";
+  }
+
+  strm << "<table border=\"1\" cellpadding=\"3\">\n"
+       << "<tr><th>Metric</th><th>Units</th>"
+       << "<th>Rate or Value</th><th>Total</th></tr>\n";
+  // groups in the order of their first log
+  std::vector<std::string> group_order;
+  std::map<std::string, std::vector<size_t> > group_logs;
+  foreach(size_t log, has_log_entry) {
+    logs[log]->lock.lock();
+    if (logs[log]->group.empty()) {
+      double total = logs[log]->aggregate.size() > 0 ?
+                        logs[log]->aggregate.rbegin()->value : 0;
+      strm << "<tr><td>" << logs[log]->name << "</td><td>"
+           << logs[log]->units;
+      if (logs[log]->logtype == log_type::CUMULATIVE) strm << "/s";
+      strm << "</td><td>" << latest_rate(logs[log]) << "</td><td>";
+      if (logs[log]->logtype == log_type::CUMULATIVE) strm << total;
+      strm << "</td></tr>\n";
+    } else {
+      if (group_logs.count(logs[log]->group) == 0) {
+        group_order.push_back(logs[log]->group);
+      }
+      group_logs[logs[log]->group].push_back(log);
+    }
+    logs[log]->lock.unlock();
+  }
+  strm << "</table>\n";
+
+  const size_t BAR_WIDTH = 300;
+  foreach(const std::string& group, group_order) {
+    const std::vector<size_t>& members = group_logs[group];
+    std::vector<double> rates(members.size());
+    std::vector<double> totals(members.size(), 0);
+    double maxrate = 0;
+    for (size_t i = 0; i < members.size(); ++i) {
+      log_group* entry = logs[members[i]];
+      entry->lock.lock();
+      rates[i] = latest_rate(entry);
+      if (entry->aggregate.size() > 0) totals[i] = entry->aggregate.rbegin()->value;
+      entry->lock.unlock();
+      maxrate = std::max(maxrate, rates[i]);
+    }
+    strm << "<h4>" << group << "</h4>\n"
+         << "<table cellpadding=\"2\">\n";
+    for (size_t i = 0; i < members.size(); ++i) {
+      log_group* entry = logs[members[i]];
+      size_t width = maxrate > 0 ? size_t(BAR_WIDTH * rates[i] / maxrate) : 0;
+      strm << "<tr><td>" << entry->name << "</td><td>"
+           << "<div style=\"background:#4682b4;height:12px;width:"
+           << width << "px\"></div></td><td>" << rates[i] << " "
+           << entry->units;
+      if (entry->logtype == log_type::CUMULATIVE) {
+        strm << "/s</td><td>" << totals[i];
+      } else {
+        strm << "</td><td>";
+      }
+      strm << "</td></tr>\n";
+    }
+    strm << "</table>\n";
+  }
+  strm << "</body>\n</html>\n";
+  return std::make_pair(std::string("text/html"), strm.str());
+}
+
 
 } // namespace graphlab
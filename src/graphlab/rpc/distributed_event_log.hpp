@@ -48,6 +48,8 @@ const size_t MAX_LOG_SIZE = 256;
 const size_t MAX_LOG_THREADS = 1024;
 const double TICK_FREQUENCY = 0.5;
 const double RECORD_FREQUENCY = 5.0;
+/// Number of log entries used by a histogram. See create_histogram_entry()
+const size_t HISTOGRAM_BUCKETS = 16;
 
 
 
@@ -75,6 +77,12 @@ struct log_group{
   /// name of the group
   std::string name;
 
+  /** Name of the set of entries this entry is displayed with.
+   * Empty if the entry stands alone. The buckets of a histogram
+   * share the name of the histogram.
+   */
+  std::string group;
+
   /// unit of measurement
   std::string units;
 
@@ -144,6 +152,10 @@ class distributed_event_logger {
     thread tick_thread;
 
     size_t allocate_log_entry(log_group* group);
+    /**
+     * Allocates consecutive ids for all the groups, returning the first.
+     */
+    size_t allocate_log_range(const std::vector<log_group*>& groups);
     /**
       * Returns a pointer to the current thread log counter
       * creating one if one does not already exist.
@@ -169,6 +181,12 @@ class distributed_event_logger {
     mutex periodic_timer_lock;
     conditional periodic_timer_cond;
     bool periodic_timer_stop;
+    // true once the tick thread is launched by start_sampling()
+    volatile bool sampling;
+
+    log_group* new_log_group(std::string name, std::string units,
+                             std::string group,
+                             log_type::log_type_enum logtype);
 
     /** a new thread spawns here and sleeps for 5 seconds at a time
      *  when it wakes up it will insert log entries
@@ -188,6 +206,26 @@ class distributed_event_logger {
      * an effect.
      */
     void set_dc(distributed_control& dc);
+
+    /**
+     * Launches the thread which periodically samples the counters
+     * and sends them to machine 0. Sampling is off until this is
+     * called (launch_metric_server() calls it), so the counters cost
+     * only the thread local increments when nobody is looking.
+     * Should be called by all machines, though not necessarily at the
+     * same time. Later calls have no effect.
+     */
+    void start_sampling();
+
+    /**
+     * Returns true if the counters are being sampled. Measurements which
+     * cost more than an increment (such as reading the clock) should
+     * only be taken when this is true.
+     */
+    inline bool is_sampling() const {
+      return sampling;
+    }
+
     /**
      * Creates a new log entry with a given name and log type.
      * Returns the ID of the log. Must be called by 
@@ -195,7 +233,8 @@ class distributed_event_logger {
      * units is the unit of measurement.
      */
     size_t create_log_entry(std::string name, std::string units, 
-                            log_type::log_type_enum logtype);
+                            log_type::log_type_enum logtype,
+                            std::string group = std::string());
 
     /**
      * Creates a new callback log entry with a given name and log type.
@@ -209,10 +248,33 @@ class distributed_event_logger {
     size_t create_callback_entry(std::string name, 
                                  std::string units,
                                  boost::function<double(void)> callback,
-                                 log_type::log_type_enum logtype);
+                                 log_type::log_type_enum logtype,
+                                 std::string group = std::string());
 
     void free_callback_entry(size_t entry);
 
+    /**
+     * Creates a histogram of HISTOGRAM_BUCKETS cumulative log entries
+     * with consecutive IDs, and returns the ID of the first one.
+     * Bucket 0 counts the samples with value 0, bucket b counts the
+     * values in [2^(b-1), 2^b), and the last bucket also counts all
+     * larger values. Must be called by all machines simultaneously
+     * with the same settings. units is the unit of the sampled values.
+     */
+    size_t create_histogram_entry(std::string name, std::string units);
+
+    /**
+     * Adds a sample to a histogram created by create_histogram_entry()
+     */
+    inline void thr_add_histogram_sample(size_t entry, size_t value) {
+      size_t bucket = 0;
+      while (value > 0 && bucket < HISTOGRAM_BUCKETS - 1) {
+        ++bucket;
+        value >>= 1;
+      }
+      get_thread_counter_ref()->values[entry + bucket] += 1;
+    }
+
     /**
      * Increments the value of a log entry
      */
@@ -223,6 +285,14 @@ class distributed_event_logger {
      */
     void thr_dec_log_entry(size_t entry, size_t value);
 
+    /**
+     * Returns the current value of a log entry on this machine, summed
+     * over the counters of all threads. A thread which decrements what
+     * another thread incremented wraps its own counter, so the counters
+     * are added as size_t and the total is read as signed.
+     */
+    double sum_thread_counts(size_t entry);
+
 
     /// \cond GRAPHLAB_INTERNAL
     inline double get_current_time() const {
@@ -266,10 +336,27 @@ extern distributed_event_logger& get_event_log();
 
 
 
+#define ADD_GROUPED_CUMULATIVE_EVENT(name, group, desc, units) \
+    name = graphlab::get_event_log().create_log_entry(desc, units, \
+           graphlab::log_type::CUMULATIVE, group);
+
+#define ADD_GROUPED_INSTANTANEOUS_CALLBACK_EVENT(name, group, desc, units, callback) \
+    name = graphlab::get_event_log().create_callback_entry(desc, units, callback, \
+           graphlab::log_type::INSTANTANEOUS, group);
+
+#define ADD_GROUPED_CUMULATIVE_CALLBACK_EVENT(name, group, desc, units, callback) \
+    name = graphlab::get_event_log().create_callback_entry(desc, units, callback, \
+           graphlab::log_type::CUMULATIVE, group);
+
+#define ADD_HISTOGRAM_EVENT(name, desc, units) \
+    name = graphlab::get_event_log().create_histogram_entry(desc, units);
+
 #define FREE_CALLBACK_EVENT(name) \
   graphlab::get_event_log().free_callback_entry(name);
 
 #define INCREMENT_EVENT(name, count) graphlab::get_event_log().thr_inc_log_entry(name, count);
 #define DECREMENT_EVENT(name, count) graphlab::get_event_log().thr_dec_log_entry(name, count);
+#define HISTOGRAM_EVENT(name, value) graphlab::get_event_log().thr_add_histogram_sample(name, value);
+#define EVENT_LOG_SAMPLING() graphlab::get_event_log().is_sampling()
 
 #endif
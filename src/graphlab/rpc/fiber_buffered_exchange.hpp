@@ -29,6 +29,7 @@
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/rpc/dc_dist_object.hpp>
 #include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/util/memory_info.hpp>
 
 
 #include <graphlab/macros_def.hpp>
@@ -162,6 +163,10 @@ namespace graphlab {
           if (send_buffers[i][j].oarc) rpc.split_call_cancel(send_buffers[i][j].oarc);
         }
       }
+      // release the accounting of values which were never received
+      for (size_t i = 0;i < recv_buffers.size(); ++i) {
+        release_bytes(recv_buffers[i]);
+      }
     }
     // fiber_buffered_exchange(distributed_control& dc, handler_type recv_handler,
     //                   size_t buffer_size = 1000) :
@@ -186,7 +191,16 @@ namespace graphlab {
       ++send_buffers[wid][proc].numinserts;
 
 
-      if(send_buffers[wid][proc].oarc->off >= max_buffer_size) {
+      // while over the memory budget send smaller buffers, and yield to
+      // let the receiving fibers drain the received values
+      if (memory_info::over_budget()) {
+        if (send_buffers[wid][proc].oarc->off >=
+            std::min<size_t>(max_buffer_size, OVER_BUDGET_BUFFERED_EXCHANGE_SIZE)) {
+          flush_buffer(wid, proc);
+          rpc.dc().flush_soon(proc);
+          fiber_control::yield();
+        }
+      } else if(send_buffers[wid][proc].oarc->off >= max_buffer_size) {
         flush_buffer(wid, proc);
       }
     } // end of send
@@ -254,6 +268,7 @@ namespace graphlab {
           }
         }
       }
+      release_bytes(ret_buffer);
       return success;
     } // end of recv
 
@@ -303,6 +318,8 @@ namespace graphlab {
         iarc >> tmp[i];
       }
 
+      memory_info::add_tagged_bytes(memory_info::EXCHANGE_BUFFERS,
+                                    numel * sizeof(T));
       size_t wid = fiber_control::get_worker_id();
       lock.lock();
       recv_buffers[wid].push_back(buffer_record());
@@ -312,6 +329,13 @@ namespace graphlab {
       lock.unlock();
     } // end of rpc rcv
 
+    static void release_bytes(const std::vector<buffer_record>& records) {
+      size_t numel = 0;
+      for (size_t i = 0;i < records.size(); ++i) numel += records[i].buffer.size();
+      memory_info::sub_tagged_bytes(memory_info::EXCHANGE_BUFFERS,
+                                    numel * sizeof(T));
+    }
+
 
 
   }; // end of buffered exchange
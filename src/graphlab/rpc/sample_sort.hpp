@@ -21,15 +21,24 @@
  */
 
 
+
 #ifndef GRAPHLAB_RPC_SAMPLE_SORT_HPP
 #define GRAPHLAB_RPC_SAMPLE_SORT_HPP
 
 #include <vector>
 #include <algorithm>
 #include <utility>
+#include <omp.h>
+#include <boost/type_traits/is_integral.hpp>
+#include <boost/type_traits/is_signed.hpp>
+#include <boost/type_traits/is_same.hpp>
+#include <boost/type_traits/make_unsigned.hpp>
 #include <graphlab/rpc/dc_dist_object.hpp>
 #include <graphlab/rpc/buffered_exchange.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/util/timer.hpp>
 #include <graphlab/logger/assertions.hpp>
+#include <graphlab/logger/logger.hpp>
 namespace graphlab {
 
 namespace sample_sort_impl {
@@ -40,89 +49,250 @@ namespace sample_sort_impl {
       return k1.first < k2.first;
     }
   };
+
+  /**
+   * LSD radix sort of a vector of (key, value) pairs by an integral key,
+   * one byte per pass. The sort is stable. Passes in which every key has
+   * the same byte are skipped, so small key ranges only pay for the bytes
+   * which actually vary. Requires a scratch buffer of the same size.
+   */
+  template <typename Key, typename Value>
+  void radix_sort(std::vector<std::pair<Key, Value> >& data) {
+    typedef typename boost::make_unsigned<Key>::type unsigned_key;
+    const size_t nbytes = sizeof(Key);
+    const size_t n = data.size();
+    if (n < 2) return;
+    // flip the sign bit of signed keys so that they order as unsigned
+    const unsigned_key flip = boost::is_signed<Key>::value ?
+        unsigned_key(unsigned_key(1) << (8 * nbytes - 1)) : unsigned_key(0);
+    // compute the histogram of every byte in one pass
+    std::vector<size_t> counts(nbytes * 256, 0);
+    for (size_t i = 0; i < n; ++i) {
+      unsigned_key u = unsigned_key(data[i].first) ^ flip;
+      for (size_t b = 0; b < nbytes; ++b) {
+        ++counts[b * 256 + (u & 0xFF)];
+        u >>= 8;
+      }
+    }
+    std::vector<std::pair<Key, Value> > scratch;
+    std::vector<size_t> offsets(256);
+    for (size_t b = 0; b < nbytes; ++b) {
+      const size_t* count = &(counts[b * 256]);
+      // skip the pass if all keys share this byte
+      bool trivial = false;
+      for (size_t d = 0; d < 256; ++d) {
+        if (count[d] == n) { trivial = true; break; }
+        if (count[d] != 0) break;
+      }
+      if (trivial) continue;
+      size_t total = 0;
+      for (size_t d = 0; d < 256; ++d) {
+        offsets[d] = total;
+        total += count[d];
+      }
+      if (scratch.size() != n) scratch.resize(n);
+      const size_t shift = 8 * b;
+      for (size_t i = 0; i < n; ++i) {
+        const unsigned_key u = unsigned_key(data[i].first) ^ flip;
+        scratch[offsets[(u >> shift) & 0xFF]++] = data[i];
+      }
+      data.swap(scratch);
+    }
+  }
+
+  /// Sorts by key using radix sort for integral keys, std::sort otherwise
+  template <typename Key, typename Value, bool UseRadix>
+  struct local_sorter {
+    static void sort(std::vector<std::pair<Key, Value> >& data, bool radix) {
+      std::sort(data.begin(), data.end(), pair_key_comparator<Key,Value>());
+    }
+  };
+
+  template <typename Key, typename Value>
+  struct local_sorter<Key, Value, true> {
+    static void sort(std::vector<std::pair<Key, Value> >& data, bool radix) {
+      if (radix) radix_sort(data);
+      else std::sort(data.begin(), data.end(), pair_key_comparator<Key,Value>());
+    }
+  };
 }
 
+/**
+ * \ingroup rpc
+ * Distributed sample sort of (key, value) pairs.
+ *
+ * All machines call sort() with their local keys and values. On return,
+ * result() on machine i holds a sorted range of pairs, and every key on
+ * machine i is no greater than every key on machine i + 1.
+ *
+ * Splitters are chosen from a sample of the keys. Each sampled key is tagged
+ * with its position (machine, index), and the position is used to break
+ * ties. A heavily duplicated key is then split across several machines
+ * instead of all landing on one, so the partitions stay balanced even when
+ * a few keys dominate (for instance when sorting by degree or label).
+ *
+ * Integral keys are sorted locally with an LSD radix sort. Other key types
+ * use std::sort.
+ *
+ * The shuffle streams: the number of pairs each machine receives is exchanged
+ * first, so the result is allocated once and filled from the receive
+ * buffers while sending is still in progress. The result and the
+ * input are the only full copies of the data. The radix sort adds a transient
+ * scratch buffer.
+ */
 template <typename Key, typename Value>
 class sample_sort {
  private:
   dc_dist_object<sample_sort<Key, Value> > rmi;
 
   typedef buffered_exchange<std::pair<Key, Value> > key_exchange_type;
+  /// A key tagged with its position (machine, index) for tie breaking
+  typedef std::pair<Key, std::pair<procid_t, size_t> > tagged_key_type;
 
   key_exchange_type key_exchange;
   std::vector<std::pair<Key, Value> > key_values;
+  mutex key_values_lock;
+  bool use_radix_sort;
+
+  static size_t num_threads() {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+  }
+
  public:
-  sample_sort(distributed_control& dc): rmi(dc, this), key_exchange(dc) { }
+  /**
+   * Constructs a sorter.
+   * \param use_radix_sort If true (default) integral keys are sorted locally 
+   *                       with a radix sort. Otherwise std::sort is used.
+   */
+  sample_sort(distributed_control& dc, bool use_radix_sort = true): 
+      rmi(dc, this), key_exchange(dc, num_threads()),
+      use_radix_sort(use_radix_sort) { }
 
   template <typename KeyIterator, typename ValueIterator>
   void sort(KeyIterator kstart, KeyIterator kend,
             ValueIterator vstart, ValueIterator vend) {
     rmi.barrier();
+    timer ti; ti.start();
 
-    size_t num_entries = std::distance(kstart, kend);
+    const size_t num_entries = std::distance(kstart, kend);
     ASSERT_EQ(num_entries, std::distance(vstart, vend));
 
     // we will sample k * p entries
-    std::vector<std::vector<Key> > sampled_keys(rmi.numprocs());
-    for (size_t i = 0;i < 100 * rmi.numprocs(); ++i) {
-      size_t idx = (rand() % num_entries); 
-      sampled_keys[rmi.procid()].push_back(*(kstart + idx));
+    std::vector<std::vector<tagged_key_type> > sampled_keys(rmi.numprocs());
+    if (num_entries > 0) {
+      for (size_t i = 0;i < 100 * rmi.numprocs(); ++i) {
+        const size_t idx = (rand() % num_entries); 
+        sampled_keys[rmi.procid()].push_back(tag(*(kstart + idx), idx));
+      }
     }
 
     rmi.all_gather(sampled_keys);
     // collapse into a single array and sort
-    std::vector<Key> all_sampled_keys;
+    std::vector<tagged_key_type> all_sampled_keys;
     for (size_t i = 0;i < sampled_keys.size(); ++i) {
       std::copy(sampled_keys[i].begin(), sampled_keys[i].end(),
                 std::inserter(all_sampled_keys, all_sampled_keys.end()));
     }
-    // sort the sampled keys and extract the ranges
+    std::vector<std::vector<tagged_key_type> >().swap(sampled_keys);
+    // sort the sampled keys and extract the splitters. 
+    // Machine i receives the keys k with splitters[i-1] <= k < splitters[i]
     std::sort(all_sampled_keys.begin(), all_sampled_keys.end());
-    std::vector<Key> ranges(rmi.numprocs());
-    ranges[0] = Key();
-    for(size_t i = 1; i < rmi.numprocs(); ++i) {
-      ranges[i] = all_sampled_keys[sampled_keys[0].size() * i];
+    std::vector<tagged_key_type> splitters;
+    if (!all_sampled_keys.empty()) {
+      for(size_t i = 1; i < rmi.numprocs(); ++i) {
+        splitters.push_back(
+            all_sampled_keys[all_sampled_keys.size() * i / rmi.numprocs()]);
+      }
     }
+    std::vector<tagged_key_type>().swap(all_sampled_keys);
+
+    // compute the destination of every entry and exchange the counts
+    // so that the result can be allocated once
+    std::vector<procid_t> targets(num_entries);
+    std::vector<std::vector<size_t> > counts(rmi.numprocs(), 
+                                             std::vector<size_t>(1, 0));
+    for (size_t i = 0; i < num_entries; ++i) {
+      targets[i] = std::upper_bound(splitters.begin(), splitters.end(),
+                                    tag(*(kstart + i), i)) - splitters.begin();
+      ++counts[targets[i]][0];
+    }
+    rmi.all_to_all(counts);
+    size_t num_receive = 0;
+    for (size_t i = 0; i < counts.size(); ++i) num_receive += counts[i][0];
+    key_values.clear();
+    key_values.reserve(num_receive);
+    rmi.barrier();
 
     // begin shuffle 
-    KeyIterator kiter = kstart;
-    ValueIterator viter = vstart;
-    if (rmi.numprocs() < 8) {
-      while(kiter != kend) {
-        procid_t target_machine = 0;
-        while (target_machine < rmi.numprocs() - 1  && 
-               ranges[target_machine + 1] < *kiter) ++target_machine;
-        key_exchange.send(target_machine, std::make_pair(*kiter, *viter));
-        ++kiter; ++viter;
-      }
-    } 
-    else {
-      while(kiter != kend) {
-        procid_t target_machine = 
-          std::upper_bound(ranges.begin(), ranges.end(), *kiter) 
-          - ranges.begin() - 1;
-        key_exchange.send(target_machine, std::make_pair(*kiter, *viter));
-        ++kiter; ++viter;
-      }
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (ptrdiff_t i = 0; i < (ptrdiff_t)num_entries; ++i) {
+#ifdef _OPENMP
+      const size_t thread_id = omp_get_thread_num();
+#else
+      const size_t thread_id = 0;
+#endif
+      key_exchange.send(targets[i], 
+                        std::make_pair(*(kstart + i), *(vstart + i)),
+                        thread_id);
+      if (i % 4096 == 0) receive(true);
     }
+    std::vector<procid_t>().swap(targets);
     key_exchange.flush();
- 
-    // read from key exchange 
-    procid_t recvid;
-    typename key_exchange_type::buffer_type buffer;
-    while(key_exchange.recv(recvid, buffer)) {
-      std::copy(buffer.begin(), buffer.end(), 
-          std::inserter(key_values, key_values.end()));
-    }
-    std::sort(key_values.begin(), key_values.end(), 
-        sample_sort_impl::pair_key_comparator<Key,Value>());
+    receive(false);
+    ASSERT_EQ(key_values.size(), num_receive);
+    const double shuffle_time = ti.current_time();
+
+    sample_sort_impl::local_sorter<
+        Key, Value, 
+        boost::is_integral<Key>::value && 
+        !boost::is_same<Key, bool>::value>::sort(key_values, use_radix_sort);
 
     rmi.barrier();
+    size_t total = num_entries;
+    size_t max_partition = key_values.size();
+    rmi.all_reduce(total);
+    rmi.all_reduce2(max_partition, max_op);
+    if (rmi.procid() == 0) {
+      const double runtime = std::max(ti.current_time(), 1E-6);
+      logstream(LOG_INFO) << "Sorted " << total << " entries in " << runtime
+                          << "s (shuffle " << shuffle_time << "s): " 
+                          << total / runtime << " entries/s. "
+                          << "Largest partition: " << max_partition 
+                          << " (balanced: " 
+                          << total / rmi.numprocs() << ")" << std::endl;
+    }
   }
 
   std::vector<std::pair<Key, Value> >& result() {
     return key_values;
   }
+
+ private:
+  tagged_key_type tag(const Key& key, size_t idx) const {
+    return tagged_key_type(key, std::make_pair(rmi.procid(), idx));
+  }
+
+  static void max_op(size_t& a, const size_t& b) {
+    a = std::max(a, b);
+  }
+
+  // move received pairs into the result, freeing each buffer as we go
+  void receive(bool try_lock) {
+    procid_t recvid;
+    typename key_exchange_type::buffer_type buffer;
+    while(key_exchange.recv(recvid, buffer, try_lock)) {
+      key_values_lock.lock();
+      key_values.insert(key_values.end(), buffer.begin(), buffer.end());
+      key_values_lock.unlock();
+      typename key_exchange_type::buffer_type().swap(buffer);
+    }
+  }
 };
 
 
@@ -0,0 +1,259 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_STRING_DICTIONARY_HPP
+#define GRAPHLAB_STRING_DICTIONARY_HPP
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/rpc/dc_dist_object.hpp>
+#include <graphlab/rpc/buffered_exchange.hpp>
+
+namespace graphlab {
+
+  /**
+   * \ingroup rpc
+   * A distributed dictionary assigning compact integer ids to strings.
+   *
+   * The ids of n distinct strings are 0 to n-1, so they can index arrays
+   * and replace string vertex or edge data, e.g. labels, by a 4 byte
+   * integer. Each string is owned by the machine given by its hash, and
+   * each id by the machine id % numprocs, which keeps the reverse
+   * mapping. Both intern() and lookup() are bulk operations that must
+   * be called on all machines simultaneously, and send every distinct
+   * key once to its owner:
+   *
+   * \code
+   * string_dictionary dict(dc);
+   * std::vector<std::string> labels = ...; // e.g. the labels of the
+   *                                        // local master vertices
+   * std::vector<string_dictionary::id_type> ids;
+   * dict.intern(labels, ids);
+   * ...
+   * dict.lookup(ids, labels);              // e.g. before saving
+   * \endcode
+   *
+   * The new strings of one intern() call are numbered after the strings
+   * already in the dictionary, in sorted order on each owner, so the
+   * ids only depend on the strings and the number of machines.
+   */
+  class string_dictionary {
+  public:
+    typedef uint32_t id_type;
+
+  private:
+    typedef boost::unordered_map<std::string, id_type> string_map_type;
+    typedef boost::unordered_map<id_type, std::string> id_map_type;
+
+    dc_dist_object<string_dictionary> rpc;
+    boost::hash<std::string> hasher;
+    /// the ids of the strings owned by this machine
+    string_map_type string_to_id;
+    /// the strings of the ids owned by this machine
+    id_map_type id_to_string;
+    /// the number of strings in the dictionary
+    size_t nstrings;
+
+  public:
+    string_dictionary(distributed_control& dc) : rpc(dc, this), nstrings(0) {
+      rpc.barrier();
+    }
+
+    /// The machine owning a string
+    procid_t owner(const std::string& key) const {
+      return hasher(key) % rpc.numprocs();
+    }
+
+    /// The machine storing the string of an id
+    procid_t id_owner(const id_type id) const {
+      return id % rpc.numprocs();
+    }
+
+    /// The number of distinct strings in the dictionary
+    size_t size() const { return nstrings; }
+
+    /**
+     * Adds the strings of keys which are not yet in the dictionary, and
+     * sets ids[i] to the id of keys[i]. Must be called on all machines
+     * simultaneously.
+     */
+    void intern(const std::vector<std::string>& keys,
+                std::vector<id_type>& ids) {
+      // the distinct keys of each owner
+      std::vector<std::vector<std::string> > requests(rpc.numprocs());
+      for (size_t i = 0; i < keys.size(); ++i) {
+        requests[owner(keys[i])].push_back(keys[i]);
+      }
+      for (procid_t p = 0; p < rpc.numprocs(); ++p) {
+        std::sort(requests[p].begin(), requests[p].end());
+        requests[p].erase(std::unique(requests[p].begin(), requests[p].end()),
+                          requests[p].end());
+      }
+      // the owners receive the keys, and number the new ones
+      std::vector<std::vector<std::string> > received;
+      exchange(requests, received);
+      std::vector<std::string> new_strings;
+      for (procid_t p = 0; p < rpc.numprocs(); ++p) {
+        for (size_t i = 0; i < received[p].size(); ++i) {
+          if (string_to_id.find(received[p][i]) == string_to_id.end()) {
+            new_strings.push_back(received[p][i]);
+          }
+        }
+      }
+      std::sort(new_strings.begin(), new_strings.end());
+      new_strings.erase(std::unique(new_strings.begin(), new_strings.end()),
+                        new_strings.end());
+      std::vector<size_t> counts(rpc.numprocs(), 0);
+      counts[rpc.procid()] = new_strings.size();
+      rpc.all_gather(counts);
+      size_t next_id = nstrings;
+      for (procid_t p = 0; p < rpc.procid(); ++p) next_id += counts[p];
+      for (procid_t p = 0; p < rpc.numprocs(); ++p) nstrings += counts[p];
+      if (nstrings > size_t(id_type(-1))) {
+        logstream(LOG_FATAL) << "More than " << id_type(-1)
+                             << " strings in the dictionary" << std::endl;
+      }
+      // the owners of the new ids keep their strings
+      std::vector<std::vector<std::pair<id_type, std::string> > >
+        new_entries(rpc.numprocs());
+      for (size_t i = 0; i < new_strings.size(); ++i) {
+        const id_type id = id_type(next_id + i);
+        string_to_id[new_strings[i]] = id;
+        new_entries[id_owner(id)].push_back(std::make_pair(id, new_strings[i]));
+      }
+      std::vector<std::string>().swap(new_strings);
+      std::vector<std::vector<std::pair<id_type, std::string> > > entries;
+      exchange(new_entries, entries);
+      for (procid_t p = 0; p < rpc.numprocs(); ++p) {
+        for (size_t i = 0; i < entries[p].size(); ++i) {
+          id_to_string[entries[p][i].first].swap(entries[p][i].second);
+        }
+      }
+      // reply with the ids of the requested keys
+      std::vector<std::vector<id_type> > replies(rpc.numprocs());
+      for (procid_t p = 0; p < rpc.numprocs(); ++p) {
+        replies[p].resize(received[p].size());
+        for (size_t i = 0; i < received[p].size(); ++i) {
+          replies[p][i] = string_to_id[received[p][i]];
+        }
+      }
+      std::vector<std::vector<std::string> >().swap(received);
+      std::vector<std::vector<id_type> > answers;
+      exchange(replies, answers);
+      ids.resize(keys.size());
+      for (size_t i = 0; i < keys.size(); ++i) {
+        const procid_t p = owner(keys[i]);
+        const size_t pos = std::lower_bound(requests[p].begin(),
+                                            requests[p].end(),
+                                            keys[i]) - requests[p].begin();
+        ids[i] = answers[p][pos];
+      }
+    } // end of intern
+
+    /**
+     * Sets keys[i] to the string of ids[i]. The ids must have been
+     * returned by intern(). Must be called on all machines
+     * simultaneously.
+     */
+    void lookup(const std::vector<id_type>& ids,
+                std::vector<std::string>& keys) {
+      std::vector<std::vector<id_type> > requests(rpc.numprocs());
+      for (size_t i = 0; i < ids.size(); ++i) {
+        requests[id_owner(ids[i])].push_back(ids[i]);
+      }
+      for (procid_t p = 0; p < rpc.numprocs(); ++p) {
+        std::sort(requests[p].begin(), requests[p].end());
+        requests[p].erase(std::unique(requests[p].begin(), requests[p].end()),
+                          requests[p].end());
+      }
+      std::vector<std::vector<id_type> > received;
+      exchange(requests, received);
+      std::vector<std::vector<std::string> > replies(rpc.numprocs());
+      for (procid_t p = 0; p < rpc.numprocs(); ++p) {
+        replies[p].resize(received[p].size());
+        for (size_t i = 0; i < received[p].size(); ++i) {
+          id_map_type::const_iterator iter = id_to_string.find(received[p][i]);
+          if (iter == id_to_string.end()) {
+            logstream(LOG_FATAL) << "String id " << received[p][i]
+                                 << " is not in the dictionary" << std::endl;
+          }
+          replies[p][i] = iter->second;
+        }
+      }
+      std::vector<std::vector<std::string> > answers;
+      exchange(replies, answers);
+      keys.resize(ids.size());
+      for (size_t i = 0; i < ids.size(); ++i) {
+        const procid_t p = id_owner(ids[i]);
+        const size_t pos = std::lower_bound(requests[p].begin(),
+                                            requests[p].end(),
+                                            ids[i]) - requests[p].begin();
+        keys[i] = answers[p][pos];
+      }
+    } // end of lookup
+
+    /**
+     * Removes all strings. Must be called on all machines
+     * simultaneously.
+     */
+    void clear() {
+      rpc.barrier();
+      string_to_id.clear();
+      id_to_string.clear();
+      nstrings = 0;
+    }
+
+  private:
+    /**
+     * Sends outgoing[p] to machine p and sets incoming[p] to the vector
+     * machine p sent to this machine.
+     */
+    template <typename T>
+    void exchange(std::vector<std::vector<T> >& outgoing,
+                  std::vector<std::vector<T> >& incoming) {
+      typedef buffered_exchange<std::vector<T> > exchange_type;
+      exchange_type exchange(rpc.dc());
+      for (procid_t p = 0; p < rpc.numprocs(); ++p) {
+        if (!outgoing[p].empty()) exchange.send(p, outgoing[p]);
+      }
+      exchange.flush();
+      incoming.clear();
+      incoming.resize(rpc.numprocs());
+      procid_t proc = -1;
+      typename exchange_type::buffer_type buffer;
+      while (exchange.recv(proc, buffer)) {
+        for (size_t i = 0; i < buffer.size(); ++i) {
+          incoming[proc].insert(incoming[proc].end(),
+                                buffer[i].begin(), buffer[i].end());
+        }
+      }
+    } // end of exchange
+  }; // end of class string_dictionary
+
+}; // end of namespace graphlab
+#endif
@@ -61,7 +61,8 @@ namespace graphlab {
     /// If contained type is not a POD use the standard serializer
     template <typename OutArcType, typename ValueType>
     struct vector_serialize_impl<OutArcType, ValueType, false > {
-      static void exec(OutArcType& oarc, const std::vector<ValueType>& vec) {
+      template <typename Alloc>
+      static void exec(OutArcType& oarc, const std::vector<ValueType, Alloc>& vec) {
         oarc << size_t(vec.size());
         serialize_iterator(oarc,vec.begin(), vec.end());
       }
@@ -70,7 +71,8 @@ namespace graphlab {
     /// Fast vector serialization if contained type is a POD
     template <typename OutArcType, typename ValueType>
     struct vector_serialize_impl<OutArcType, ValueType, true > {
-      static void exec(OutArcType& oarc, const std::vector<ValueType>& vec) {
+      template <typename Alloc>
+      static void exec(OutArcType& oarc, const std::vector<ValueType, Alloc>& vec) {
         oarc << size_t(vec.size());
         serialize(oarc, &(vec[0]),sizeof(ValueType)*vec.size());
       }
@@ -79,7 +81,8 @@ namespace graphlab {
     /// If contained type is not a POD use the standard deserializer
     template <typename InArcType, typename ValueType>
     struct vector_deserialize_impl<InArcType, ValueType, false > {
-      static void exec(InArcType& iarc, std::vector<ValueType>& vec){
+      template <typename Alloc>
+      static void exec(InArcType& iarc, std::vector<ValueType, Alloc>& vec){
         size_t len;
         iarc >> len;
         vec.clear(); vec.reserve(len);
@@ -90,7 +93,8 @@ namespace graphlab {
     /// Fast vector deserialization if contained type is a POD
     template <typename InArcType, typename ValueType>
     struct vector_deserialize_impl<InArcType, ValueType, true > {
-      static void exec(InArcType& iarc, std::vector<ValueType>& vec){
+      template <typename Alloc>
+      static void exec(InArcType& iarc, std::vector<ValueType, Alloc>& vec){
         size_t len;
         iarc >> len;
         vec.clear(); vec.resize(len);
@@ -102,18 +106,18 @@ namespace graphlab {
     
     /**
        Serializes a vector */
-    template <typename OutArcType, typename ValueType>
-    struct serialize_impl<OutArcType, std::vector<ValueType>, false > {
-      static void exec(OutArcType& oarc, const std::vector<ValueType>& vec) {
+    template <typename OutArcType, typename ValueType, typename Alloc>
+    struct serialize_impl<OutArcType, std::vector<ValueType, Alloc>, false > {
+      static void exec(OutArcType& oarc, const std::vector<ValueType, Alloc>& vec) {
         vector_serialize_impl<OutArcType, ValueType, 
           gl_is_pod_or_scaler<ValueType>::value >::exec(oarc, vec);
       }
     };
     /**
        deserializes a vector */
-    template <typename InArcType, typename ValueType>
-    struct deserialize_impl<InArcType, std::vector<ValueType>, false > {
-      static void exec(InArcType& iarc, std::vector<ValueType>& vec){
+    template <typename InArcType, typename ValueType, typename Alloc>
+    struct deserialize_impl<InArcType, std::vector<ValueType, Alloc>, false > {
+      static void exec(InArcType& iarc, std::vector<ValueType, Alloc>& vec){
         vector_deserialize_impl<InArcType, ValueType, 
           gl_is_pod_or_scaler<ValueType>::value >::exec(iarc, vec);
       }
@@ -203,6 +203,8 @@ void add_metric_server_callback(std::string page,
 }
 
 void launch_metric_server() {
+  // every machine samples its counters, only machine 0 serves them
+  get_event_log().start_sampling();
   if (distributed_control::get_instance_procid() == 0) {
     const char *options[] = {"listening_ports", "8090", NULL};
     metric_context = mg_start(process_request, (void*)(&(callbacks())), options);
@@ -86,8 +86,10 @@ void add_metric_server_callback(std::string page,
   \ingroup httpserver
   \brief Starts the metrics reporting server.
 
-  The function may be called by all machines simultaneously since it only
-  does useful work on machine 0. Only machine 0 will launch the web server.
+  The function should be called by all machines. Every machine starts
+  sampling its event log counters (see distributed_event_logger::start_sampling()),
+  and only machine 0 will launch the web server. The page dashboard.html
+  shows the latest value of every counter.
  */
 void launch_metric_server();
 
@@ -0,0 +1,140 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_FIRST_TOUCH_ARRAY_HPP
+#define GRAPHLAB_FIRST_TOUCH_ARRAY_HPP
+
+#ifndef __NO_OPENMP__
+#include <omp.h>
+#endif
+
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+#include <boost/type_traits/is_empty.hpp>
+#include <boost/type_traits/has_trivial_destructor.hpp>
+
+namespace graphlab {
+
+  /**  \ingroup util
+   * A resizable array of per vertex state whose elements are
+   * constructed and destroyed in parallel.
+   *
+   * A std::vector constructs its elements on one thread, so the pages
+   * of a large array are faulted in serially and all end up on the
+   * memory node of that thread. Here each thread of an OpenMP loop
+   * constructs a block of elements, which spreads both the page
+   * faults and the placement across the machine.
+   *
+   * Arrays of an empty type (such as graphlab::empty messages or
+   * gathers) allocate no storage; every index refers to the same
+   * object.
+   */
+  template <typename T>
+  class first_touch_array {
+  public:
+    typedef T value_type;
+
+    /// Constructs an empty array
+    first_touch_array() : array(NULL), len(0) { }
+
+    ~first_touch_array() { clear(); }
+
+    size_t size() const { return len; }
+
+    bool empty() const { return len == 0; }
+
+    T& operator[](size_t i) {
+      return boost::is_empty<T>::value ? shared_element() : array[i];
+    }
+
+    const T& operator[](size_t i) const {
+      return boost::is_empty<T>::value ? shared_element() : array[i];
+    }
+
+    /**
+     * Resizes the array to n elements. The first min(n, size())
+     * elements are copied; the rest are copies of value.
+     */
+    void resize(size_t n, const T& value = T()) {
+      if (n == len) return;
+      if (boost::is_empty<T>::value) {
+        len = n;
+        return;
+      }
+      T* newarray = NULL;
+      if (n > 0) {
+        void* ptr = NULL;
+        if (posix_memalign(&ptr, 64, n * sizeof(T)) != 0) {
+          throw std::bad_alloc();
+        }
+        newarray = static_cast<T*>(ptr);
+        const size_t keep = std::min(n, len);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (ssize_t i = 0; i < ssize_t(n); ++i) {
+          if (size_t(i) < keep) new (newarray + i) T(array[i]);
+          else new (newarray + i) T(value);
+        }
+      }
+      clear();
+      array = newarray;
+      len = n;
+    }
+
+    /// Destroys all elements and releases the memory
+    void clear() {
+      if (!boost::is_empty<T>::value &&
+          !boost::has_trivial_destructor<T>::value) {
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (ssize_t i = 0; i < ssize_t(len); ++i) array[i].~T();
+      }
+      free(array);
+      array = NULL;
+      len = 0;
+    }
+
+    void swap(first_touch_array& other) {
+      std::swap(array, other.array);
+      std::swap(len, other.len);
+    }
+
+  private:
+    T* array;
+    size_t len;
+
+    static T& shared_element() {
+      static T element;
+      return element;
+    }
+
+    /** Not copyable */
+    first_touch_array(const first_touch_array&);
+    void operator=(const first_touch_array&);
+  }; // end of first_touch_array
+
+} // end of graphlab namespace
+#endif
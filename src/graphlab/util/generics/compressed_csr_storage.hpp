@@ -0,0 +1,336 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+#ifndef GRAPHLAB_COMPRESSED_CSR_STORAGE
+#define GRAPHLAB_COMPRESSED_CSR_STORAGE
+
+#include <vector>
+#include <iterator>
+#include <algorithm>
+
+#ifndef __NO_OPENMP__
+#include <omp.h>
+#endif
+
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/serialization/iarchive.hpp>
+#include <graphlab/serialization/oarchive.hpp>
+
+namespace graphlab {
+  /**
+   * A read-only, compressed version of csr_storage for integer values.
+   *
+   * Each key is associated with a list of (value, id) pairs sorted by
+   * value, then by id. Consecutive values are stored as gaps in a
+   * variable length byte encoding (7 bits per byte), so a list of nearby
+   * values costs one or two bytes per entry. The id is either implicit,
+   * equal to the position of the entry in the storage, or explicit and
+   * stored as a gap from the previous id of the same list. Explicit ids
+   * must then increase along each list.
+   *
+   * Lists are decoded on the fly by a forward const_iterator. The
+   * iterator also supports advancing by an arbitrary offset in O(degree).
+   */
+  template <typename valuetype, typename sizetype=size_t>
+  class compressed_csr_storage {
+   public:
+
+     /**
+      * Iterates over the (value, id) pairs of one key, decoding the
+      * entries as it goes.
+      */
+     class const_iterator {
+      public:
+       typedef std::forward_iterator_tag iterator_category;
+       typedef std::pair<valuetype, sizetype> value_type;
+       typedef ptrdiff_t difference_type;
+       typedef const value_type* pointer;
+       typedef const value_type& reference;
+
+       const_iterator(): bytes(NULL), row_bytes(NULL),
+                         idx(0), row_begin(0), row_end(0), explicit_ids(false) { }
+
+       reference operator*() const { return cur; }
+       pointer operator->() const { return &cur; }
+
+       const_iterator& operator++() {
+         ++idx;
+         if (idx < row_end) decode_next();
+         return *this;
+       }
+
+       const_iterator operator++(int) {
+         const_iterator ret = *this;
+         ++(*this);
+         return ret;
+       }
+
+       bool operator==(const const_iterator& other) const {
+         return idx == other.idx;
+       }
+
+       bool operator!=(const const_iterator& other) const {
+         return idx != other.idx;
+       }
+
+       /// Moves by n entries. Moving backwards restarts from the first entry.
+       void advance(difference_type n) {
+         sizetype target = idx + n;
+         if (n < 0) reset();
+         while (idx < target) ++(*this);
+       }
+
+       difference_type distance_to(const const_iterator& other) const {
+         return difference_type(other.idx) - difference_type(idx);
+       }
+
+       /// The position of the current entry in the storage
+       sizetype index() const { return idx; }
+
+      private:
+       friend class compressed_csr_storage;
+
+       const_iterator(const unsigned char* row_bytes, sizetype idx,
+                      sizetype row_begin, sizetype row_end, bool explicit_ids):
+           bytes(row_bytes), row_bytes(row_bytes), idx(idx),
+           row_begin(row_begin), row_end(row_end), explicit_ids(explicit_ids) {
+         cur.first = 0; cur.second = 0;
+         if (idx < row_end) {
+           // idx is either row_begin or row_end
+           decode_next();
+         }
+       }
+
+       void reset() {
+         bytes = row_bytes;
+         idx = row_begin;
+         cur.first = 0; cur.second = 0;
+         if (idx < row_end) decode_next();
+       }
+
+       // Decodes the entry idx, which follows the current entry
+       void decode_next() {
+         cur.first += valuetype(decode_varint(bytes));
+         if (explicit_ids) {
+           cur.second += sizetype(decode_varint(bytes));
+         } else {
+           cur.second = idx;
+         }
+       }
+
+       const unsigned char* bytes;
+       const unsigned char* row_bytes;
+       sizetype idx;
+       sizetype row_begin, row_end;
+       bool explicit_ids;
+       value_type cur;
+     };
+
+   public:
+     compressed_csr_storage(): explicit_ids(false) { }
+
+     /**
+      * Compresses a csr layout. value_ptrs[k] is the position of the first
+      * value of key k. Keys at or beyond value_ptrs.size() have no values.
+      * If ids is NULL, the id of a value is its position. Otherwise
+      * ids[i] is the id of values[i]. Each list of values (and ids)
+      * must already be sorted.
+      */
+     void build(const std::vector<sizetype>& value_ptrs,
+                const std::vector<valuetype>& values,
+                const std::vector<sizetype>* ids,
+                size_t num_keys) {
+       clear();
+       explicit_ids = ids != NULL;
+       row_ptrs.resize(num_keys + 1);
+       for (size_t k = 0; k < num_keys; ++k) {
+         row_ptrs[k] = k < value_ptrs.size() ? value_ptrs[k] : values.size();
+       }
+       row_ptrs[num_keys] = values.size();
+
+       // encode each key separately, then concatenate
+       std::vector<size_t> row_sizes(num_keys + 1, 0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+       for (ssize_t k = 0; k < ssize_t(num_keys); ++k) {
+         row_sizes[k] = encode_row(k, values, ids, NULL);
+       }
+       byte_ptrs.resize(num_keys + 1);
+       size_t total = 0;
+       for (size_t k = 0; k <= num_keys; ++k) {
+         byte_ptrs[k] = total;
+         total += row_sizes[k];
+       }
+       std::vector<size_t>().swap(row_sizes);
+       // padding so that decoding never needs a bounds check
+       bytes.resize(total + 16, 0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+       for (ssize_t k = 0; k < ssize_t(num_keys); ++k) {
+         encode_row(k, values, ids, &(bytes[byte_ptrs[k]]));
+       }
+     }
+
+     /// Number of keys in the storage.
+     inline size_t num_keys() const {
+       return row_ptrs.empty() ? 0 : row_ptrs.size() - 1;
+     }
+
+     /// Number of values in the storage.
+     inline size_t num_values() const {
+       return row_ptrs.empty() ? 0 : row_ptrs.back();
+     }
+
+     /// True if the ids were given to build(), not the positions
+     inline bool has_explicit_ids() const { return explicit_ids; }
+
+     /// Position of the first value of key id
+     inline sizetype begin_index(size_t id) const {
+       return id < num_keys() ? row_ptrs[id] : num_values();
+     }
+
+     /// Position of the ending+1 value of key id
+     inline sizetype end_index(size_t id) const {
+       return id < num_keys() ? row_ptrs[id + 1] : num_values();
+     }
+
+     /// Return iterator to the begining value with key == id
+     inline const_iterator begin(size_t id) const {
+       if (id >= num_keys()) return const_iterator();
+       return const_iterator(&(bytes[byte_ptrs[id]]), row_ptrs[id],
+                             row_ptrs[id], row_ptrs[id + 1], explicit_ids);
+     }
+
+     /// Return iterator to the ending+1 value with key == id
+     inline const_iterator end(size_t id) const {
+       if (id >= num_keys()) return const_iterator();
+       return const_iterator(&(bytes[byte_ptrs[id]]), row_ptrs[id + 1],
+                             row_ptrs[id], row_ptrs[id + 1], explicit_ids);
+     }
+
+     /**
+      * Decompresses into the arguments of build(). ids is only filled if
+      * the storage has explicit ids. As in csr_storage, value_ptrs does
+      * not cover the trailing keys without values.
+      */
+     void decompress(std::vector<sizetype>& value_ptrs,
+                     std::vector<valuetype>& values,
+                     std::vector<sizetype>& ids) const {
+       size_t nkeys = num_keys();
+       while (nkeys > 0 && row_ptrs[nkeys - 1] == num_values()) --nkeys;
+       value_ptrs.assign(row_ptrs.begin(), row_ptrs.begin() + nkeys);
+       values.resize(num_values());
+       ids.resize(explicit_ids ? num_values() : 0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+       for (ssize_t k = 0; k < ssize_t(num_keys()); ++k) {
+         for (const_iterator iter = begin(k); iter != end(k); ++iter) {
+           values[iter.index()] = iter->first;
+           if (explicit_ids) ids[iter.index()] = iter->second;
+         }
+       }
+     }
+
+     void swap(compressed_csr_storage& other) {
+       row_ptrs.swap(other.row_ptrs);
+       byte_ptrs.swap(other.byte_ptrs);
+       bytes.swap(other.bytes);
+       std::swap(explicit_ids, other.explicit_ids);
+     }
+
+     void clear() {
+       std::vector<sizetype>().swap(row_ptrs);
+       std::vector<size_t>().swap(byte_ptrs);
+       std::vector<unsigned char>().swap(bytes);
+     }
+
+     void load(iarchive& iarc) {
+       clear();
+       iarc >> row_ptrs >> byte_ptrs >> bytes >> explicit_ids;
+     }
+
+     void save(oarchive& oarc) const {
+       oarc << row_ptrs << byte_ptrs << bytes << explicit_ids;
+     }
+
+     size_t estimate_sizeof() const {
+       return sizeof(row_ptrs) + sizeof(byte_ptrs) + sizeof(bytes) +
+           sizeof(sizetype) * row_ptrs.capacity() +
+           sizeof(size_t) * byte_ptrs.capacity() + bytes.capacity();
+     }
+
+   private:
+     static size_t encode_varint(size_t val, unsigned char* out) {
+       size_t len = 0;
+       while (val >= 0x80) {
+         if (out) out[len] = (unsigned char)(val | 0x80);
+         val >>= 7;
+         ++len;
+       }
+       if (out) out[len] = (unsigned char)val;
+       return len + 1;
+     }
+
+     static size_t decode_varint(const unsigned char*& in) {
+       size_t val = *in & 0x7F;
+       size_t shift = 7;
+       while (*in & 0x80) {
+         ++in;
+         val |= size_t(*in & 0x7F) << shift;
+         shift += 7;
+       }
+       ++in;
+       return val;
+     }
+
+     // Encodes the list of key k into out. Returns the number of bytes.
+     // If out is NULL only the length is computed.
+     size_t encode_row(size_t k, const std::vector<valuetype>& values,
+                       const std::vector<sizetype>* ids,
+                       unsigned char* out) const {
+       size_t len = 0;
+       valuetype prev_value = 0;
+       sizetype prev_id = 0;
+       for (size_t i = row_ptrs[k]; i < row_ptrs[k + 1]; ++i) {
+         ASSERT_GE(values[i], prev_value);
+         len += encode_varint(values[i] - prev_value, out ? out + len : NULL);
+         prev_value = values[i];
+         if (ids) {
+           ASSERT_GE((*ids)[i], prev_id);
+           len += encode_varint((*ids)[i] - prev_id, out ? out + len : NULL);
+           prev_id = (*ids)[i];
+         }
+       }
+       return len;
+     }
+
+     /// row_ptrs[k] is the position of the first value of key k
+     std::vector<sizetype> row_ptrs;
+     /// byte_ptrs[k] is the offset of the encoding of key k in bytes
+     std::vector<size_t> byte_ptrs;
+     std::vector<unsigned char> bytes;
+     bool explicit_ids;
+  }; // end of class
+} // end of graphlab
+#endif
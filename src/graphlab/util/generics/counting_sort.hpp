@@ -27,53 +27,169 @@
 #endif
 
 #include <vector>
-#include <graphlab/parallel/atomic.hpp>
+#include <algorithm>
 
 namespace graphlab {
+
     /**
-     *  Count the value_vec.
-     *  Generate permute_index for value_vec in ascending order and 
-     *  optionally fill in the prefix array of the counts. 
+     *  Replace vec with its exclusive prefix sum, computed in parallel
+     *  over blocks of the vector. Return the total.
      **/
-    template <typename valuetype, typename sizetype>
-    void counting_sort(const std::vector<valuetype>& value_vec,
-                       std::vector<sizetype>& permute_index,
-                       std::vector<sizetype>* prefix_array = NULL) {
-      if(value_vec.size() == 0) return;
-
-      valuetype maxval = *std::max_element(value_vec.begin(), value_vec.end());
-      std::vector< atomic<size_t> > counter_array(maxval+1);
-      permute_index.resize(value_vec.size(), 0);
-      permute_index.assign(value_vec.size(), 0);
+    template <typename sizetype>
+    sizetype parallel_prefix_sum(std::vector<sizetype>& vec) {
+      const size_t n = vec.size();
+      size_t nblocks = 1;
 #ifdef _OPENMP
-#pragma omp parallel for
+      nblocks = std::max<size_t>(1, std::min<size_t>(omp_get_max_threads(),
+                                                     n / 65536));
+#endif
+      std::vector<sizetype> block_sums(nblocks + 1, 0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1)
 #endif
-      for (ssize_t i = 0; i < ssize_t(value_vec.size()); ++i) {
-        size_t val = value_vec[i];
-        counter_array[val].inc();
+      for (ssize_t b = 0; b < ssize_t(nblocks); ++b) {
+        sizetype sum = 0;
+        for (size_t i = n * b / nblocks; i < n * (b + 1) / nblocks; ++i) {
+          sum += vec[i];
+        }
+        block_sums[b + 1] = sum;
       }
-
-      for (size_t i = 1; i < counter_array.size(); ++i) {
-        counter_array[i] += counter_array[i-1];
+      for (size_t b = 0; b < nblocks; ++b) block_sums[b + 1] += block_sums[b];
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1)
+#endif
+      for (ssize_t b = 0; b < ssize_t(nblocks); ++b) {
+        sizetype sum = block_sums[b];
+        for (size_t i = n * b / nblocks; i < n * (b + 1) / nblocks; ++i) {
+          const sizetype val = vec[i];
+          vec[i] = sum;
+          sum += val;
+        }
       }
+      return block_sums[nblocks];
+    }
+
+    namespace counting_sort_detail {
+      /// Records the source index of each position
+      template <typename sizetype>
+      struct permute_place {
+        std::vector<sizetype>& permute_index;
+        permute_place(std::vector<sizetype>& permute_index):
+            permute_index(permute_index) { }
+        void operator()(size_t i, size_t pos) { permute_index[pos] = i; }
+      };
 
+      /// Moves the value of each index to its position
+      template <typename invector, typename outvector>
+      struct value_place {
+        const invector& in;
+        outvector& out;
+        value_place(const invector& in, outvector& out): in(in), out(out) { }
+        void operator()(size_t i, size_t pos) { out[pos] = in[i]; }
+      };
+
+      /**
+       *  The stable counting sort behind counting_sort and
+       *  counting_sort_values. Call place(i, pos) to move the ith element
+       *  to position pos.
+       *
+       *  The input is split into one chunk per thread, each with its own
+       *  counts so that no atomic counter is needed. The counts are laid
+       *  out key by key, then chunk by chunk: their prefix sum is the
+       *  position of the first element of each key in each chunk.
+       **/
+      template <typename keytype, typename keyalloc, typename sizetype,
+                typename placetype>
+      void sort(const std::vector<keytype, keyalloc>& key_vec,
+                placetype& place,
+                std::vector<sizetype>* prefix_array) {
+        const size_t n = key_vec.size();
+        size_t nthreads = 1;
 #ifdef _OPENMP
-#pragma omp parallel for
+        nthreads = omp_get_max_threads();
 #endif
-      for (ssize_t i = 0; i < ssize_t(value_vec.size()); ++i) {
-        size_t val = value_vec[i];
-        permute_index[counter_array[val].dec()] = i;
-      }
+        std::vector<keytype> chunk_max(nthreads, 0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1)
+#endif
+        for (ssize_t c = 0; c < ssize_t(nthreads); ++c) {
+          for (size_t i = n * c / nthreads; i < n * (c + 1) / nthreads; ++i) {
+            chunk_max[c] = std::max(chunk_max[c], key_vec[i]);
+          }
+        }
+        const size_t nkeys =
+            size_t(*std::max_element(chunk_max.begin(), chunk_max.end())) + 1;
+        // keep the counts smaller than the input
+        const size_t nchunks = std::max<size_t>(1, std::min(nthreads, n / nkeys));
+
+        std::vector<sizetype> counts(nkeys * nchunks, 0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1)
+#endif
+        for (ssize_t c = 0; c < ssize_t(nchunks); ++c) {
+          for (size_t i = n * c / nchunks; i < n * (c + 1) / nchunks; ++i) {
+            ++counts[size_t(key_vec[i]) * nchunks + c];
+          }
+        }
+        parallel_prefix_sum(counts);
 
-      if (prefix_array != NULL) {
-        prefix_array->resize(counter_array.size());
+        if (prefix_array != NULL) {
+          prefix_array->resize(nkeys);
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-        for (ssize_t i = 0; i < ssize_t(counter_array.size()); ++i) {
-          (*prefix_array)[i] = counter_array[i];
+          for (ssize_t k = 0; k < ssize_t(nkeys); ++k) {
+            (*prefix_array)[k] = counts[k * nchunks];
+          }
+        }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1)
+#endif
+        for (ssize_t c = 0; c < ssize_t(nchunks); ++c) {
+          for (size_t i = n * c / nchunks; i < n * (c + 1) / nchunks; ++i) {
+            place(i, counts[size_t(key_vec[i]) * nchunks + c]++);
+          }
         }
       }
+    } // end of counting_sort_detail
+
+    /**
+     *  Count the value_vec.
+     *  Generate permute_index for value_vec in ascending order and
+     *  optionally fill in the prefix array of the counts.
+     *  The sort is stable and runs in parallel.
+     **/
+    template <typename valuetype, typename valuealloc, typename sizetype>
+    void counting_sort(const std::vector<valuetype, valuealloc>& value_vec,
+                       std::vector<sizetype>& permute_index,
+                       std::vector<sizetype>* prefix_array = NULL) {
+      if(value_vec.size() == 0) return;
+      permute_index.resize(value_vec.size());
+      counting_sort_detail::permute_place<sizetype> place(permute_index);
+      counting_sort_detail::sort(value_vec, place, prefix_array);
+    }
+
+    /**
+     *  Count the key_vec.
+     *  Place the values in out in ascending order of their keys, where
+     *  value_vec[i] has key key_vec[i], without building the permute
+     *  index. Optionally fill in the prefix array of the counts.
+     *  The sort is stable and runs in parallel.
+     **/
+    template <typename keytype, typename keyalloc,
+              typename valuetype, typename valuealloc, typename outalloc,
+              typename sizetype>
+    void counting_sort_values(const std::vector<keytype, keyalloc>& key_vec,
+                              const std::vector<valuetype, valuealloc>& value_vec,
+                              std::vector<valuetype, outalloc>& out,
+                              std::vector<sizetype>* prefix_array = NULL) {
+      out.resize(key_vec.size());
+      if(key_vec.size() == 0) return;
+      typedef std::vector<valuetype, valuealloc> invector;
+      typedef std::vector<valuetype, outalloc> outvector;
+      counting_sort_detail::value_place<invector, outvector> place(value_vec, out);
+      counting_sort_detail::sort(key_vec, place, prefix_array);
     }
 } // end of graphlab
 
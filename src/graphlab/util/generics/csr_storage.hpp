@@ -35,12 +35,15 @@ namespace graphlab {
    * The key has type size_t and can be assolicated with multiple values of valuetype.
    * The core operation of is querying the list of values associated with the query key *  and returns the begin and end iterators via <code>begin(id)</code>
    * and <code>end(id)</code>.
+   * The values are allocated with the given allocator.
    */
-  template <typename valuetype, typename sizetype=size_t>
+  template <typename valuetype, typename sizetype=size_t,
+            typename allocator=std::allocator<valuetype> >
   class csr_storage {
    public:
-     typedef typename std::vector<valuetype>::iterator iterator;
-     typedef typename std::vector<valuetype>::const_iterator const_iterator;
+     typedef std::vector<valuetype, allocator> value_vector_type;
+     typedef typename value_vector_type::iterator iterator;
+     typedef typename value_vector_type::const_iterator const_iterator;
      typedef valuetype value_type;
 
    public:
@@ -107,21 +110,36 @@ namespace graphlab {
       * The input vector will be cleared. 
       */
      void wrap(std::vector<sizetype>& valueptr_vec,
-               std::vector<valuetype>& value_vec) {
-       for (ssize_t i = 1; i < (ssize_t)valueptr_vec.size(); ++i) {
-         ASSERT_LE(valueptr_vec[i-1], valueptr_vec[i]);
-         ASSERT_LT(valueptr_vec[i], value_vec.size());
-       }
+               value_vector_type& value_vec) {
+       check_wrap(valueptr_vec, value_vec);
        value_ptrs.swap(valueptr_vec);
        values.swap(value_vec);
      }
 
+     /**
+      * Wrap a value vector with a different allocator. The values
+      * are copied.
+      */
+     template <typename otherallocator>
+     void wrap(std::vector<sizetype>& valueptr_vec,
+               std::vector<valuetype, otherallocator>& value_vec) {
+       check_wrap(valueptr_vec, value_vec);
+       value_ptrs.swap(valueptr_vec);
+       values.assign(value_vec.begin(), value_vec.end());
+       std::vector<valuetype, otherallocator>().swap(value_vec);
+     }
+
      /// Number of keys in the storage.
      inline size_t num_keys() const { return value_ptrs.size(); }
 
      /// Number of values in the storage.
      inline size_t num_values() const { return values.size(); }
 
+     /// Position of the first value of key id
+     inline size_t begin_index(size_t id) const {
+       return id < num_keys() ? value_ptrs[id] : num_values();
+     }
+
      /// Return iterator to the begining value with key == id 
      inline iterator begin(size_t id) {
        return id < num_keys() ? values.begin()+value_ptrs[id] : values.end();
@@ -156,17 +174,19 @@ namespace graphlab {
      }
 
    public:
-     std::vector<valuetype> get_values() { return values; }
-     std::vector<sizetype> get_index() { return value_ptrs; }
+     std::vector<valuetype> get_values() const {
+       return std::vector<valuetype>(values.begin(), values.end());
+     }
+     std::vector<sizetype> get_index() const { return value_ptrs; }
 
-     void swap(csr_storage<valuetype, sizetype>& other) {
+     void swap(csr_storage& other) {
        value_ptrs.swap(other.value_ptrs);
        values.swap(other.values);
      }
 
      void clear() {
        std::vector<sizetype>().swap(value_ptrs);
-       std::vector<valuetype>().swap(values);
+       value_vector_type().swap(values);
      }
 
      void load(iarchive& iarc) {
@@ -183,9 +203,21 @@ namespace graphlab {
        return sizeof(value_ptrs) + sizeof(values) + sizeof(sizetype)*value_ptrs.capacity() + sizeof(valuetype) * values.capacity();
      }
 
+     /// The values of all keys, in key order
+     const value_vector_type& get_value_vector() const { return values; }
+
    private:
+     template <typename vectortype>
+     void check_wrap(const std::vector<sizetype>& valueptr_vec,
+                     const vectortype& value_vec) {
+       for (ssize_t i = 1; i < (ssize_t)valueptr_vec.size(); ++i) {
+         ASSERT_LE(valueptr_vec[i-1], valueptr_vec[i]);
+         ASSERT_LT(valueptr_vec[i], value_vec.size());
+       }
+     }
+
      std::vector<sizetype> value_ptrs;
-     std::vector<valuetype> values;
+     value_vector_type values;
   }; // end of class
 } // end of graphlab 
 #endif
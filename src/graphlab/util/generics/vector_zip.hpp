@@ -51,5 +51,26 @@ namespace graphlab {
     std::vector<v2>().swap(vec2);
     return out;
   }
+
+  /**
+   * Zips vec1 and vec2 into out, which may use a different allocator
+   * than the inputs. vec1 and vec2 are cleared.
+   */
+  template<typename v1, typename a1, typename v2, typename a2, typename a3>
+  void vector_zip(std::vector<v1, a1>& vec1, std::vector<v2, a2>& vec2,
+                  std::vector<std::pair<v1, v2>, a3>& out) {
+    assert(vec1.size() == vec2.size());
+    size_t length = vec1.size();
+    out.clear();
+    out.resize(length);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (ssize_t i = 0; i < ssize_t(length); ++i) {
+      out[i] = (std::pair<v1, v2>(vec1[i], vec2[i]));
+    }
+    std::vector<v1, a1>().swap(vec1);
+    std::vector<v2, a2>().swap(vec2);
+  }
 } // end of graphlab
 #endif
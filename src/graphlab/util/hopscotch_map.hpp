@@ -398,6 +398,58 @@ namespace graphlab {
       }
     }
 
+    /**
+     * Searches for a batch of n keys. results[i] is set to find(keys[i]).
+     * Lookups are pipelined with prefetching, which is considerably faster
+     * than n calls to find() on tables which do not fit in cache.
+     */
+    void find_batch(const key_type* keys, size_t n,
+                    const_iterator* results) const {
+      const size_t CHUNK = 256;
+      storage_type probe[CHUNK];
+      typename container_type::const_iterator found[CHUNK];
+      for (size_t start = 0; start < n; start += CHUNK) {
+        const size_t len = std::min(CHUNK, n - start);
+        for (size_t i = 0; i < len; ++i) probe[i].first = keys[start + i];
+        ((const container_type*)container)->find_batch(probe, len, found);
+        for (size_t i = 0; i < len; ++i) {
+          if (found[i] != ((const container_type*)container)->end()) {
+            results[start + i] = const_iterator(this, found[i], spill.begin());
+          } else {
+            results[start + i] = const_iterator(this, found[i],
+                                                spill.find(keys[start + i]));
+          }
+        }
+      }
+    }
+
+    /**
+     * Inserts the (key, value) pairs in the random access range 
+     * [first, last) using all threads. Existing keys are overwritten.
+     * The table is grown once up front, so this is much faster than 
+     * calling put() on each pair.
+     */
+    template <typename RandomIterator>
+    void bulk_insert(RandomIterator first, RandomIterator last) {
+      if (!spill.empty()) {
+        // a spilled key must not also be inserted into the container
+        for (RandomIterator i = first; i != last; ++i) put(*i);
+        return;
+      }
+      const size_t n = std::distance(first, last);
+      // grow at the same 0.8 load factor as put(), so the table ends up
+      // between 40% and 80% full after rounding to a power of two
+      const size_t target = size() + n;
+      if (5 * target > 4 * container->capacity()) {
+        rehash_to_new_container(target + target / 4);
+      }
+      std::vector<storage_type> failed;
+      container->bulk_insert(first, last, failed);
+      for (size_t i = 0; i < failed.size(); ++i) {
+        spill[failed[i].first] = failed[i].second;
+      }
+    }
+
     size_t count(key_type const& k) const {
       value_type v(k, mapped_type());
       return container->count(v) || spill.count(k);
@@ -462,11 +514,12 @@ namespace graphlab {
       else {
         container->clear();
       }
+      spill.clear();
+      std::vector<value_type> values(s);
       for (size_t i = 0;i < s; ++i) {
-        value_type v;
-        iarc >> v;
-        insert(v);
+        iarc >> values[i];
       }
+      bulk_insert(values.begin(), values.end());
     }
 
     void put(const value_type &v) {
@@ -31,6 +31,9 @@
 #include <functional>
 #include <iterator>
 
+#ifndef __NO_OPENMP__
+#include <omp.h>
+#endif
 
 #include <boost/functional/hash.hpp>
 #define _HOPSCOTCH_TABLE_DEFAULT_HASH boost::hash<T>
@@ -89,6 +92,9 @@ class hopscotch_table {
     size_t numel;
     size_t mask;
 
+    /// The furthest an entry may be placed from its hash target
+    static const size_t MAX_PROBE = 31 * 20;
+
     /// Returns the next power of 2 of a value
     static uint64_t next_powerof2(uint64_t val) {
       --val;
@@ -340,11 +346,24 @@ class hopscotch_table {
                                             overwrite);
       if (ret != end()) return ret;
 
+      size_t slot = insert_new(newdata, target);
+      if (slot == data.size()) return end();
+      ++numel;
+      return iterator(this, data.begin() + slot);
+    }
+
+    /**
+     * Places an entry which is known not to be in the table into the
+     * neighbourhood of its hash target. Returns the slot the entry was
+     * placed in, or data.size() on failure. Does not update numel.
+     * Only touches slots in [target, target + 31 * 20).
+     */
+    size_t insert_new(const value_type& newdata, size_t target) {
       // search for a place to stick it into
       bool found = false;
       size_t shift_target = target;
       // let max range is 31 * 20
-      size_t limit = std::min(data.size(), target + 31 * 20);
+      size_t limit = std::min(data.size(), target + MAX_PROBE);
       for (;shift_target < limit; shift_target++) {
         if (data[shift_target].hasdata == false) {
           // double check
@@ -360,7 +379,7 @@ class hopscotch_table {
 
       if (!found) {
         // failed to find a place to put this value.
-        return iterator(this, data.end());
+        return data.size();
       }
 
       // while the shift target is out of range
@@ -398,7 +417,7 @@ class hopscotch_table {
         }
 
         if (!found) {
-          return iterator(this, data.end());
+          return data.size();
         }
       }
       // insert and return
@@ -406,8 +425,7 @@ class hopscotch_table {
       data[shift_target].elem = newdata;
       data[target].field |= (1 << (shift_target - target));
       data[shift_target].hasdata = true;
-      ++numel;
-      return iterator(this, data.begin() + shift_target);
+      return shift_target;
     }
 
 
@@ -484,6 +502,144 @@ class hopscotch_table {
     }
 
 
+    /**
+     * Searches for a batch of n entries. results[i] is set to the result of
+     * find(keys[i]). The hash targets of a window of upcoming keys are
+     * computed and prefetched ahead of the probes so that the cache misses
+     * of successive lookups overlap.
+     */
+    void find_batch(const value_type* keys, size_t n,
+                    const_iterator* results) const {
+      const size_t WINDOW = 16;
+      size_t targets[WINDOW];
+      for (size_t i = 0; i < std::min(n, WINDOW); ++i) {
+        targets[i] = compute_hash(keys[i]) & mask;
+        __builtin_prefetch(&(data[targets[i]]));
+      }
+      for (size_t i = 0; i < n; ++i) {
+        const size_t target = targets[i % WINDOW];
+        if (i + WINDOW < n) {
+          targets[i % WINDOW] = compute_hash(keys[i + WINDOW]) & mask;
+          __builtin_prefetch(&(data[targets[i % WINDOW]]));
+        }
+        results[i] = find_impl(keys[i], target);
+      }
+    }
+
+    /**
+     * Inserts the entries in the random access range [first, last) in
+     * parallel, overwriting existing entries with the same key. 
+     * The table is not resized: entries which do not fit in the
+     * neighbourhood of their hash target are appended to failed.
+     * Not safe to call concurrently with any other operation.
+     *
+     * The table is cut into segments of at least 2 * MAX_PROBE entries and
+     * the input is bucketed by the segment of its hash target. 
+     * An insertion only touches entries between its hash target and 
+     * MAX_PROBE entries beyond it, so even segments never interfere with 
+     * each other and are filled in parallel, followed by the odd segments.
+     */
+    template <typename RandomIterator>
+    void bulk_insert(RandomIterator first, RandomIterator last,
+                     std::vector<value_type>& failed) {
+      const size_t n = std::distance(first, last);
+#ifdef _OPENMP
+      const size_t nthreads = omp_get_max_threads();
+#else
+      const size_t nthreads = 1;
+#endif
+      const size_t table_size = mask + 1;
+      size_t nsegments = 1;
+      while(nsegments < 8 * nthreads &&
+            table_size / (2 * nsegments) >= 2 * MAX_PROBE) {
+        nsegments *= 2;
+      }
+      if (nthreads == 1 || nsegments < 4 || n < 4096) {
+        for (size_t i = 0; i < n; ++i) {
+          if (insert_impl(*(first + i)) == end()) failed.push_back(*(first + i));
+        }
+        return;
+      }
+      size_t segment_bits = 0;
+      while(((size_t)1 << segment_bits) * nsegments < table_size) ++segment_bits;
+
+      // bucket the input by segment: counting sort with one histogram
+      // per thread.
+      std::vector<size_t> targets(n);
+      std::vector<size_t> order(n);
+      std::vector<std::vector<size_t> > counts(nthreads,
+                                               std::vector<size_t>(nsegments, 0));
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+      {
+#ifdef _OPENMP
+        const size_t t = omp_get_thread_num();
+#else
+        const size_t t = 0;
+#endif
+        const size_t lo = n * t / nthreads, hi = n * (t + 1) / nthreads;
+        for (size_t i = lo; i < hi; ++i) {
+          targets[i] = compute_hash(*(first + i)) & mask;
+          ++counts[t][targets[i] >> segment_bits];
+        }
+      }
+      std::vector<size_t> segment_begin(nsegments + 1, 0);
+      size_t total = 0;
+      for (size_t s = 0; s < nsegments; ++s) {
+        segment_begin[s] = total;
+        for (size_t t = 0; t < nthreads; ++t) {
+          const size_t c = counts[t][s];
+          counts[t][s] = total;
+          total += c;
+        }
+      }
+      segment_begin[nsegments] = total;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+      {
+#ifdef _OPENMP
+        const size_t t = omp_get_thread_num();
+#else
+        const size_t t = 0;
+#endif
+        const size_t lo = n * t / nthreads, hi = n * (t + 1) / nthreads;
+        for (size_t i = lo; i < hi; ++i) {
+          order[counts[t][targets[i] >> segment_bits]++] = i;
+        }
+      }
+      std::vector<std::vector<size_t> >().swap(counts);
+
+      // fill the even segments, then the odd segments
+      std::vector<size_t> inserted(nsegments, 0);
+      std::vector<std::vector<size_t> > segment_failed(nsegments);
+      for (size_t parity = 0; parity < 2; ++parity) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(nthreads)
+#endif
+        for (ptrdiff_t s = parity; s < (ptrdiff_t)nsegments; s += 2) {
+          for (size_t j = segment_begin[s]; j < segment_begin[s + 1]; ++j) {
+            const size_t i = order[j];
+            const value_type& v = *(first + i);
+            if (try_find_and_overwrite(v, targets[i], true) != end()) continue;
+            if (insert_new(v, targets[i]) == data.size()) {
+              segment_failed[s].push_back(i);
+            } else {
+              ++inserted[s];
+            }
+          }
+        }
+      }
+      for (size_t s = 0; s < nsegments; ++s) {
+        numel += inserted[s];
+        for (size_t j = 0; j < segment_failed[s].size(); ++j) {
+          failed.push_back(*(first + segment_failed[s][j]));
+        }
+      }
+    }
+
+
     void clear() {
       for (size_t i = 0;i < data.size(); ++i) {
         data[i].hasdata = false;
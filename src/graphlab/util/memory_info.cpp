@@ -21,10 +21,14 @@
  */
 
 #include <iostream>
+#include <sstream>
+#include <pthread.h>
 #ifdef HAS_TCMALLOC
 #include <google/malloc_extension.h>
 #endif
 #include <graphlab/logger/assertions.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/util/memory_info.hpp>
 
 namespace graphlab {
   namespace memory_info {
@@ -100,6 +104,167 @@ namespace graphlab {
     } // end of log usage
 
 
+    /**
+     * The counts of one thread. Only the owning thread writes them, so
+     * counting takes no atomic operation, and the readers sum the counts
+     * of all the threads. Memory is often released by another thread
+     * than the one that counted it, so a single count may wrap below
+     * zero; only the sums are meaningful.
+     *
+     * The counts are never freed: when a thread exits its counts are
+     * kept in the list and handed to the next new thread, so the list
+     * can be read without a lock.
+     */
+    struct thread_counts {
+      size_t tags[NUM_MEMORY_TAGS];
+      size_t total;
+      bool in_use;
+      thread_counts* next;
+      // keep the counts of two threads off the same cache line
+      char padding[64];
+      thread_counts() : total(0), in_use(true), next(NULL) {
+        for (size_t i = 0; i < NUM_MEMORY_TAGS; ++i) tags[i] = 0;
+      }
+    };
+
+    static thread_counts* volatile counts_list = NULL;
+    // protects the in_use flags and the insertions into counts_list
+    static pthread_mutex_t counts_mut = PTHREAD_MUTEX_INITIALIZER;
+
+    static void release_thread_counts(void* counts) {
+      pthread_mutex_lock(&counts_mut);
+      reinterpret_cast<thread_counts*>(counts)->in_use = false;
+      pthread_mutex_unlock(&counts_mut);
+    }
+
+    static pthread_key_t counts_key() {
+      // function statics are initialized once even with several threads
+      struct key_holder {
+        pthread_key_t key;
+        key_holder() { pthread_key_create(&key, release_thread_counts); }
+      };
+      static key_holder holder;
+      return holder.key;
+    }
+
+    static thread_counts& get_thread_counts() {
+      const pthread_key_t key = counts_key();
+      thread_counts* counts =
+        reinterpret_cast<thread_counts*>(pthread_getspecific(key));
+      if (counts != NULL) return *counts;
+      pthread_mutex_lock(&counts_mut);
+      for (counts = counts_list; counts != NULL; counts = counts->next) {
+        if (!counts->in_use) break;
+      }
+      if (counts != NULL) {
+        counts->in_use = true;
+      } else {
+        counts = new thread_counts;
+        counts->next = counts_list;
+        // publish the counts after they are initialized
+        __sync_synchronize();
+        counts_list = counts;
+      }
+      pthread_mutex_unlock(&counts_mut);
+      pthread_setspecific(key, counts);
+      return *counts;
+    }
+
+    // the largest total_tagged_bytes() since the last reset, tracked only
+    // once reset_peak_tagged_bytes() has been called
+    static atomic<size_t> peak_counter;
+    static volatile bool track_peak = false;
+    static size_t memory_budget = 0;
+    // the total above which over_budget() is true
+    static size_t budget_watermark = size_t(-1);
+
+    static void update_peak() {
+      const size_t total = total_tagged_bytes();
+      size_t peak = peak_counter.value;
+      while (total > peak &&
+             !atomic_compare_and_swap(peak_counter.value, peak, total)) {
+        peak = peak_counter.value;
+      }
+    } // end of update_peak
+
+    const char* tag_name(memory_tag tag) {
+      static const char* names[NUM_MEMORY_TAGS] = {
+        "Graph Structure", "Vertex Data", "Edge Data", "Engine State",
+        "Gather Cache", "Exchange Buffers", "RPC Buffers", "Fiber Stacks" };
+      ASSERT_LT(size_t(tag), size_t(NUM_MEMORY_TAGS));
+      return names[tag];
+    } // end of tag_name
+
+    void add_tagged_bytes(memory_tag tag, size_t bytes) {
+      thread_counts& counts = get_thread_counts();
+      counts.tags[tag] += bytes;
+      counts.total += bytes;
+      if (track_peak) update_peak();
+    } // end of add_tagged_bytes
+
+    void sub_tagged_bytes(memory_tag tag, size_t bytes) {
+      thread_counts& counts = get_thread_counts();
+      counts.tags[tag] -= bytes;
+      counts.total -= bytes;
+    } // end of sub_tagged_bytes
+
+    size_t tagged_bytes(memory_tag tag) {
+      size_t bytes = 0;
+      for (thread_counts* counts = counts_list; counts != NULL;
+           counts = counts->next) {
+        bytes += counts->tags[tag];
+      }
+      return bytes;
+    } // end of tagged_bytes
+
+    size_t total_tagged_bytes() {
+      size_t bytes = 0;
+      for (thread_counts* counts = counts_list; counts != NULL;
+           counts = counts->next) {
+        bytes += counts->total;
+      }
+      return bytes;
+    } // end of total_tagged_bytes
+
+    size_t peak_tagged_bytes() {
+      return peak_counter.value;
+    } // end of peak_tagged_bytes
+
+    void reset_peak_tagged_bytes() {
+      peak_counter.value = total_tagged_bytes();
+      track_peak = true;
+    } // end of reset_peak_tagged_bytes
+
+    void log_tagged_usage(const std::string& label) {
+      const double BYTES_TO_MB = double(1) / double(1024 * 1024);
+      std::stringstream strm;
+      strm << "Tagged Memory: " << label;
+      for (size_t i = 0; i < NUM_MEMORY_TAGS; ++i) {
+        strm << "\n\t " << tag_name(memory_tag(i)) << ": "
+             << (tagged_bytes(memory_tag(i)) * BYTES_TO_MB) << " MB";
+      }
+      strm << "\n\t Total: " << (total_tagged_bytes() * BYTES_TO_MB) << " MB";
+      if (memory_budget > 0) {
+        strm << " of a " << (memory_budget * BYTES_TO_MB) << " MB budget";
+      }
+      logstream(LOG_INFO) << strm.str() << std::endl;
+    } // end of log_tagged_usage
+
+    void set_budget(size_t bytes) {
+      memory_budget = bytes;
+      budget_watermark = bytes > 0 ? size_t(bytes * BUDGET_HIGH_WATERMARK)
+                                   : size_t(-1);
+    } // end of set_budget
+
+    size_t budget() {
+      return memory_budget;
+    } // end of budget
+
+    bool over_budget() {
+      return memory_budget > 0 && total_tagged_bytes() >= budget_watermark;
+    } // end of over_budget
+
+
   }; // end of namespace memory info
 
 }; // end of graphlab namespace
@@ -23,6 +23,9 @@
 #ifndef GRAPHLAB_MEMORY_INFO_HPP
 #define GRAPHLAB_MEMORY_INFO_HPP
 
+#include <cstddef>
+#include <string>
+
 namespace graphlab {
   /**
    * \internal \brief Memory info namespace contains functions used to
@@ -83,6 +86,138 @@ namespace graphlab {
      * @param [in] label the string to print before the memory usage summary.
      */
     void log_usage(const std::string& label = "");
+
+
+    /**
+     * \internal
+     *
+     * \brief The subsystems whose memory is accounted separately.
+     *
+     * The tagged counts are estimates reported by the containers
+     * themselves (see tracked_bytes), so they are available without
+     * TCMalloc but do not cover heap memory owned by the stored
+     * types, such as the contents of a std::vector vertex data.
+     *
+     * Each thread counts into its own slots without atomic operations,
+     * and the readers below sum the slots of all the threads.
+     */
+    enum memory_tag {
+      GRAPH_STRUCTURE = 0, ///< Adjacency and vertex records of the graph
+      VERTEX_DATA,         ///< Vertex data of the local graph
+      EDGE_DATA,           ///< Edge data of the local graph
+      ENGINE_STATE,        ///< Per vertex arrays of the engines
+      GATHER_CACHE,        ///< Gather caches of the engines
+      EXCHANGE_BUFFERS,    ///< Values received by buffered exchanges
+      RPC_BUFFERS,         ///< Outgoing data queued on the sockets
+      FIBER_STACKS,        ///< Stacks of the live fibers
+      NUM_MEMORY_TAGS
+    };
+
+    /// \internal \brief Returns a printable name for a memory tag
+    const char* tag_name(memory_tag tag);
+
+    /// \internal \brief Adds bytes to the count of a memory tag
+    void add_tagged_bytes(memory_tag tag, size_t bytes);
+
+    /// \internal \brief Removes bytes from the count of a memory tag
+    void sub_tagged_bytes(memory_tag tag, size_t bytes);
+
+    /// \internal \brief Returns the bytes currently counted for a tag
+    size_t tagged_bytes(memory_tag tag);
+
+    /// \internal \brief Returns the sum of the bytes of all tags
+    size_t total_tagged_bytes();
+
+    /**
+     * \internal
+     *
+     * \brief Returns the largest value total_tagged_bytes() reached
+     * since the last call to reset_peak_tagged_bytes().
+     *
+     * The peak is only tracked once reset_peak_tagged_bytes() has been
+     * called, since tracking it sums the counts of all the threads on
+     * every add_tagged_bytes().
+     */
+    size_t peak_tagged_bytes();
+
+    /// \internal \brief Restarts the peak at the current total
+    void reset_peak_tagged_bytes();
+
+    /**
+     * \internal
+     *
+     * \brief Log the bytes of every memory tag on this machine, prefixed
+     * by the string argument.
+     */
+    void log_tagged_usage(const std::string& label = "");
+
+    /**
+     * \internal
+     *
+     * \brief Sets the memory budget of this machine in bytes. 0, the
+     * default, disables the budget.
+     *
+     * The budget is compared against total_tagged_bytes(). Once the
+     * tagged memory passes BUDGET_HIGH_WATERMARK of the budget,
+     * over_budget() returns true and the subsystems apply backpressure:
+     * the buffered exchanges send smaller buffers and flush them at once,
+     * and the synchronous engine drops its gather cache. A sender in a fiber
+     * also yields to the other fibers of its worker. Senders are never
+     * blocked, so the budget reduces the buffered data but is not a hard
+     * limit. The graph option memory_budget_mb sets the budget when the
+     * distributed_graph is constructed, so it also applies to ingress,
+     * where the received data is only drained by finalize().
+     */
+    void set_budget(size_t bytes);
+
+    /// \internal \brief Returns the memory budget in bytes, or 0 if none
+    size_t budget();
+
+    /// The fraction of the budget above which over_budget() is true
+    const double BUDGET_HIGH_WATERMARK = 0.9;
+
+    /**
+     * \internal
+     *
+     * \brief Returns true if a budget is set and the tagged memory is
+     * above its high watermark. Without a budget this is a single load;
+     * with one it sums the counts of the threads, which is cheap enough
+     * to call per send.
+     */
+    bool over_budget();
+
+
+    /**
+     * \internal
+     *
+     * \brief Holds the bytes a container reports for a memory tag.
+     *
+     * The container calls set() with its new footprint whenever it
+     * grows or shrinks, and the difference is applied to the tag. The
+     * bytes are released on destruction. A copy starts with no bytes,
+     * since the copied container reports its own.
+     */
+    class tracked_bytes {
+    public:
+      explicit tracked_bytes(memory_tag tag) : tag(tag), bytes(0) { }
+      tracked_bytes(const tracked_bytes& other) : tag(other.tag), bytes(0) { }
+      tracked_bytes& operator=(const tracked_bytes& other) { return *this; }
+      ~tracked_bytes() { set(0); }
+
+      /// Sets the footprint of the container
+      void set(size_t newbytes) {
+        if (newbytes > bytes) add_tagged_bytes(tag, newbytes - bytes);
+        else if (newbytes < bytes) sub_tagged_bytes(tag, bytes - newbytes);
+        bytes = newbytes;
+      }
+
+      /// Returns the footprint last set
+      size_t get() const { return bytes; }
+
+    private:
+      memory_tag tag;
+      size_t bytes;
+    };
   } // end of namespace memory info
 };
 
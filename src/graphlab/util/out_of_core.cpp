@@ -0,0 +1,236 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <vector>
+#include <graphlab/util/out_of_core.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/logger/assertions.hpp>
+
+namespace graphlab {
+  namespace out_of_core {
+
+    namespace {
+      /// A file backed mapping
+      struct region {
+        size_t bytes;
+        int fd;
+      };
+
+      struct state_type {
+        mutex lock;
+        std::string dir;
+        size_t budget;
+        size_t mapped_bytes;
+        /// mappings indexed by their address
+        std::map<const char*, region> regions;
+        state_type(): budget(size_t(-1)), mapped_bytes(0) { }
+      };
+
+      state_type& state() {
+        static state_type s;
+        return s;
+      }
+
+      /**
+       * Finds the mapping containing ptr. Returns false if there is
+       * none. Requires the lock.
+       */
+      bool find_region(const char* ptr, const char*& begin, region& reg) {
+        std::map<const char*, region>& regions = state().regions;
+        if (regions.empty()) return false;
+        std::map<const char*, region>::const_iterator iter =
+            regions.upper_bound(ptr);
+        if (iter == regions.begin()) return false;
+        --iter;
+        if (ptr >= iter->first + iter->second.bytes) return false;
+        begin = iter->first;
+        reg = iter->second;
+        return true;
+      }
+
+      /**
+       * Restricts [ptr, ptr + bytes) to the pages of the mapping which
+       * contains ptr. Returns false if ptr is not file backed.
+       */
+      bool page_range(const void* ptr, size_t bytes,
+                      char*& first, size_t& len, size_t& offset, int& fd) {
+        if (ptr == NULL || bytes == 0) return false;
+        const char* begin;
+        region reg;
+        {
+          state_type& s = state();
+          s.lock.lock();
+          const bool found = find_region((const char*)ptr, begin, reg);
+          s.lock.unlock();
+          if (!found) return false;
+        }
+        const size_t page = sysconf(_SC_PAGESIZE);
+        size_t start = (const char*)ptr - begin;
+        size_t end = std::min(start + bytes, reg.bytes);
+        start = start / page * page;
+        first = const_cast<char*>(begin) + start;
+        len = end - start;
+        offset = start;
+        fd = reg.fd;
+        return len > 0;
+      }
+    } // anonymous namespace
+
+
+    void set_directory(const std::string& dir) {
+      state_type& s = state();
+      s.lock.lock();
+      s.dir = dir;
+      s.lock.unlock();
+    }
+
+    std::string directory() {
+      state_type& s = state();
+      s.lock.lock();
+      std::string ret = s.dir;
+      s.lock.unlock();
+      return ret;
+    }
+
+    bool enabled() {
+      return !directory().empty();
+    }
+
+    void set_memory_budget(size_t bytes) {
+      state().budget = bytes;
+    }
+
+    size_t memory_budget() {
+      return state().budget;
+    }
+
+    size_t min_file_bytes() {
+      return 1 << 20;
+    }
+
+
+    void* allocate(size_t bytes) {
+      const std::string dir = directory();
+      if (dir.empty() || bytes < min_file_bytes()) return malloc(bytes);
+
+      std::string path = dir + "/graphlab_ooc_XXXXXX";
+      std::vector<char> name(path.begin(), path.end());
+      name.push_back('\0');
+      int fd = mkstemp(&(name[0]));
+      if (fd < 0) {
+        logstream(LOG_WARNING) << "Unable to create a backing file in "
+                               << dir << ": " << strerror(errno)
+                               << ". Allocating in memory." << std::endl;
+        return malloc(bytes);
+      }
+      // the file lives as long as the mapping
+      unlink(&(name[0]));
+      void* ptr = MAP_FAILED;
+      if (ftruncate(fd, bytes) == 0) {
+        ptr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      }
+      if (ptr == MAP_FAILED) {
+        logstream(LOG_WARNING) << "Unable to map " << bytes
+                               << " bytes in " << dir << ": "
+                               << strerror(errno)
+                               << ". Allocating in memory." << std::endl;
+        close(fd);
+        return malloc(bytes);
+      }
+      region reg;
+      reg.bytes = bytes;
+      reg.fd = fd;
+      state_type& s = state();
+      s.lock.lock();
+      s.regions[(const char*)ptr] = reg;
+      s.mapped_bytes += bytes;
+      s.lock.unlock();
+      return ptr;
+    }
+
+
+    void deallocate(void* ptr) {
+      if (ptr == NULL) return;
+      state_type& s = state();
+      s.lock.lock();
+      std::map<const char*, region>::iterator iter =
+          s.regions.find((const char*)ptr);
+      if (iter == s.regions.end()) {
+        s.lock.unlock();
+        free(ptr);
+        return;
+      }
+      const region reg = iter->second;
+      s.regions.erase(iter);
+      s.mapped_bytes -= reg.bytes;
+      s.lock.unlock();
+      munmap(ptr, reg.bytes);
+      close(reg.fd);
+    }
+
+
+    bool is_file_backed(const void* ptr) {
+      const char* begin;
+      region reg;
+      state_type& s = state();
+      s.lock.lock();
+      const bool found = find_region((const char*)ptr, begin, reg);
+      s.lock.unlock();
+      return found;
+    }
+
+
+    size_t file_backed_bytes() {
+      state_type& s = state();
+      s.lock.lock();
+      const size_t ret = s.mapped_bytes;
+      s.lock.unlock();
+      return ret;
+    }
+
+
+    void will_need(const void* ptr, size_t bytes) {
+      char* first; size_t len, offset; int fd;
+      if (!page_range(ptr, bytes, first, len, offset, fd)) return;
+      madvise(first, len, MADV_WILLNEED);
+    }
+
+
+    void dont_need(const void* ptr, size_t bytes) {
+      char* first; size_t len, offset; int fd;
+      if (!page_range(ptr, bytes, first, len, offset, fd)) return;
+      // start writing back dirty pages, then drop the mapping and the
+      // cached pages which are already clean
+      msync(first, len, MS_ASYNC);
+      madvise(first, len, MADV_DONTNEED);
+      posix_fadvise(fd, offset, len, POSIX_FADV_DONTNEED);
+    }
+
+  } // namespace out_of_core
+} // namespace graphlab
@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_OUT_OF_CORE_HPP
+#define GRAPHLAB_OUT_OF_CORE_HPP
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <string>
+
+namespace graphlab {
+  /**
+   * \internal \brief Functions managing file backed memory, used to keep
+   * large arrays such as the edges of the local graph out of core.
+   *
+   * When a directory is set, every allocation of at least
+   * min_file_bytes() made through allocate() is backed by its own
+   * unlinked file in that directory and mapped with mmap. The kernel
+   * then reads and writes the pages on demand, so the arrays can be
+   * larger than the memory of the machine. will_need() and dont_need()
+   * give read-ahead and release hints for ranges of such arrays. When
+   * no directory is set, allocate() is a plain malloc and the hints do
+   * nothing.
+   */
+  namespace out_of_core {
+
+    /**
+     * \internal
+     * \brief Sets the directory of the backing files. An empty string
+     * disables out of core storage for later allocations.
+     */
+    void set_directory(const std::string& dir);
+
+    /// \internal \brief Returns the directory of the backing files.
+    std::string directory();
+
+    /// \internal \brief Returns true if a directory is set.
+    bool enabled();
+
+    /**
+     * \internal
+     * \brief Sets the number of bytes of file backed memory which
+     * should stay resident. This is a target for the users of
+     * will_need() and dont_need(); the kernel may keep more pages.
+     */
+    void set_memory_budget(size_t bytes);
+
+    /// \internal \brief Returns the memory budget in bytes. Unlimited by default.
+    size_t memory_budget();
+
+    /// \internal \brief Allocations smaller than this stay in memory.
+    size_t min_file_bytes();
+
+    /**
+     * \internal
+     * \brief Allocates bytes of memory, file backed if out of core
+     * storage is enabled. Returns NULL on failure.
+     */
+    void* allocate(size_t bytes);
+
+    /// \internal \brief Releases memory returned by allocate().
+    void deallocate(void* ptr);
+
+    /// \internal \brief Returns true if ptr points into file backed memory.
+    bool is_file_backed(const void* ptr);
+
+    /// \internal \brief Total bytes of file backed memory allocated.
+    size_t file_backed_bytes();
+
+    /**
+     * \internal
+     * \brief Starts reading the given range in the background if it
+     * is file backed.
+     */
+    void will_need(const void* ptr, size_t bytes);
+
+    /**
+     * \internal
+     * \brief Writes back and releases the pages of the given range if
+     * it is file backed. The content is preserved.
+     */
+    void dont_need(const void* ptr, size_t bytes);
+
+  } // namespace out_of_core
+
+
+  /**
+   * \internal
+   * A standard allocator which allocates through out_of_core::allocate.
+   * Containers using it keep their contents in files when out of core
+   * storage is enabled, and in memory otherwise.
+   */
+  template <typename T>
+  class out_of_core_allocator {
+   public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <typename U>
+    struct rebind { typedef out_of_core_allocator<U> other; };
+
+    out_of_core_allocator() { }
+    out_of_core_allocator(const out_of_core_allocator&) { }
+    template <typename U>
+    out_of_core_allocator(const out_of_core_allocator<U>&) { }
+
+    pointer address(reference x) const { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+
+    pointer allocate(size_type n, const void* = 0) {
+      if (n == 0) return NULL;
+      void* ptr = out_of_core::allocate(n * sizeof(T));
+      if (ptr == NULL) throw std::bad_alloc();
+      return static_cast<pointer>(ptr);
+    }
+
+    void deallocate(pointer ptr, size_type) {
+      if (ptr != NULL) out_of_core::deallocate(ptr);
+    }
+
+    size_type max_size() const {
+      return std::numeric_limits<size_type>::max() / sizeof(T);
+    }
+
+    void construct(pointer ptr, const T& val) { new (ptr) T(val); }
+    void destroy(pointer ptr) { ptr->~T(); }
+
+    bool operator==(const out_of_core_allocator&) const { return true; }
+    bool operator!=(const out_of_core_allocator&) const { return false; }
+  }; // end of out_of_core_allocator
+
+} // namespace graphlab
+
+#endif
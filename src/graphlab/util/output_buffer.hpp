@@ -0,0 +1,202 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_OUTPUT_BUFFER_HPP
+#define GRAPHLAB_OUTPUT_BUFFER_HPP
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <graphlab/logger/assertions.hpp>
+
+namespace graphlab {
+
+  /**
+   * \ingroup util
+   * An append-only character buffer with fast formatted output.
+   *
+   * output_buffer is a lightweight replacement for std::stringstream when
+   * producing large amounts of text (or binary) output. It never
+   * allocates temporaries: integers are formatted by hand and floating point
+   * values are formatted directly into the buffer with snprintf.
+   * Formatting matches the default behavior of std::ostream.
+   *
+   * \code
+   * output_buffer out;
+   * out << vid << '\t' << 0.5 << '\n';
+   * fwrite(out.data(), 1, out.size(), file);
+   * \endcode
+   *
+   * It is not thread-safe; in parallel code each thread should own its own
+   * buffer.
+   */
+  class output_buffer {
+   private:
+    char* buf;
+    size_t len;
+    size_t buffer_size;
+
+    // not copyable
+    output_buffer(const output_buffer&);
+    output_buffer& operator=(const output_buffer&);
+
+    inline void grow(size_t n) {
+      if (len + n > buffer_size) {
+        buffer_size = 2 * (len + n);
+        buf = (char*)realloc(buf, buffer_size);
+        ASSERT_TRUE(buf != NULL);
+      }
+    }
+
+    template <typename T>
+    inline void write_unsigned(T val) {
+      char tmp[24];
+      char* end = tmp + sizeof(tmp);
+      char* c = end;
+      do {
+        *(--c) = '0' + (val % 10);
+        val /= 10;
+      } while(val != 0);
+      write(c, end - c);
+    }
+
+    template <typename T, typename UnsignedT>
+    inline void write_signed(T val) {
+      if (val < 0) {
+        put('-');
+        // negate in the unsigned type so that the minimum value is correct
+        write_unsigned<UnsignedT>(UnsignedT(0) - UnsignedT(val));
+      } else {
+        write_unsigned<UnsignedT>(UnsignedT(val));
+      }
+    }
+
+   public:
+    explicit output_buffer(size_t initial = 4096):
+        buf(NULL), len(0), buffer_size(0) {
+      reserve(initial);
+    }
+
+    ~output_buffer() {
+      free(buf);
+    }
+
+    /// Returns the number of bytes written into the buffer
+    inline size_t size() const { return len; }
+
+    /// Returns a pointer to the contents of the buffer
+    inline const char* data() const { return buf; }
+
+    /// Empties the buffer without releasing memory
+    inline void clear() { len = 0; }
+
+    /// Ensures the buffer can hold at least n bytes without reallocating
+    inline void reserve(size_t n) {
+      if (n > buffer_size) {
+        buf = (char*)realloc(buf, n);
+        ASSERT_TRUE(buf != NULL);
+        buffer_size = n;
+      }
+    }
+
+    inline void swap(output_buffer& other) {
+      std::swap(buf, other.buf);
+      std::swap(len, other.len);
+      std::swap(buffer_size, other.buffer_size);
+    }
+
+    /// Appends n bytes
+    inline void write(const char* s, size_t n) {
+      grow(n);
+      memcpy(buf + len, s, n);
+      len += n;
+    }
+
+    /// Appends a single character
+    inline void put(char c) {
+      grow(1);
+      buf[len++] = c;
+    }
+
+    /// Appends the raw binary representation of a POD value
+    template <typename T>
+    inline void write_pod(const T& val) {
+      write(reinterpret_cast<const char*>(&val), sizeof(T));
+    }
+
+    inline output_buffer& operator<<(char c) { put(c); return *this; }
+
+    inline output_buffer& operator<<(const char* s) {
+      write(s, strlen(s)); return *this;
+    }
+
+    inline output_buffer& operator<<(const std::string& s) {
+      write(s.c_str(), s.length()); return *this;
+    }
+
+    inline output_buffer& operator<<(int val) {
+      write_signed<int, unsigned int>(val); return *this;
+    }
+
+    inline output_buffer& operator<<(long val) {
+      write_signed<long, unsigned long>(val); return *this;
+    }
+
+    inline output_buffer& operator<<(long long val) {
+      write_signed<long long, unsigned long long>(val); return *this;
+    }
+
+    inline output_buffer& operator<<(unsigned int val) {
+      write_unsigned(val); return *this;
+    }
+
+    inline output_buffer& operator<<(unsigned long val) {
+      write_unsigned(val); return *this;
+    }
+
+    inline output_buffer& operator<<(unsigned long long val) {
+      write_unsigned(val); return *this;
+    }
+
+    /// Formats like std::ostream with the default precision of 6
+    inline output_buffer& operator<<(double val) {
+      grow(32);
+      len += snprintf(buf + len, 32, "%g", val);
+      return *this;
+    }
+
+    /// Formats a floating point value with the given number of digits
+    inline void write_double(double val, int precision) {
+      grow(40);
+      len += snprintf(buf + len, 40, "%.*g", precision, val);
+    }
+
+    inline output_buffer& operator<<(float val) {
+      return (*this) << double(val);
+    }
+  }; // end of output_buffer
+
+} // end of namespace graphlab
+#endif
@@ -0,0 +1,151 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_PARALLEL_BLOCK_WRITER_HPP
+#define GRAPHLAB_PARALLEL_BLOCK_WRITER_HPP
+
+#include <vector>
+#include <ostream>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/util/charstream.hpp>
+#include <graphlab/logger/assertions.hpp>
+
+namespace graphlab {
+
+  /**
+   * \ingroup util
+   * Writes independent blocks of output into a set of output streams
+   * from many threads at once.
+   *
+   * Each call to write_block() appends one block to one of the output
+   * streams. When compression is enabled, every block is compressed into
+   * a complete gzip member by the calling thread <b>before</b> the
+   * stream lock is acquired. Compression therefore runs on all
+   * threads in parallel, regardless of the number of output files. A
+   * concatenation of gzip members is itself a valid gzip file, so the
+   * output can be read by gunzip or boost::iostreams::gzip_decompressor.
+   *
+   * The order of blocks within a file is not defined. Output which must be
+   * read back in order should be made of self-contained blocks.
+   *
+   * \code
+   * parallel_block_writer writer(streams, true);
+   * #pragma omp parallel
+   * {
+   *   output_buffer buffer;
+   *   ... fill buffer ...
+   *   if (buffer.size() >= parallel_block_writer::DEFAULT_BLOCK_SIZE) {
+   *     writer.write_block(buffer.data(), buffer.size());
+   *     buffer.clear();
+   *   }
+   * }
+   * \endcode
+   */
+  class parallel_block_writer {
+   public:
+    /// Recommended amount of uncompressed data per block
+    static const size_t DEFAULT_BLOCK_SIZE = 1024 * 1024;
+
+   private:
+    std::vector<std::ostream*> outs;
+    std::vector<mutex> locks;
+    bool gzip;
+    int compression_level;
+    atomic<size_t> next_stream;
+    atomic<size_t> bytes_in, bytes_out;
+
+   public:
+    /**
+     * Constructs a block writer over a set of output streams. The streams
+     * are not owned by the writer and must outlive it.
+     *
+     * \param outs The output streams. Must not be empty.
+     * \param gzip If true, each block is written as a gzip member.
+     * \param compression_level The zlib compression level (1 - 9).
+     */
+    parallel_block_writer(const std::vector<std::ostream*>& outs,
+                          bool gzip,
+                          int compression_level = 
+                              boost::iostreams::gzip::default_compression):
+        outs(outs), locks(outs.size()), gzip(gzip),
+        compression_level(compression_level) {
+      ASSERT_GT(outs.size(), 0);
+    }
+
+    /**
+     * Writes a block of len bytes into one of the output streams.
+     * Thread safe. An idle stream is picked if one is available.
+     */
+    void write_block(const char* data, size_t len) {
+      if (len == 0) return;
+      bytes_in.inc(len);
+      if (gzip) {
+        charstream compressed(len / 2 + 128);
+        {
+          boost::iostreams::filtering_stream<boost::iostreams::output> fout;
+          fout.push(boost::iostreams::gzip_compressor(
+              boost::iostreams::gzip_params(compression_level)));
+          fout.push(compressed);
+          fout.write(data, len);
+          fout.pop();
+          fout.pop();
+        }
+        compressed.flush();
+        append(compressed->c_str(), compressed->size());
+      } else {
+        append(data, len);
+      }
+    }
+
+    /// Total number of bytes passed to write_block()
+    size_t uncompressed_bytes() const { return bytes_in.value; }
+
+    /// Total number of bytes written to the output streams
+    size_t written_bytes() const { return bytes_out.value; }
+
+   private:
+    void append(const char* data, size_t len) {
+      const size_t first = next_stream.inc_ret_last() % outs.size();
+      // look for an uncontended stream before blocking on one
+      size_t target = first;
+      bool locked = false;
+      for (size_t i = 0; i < outs.size() && !locked; ++i) {
+        target = (first + i) % outs.size();
+        locked = locks[target].try_lock();
+      }
+      if (!locked) {
+        target = first;
+        locks[target].lock();
+      }
+      outs[target]->write(data, len);
+      locks[target].unlock();
+      bytes_out.inc(len);
+    }
+  }; // end of parallel_block_writer
+
+} // end of namespace graphlab
+#endif
@@ -28,6 +28,7 @@
 #include <stdint.h>
 
 
+#include <cmath>
 #include <vector>
 #include <limits>
 #include <algorithm>
@@ -313,6 +314,375 @@ namespace graphlab {
 
 
 
+    /**
+     * A counter based generator (Philox4x32-10, Salmon et al., "Parallel
+     * Random Numbers: As Easy as 1, 2, 3", SC11). The output is a pure
+     * function of the key, given by the seed, and of the counter, given
+     * by the stream, the iteration and the position in the stream. This
+     * makes the draws of a stream reproducible regardless of the thread
+     * or machine that makes them:
+     *
+     * \code
+     * // the same numbers for (seed, vertex, iteration) on any thread count
+     * random::counter_generator rng(seed, vertex.id(), iteration);
+     * double u = rng.rand01();
+     * \endcode
+     *
+     * The generator holds no lock and no shared state. Each thread, fiber
+     * or vertex program constructs its own, which costs a few words of
+     * stack. A stream produces up to 2^34 numbers per iteration before its
+     * counter wraps.
+     */
+    class counter_generator {
+    public:
+      counter_generator(const uint64_t seed_value = 0,
+                        const uint64_t stream = 0,
+                        const uint32_t iteration = 0) {
+        seed(seed_value, stream, iteration);
+      }
+
+      //! Restart the generator at the beginning of a stream
+      inline void seed(const uint64_t seed_value,
+                       const uint64_t stream = 0,
+                       const uint32_t iteration = 0) {
+        key[0] = uint32_t(seed_value);
+        key[1] = uint32_t(seed_value >> 32);
+        counter[0] = 0;
+        counter[1] = iteration;
+        counter[2] = uint32_t(stream);
+        counter[3] = uint32_t(stream >> 32);
+        position = 4;
+        has_spare = false;
+      }
+
+      //! Return the next 32 random bits
+      inline uint32_t next_uint32() {
+        if (position == 4) {
+          philox(counter, key, buffer);
+          ++counter[0];
+          position = 0;
+        }
+        return buffer[position++];
+      }
+
+      //! Return the next 64 random bits
+      inline uint64_t next_uint64() {
+        const uint64_t high = next_uint32();
+        return (high << 32) | next_uint32();
+      }
+
+      //! Generate a uniform random double in [0, 1)
+      inline double rand01() {
+        const uint32_t high = next_uint32();
+        return to_double(high, next_uint32());
+      }
+
+      /**
+       * Generate a random number in the uniform real with range [min,
+       * max) or [min, max] if the number type is discrete.
+       */
+      template<typename NumType>
+      inline NumType uniform(const NumType min, const NumType max) {
+        if (!std::numeric_limits<NumType>::is_integer) {
+          return NumType(min + (max - min) * rand01());
+        }
+        // the span of [min, max] is below 2^64, so a 64 bit multiply
+        // shift keeps the bias below 2^-64 * span.
+        const uint64_t span = uint64_t(max) - uint64_t(min) + 1;
+        if (span == 0) return NumType(next_uint64());
+        return NumType(uint64_t(min) + mulhi64(next_uint64(), span));
+      } // end of uniform
+
+      /**
+       * Generate a gaussian random variable. The Box-Muller transform
+       * yields two variables for two uniforms, and the second one is
+       * kept for the next call.
+       */
+      inline double gaussian(const double mean = double(0),
+                             const double stdev = double(1)) {
+        if (has_spare) {
+          has_spare = false;
+          return mean + stdev * spare;
+        }
+        double first;
+        box_muller(rand01(), rand01(), first, spare);
+        has_spare = true;
+        return mean + stdev * first;
+      } // end of gaussian
+
+      inline double normal(const double mean = double(0),
+                           const double stdev = double(1)) {
+        return gaussian(mean, stdev);
+      } // end of normal
+
+      inline bool bernoulli(const double p = double(0.5)) {
+        return rand01() < p;
+      } // end of bernoulli
+
+      /**
+       * Fill out[0 ... n) with uniform random doubles in [0, 1). Blocks
+       * of the stream are generated independently of each other into a
+       * local batch, which the compiler can vectorize, and the next
+       * scalar draw continues after the last block used.
+       */
+      void fill_uniform(double* out, const size_t n) {
+        size_t i = 0;
+        // drain the whole pairs left from a previous scalar draw. This
+        // stops at a block boundary, or one word before it if an odd
+        // number of words was used.
+        while (i < n && position < 3) out[i++] = rand01();
+        uint32_t batch[BATCH_BLOCKS][4];
+        if (position == 4) {
+          while (i + 2 * BATCH_BLOCKS <= n) {
+            philox_batch(batch);
+            for (size_t b = 0; b < BATCH_BLOCKS; ++b) {
+              out[i++] = to_double(batch[b][0], batch[b][1]);
+              out[i++] = to_double(batch[b][2], batch[b][3]);
+            }
+          }
+        } else if (i + 2 * BATCH_BLOCKS <= n) {
+          // each pair straddles two blocks: carry the last word of a
+          // block into the first draw of the next one
+          uint32_t carry = buffer[3];
+          while (i + 2 * BATCH_BLOCKS <= n) {
+            philox_batch(batch);
+            for (size_t b = 0; b < BATCH_BLOCKS; ++b) {
+              out[i++] = to_double(carry, batch[b][0]);
+              out[i++] = to_double(batch[b][1], batch[b][2]);
+              carry = batch[b][3];
+            }
+          }
+          // leave the carried word for the next scalar draw
+          for (size_t j = 0; j < 4; ++j) buffer[j] = batch[BATCH_BLOCKS - 1][j];
+        }
+        while (i < n) out[i++] = rand01();
+      } // end of fill_uniform
+
+      /**
+       * Fill out[0 ... n) with gaussian random variables. The uniforms
+       * are generated in bulk and paired through the Box-Muller
+       * transform.
+       */
+      void fill_gaussian(double* out, const size_t n,
+                         const double mean = double(0),
+                         const double stdev = double(1)) {
+        if (n == 0) return;
+        fill_uniform(out, n);
+        size_t i = 0;
+        for (; i + 1 < n; i += 2) {
+          double z0, z1;
+          box_muller(out[i], out[i + 1], z0, z1);
+          out[i] = mean + stdev * z0;
+          out[i + 1] = mean + stdev * z1;
+        }
+        if (i < n) out[i] = gaussian(mean, stdev);
+      } // end of fill_gaussian
+
+      /**
+       * Draw a random number from a multinomial. For repeated draws from
+       * the same distribution, an alias_table is O(1) per draw.
+       */
+      template<typename Double>
+      size_t multinomial(const std::vector<Double>& prb) {
+        ASSERT_GT(prb.size(), 0);
+        if (prb.size() == 1) { return 0; }
+        Double sum(0);
+        for(size_t i = 0; i < prb.size(); ++i) {
+          ASSERT_GE(prb[i], 0); // Each entry must be P[i] >= 0
+          sum += prb[i];
+        }
+        ASSERT_GT(sum, 0); // Normalizer must be positive
+        const Double rnd(Double(rand01()) * sum);
+        size_t ind = 0;
+        for(Double cumsum(prb[ind]);
+            rnd >= cumsum && (ind+1) < prb.size();
+            cumsum += prb[++ind]);
+        return ind;
+      } // end of multinomial
+
+      /**
+       * Generate a draw from a multinomial using a CDF.
+       */
+      template<typename Double>
+      inline size_t multinomial_cdf(const std::vector<Double>& cdf) {
+        return std::upper_bound(cdf.begin(), cdf.end(),
+                                Double(rand01())) - cdf.begin();
+      } // end of multinomial_cdf
+
+      /**
+       * Shuffle a range using the begin and end iterators
+       */
+      template<typename Iterator>
+      void shuffle(Iterator begin, Iterator end) {
+        const std::ptrdiff_t len = end - begin;
+        for (std::ptrdiff_t i = len - 1; i > 0; --i) {
+          std::iter_swap(begin + i, begin + uniform<std::ptrdiff_t>(0, i));
+        }
+      } // end of shuffle
+
+      /**
+       * Shuffle a standard vector
+       */
+      template<typename T>
+      void shuffle(std::vector<T>& vec) { shuffle(vec.begin(), vec.end()); }
+
+      /**
+       * The Philox4x32-10 block function: encrypts the counter ctr with
+       * the key and writes 128 random bits to out.
+       */
+      static inline void philox(const uint32_t ctr[4], const uint32_t k[2],
+                                uint32_t out[4]) {
+        uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+        uint32_t k0 = k[0], k1 = k[1];
+        for (size_t round = 0; round < 10; ++round) {
+          const uint64_t p0 = uint64_t(PHILOX_M0) * c0;
+          const uint64_t p1 = uint64_t(PHILOX_M1) * c2;
+          const uint32_t n0 = uint32_t(p1 >> 32) ^ c1 ^ k0;
+          const uint32_t n2 = uint32_t(p0 >> 32) ^ c3 ^ k1;
+          c1 = uint32_t(p1);
+          c3 = uint32_t(p0);
+          c0 = n0;
+          c2 = n2;
+          k0 += PHILOX_W0;
+          k1 += PHILOX_W1;
+        }
+        out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+      } // end of philox
+
+    private:
+      static const uint32_t PHILOX_M0 = 0xD2511F53;
+      static const uint32_t PHILOX_M1 = 0xCD9E8D57;
+      static const uint32_t PHILOX_W0 = 0x9E3779B9;
+      static const uint32_t PHILOX_W1 = 0xBB67AE85;
+      //! Number of blocks generated together by the bulk routines
+      static const size_t BATCH_BLOCKS = 8;
+
+      //! Generate the next BATCH_BLOCKS blocks of the stream
+      inline void philox_batch(uint32_t batch[BATCH_BLOCKS][4]) {
+        uint32_t ctr[4] = { counter[0], counter[1], counter[2], counter[3] };
+        for (size_t b = 0; b < BATCH_BLOCKS; ++b) {
+          ctr[0] = counter[0] + uint32_t(b);
+          philox(ctr, key, batch[b]);
+        }
+        counter[0] += BATCH_BLOCKS;
+      } // end of philox_batch
+
+      //! 53 random bits scaled to [0, 1)
+      static inline double to_double(const uint32_t high, const uint32_t low) {
+        const uint64_t bits =
+          ((uint64_t(high) << 32) | uint64_t(low)) >> 11;
+        return double(bits) * (1.0 / 9007199254740992.0);
+      } // end of to_double
+
+      //! The high 64 bits of the 128 bit product a * b
+      static inline uint64_t mulhi64(const uint64_t a, const uint64_t b) {
+        const uint64_t a_lo = uint32_t(a), a_hi = a >> 32;
+        const uint64_t b_lo = uint32_t(b), b_hi = b >> 32;
+        const uint64_t lo_lo = a_lo * b_lo;
+        const uint64_t hi_lo = a_hi * b_lo;
+        const uint64_t lo_hi = a_lo * b_hi;
+        const uint64_t cross = (lo_lo >> 32) + uint32_t(hi_lo) + lo_hi;
+        return a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+      } // end of mulhi64
+
+      //! Map two uniforms in [0, 1) to two independent gaussians
+      static inline void box_muller(const double u0, const double u1,
+                                    double& z0, double& z1) {
+        // 1 - u0 is in (0, 1] so that the log is finite
+        const double radius = std::sqrt(-2.0 * std::log(1.0 - u0));
+        const double theta = 6.283185307179586476925 * u1;
+        z0 = radius * std::cos(theta);
+        z1 = radius * std::sin(theta);
+      } // end of box_muller
+
+      uint32_t key[2];
+      uint32_t counter[4];
+      uint32_t buffer[4];
+      size_t position;
+      double spare;
+      bool has_spare;
+    }; // end of class counter_generator
+
+
+
+    /**
+     * An alias table (Walker's alias method, built with Vose's
+     * algorithm) for drawing from a fixed discrete distribution in
+     * constant time. Construction is linear in the number of outcomes,
+     * and each draw costs one uniform, one multiply and one comparison
+     * instead of the linear scan of multinomial() or the binary search
+     * of multinomial_cdf(). The table is read only after construction,
+     * so threads can share it and draw with their own generators.
+     */
+    class alias_table {
+    public:
+      alias_table() { }
+
+      //! Build a table from unnormalized non negative weights
+      template<typename Double>
+      explicit alias_table(const std::vector<Double>& weights) {
+        build(weights);
+      }
+
+      //! Rebuild the table from unnormalized non negative weights
+      template<typename Double>
+      void build(const std::vector<Double>& weights) {
+        const size_t n = weights.size();
+        ASSERT_GT(n, 0);
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i) {
+          ASSERT_GE(weights[i], 0); // Each entry must be P[i] >= 0
+          sum += weights[i];
+        }
+        ASSERT_GT(sum, 0); // Normalizer must be positive
+        prob.resize(n);
+        alias.resize(n);
+        std::vector<uint32_t> small, large;
+        for (size_t i = 0; i < n; ++i) {
+          prob[i] = double(weights[i]) * n / sum;
+          alias[i] = uint32_t(i);
+          if (prob[i] < 1) small.push_back(uint32_t(i));
+          else large.push_back(uint32_t(i));
+        }
+        while (!small.empty() && !large.empty()) {
+          const uint32_t s = small.back(); small.pop_back();
+          const uint32_t l = large.back();
+          alias[s] = l;
+          prob[l] -= 1 - prob[s];
+          if (prob[l] < 1) {
+            large.pop_back();
+            small.push_back(l);
+          }
+        }
+        // what is left is 1 up to rounding
+        for (size_t i = 0; i < large.size(); ++i) prob[large[i]] = 1;
+        for (size_t i = 0; i < small.size(); ++i) prob[small[i]] = 1;
+      } // end of build
+
+      //! The number of outcomes
+      inline size_t size() const { return prob.size(); }
+
+      /**
+       * Draw an outcome using a generator providing
+       * uniform<double>(0, 1), such as counter_generator or generator.
+       */
+      template<typename RNG>
+      inline size_t sample(RNG& rng) const {
+        const double u = rng.template uniform<double>(0, 1) * prob.size();
+        size_t i = size_t(u);
+        if (i >= prob.size()) i = prob.size() - 1;
+        return (u - i) < prob[i] ? i : alias[i];
+      } // end of sample
+
+    private:
+      //! Probability of keeping outcome i in bucket i
+      std::vector<double> prob;
+      //! Outcome drawn from bucket i otherwise
+      std::vector<uint32_t> alias;
+    }; // end of class alias_table
+
+
+
 
 
 
@@ -764,6 +764,21 @@ namespace graphlab {
     virtual void post_local_gather(gather_type&) const {
     }
 
+    /**
+     * \internal
+     * Computes the local part of the gather in one call instead of one
+     * gather() per edge. Called by the synchronous engine between
+     * pre_local_gather and post_local_gather with the edges returned
+     * by gather_edges. Returns true if accum was set. Returns false if
+     * there is no local edge to gather from, or to let the engine call
+     * gather() on each edge, which is the default.
+     */
+    virtual bool local_gather(icontext_type& context, const vertex_type& vertex,
+                              edge_dir_type gather_dir,
+                              gather_type& accum) const {
+      return false;
+    }
+
   };  // end of ivertex_program
  
 }; //end of namespace graphlab
@@ -25,6 +25,8 @@
 #include <graphlab/util/generics/csr_storage.hpp>
 #include <graphlab/util/generics/dynamic_csr_storage.hpp>
 #include <graphlab/util/generics/shuffle.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/util/timer.hpp>
 #include <graphlab/logger/assertions.hpp>
 
 class csr_storage_test : public CxxTest::TestSuite {  
@@ -209,8 +211,84 @@ class csr_storage_test : public CxxTest::TestSuite {
     check_dcsr(csr, nkey, nval);
     printf("+ Pass test: dynamic_csr_storage stress insertion:)\n\n");
   }
+  /**
+   * Benchmark counting_sort against the atomic counter counting sort it
+   * replaced, on keys distributed like the sources of a graph with the
+   * given average degree, and check that it is a stable sort.
+   */
+  void test_counting_sort_benchmark() {
+    counting_sort_benchmark(20000000, 10);
+    counting_sort_benchmark(20000000, 2);
+  }
+
+  void counting_sort_benchmark(size_t n, size_t degree) {
+    const size_t nkeys = n / degree;
+    std::vector<uint32_t> keys(n);
+    srand(0);
+    for (size_t i = 0; i < n; ++i) {
+      // a few keys with large degree
+      keys[i] = (i % 16 == 0) ? rand() % 64 : rand() % nkeys;
+    }
+    std::vector<size_t> permute, prefix, expected_permute, expected_prefix;
+    graphlab::timer ti;
+    ti.start();
+    atomic_counting_sort(keys, expected_permute, &expected_prefix);
+    const double atomic_time = std::max(ti.current_time(), 1E-6);
+    ti.start();
+    graphlab::counting_sort(keys, permute, &prefix);
+    const double time = std::max(ti.current_time(), 1E-6);
+
+    ASSERT_TRUE(prefix == expected_prefix);
+    for (size_t i = 1; i < n; ++i) {
+      const uint32_t prev = keys[permute[i - 1]];
+      const uint32_t cur = keys[permute[i]];
+      ASSERT_LE(prev, cur);
+      if (prev == cur) ASSERT_LT(permute[i - 1], permute[i]);
+    }
+
+    std::vector<uint32_t> values(n), sorted_values;
+    for (size_t i = 0; i < n; ++i) values[i] = i;
+    ti.start();
+    graphlab::counting_sort_values(keys, values, sorted_values, &prefix);
+    const double values_time = std::max(ti.current_time(), 1E-6);
+    for (size_t i = 0; i < n; ++i) ASSERT_EQ(sorted_values[i], permute[i]);
+
+    std::cout << n << " keys, degree " << degree << ": atomic counting sort "
+              << n / atomic_time / 1000000 << "M keys/s, counting_sort "
+              << n / time / 1000000 << "M keys/s, counting_sort_values "
+              << n / values_time / 1000000 << "M keys/s" << std::endl;
+  }
 
  private:
+  /// The counting sort with shared atomic counters, as a baseline
+  template <typename valuetype, typename sizetype>
+  void atomic_counting_sort(const std::vector<valuetype>& value_vec,
+                            std::vector<sizetype>& permute_index,
+                            std::vector<sizetype>* prefix_array) {
+    valuetype maxval = *std::max_element(value_vec.begin(), value_vec.end());
+    std::vector< graphlab::atomic<size_t> > counter_array(maxval+1);
+    permute_index.assign(value_vec.size(), 0);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (ssize_t i = 0; i < ssize_t(value_vec.size()); ++i) {
+      counter_array[value_vec[i]].inc();
+    }
+    for (size_t i = 1; i < counter_array.size(); ++i) {
+      counter_array[i] += counter_array[i-1];
+    }
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (ssize_t i = 0; i < ssize_t(value_vec.size()); ++i) {
+      permute_index[counter_array[value_vec[i]].dec()] = i;
+    }
+    prefix_array->resize(counter_array.size());
+    for (size_t i = 0; i < counter_array.size(); ++i) {
+      (*prefix_array)[i] = counter_array[i];
+    }
+  }
+
   template<typename csr_type>
       void check(csr_type& csr,
                  std::vector<keytype> keyout,
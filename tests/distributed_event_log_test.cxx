@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <boost/bind.hpp>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/rpc/distributed_event_log.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+
+using namespace graphlab;
+
+void increment_event(size_t entry, size_t count) {
+  for (size_t i = 0; i < count; ++i) INCREMENT_EVENT(entry, 1);
+}
+
+void decrement_event(size_t entry, size_t count) {
+  for (size_t i = 0; i < count; ++i) DECREMENT_EVENT(entry, 1);
+}
+
+
+class DistributedEventLogTest: public CxxTest::TestSuite {
+ public:
+  void test_instantaneous_across_threads() {
+    distributed_control dc;
+    size_t pending;
+    ADD_INSTANTANEOUS_EVENT(pending, "Test Pending", "Vertices");
+    distributed_event_logger& evlog = get_event_log();
+    TS_ASSERT_EQUALS(evlog.sum_thread_counts(pending), 0);
+    // added on one thread and removed on another
+    thread_group group;
+    group.launch(boost::bind(increment_event, pending, 1000));
+    group.join();
+    group.launch(boost::bind(decrement_event, pending, 993));
+    group.join();
+    TS_ASSERT_EQUALS(evlog.sum_thread_counts(pending), 7);
+    decrement_event(pending, 7);
+    TS_ASSERT_EQUALS(evlog.sum_thread_counts(pending), 0);
+    // a transient negative total reads as negative
+    decrement_event(pending, 3);
+    TS_ASSERT_EQUALS(evlog.sum_thread_counts(pending), -3);
+    increment_event(pending, 3);
+  }
+};
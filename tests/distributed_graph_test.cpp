@@ -22,7 +22,9 @@
 
 // standard C++ headers
 #include <iostream>
+#include <fstream>
 #include <vector>
+#include <algorithm>
 #include <cxxtest/TestSuite.h>
 
 
@@ -124,7 +126,280 @@ class distributed_graph_test  {
      dc->cout() << "\n+ Pass test: graph save load binary. :) \n";
    }
 
+   /**
+    * Test saving and loading the columnar binary format
+    */
+   void test_save_load_columnar() {
+     typedef graphlab::distributed_graph<vertex_data, edge_data> graph_type;
+     graph_type g(*dc);
+     // enough in edges per vertex range to split the edge row groups
+     const size_t nverts = 100000;
+     for (size_t i = dc->procid(); i < nverts; i += dc->numprocs()) {
+       const size_t next = (i + 1) % nverts, opposite = (i + nverts / 2) % nverts;
+       g.add_vertex(i, vertex_data(3 * i));
+       g.add_edge(i, next, edge_data(i, next));
+       g.add_edge(i, opposite, edge_data(i, opposite));
+     }
+     g.finalize();
+
+     using namespace boost::filesystem;
+     for (size_t gzip = 0; gzip < 2; ++gzip) {
+       // all machines save to and load from the directory of machine 0
+       std::string dir = unique_path().string();
+       dc->broadcast(dir, dc->procid() == 0);
+       path ph = dir;
+       bool created = dc->procid() == 0 && create_directory(ph);
+       dc->broadcast(created, dc->procid() == 0);
+       if (!created) continue;
+       path prefix = ph;
+       prefix /= "test";
+       g.save_format(prefix.string(), "bincol", gzip);
+       if (dc->procid() == 0) {
+         // a row group without rows is skipped
+         const uint32_t header[4] = {0, sizeof(graphlab::vertex_id_type),
+                                     sizeof(vertex_data), 0};
+         const uint64_t nrows = 0;
+         std::ofstream fout((prefix.string() + ".empty.bincol").c_str(),
+                            std::ios_base::out | std::ios_base::binary);
+         fout.write(reinterpret_cast<const char*>(header), sizeof(header));
+         fout.write(reinterpret_cast<const char*>(&nrows), sizeof(nrows));
+       }
+       dc->barrier();
+       graph_type g2(*dc);
+       g2.load_format(prefix.string(), "bincol");
+       g2.finalize();
+       ASSERT_EQ(g2.num_vertices(), nverts);
+       ASSERT_EQ(g2.num_edges(), 2 * nverts);
+       for (size_t i = 0; i < g2.num_local_vertices(); ++i) {
+         ASSERT_EQ(g2.l_vertex(i).data().value, 3 * g2.global_vid(i));
+       }
+       check_edge_data(g2);
+       check_vertex_info(g2);
+       dc->barrier();
+       if (dc->procid() == 0) remove_all(ph);
+     }
+     dc->cout() << "\n+ Pass test: graph save load columnar. :) \n";
+   }
+
+   /**
+    * Test copying the topology into a graph with other data types, and
+    * compare its time with the ingress of the same graph.
+    */
+   void test_copy_topology() {
+     typedef graphlab::distributed_graph<vertex_data, edge_data> graph_type;
+     typedef graphlab::distributed_graph<double, graphlab::empty> view_type;
+     graph_type g(*dc);
+     const size_t nverts = 100000;
+     graphlab::timer ti; ti.start();
+     srand(dc->procid());
+     for (size_t i = 0; i < 10 * nverts / dc->numprocs(); ++i) {
+       const size_t src = rand() % nverts;
+       const size_t dst = rand() % nverts;
+       if (src != dst) g.add_edge(src, dst, edge_data(src, dst));
+     }
+     g.finalize();
+     const double ingress_time = ti.current_time();
+
+     ti.start();
+     view_type view(*dc, g);
+     const double copy_time = ti.current_time();
+     ASSERT_TRUE(view.is_finalized());
+     ASSERT_EQ(view.num_vertices(), g.num_vertices());
+     ASSERT_EQ(view.num_edges(), g.num_edges());
+     ASSERT_EQ(view.num_local_vertices(), g.num_local_vertices());
+     for (size_t i = 0; i < g.num_local_vertices(); ++i) {
+       ASSERT_TRUE(g.l_get_vertex_record(i) == view.l_get_vertex_record(i));
+       ASSERT_EQ(view.local_vid(g.global_vid(i)), i);
+       ASSERT_EQ(g.l_in_edges(i).size(), view.l_in_edges(i).size());
+       ASSERT_EQ(g.l_out_edges(i).size(), view.l_out_edges(i).size());
+       // the view has no edge data, so its out edges are sorted by target
+       std::vector<graphlab::lvid_type> targets, view_targets;
+       for (size_t j = 0; j < g.l_out_edges(i).size(); ++j) {
+         targets.push_back(g.l_out_edges(i)[j].target().lvid);
+         view_targets.push_back(view.l_out_edges(i)[j].target().lvid);
+       }
+       std::sort(targets.begin(), targets.end());
+       std::sort(view_targets.begin(), view_targets.end());
+       ASSERT_TRUE(targets == view_targets);
+     }
+     check_vertex_info(view);
+
+     // a second stage with edge data again
+     graph_type g2(*dc, view);
+     g2.transform_edges(set_edge_data);
+     check_edge_data(g2);
+     dc->cout() << "Ingress: " << ingress_time << " secs, topology copy: "
+                << copy_time << " secs" << std::endl;
+     dc->cout() << "\n+ Pass test: graph copy topology. :) \n";
+   }
+
+   /**
+    * Test extracting an induced subgraph, and compare its time with a
+    * save and a filtered reload of the same subgraph.
+    */
+   void test_extract_subgraph() {
+     typedef graphlab::distributed_graph<vertex_data, edge_data> graph_type;
+     graph_type g(*dc);
+     const size_t nverts = 100000;
+     srand(dc->procid());
+     for (size_t i = dc->procid(); i < nverts; i += dc->numprocs()) {
+       g.add_vertex(i, vertex_data(i));
+     }
+     for (size_t i = 0; i < 10 * nverts / dc->numprocs(); ++i) {
+       const size_t src = rand() % nverts;
+       const size_t dst = rand() % nverts;
+       if (src != dst) g.add_edge(src, dst, edge_data(src, dst));
+     }
+     g.finalize();
+
+     graphlab::timer ti; ti.start();
+     graph_type sub(*dc);
+     g.extract_subgraph(sub, keep_vertex, keep_edge);
+     const double extract_time = ti.current_time();
+
+     size_t expected_edges = 0;
+     for (size_t i = 0; i < g.num_local_vertices(); ++i) {
+       foreach(const graph_type::local_edge_type& e,
+               g.l_vertex(i).out_edges()) {
+         if (keep_vertex_id(e.source().global_id()) &&
+             keep_vertex_id(e.target().global_id()) &&
+             e.source().global_id() < e.target().global_id()) {
+           ++expected_edges;
+         }
+       }
+     }
+     dc->all_reduce(expected_edges);
+     ASSERT_EQ(sub.num_edges(), expected_edges);
+     ASSERT_EQ(sub.num_vertices(), g.vertex_set_size(g.select(keep_vertex)));
+     for (size_t i = 0; i < sub.num_local_vertices(); ++i) {
+       ASSERT_TRUE(keep_vertex_id(sub.global_vid(i)));
+       ASSERT_EQ(sub.l_vertex(i).data().value, sub.global_vid(i));
+     }
+     check_edge_data(sub);
+     check_vertex_info(sub);
+
+     // the same edges through a save and a filtered reload
+     using namespace boost::filesystem;
+     // all machines save to and load from the directory of machine 0
+     std::string dir = unique_path().string();
+     dc->broadcast(dir, dc->procid() == 0);
+     path ph = dir;
+     bool created = dc->procid() == 0 && create_directory(ph);
+     dc->broadcast(created, dc->procid() == 0);
+     if (created) {
+       path prefix = ph;
+       prefix /= "test";
+       ti.start();
+       g.save_format(prefix.string(), "tsv", false);
+       dc->barrier();
+       graph_type reloaded(*dc);
+       reloaded.load(prefix.string(), filtered_parser);
+       reloaded.finalize();
+       const double reload_time = ti.current_time();
+       ASSERT_EQ(reloaded.num_edges(), expected_edges);
+       dc->cout() << "Subgraph extraction: " << extract_time
+                  << " secs, save and filtered reload: " << reload_time
+                  << " secs" << std::endl;
+       dc->barrier();
+       if (dc->procid() == 0) remove_all(ph);
+     }
+     dc->cout() << "\n+ Pass test: graph extract subgraph. :) \n";
+   }
+
+   /**
+    * Test the R-MAT and LFR generators
+    */
+   void test_synthetic_generators() {
+     typedef graphlab::distributed_graph<vertex_data, edge_data> graph_type;
+     const size_t scale = 12, edge_factor = 8;
+     graph_type g(*dc);
+     graphlab::timer ti; ti.start();
+     g.load_synthetic_rmat(scale, edge_factor, 0.57, 0.19, 0.19, 3);
+     g.finalize();
+     const double rmat_time = ti.current_time();
+     ASSERT_LE(g.num_vertices(), size_t(1) << scale);
+     // only the self edges are dropped
+     ASSERT_LE(g.num_edges(), edge_factor << scale);
+     ASSERT_GT(g.num_edges(), (edge_factor << scale) * 9 / 10);
+     // the same arguments give the same graph
+     graph_type g2(*dc);
+     g2.load_synthetic_rmat(scale, edge_factor, 0.57, 0.19, 0.19, 3);
+     g2.finalize();
+     ASSERT_EQ(g.num_edges(), g2.num_edges());
+     ASSERT_EQ(g.map_reduce_edges<size_t>(edge_hash),
+               g2.map_reduce_edges<size_t>(edge_hash));
+
+     const size_t nverts = 10000;
+     const double mixing = 0.2;
+     graph_type lfr(*dc);
+     ti.start();
+     const std::vector<size_t> communities =
+       lfr.load_synthetic_lfr(nverts, 5, 50, 2.5, 20, 200, 1.5, mixing, 3);
+     lfr.finalize();
+     const double lfr_time = ti.current_time();
+     ASSERT_EQ(communities.front(), 0);
+     ASSERT_EQ(communities.back(), nverts);
+     for (size_t i = 1; i < communities.size(); ++i) {
+       ASSERT_GE(communities[i] - communities[i - 1], 20);
+     }
+     ASSERT_EQ(lfr.num_vertices(), nverts);
+     const size_t intra_edges = lfr.map_reduce_edges<size_t>(
+         boost::bind(intra_community_edge, _1, boost::cref(communities)));
+     const double intra_fraction = double(intra_edges) / lfr.num_edges();
+     ASSERT_GT(intra_fraction, 1 - mixing - 0.05);
+     ASSERT_LT(intra_fraction, 1 - mixing + 0.05);
+     dc->cout() << "R-MAT: " << g.num_edges() << " edges in " << rmat_time
+                << " secs, LFR: " << lfr.num_edges() << " edges in "
+                << lfr_time << " secs" << std::endl;
+     dc->cout() << "\n+ Pass test: graph synthetic generators. :) \n";
+   }
+
  private: 
+   static bool keep_vertex_id(size_t vid) {
+     return vid % 3 != 0;
+   }
+
+   static bool keep_vertex(
+       const graphlab::distributed_graph<vertex_data, edge_data>::vertex_type& v) {
+     return keep_vertex_id(v.id());
+   }
+
+   static bool keep_edge(
+       const graphlab::distributed_graph<vertex_data, edge_data>::edge_type& e) {
+     return e.source().id() < e.target().id();
+   }
+
+   static bool filtered_parser(
+       graphlab::distributed_graph<vertex_data, edge_data>& graph,
+       const std::string& filename, const std::string& line) {
+     std::stringstream strm(line);
+     size_t src, dst;
+     strm >> src >> dst;
+     if (keep_vertex_id(src) && keep_vertex_id(dst) && src < dst) {
+       graph.add_edge(src, dst, edge_data(src, dst));
+     }
+     return true;
+   }
+
+   static size_t edge_hash(
+       const graphlab::distributed_graph<vertex_data, edge_data>::edge_type& e) {
+     return e.source().id() * 2654435761u + e.target().id();
+   }
+
+   static size_t intra_community_edge(
+       const graphlab::distributed_graph<vertex_data, edge_data>::edge_type& e,
+       const std::vector<size_t>& communities) {
+     return std::upper_bound(communities.begin(), communities.end(),
+                             e.source().id()) ==
+            std::upper_bound(communities.begin(), communities.end(),
+                             e.target().id());
+   }
+
+   static void set_edge_data(
+       graphlab::distributed_graph<vertex_data, edge_data>::edge_type& e) {
+     e.data() = edge_data(e.source().id(), e.target().id());
+   }
+
    template<typename Graph>
        void test_add_vertex_impl(Graph& g, size_t nverts) {
          g.clear();
@@ -416,7 +691,7 @@ class distributed_graph_test  {
            info.num_in_edges = v.num_in_edges();
            info.num_out_edges = v.num_out_edges();
            info.data = v.data();
-           info.mirrors = lv.mirrors();
+           info.mirrors = g.l_get_vertex_record(i).mirrors();
            info.master = lv.owner();
            // master should not be in the mirror set
            ASSERT_TRUE(info.mirrors.get(info.master) == 0);
@@ -506,6 +781,10 @@ int main(int argc, char** argv) {
   testsuit.test_add_edge();
   testsuit.test_dynamic_add_edge();
   testsuit.test_save_load();
+  testsuit.test_save_load_columnar();
+  testsuit.test_copy_topology();
+  testsuit.test_extract_subgraph();
+  testsuit.test_synthetic_generators();
 
   delete(dc);
   graphlab::mpi_tools::finalize();
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/util/first_touch_array.hpp>
+#include <graphlab/util/empty.hpp>
+using namespace graphlab;
+
+// counts live instances to check that every element is destroyed
+struct counted {
+  static int live;
+  std::vector<int> payload;
+  counted(): payload(3, 1) { __sync_fetch_and_add(&live, 1); }
+  counted(const counted& other): payload(other.payload) {
+    __sync_fetch_and_add(&live, 1);
+  }
+  ~counted() { __sync_fetch_and_sub(&live, 1); }
+};
+int counted::live = 0;
+
+class FirstTouchArrayTestSuite : public CxxTest::TestSuite {
+public:
+  void test_resize(void) {
+    first_touch_array<size_t> a;
+    TS_ASSERT(a.empty());
+    a.resize(100000, 7);
+    TS_ASSERT_EQUALS(a.size(), 100000);
+    for (size_t i = 0; i < a.size(); ++i) {
+      TS_ASSERT_EQUALS(a[i], 7);
+      a[i] = i;
+    }
+    // growing keeps the existing elements
+    a.resize(200000, 3);
+    for (size_t i = 0; i < 100000; ++i) TS_ASSERT_EQUALS(a[i], i);
+    for (size_t i = 100000; i < 200000; ++i) TS_ASSERT_EQUALS(a[i], 3);
+    // and so does shrinking
+    a.resize(10);
+    TS_ASSERT_EQUALS(a.size(), 10);
+    for (size_t i = 0; i < 10; ++i) TS_ASSERT_EQUALS(a[i], i);
+    a.clear();
+    TS_ASSERT(a.empty());
+  }
+
+  void test_lifetime(void) {
+    {
+      first_touch_array<counted> a;
+      a.resize(5000);
+      TS_ASSERT_EQUALS(counted::live, 5000);
+      TS_ASSERT_EQUALS(a[4999].payload.size(), 3);
+      a.resize(100);
+      TS_ASSERT_EQUALS(counted::live, 100);
+      first_touch_array<counted> b;
+      b.swap(a);
+      TS_ASSERT(a.empty());
+      TS_ASSERT_EQUALS(b.size(), 100);
+    }
+    TS_ASSERT_EQUALS(counted::live, 0);
+  }
+
+  void test_empty_type(void) {
+    first_touch_array<graphlab::empty> a;
+    a.resize(size_t(1) << 40);
+    TS_ASSERT_EQUALS(a.size(), size_t(1) << 40);
+    TS_ASSERT_EQUALS(&a[0], &a[12345]);
+    a.clear();
+    TS_ASSERT(a.empty());
+  }
+};
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <iostream>
+#include <cstdlib>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/util/timer.hpp>
+#include <graphlab/util/empty.hpp>
+#include <graphlab/graph/distributed_graph.hpp>
+#include <graphlab/graph/graph_contraction.hpp>
+#include <graphlab/macros_def.hpp>
+using namespace graphlab;
+
+typedef distributed_graph<empty, empty> graph_type;
+typedef distributed_graph<size_t, double> coarse_graph_type;
+
+const size_t NUM_VERTICES = 1000000;
+const size_t EDGES_PER_VERTEX = 8;
+const size_t CLUSTER_SIZE = 100;
+
+vertex_id_type cluster(const graph_type::vertex_type& vtx) {
+  return vtx.id() / CLUSTER_SIZE;
+}
+
+size_t one_vertex(const graph_type::vertex_type& vtx) {
+  return 1;
+}
+
+void add_vertices(size_t& acc, const size_t& other) {
+  acc += other;
+}
+
+double unit_weight(const graph_type::edge_type& edge) {
+  return 1;
+}
+
+void add_weights(double& acc, const double& other) {
+  acc += other;
+}
+
+int main(int argc, char** argv) {
+  mpi_tools::init(argc, argv);
+  distributed_control dc;
+
+  // random edges, mostly within a cluster of nearby vertex ids
+  graph_type graph(dc);
+  srand(dc.procid());
+  for (size_t i = dc.procid(); i < NUM_VERTICES; i += dc.numprocs()) {
+    for (size_t j = 0; j < EDGES_PER_VERTEX; ++j) {
+      const size_t target = j == 0 ? rand() % NUM_VERTICES :
+          (i + 1 + rand() % (2 * CLUSTER_SIZE)) % NUM_VERTICES;
+      if (target != i) graph.add_edge(i, target);
+    }
+  }
+  graph.finalize();
+
+  coarse_graph_type coarse(dc);
+  graph_contraction<graph_type, coarse_graph_type> contraction(dc, graph,
+                                                               coarse);
+  timer ti; ti.start();
+  contraction.contract(cluster, one_vertex, add_vertices,
+                       unit_weight, add_weights);
+  const double runtime = std::max(ti.current_time(), 1E-6);
+  ASSERT_EQ(coarse.num_vertices(), NUM_VERTICES / CLUSTER_SIZE);
+
+  // every coarse vertex counts its vertices, and the weights count the
+  // edges between clusters
+  for (size_t i = 0; i < coarse.num_local_vertices(); ++i) {
+    if (coarse.l_vertex(i).owned()) {
+      ASSERT_EQ(coarse.l_vertex(i).data(), CLUSTER_SIZE);
+    }
+  }
+  size_t expected = 0;
+  for (size_t i = 0; i < graph.num_local_vertices(); ++i) {
+    foreach(const graph_type::local_edge_type& e,
+            graph.l_vertex(i).out_edges()) {
+      if (e.source().global_id() / CLUSTER_SIZE !=
+          e.target().global_id() / CLUSTER_SIZE) {
+        ++expected;
+      }
+    }
+  }
+  double weights = 0;
+  for (size_t i = 0; i < coarse.num_local_vertices(); ++i) {
+    foreach(const coarse_graph_type::local_edge_type& e,
+            coarse.l_vertex(i).out_edges()) {
+      weights += e.data();
+    }
+  }
+  dc.all_reduce(expected);
+  dc.all_reduce(weights);
+  ASSERT_EQ(size_t(weights), expected);
+  dc.cout() << "Contracted " << graph.num_edges() << " edges into "
+            << coarse.num_edges() << " edges in " << runtime << "s ("
+            << graph.num_edges() / runtime << " edges/s)" << std::endl;
+  dc.cout() << "\n+ Pass test: graph contraction. :) \n";
+  mpi_tools::finalize();
+}
+
+#include <graphlab/macros_undef.hpp>
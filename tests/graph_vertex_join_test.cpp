@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#include <iostream>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/util/timer.hpp>
+#include <graphlab/util/empty.hpp>
+#include <graphlab/graph/distributed_graph.hpp>
+#include <graphlab/graph/graph_vertex_join.hpp>
+#include <graphlab/macros_def.hpp>
+using namespace graphlab;
+
+struct user_data: public IS_POD_TYPE {
+  size_t user;
+  size_t num_sessions;
+  user_data(size_t user = 0): user(user), num_sessions(0) { }
+};
+
+struct session_data: public IS_POD_TYPE {
+  size_t user;
+  size_t count;
+  session_data(size_t user = 0): user(user), count(1) { }
+};
+
+typedef distributed_graph<user_data, empty> user_graph_type;
+typedef distributed_graph<session_data, empty> session_graph_type;
+
+const size_t NUM_USERS = 100000;
+const size_t USER_COPIES = 4;
+const size_t SESSIONS_PER_USER = 10;
+
+size_t emit_user(const user_graph_type::vertex_type& vtx) {
+  return vtx.data().user;
+}
+
+size_t emit_session_user(const session_graph_type::vertex_type& vtx) {
+  return vtx.data().user;
+}
+
+void add_counts(session_data& acc, const session_data& other) {
+  acc.count += other.count;
+}
+
+void set_count(user_graph_type::vertex_type& vtx, const session_data& s) {
+  vtx.data().num_sessions = s.count;
+}
+
+void keep_first(user_data& acc, const user_data& other) { }
+
+void mark_session(session_graph_type::vertex_type& vtx, const user_data& u) {
+  vtx.data().count = 0;
+}
+
+int main(int argc, char** argv) {
+  mpi_tools::init(argc, argv);
+  distributed_control dc;
+
+  // USER_COPIES user vertices per user id, SESSIONS_PER_USER sessions per
+  // user id. Only even user ids have sessions.
+  user_graph_type users(dc);
+  session_graph_type sessions(dc);
+  for (size_t i = dc.procid(); i < NUM_USERS * USER_COPIES; i += dc.numprocs()) {
+    users.add_vertex(i, user_data(i % NUM_USERS));
+  }
+  for (size_t i = dc.procid(); i < NUM_USERS * SESSIONS_PER_USER;
+       i += dc.numprocs()) {
+    if ((i % NUM_USERS) % 2 == 0) {
+      sessions.add_vertex(i, session_data(i % NUM_USERS));
+    }
+  }
+  users.finalize();
+  sessions.finalize();
+
+  graph_vertex_join<user_graph_type, session_graph_type> vjoin(dc, users,
+                                                               sessions);
+  timer ti; ti.start();
+  vjoin.prepare_join(emit_user, emit_session_user);
+  vjoin.left_join(set_count, add_counts);
+  const double runtime = ti.current_time();
+  for (size_t i = 0; i < users.num_local_vertices(); ++i) {
+    const user_data& data = users.l_vertex(i).data();
+    if (data.user % 2 == 0) {
+      ASSERT_EQ(data.num_sessions, SESSIONS_PER_USER);
+    } else {
+      ASSERT_EQ(data.num_sessions, 0);
+    }
+  }
+  // every session of a user is marked
+  vjoin.right_join(mark_session, keep_first);
+  for (size_t i = 0; i < sessions.num_local_vertices(); ++i) {
+    ASSERT_EQ(sessions.l_vertex(i).data().count, 0);
+  }
+  dc.cout() << "Joined " << users.num_vertices() << " x " 
+            << sessions.num_vertices() << " vertices in " << runtime << "s ("
+            << (users.num_vertices() + sessions.num_vertices()) / runtime
+            << " keys/s)" << std::endl;
+  dc.cout() << "\n+ Pass test: graph vertex join. :) \n";
+  mpi_tools::finalize();
+}
+
+#include <graphlab/macros_undef.hpp>
@@ -159,6 +159,51 @@ void hopscotch_high_collision_sanity_checks() {
 
 
 
+void hopscotch_bulk_sanity_checks() {
+  const size_t NINS = 1500000;
+  std::vector<std::pair<uint32_t, uint32_t> > pairs;
+  for (size_t i = 0;i < NINS; ++i) {
+    pairs.push_back(std::make_pair(17 * i, i));
+  }
+  std::random_shuffle(pairs.begin(), pairs.end());
+  graphlab::hopscotch_map<uint32_t, uint32_t> cm;
+  // some keys already present with a different value
+  for (size_t i = 0;i < 1000; ++i) {
+    cm[17 * i] = -1;
+  }
+  cm.bulk_insert(pairs.begin(), pairs.end());
+  ASSERT_EQ(cm.size(), NINS);
+
+  std::vector<uint32_t> keys;
+  for (size_t i = 0;i < 2 * NINS; ++i) keys.push_back(17 * i);
+  std::vector<graphlab::hopscotch_map<uint32_t, uint32_t>::const_iterator> 
+      results(keys.size());
+  cm.find_batch(&(keys[0]), keys.size(), &(results[0]));
+  for (size_t i = 0;i < keys.size(); ++i) {
+    if (i < NINS) {
+      ASSERT_TRUE(results[i] != cm.end());
+      ASSERT_EQ(results[i]->second, i);
+    } else {
+      ASSERT_TRUE(results[i] == cm.end());
+    }
+  }
+
+  // every key in one neighbourhood: most of them spill
+  graphlab::hopscotch_map<uint32_t, uint32_t, bad_hasher> bm;
+  bm.bulk_insert(pairs.begin(), pairs.begin() + 10000);
+  ASSERT_EQ(bm.size(), 10000);
+  for (size_t i = 0;i < 10000; ++i) {
+    ASSERT_EQ(bm[pairs[i].first], pairs[i].second);
+  }
+}
+
+
+
+void report(const std::string& name, size_t n, double time) {
+  std::cout << name << ": " << n / 1000000 << "M in " << time << "s ("
+            << n / std::max(time, 1E-6) / 1000000 << "M/s)" << std::endl;
+}
+
 void benchmark() {
   graphlab::timer ti;
 
@@ -171,6 +216,8 @@ void benchmark() {
     u += 1 + rand() % 8;
   }
   std::random_shuffle(v.begin(), v.end());
+  std::vector<std::pair<uint32_t, uint32_t> > pairs(NUM_ELS);
+  for (size_t i = 0;i < NUM_ELS; ++i) pairs[i] = std::make_pair(v[i], i);
   graphlab::memory_info::print_usage();
 
   {
@@ -179,16 +226,17 @@ void benchmark() {
     for (size_t i = 0;i < NUM_ELS; ++i) {
       um[v[i]] = i;
     }
-    std::cout <<  NUM_ELS / 1000000 << "M unordered map inserts in " << ti.current_time() << " (Load factor = " << um.load_factor() << ")" << std::endl;
+    report("unordered map inserts", NUM_ELS, ti.current_time());
+    std::cout << "Load factor = " << um.load_factor() << std::endl;
 
     graphlab::memory_info::print_usage();
 
     ti.start();
-    for (size_t i = 0;i < 10000000; ++i) {
+    for (size_t i = 0;i < NUM_ELS; ++i) {
       size_t t = um[v[i]];
       assert(t == i);
     }
-    std::cout << "10M unordered map successful probes in " << ti.current_time() << std::endl;
+    report("unordered map successful probes", NUM_ELS, ti.current_time());
     um.clear();
   }
 
@@ -202,19 +250,20 @@ void benchmark() {
   //    if (i % 1000000 == 0) std::cout << cm.load_factor() << std::endl;
 
     }
-    std::cout << NUM_ELS / 1000000 << "M cuckoo map pow2 inserts in " << ti.current_time() << " (Load factor = " << cm.load_factor() << ")" << std::endl;
+    report("cuckoo map pow2 inserts", NUM_ELS, ti.current_time());
+    std::cout << "Load factor = " << cm.load_factor() << std::endl;
 
     graphlab::memory_info::print_usage();
 
     ti.start();
-    for (size_t i = 0;i < 10000000; ++i) {
+    for (size_t i = 0;i < NUM_ELS; ++i) {
       size_t t = cm[v[i]];
       assert(t == i);
     }
-    std::cout << "10M cuckoo map pow2 successful probes in " << ti.current_time() << std::endl;
+    report("cuckoo map pow2 successful probes", NUM_ELS, ti.current_time());
   }
 
-{
+  {
     graphlab::hopscotch_map<uint32_t, uint32_t> cm;
     ti.start();
     for (size_t i = 0;i < NUM_ELS; ++i) {
@@ -222,17 +271,35 @@ void benchmark() {
 //      if (i % 1000000 == 0) std::cout << cm.load_factor() << std::endl;
 
     }
-    std::cout << NUM_ELS / 1000000 << "M hopscotch inserts in " << ti.current_time() << " (Load factor = " << cm.load_factor() << ")" << std::endl;
+    report("hopscotch inserts", NUM_ELS, ti.current_time());
+    std::cout << "Load factor = " << cm.load_factor() << std::endl;
 
     graphlab::memory_info::print_usage();
 
     ti.start();
-    for (size_t i = 0;i < 10000000; ++i) {
+    for (size_t i = 0;i < NUM_ELS; ++i) {
       size_t t = cm[v[i]];
       assert(t == i);
     }
-    std::cout << "10M hopscotch successful probes in " << ti.current_time() << std::endl;
+    report("hopscotch successful probes", NUM_ELS, ti.current_time());
+  }
 
+  {
+    graphlab::hopscotch_map<uint32_t, uint32_t> cm;
+    ti.start();
+    cm.bulk_insert(pairs.begin(), pairs.end());
+    report("hopscotch bulk inserts", NUM_ELS, ti.current_time());
+    std::cout << "Load factor = " << cm.load_factor() << std::endl;
+    ASSERT_EQ(cm.size(), NUM_ELS);
+
+    std::vector<graphlab::hopscotch_map<uint32_t, uint32_t>::const_iterator>
+        results(NUM_ELS);
+    ti.start();
+    cm.find_batch(&(v[0]), NUM_ELS, &(results[0]));
+    report("hopscotch batch successful probes", NUM_ELS, ti.current_time());
+    for (size_t i = 0;i < NUM_ELS; ++i) {
+      ASSERT_EQ(results[i]->second, i);
+    }
   }
 }
 
@@ -245,6 +312,9 @@ int main(int argc, char** argv) {
   std::cout << "Hopscotch High Collision Sanity Checks... \n";
   hopscotch_high_collision_sanity_checks();
 
+  std::cout << "Hopscotch Bulk Insert Sanity Checks... \n";
+  hopscotch_bulk_sanity_checks();
+
   std::cout << "Map Benchmarks... \n";
   benchmark();
   std::cout << "Done" << std::endl;
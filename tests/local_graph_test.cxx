@@ -29,6 +29,9 @@
 #include <graphlab/graph/local_graph.hpp>
 #include <graphlab/graph/dynamic_local_graph.hpp>
 #include <graphlab/util/random.hpp>
+#include <graphlab/util/empty.hpp>
+#include <graphlab/util/timer.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
 #include <graphlab/macros_def.hpp>
 
 /**
@@ -36,13 +39,13 @@
  */
 class local_graph_test : public CxxTest::TestSuite {
 public:
-  struct vertex_data {
+  struct vertex_data : public graphlab::IS_POD_TYPE {
     size_t value;
     vertex_data() : value(0) { }
     vertex_data(size_t n) : value(n) { }
   };
 
-  struct edge_data { 
+  struct edge_data : public graphlab::IS_POD_TYPE { 
     int from; 
     int to;
     edge_data (int f = 0, int t = 0) : from(f), to(t) {}
@@ -131,6 +134,235 @@ public:
     std::cout << "\n+ Pass test: grid dynamic graph test. :) \n";
   }
 
+  void test_compressed_adjacency() {
+    graphlab::local_graph<vertex_data, edge_data> g;
+    g.set_compressed_adjacency(true);
+    test_add_edge_impl(g, 10000);
+    g.clear();
+    test_sparse_graph_impl(g);
+    test_grid_graph_impl(g);
+    test_powerlaw_graph_impl(g, 10000);
+    // save and load through the uncompressed archive format
+    std::stringstream strm;
+    graphlab::oarchive oarc(strm);
+    oarc << g;
+    graphlab::local_graph<vertex_data, edge_data> g2, g3;
+    g2.set_compressed_adjacency(true);
+    graphlab::iarchive iarc(strm);
+    iarc >> g2;
+    std::stringstream strm2(strm.str());
+    graphlab::iarchive iarc2(strm2);
+    iarc2 >> g3;
+    ASSERT_EQ(g2.num_edges(), g.num_edges());
+    for (size_t i = 0; i < g.num_vertices(); ++i) {
+      ASSERT_EQ(g2.num_in_edges(i), g.num_in_edges(i));
+      ASSERT_EQ(g3.num_out_edges(i), g.num_out_edges(i));
+    }
+    check_edge_data(g2);
+    check_edge_data(g3);
+    std::cout << "\n+ Pass test: compressed adjacency. :) \n";
+
+    // compare memory and gather throughput with the csr layout
+    typedef graphlab::local_graph<vertex_data, graphlab::empty> empty_graph;
+    for (size_t compress = 0; compress < 2; ++compress) {
+      empty_graph pg;
+      pg.set_compressed_adjacency(compress);
+      const size_t nverts = 200000;
+      graphlab::random::seed(0);
+      for (size_t src = 0; src < nverts; ++src) {
+        const size_t degree = 1 + graphlab::random::fast_uniform<size_t>(0, 20);
+        for (size_t i = 0; i < degree; ++i) {
+          size_t dst = graphlab::random::fast_uniform<size_t>(0, nverts - 1);
+          if (dst != src) pg.add_edge(src, dst);
+        }
+      }
+      pg.finalize();
+      graphlab::timer ti; ti.start();
+      size_t checksum = 0;
+      for (size_t rep = 0; rep < 5; ++rep) {
+        for (size_t v = 0; v < nverts; ++v) {
+          foreach(const empty_graph::edge_type& e, pg.in_edges(v)) {
+            checksum += e.source().id();
+          }
+        }
+      }
+      const double runtime = std::max(ti.current_time(), 1E-6);
+      std::cout << (compress ? "compressed" : "csr") << " adjacency: " 
+                << double(pg.adjacency_sizeof()) / pg.num_edges()
+                << " bytes/edge, " << 5 * pg.num_edges() / runtime 
+                << " in edges gathered/s (checksum " << checksum << ")" 
+                << std::endl;
+    }
+  }
+
+  /**
+   * Test graphlab::empty edge data: the in edges store no edge ids, and
+   * must match the same graph with edge data.
+   */
+  void test_empty_edge_data() {
+    typedef graphlab::local_graph<vertex_data, graphlab::empty> empty_graph;
+    for (size_t compress = 0; compress < 2; ++compress) {
+      graphlab::local_graph<vertex_data, edge_data> g;
+      empty_graph eg;
+      eg.set_compressed_adjacency(compress);
+      const size_t nverts = 20000;
+      srand(0);
+      for (size_t i = 0; i < 10 * nverts; ++i) {
+        const size_t src = rand() % nverts;
+        const size_t dst = rand() % nverts;
+        if (src == dst) continue;
+        g.add_edge(src, dst, edge_data(src, dst));
+        eg.add_edge(src, dst);
+      }
+      g.finalize();
+      eg.finalize();
+      check_empty_edges(eg, g);
+
+      // save and load through the archive format with in edge ids
+      std::stringstream strm;
+      graphlab::oarchive oarc(strm);
+      oarc << eg;
+      empty_graph eg2;
+      graphlab::iarchive iarc(strm);
+      iarc >> eg2;
+      check_empty_edges(eg2, g);
+      std::cout << (compress ? "compressed" : "csr") << " adjacency: "
+                << double(eg.adjacency_sizeof()) / eg.num_edges()
+                << " bytes/edge without edge data, "
+                << double(g.adjacency_sizeof()) / g.num_edges()
+                << " with edge data" << std::endl;
+    }
+    std::cout << "\n+ Pass test: empty edge data. :) \n";
+  }
+
+  /**
+   * Test parallel edges without edge data: each in edge must have the
+   * id of a distinct out edge.
+   */
+  void test_parallel_edges() {
+    typedef graphlab::local_graph<vertex_data, edge_data> graph_type;
+    typedef graphlab::local_graph<vertex_data, graphlab::empty> empty_graph;
+    const size_t edges[][2] = {{0, 1}, {2, 1}, {0, 1}, {1, 0}, {0, 2},
+                               {2, 1}, {0, 1}, {3, 1}};
+    const size_t nedges = sizeof(edges) / sizeof(edges[0]);
+    for (size_t compress = 0; compress < 2; ++compress) {
+      for (size_t spill = 0; spill < 2; ++spill) {
+        graph_type g;
+        empty_graph eg;
+        eg.set_compressed_adjacency(compress);
+        if (spill) eg.set_edge_buffer_limit(64);
+        for (size_t i = 0; i < nedges; ++i) {
+          g.add_edge(edges[i][0], edges[i][1],
+                     edge_data(edges[i][0], edges[i][1]));
+          eg.add_edge(edges[i][0], edges[i][1]);
+        }
+        g.finalize();
+        eg.finalize();
+        check_empty_edges(eg, g);
+
+        std::stringstream strm;
+        graphlab::oarchive oarc(strm);
+        oarc << eg;
+        empty_graph eg2;
+        eg2.set_compressed_adjacency(compress);
+        graphlab::iarchive iarc(strm);
+        iarc >> eg2;
+        check_empty_edges(eg2, g);
+      }
+    }
+    std::cout << "\n+ Pass test: parallel edges. :) \n";
+  }
+
+  /**
+   * Test a bounded edge buffer: the edges spilled in sorted runs and
+   * merged at finalize must match the graph built in memory.
+   */
+  void test_edge_buffer_spill() {
+    typedef graphlab::local_graph<vertex_data, edge_data> graph_type;
+    typedef graphlab::local_graph<vertex_data, graphlab::empty> empty_graph;
+    for (size_t compress = 0; compress < 2; ++compress) {
+      graph_type g, sg;
+      empty_graph seg;
+      sg.set_compressed_adjacency(compress);
+      seg.set_compressed_adjacency(compress);
+      sg.set_edge_buffer_limit(64 * 1024);
+      seg.set_edge_buffer_limit(64 * 1024);
+      const size_t nverts = 20000;
+      srand(0);
+      for (size_t i = 0; i < 10 * nverts; ++i) {
+        const size_t src = rand() % nverts;
+        const size_t dst = rand() % nverts;
+        if (src == dst) continue;
+        g.add_edge(src, dst, edge_data(src, dst));
+        sg.add_edge(src, dst, edge_data(src, dst));
+        seg.add_edge(src, dst);
+      }
+      g.finalize();
+      sg.finalize();
+      seg.finalize();
+      ASSERT_EQ(sg.num_edges(), g.num_edges());
+      for (size_t i = 0; i < g.num_vertices(); ++i) {
+        ASSERT_EQ(sg.num_in_edges(i), g.num_in_edges(i));
+        ASSERT_EQ(sg.num_out_edges(i), g.num_out_edges(i));
+        std::vector<size_t> expected, targets;
+        foreach(const graph_type::edge_type& e, g.out_edges(i)) {
+          expected.push_back(e.target().id());
+        }
+        foreach(const graph_type::edge_type& e, sg.out_edges(i)) {
+          targets.push_back(e.target().id());
+        }
+        std::sort(expected.begin(), expected.end());
+        std::sort(targets.begin(), targets.end());
+        ASSERT_TRUE(expected == targets);
+      }
+      check_edge_data(sg);
+      check_empty_edges(seg, g);
+    }
+    std::cout << "\n+ Pass test: edge buffer spill. :) \n";
+  }
+
+  /**
+   * Test copying the topology into graphs with other data types, with
+   * the same and with a different adjacency layout.
+   */
+  void test_copy_topology() {
+    typedef graphlab::local_graph<vertex_data, edge_data> graph_type;
+    typedef graphlab::local_graph<double, graphlab::empty> empty_graph;
+    for (size_t compress = 0; compress < 2; ++compress) {
+      graph_type g;
+      g.set_compressed_adjacency(compress);
+      const size_t nverts = 20000;
+      srand(0);
+      for (size_t i = 0; i < 10 * nverts; ++i) {
+        const size_t src = rand() % nverts;
+        const size_t dst = rand() % nverts;
+        if (src == dst) continue;
+        g.add_edge(src, dst, edge_data(src, dst));
+      }
+      g.finalize();
+      for (size_t other_compress = 0; other_compress < 2; ++other_compress) {
+        empty_graph eg;
+        eg.set_compressed_adjacency(other_compress);
+        eg.copy_topology(g);
+        ASSERT_EQ(eg.num_vertices(), g.num_vertices());
+        check_empty_edges(eg, g);
+
+        // and back to edge data, through the graph without edge data
+        graph_type g2;
+        g2.set_compressed_adjacency(compress);
+        g2.copy_topology(eg);
+        for (size_t i = 0; i < g2.num_vertices(); ++i) {
+          foreach(graph_type::edge_type e, g2.out_edges(i)) {
+            e.data() = edge_data(e.source().id(), e.target().id());
+          }
+        }
+        check_edge_data(g2);
+        check_empty_edges(eg, g2);
+      }
+    }
+    std::cout << "\n+ Pass test: copy topology. :) \n";
+  }
+
 private: 
   template<typename Graph>
   void test_add_vertex_impl(Graph& g, size_t nverts) {
@@ -229,6 +461,39 @@ template<typename Graph>
     }
   } 
 
+  template<typename EmptyGraph, typename Graph>
+  void check_empty_edges(EmptyGraph& eg, Graph& g) {
+    ASSERT_EQ(eg.num_edges(), g.num_edges());
+    std::vector<size_t> in_ids;
+    for (size_t i = 0; i < g.num_vertices(); ++i) {
+      std::vector<size_t> expected, sources;
+      foreach(const typename Graph::edge_type& e, g.in_edges(i)) {
+        expected.push_back(e.source().id());
+      }
+      foreach(const typename EmptyGraph::edge_type& e, eg.in_edges(i)) {
+        sources.push_back(e.source().id());
+        in_ids.push_back(e.id());
+        // the id is found among the out edges of the source
+        bool found = false;
+        foreach(const typename EmptyGraph::edge_type& out,
+                eg.out_edges(e.source().id())) {
+          if (out.id() == e.id()) {
+            ASSERT_EQ(out.target().id(), i);
+            found = true;
+          }
+        }
+        ASSERT_TRUE(found);
+      }
+      std::sort(expected.begin(), expected.end());
+      std::sort(sources.begin(), sources.end());
+      ASSERT_TRUE(expected == sources);
+      ASSERT_EQ(eg.num_out_edges(i), g.num_out_edges(i));
+    }
+    // parallel edges too have distinct ids
+    std::sort(in_ids.begin(), in_ids.end());
+    for (size_t i = 0; i < in_ids.size(); ++i) ASSERT_EQ(in_ids[i], i);
+  }
+
   template<typename Graph>
   void test_add_edge_impl(Graph& g, size_t nedges, bool use_dynamic=false) {
     typedef typename Graph::vertex_id_type vertex_id_type;
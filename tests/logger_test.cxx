@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <cxxtest/TestSuite.h>
+
+#include <unistd.h>
+#include <time.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <boost/bind.hpp>
+
+
+void log_lines(size_t thread, size_t nlines) {
+  for (size_t i = 0; i < nlines; ++i) {
+    logstream(LOG_INFO) << "thread " << thread << " line " << i << std::endl;
+  }
+}
+
+void log_field_lines(size_t thread, size_t nlines) {
+  for (size_t i = 0; i < nlines; ++i) {
+    logfields(LOG_INFO, "fields")("thread", thread)("line", i)("half", 0.5)
+      ("name", "value");
+  }
+}
+
+/// Reads the log file into lines
+std::vector<std::string> read_lines(const std::string& file) {
+  std::ifstream fin(file.c_str());
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(fin, line)) lines.push_back(line);
+  return lines;
+}
+
+/// Returns the CPU time used by the calling thread, in seconds
+double thread_cpu_time() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/// Runs fn and adds the CPU time of the thread to *elapsed
+void timed_logging(void (*fn)(size_t, size_t), size_t thread, size_t nlines,
+                   double* elapsed) {
+  const double start = thread_cpu_time();
+  fn(thread, nlines);
+  *elapsed = thread_cpu_time() - start;
+}
+
+/**
+ * Logs from nthreads threads and returns the CPU time the logging
+ * threads took, summed over the threads. Time spent by the background
+ * thread, and the flush of the pending messages afterwards, are not
+ * counted.
+ */
+double log_from_threads(void (*fn)(size_t, size_t),
+                        size_t nthreads, size_t nlines) {
+  std::vector<double> elapsed(nthreads, 0);
+  graphlab::thread_group threads;
+  for (size_t t = 0; t < nthreads; ++t) {
+    threads.launch(boost::bind(timed_logging, fn, t, nlines, &elapsed[t]));
+  }
+  threads.join();
+  global_logger().flush();
+  double total = 0;
+  for (size_t t = 0; t < nthreads; ++t) total += elapsed[t];
+  return total;
+}
+
+/// Returns the best time of a few runs of log_from_threads
+double best_time(void (*fn)(size_t, size_t), size_t nthreads, size_t nlines) {
+  double best = log_from_threads(fn, nthreads, nlines);
+  for (size_t i = 1; i < 5; ++i) {
+    best = std::min(best, log_from_threads(fn, nthreads, nlines));
+  }
+  return best;
+}
+
+
+class LoggerTestSuite: public CxxTest::TestSuite {
+  std::string log_file;
+
+ public:
+  LoggerTestSuite() {
+    std::stringstream strm;
+    strm << "logger_test_" << getpid() << ".log";
+    log_file = strm.str();
+  }
+
+  void setUp() {
+    global_logger().set_log_to_console(false);
+    global_logger().set_log_file(log_file);
+    global_logger().set_log_level(LOG_INFO);
+  }
+
+  void tearDown() {
+    global_logger().set_async(false);
+    global_logger().set_log_file("");
+    global_logger().set_log_to_console(true);
+    global_logger().set_log_level(LOG_EMPH);
+    remove(log_file.c_str());
+  }
+
+  void test_async_order() {
+    const size_t nthreads = 4, nlines = 10000;
+    global_logger().set_async(true);
+    log_from_threads(log_lines, nthreads, nlines);
+    logstream(LOG_DEBUG) << "below the log level" << std::endl;
+    global_logger().flush();
+    const std::vector<std::string> lines = read_lines(log_file);
+    TS_ASSERT_EQUALS(lines.size(), nthreads * nlines);
+    // the lines of each thread are in order
+    std::vector<size_t> next(nthreads, 0);
+    for (size_t i = 0; i < lines.size(); ++i) {
+      const size_t pos = lines[i].find("thread ");
+      TS_ASSERT(pos != std::string::npos);
+      size_t thread = 0, line = 0;
+      sscanf(lines[i].c_str() + pos, "thread %lu line %lu", &thread, &line);
+      TS_ASSERT_EQUALS(line, next[thread]);
+      ++next[thread];
+    }
+  }
+
+  void test_fields() {
+    logfields(LOG_INFO, "sync")("a", 1)("b", -2L)("c", 0.25)("d", "x");
+    global_logger().set_async(true);
+    logfields(LOG_INFO, "async")("a", 1U)("b", (unsigned long long)2);
+    logfields(LOG_DEBUG, "below the log level")("a", 1);
+    global_logger().set_async(false);
+    const std::vector<std::string> lines = read_lines(log_file);
+    TS_ASSERT_EQUALS(lines.size(), 2);
+    TS_ASSERT(lines[0].find("): sync a=1 b=-2 c=0.25 d=x") !=
+              std::string::npos);
+    TS_ASSERT(lines[1].find("): async a=1 b=2") != std::string::npos);
+  }
+
+  void test_ratelimit() {
+    global_logger().set_async(true);
+    size_t written = 0, other_written = 0;
+    for (size_t i = 0; i < 1000; ++i) {
+      logstream_ratelimit(LOG_INFO, 10) << "limited " << i << std::endl;
+      logstream_ratelimit(LOG_INFO, 5) << "other site " << i << std::endl;
+    }
+    global_logger().flush();
+    const std::vector<std::string> lines = read_lines(log_file);
+    for (size_t i = 0; i < lines.size(); ++i) {
+      if (lines[i].find("limited") != std::string::npos) ++written;
+      if (lines[i].find("other site") != std::string::npos) ++other_written;
+    }
+    // at most two windows if the clock ticked in between. Each call site
+    // has its own limit.
+    TS_ASSERT_LESS_THAN_EQUALS(written, 20);
+    TS_ASSERT_LESS_THAN_EQUALS(10, written);
+    TS_ASSERT_LESS_THAN_EQUALS(other_written, 10);
+    TS_ASSERT_LESS_THAN_EQUALS(5, other_written);
+  }
+
+  void test_async_speed() {
+    // a burst small enough to fit in the buffers of the threads, so the
+    // async callers do not wait for the background thread
+    const size_t nthreads = 4, nlines = 2000;
+    const double sync_lines = best_time(log_lines, nthreads, nlines);
+    const double sync_fields = best_time(log_field_lines, nthreads, nlines);
+    global_logger().set_async(true);
+    const double async_lines = best_time(log_lines, nthreads, nlines);
+    const double async_fields = best_time(log_field_lines, nthreads, nlines);
+    global_logger().set_async(false);
+    global_logger().set_log_level(LOG_EMPH);
+    const double disabled = best_time(log_lines, nthreads, nlines);
+    std::cout << std::endl << nthreads * nlines << " messages from "
+              << nthreads << " threads\n"
+              << "logstream sync: " << sync_lines << "s, async: "
+              << async_lines << "s\n"
+              << "logfields sync: " << sync_fields << "s, async: "
+              << async_fields << "s\n"
+              << "below the log level: " << disabled << "s" << std::endl;
+    // the fields are formatted by the background thread
+    TS_ASSERT_LESS_THAN(async_fields, sync_fields);
+  }
+};
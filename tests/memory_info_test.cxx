@@ -0,0 +1,137 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <vector>
+#include <boost/bind.hpp>
+#include <graphlab/util/memory_info.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+
+using namespace graphlab;
+
+void grow_and_shrink(size_t iterations) {
+  memory_info::tracked_bytes bytes(memory_info::EXCHANGE_BUFFERS);
+  for (size_t i = 0; i < iterations; ++i) {
+    bytes.set(i % 100);
+    memory_info::add_tagged_bytes(memory_info::RPC_BUFFERS, 3);
+    memory_info::sub_tagged_bytes(memory_info::RPC_BUFFERS, 3);
+  }
+}
+
+void add_rpc_bytes(size_t bytes) {
+  memory_info::add_tagged_bytes(memory_info::RPC_BUFFERS, bytes);
+}
+
+
+class MemoryInfoTest: public CxxTest::TestSuite {
+ public:
+  void test_tracked_bytes() {
+    const size_t base = memory_info::tagged_bytes(memory_info::VERTEX_DATA);
+    const size_t total = memory_info::total_tagged_bytes();
+    {
+      memory_info::tracked_bytes bytes(memory_info::VERTEX_DATA);
+      bytes.set(1000);
+      TS_ASSERT_EQUALS(memory_info::tagged_bytes(memory_info::VERTEX_DATA),
+                       base + 1000);
+      bytes.set(400);
+      TS_ASSERT_EQUALS(memory_info::tagged_bytes(memory_info::VERTEX_DATA),
+                       base + 400);
+      TS_ASSERT_EQUALS(memory_info::total_tagged_bytes(), total + 400);
+      // a copy reports its own footprint
+      memory_info::tracked_bytes copy(bytes);
+      TS_ASSERT_EQUALS(copy.get(), 0);
+      copy.set(100);
+      TS_ASSERT_EQUALS(memory_info::tagged_bytes(memory_info::VERTEX_DATA),
+                       base + 500);
+    }
+    // released on destruction
+    TS_ASSERT_EQUALS(memory_info::tagged_bytes(memory_info::VERTEX_DATA), base);
+    TS_ASSERT_EQUALS(memory_info::total_tagged_bytes(), total);
+  }
+
+  void test_peak() {
+    memory_info::reset_peak_tagged_bytes();
+    const size_t total = memory_info::total_tagged_bytes();
+    TS_ASSERT_EQUALS(memory_info::peak_tagged_bytes(), total);
+    {
+      memory_info::tracked_bytes bytes(memory_info::EDGE_DATA);
+      bytes.set(5000);
+      bytes.set(10);
+    }
+    TS_ASSERT_EQUALS(memory_info::total_tagged_bytes(), total);
+    TS_ASSERT_EQUALS(memory_info::peak_tagged_bytes(), total + 5000);
+    memory_info::reset_peak_tagged_bytes();
+    TS_ASSERT_EQUALS(memory_info::peak_tagged_bytes(), total);
+  }
+
+  void test_threads() {
+    const size_t total = memory_info::total_tagged_bytes();
+    thread_group group;
+    for (size_t i = 0; i < 4; ++i) {
+      group.launch(boost::bind(grow_and_shrink, 100000));
+    }
+    group.join();
+    TS_ASSERT_EQUALS(memory_info::total_tagged_bytes(), total);
+    TS_ASSERT_EQUALS(memory_info::tagged_bytes(memory_info::RPC_BUFFERS), 0);
+  }
+
+  void test_release_on_other_thread() {
+    const size_t total = memory_info::total_tagged_bytes();
+    // the counts of an exited thread are kept
+    thread_group group;
+    group.launch(boost::bind(add_rpc_bytes, 700));
+    group.join();
+    TS_ASSERT_EQUALS(memory_info::tagged_bytes(memory_info::RPC_BUFFERS), 700);
+    TS_ASSERT_EQUALS(memory_info::total_tagged_bytes(), total + 700);
+    memory_info::sub_tagged_bytes(memory_info::RPC_BUFFERS, 700);
+    TS_ASSERT_EQUALS(memory_info::tagged_bytes(memory_info::RPC_BUFFERS), 0);
+    TS_ASSERT_EQUALS(memory_info::total_tagged_bytes(), total);
+  }
+
+  void test_budget() {
+    TS_ASSERT_EQUALS(memory_info::budget(), 0);
+    TS_ASSERT(!memory_info::over_budget());
+    const size_t total = memory_info::total_tagged_bytes();
+    memory_info::set_budget(total + 1000);
+    TS_ASSERT(!memory_info::over_budget());
+    memory_info::tracked_bytes bytes(memory_info::GATHER_CACHE);
+    // just below the high watermark
+    bytes.set(size_t((total + 1000) * memory_info::BUDGET_HIGH_WATERMARK)
+              - total - 1);
+    TS_ASSERT(!memory_info::over_budget());
+    bytes.set(1000);
+    TS_ASSERT(memory_info::over_budget());
+    memory_info::log_tagged_usage("test_budget");
+    bytes.set(0);
+    TS_ASSERT(!memory_info::over_budget());
+    memory_info::set_budget(0);
+    bytes.set(size_t(-1) / 2);
+    TS_ASSERT(!memory_info::over_budget());
+  }
+
+  void test_tag_names() {
+    for (size_t i = 0; i < memory_info::NUM_MEMORY_TAGS; ++i) {
+      TS_ASSERT(std::string(memory_info::tag_name(memory_info::memory_tag(i)))
+                != "");
+    }
+  }
+};
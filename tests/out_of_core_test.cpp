@@ -0,0 +1,108 @@
+#include <graphlab/graph/local_graph.hpp>
+#include <graphlab/util/out_of_core.hpp>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/util/timer.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <boost/lexical_cast.hpp>
+#include <graphlab/macros_def.hpp>
+
+using namespace graphlab;
+
+typedef local_graph<size_t, double> graph_type;
+
+/**
+ * Builds a random graph with nverts vertices and nedges edges. The
+ * edges are file backed if out of core storage is enabled.
+ */
+void build_graph(graph_type& g, size_t nverts, size_t nedges) {
+  srand(0);
+  g.resize(nverts);
+  g.reserve_edge_space(nedges);
+  for (size_t i = 0; i < nedges; ++i) {
+    const lvid_type source = rand() % nverts;
+    const lvid_type target = (source + 1 + rand() % (nverts - 1)) % nverts;
+    g.add_edge(source, target, double(i % 100));
+  }
+  g.finalize();
+}
+
+/**
+ * Sums the data on the in and out edges of every vertex, in lvid order
+ * as the synchronous engine gathers, reading ahead and releasing the
+ * edges window by window as in synchronous_engine::stream_edges.
+ * A window of 0 disables the hints.
+ */
+double gather(graph_type& g, size_t window, bool release) {
+  double total = 0;
+  const size_t nverts = g.num_vertices();
+  for (lvid_type v = 0; v < nverts; ++v) {
+    if (window > 0 && v % window == 0) {
+      if (v == 0) g.prefetch_edges(0, window);
+      g.prefetch_edges(v + window, v + 2 * window);
+      if (release && v >= 2 * window) g.release_edges(v - 2 * window, v - window);
+    }
+    foreach(graph_type::edge_type e, g.in_edges(v)) total += e.data();
+    foreach(graph_type::edge_type e, g.out_edges(v)) total += e.data();
+  }
+  return total;
+}
+
+/**
+ * Runs a few gathers over a graph built with the given budget in MB
+ * and reports the edge throughput. A negative budget keeps the edges
+ * in memory, 0 means out of core without a budget.
+ */
+double run_test(const std::string& dir, int budget_mb,
+                size_t nverts, size_t nedges) {
+  out_of_core::set_directory(budget_mb < 0 ? "" : dir);
+  out_of_core::set_memory_budget(budget_mb <= 0 ? size_t(-1)
+                                                : size_t(budget_mb) << 20);
+  graph_type g;
+  build_graph(g, nverts, nedges);
+  ASSERT_EQ(g.is_out_of_core(), budget_mb >= 0);
+
+  size_t window = 0;
+  bool release = false;
+  if (g.is_out_of_core()) {
+    if (out_of_core::memory_budget() == size_t(-1)) {
+      window = 64 * 1024;
+    } else {
+      window = out_of_core::memory_budget() / 4 /
+          std::max<size_t>(1, g.estimate_sizeof() / nverts);
+      window = std::max<size_t>(64, window / 64 * 64);
+      release = true;
+    }
+  }
+  const size_t rounds = 3;
+  double total = 0;
+  timer ti;
+  ti.start();
+  for (size_t i = 0; i < rounds; ++i) total += gather(g, window, release);
+  const double runtime = std::max(ti.current_time(), 1E-6);
+
+  std::cout << (budget_mb < 0 ? std::string("in memory") :
+                budget_mb == 0 ? std::string("out of core, no budget") :
+                "out of core, " + boost::lexical_cast<std::string>(budget_mb)
+                + "MB budget")
+            << ": " << 2 * rounds * nedges / runtime / 1000000
+            << "M edges/s, window " << window << " vertices, "
+            << out_of_core::file_backed_bytes() / (1 << 20)
+            << "MB file backed" << std::endl;
+  return total;
+}
+
+int main(int argc, char** argv) {
+  const std::string dir = argc > 1 ? argv[1] : "/tmp";
+  const size_t nverts = 1000000;
+  const size_t nedges = 8000000;
+  std::cout << "Backing files in " << dir << std::endl;
+  const double expected = run_test(dir, -1, nverts, nedges);
+  ASSERT_EQ(run_test(dir, 0, nverts, nedges), expected);
+  ASSERT_EQ(run_test(dir, 64, nverts, nedges), expected);
+  ASSERT_EQ(run_test(dir, 16, nverts, nedges), expected);
+  out_of_core::set_directory("");
+  std::cout << "Done" << std::endl;
+}
+#include <graphlab/macros_undef.hpp>
@@ -0,0 +1,101 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <climits>
+#include <string>
+#include <sstream>
+#include <graphlab/util/output_buffer.hpp>
+
+using namespace graphlab;
+
+template <typename T>
+std::string ostream_format(const T& val) {
+  std::ostringstream strm;
+  strm << val;
+  return strm.str();
+}
+
+template <typename T>
+std::string buffer_format(const T& val) {
+  output_buffer out;
+  out << val;
+  return std::string(out.data(), out.size());
+}
+
+
+class OutputBufferTest: public CxxTest::TestSuite {
+ public:
+  void test_integers() {
+    const long long signed_vals[] = {0, 1, -1, 9, 10, -10, 123456789,
+                                     INT_MAX, INT_MIN, LLONG_MAX, LLONG_MIN};
+    for (size_t i = 0; i < sizeof(signed_vals) / sizeof(long long); ++i) {
+      const long long val = signed_vals[i];
+      TS_ASSERT_EQUALS(buffer_format(val), ostream_format(val));
+      TS_ASSERT_EQUALS(buffer_format(long(val)), ostream_format(long(val)));
+      TS_ASSERT_EQUALS(buffer_format(int(val)), ostream_format(int(val)));
+    }
+    const unsigned long long unsigned_vals[] = {0, 1, 10, 4294967295ULL,
+                                                ULLONG_MAX};
+    for (size_t i = 0; i < sizeof(unsigned_vals) / sizeof(long long); ++i) {
+      const unsigned long long val = unsigned_vals[i];
+      TS_ASSERT_EQUALS(buffer_format(val), ostream_format(val));
+      TS_ASSERT_EQUALS(buffer_format((unsigned long)val),
+                       ostream_format((unsigned long)val));
+      TS_ASSERT_EQUALS(buffer_format((unsigned int)val),
+                       ostream_format((unsigned int)val));
+    }
+  }
+
+  void test_floating_point() {
+    const double vals[] = {0.0, -0.0, 1.0, -2.5, 0.1, 1.0 / 3, 123456789.0,
+                           1e-7, 1e20, -6.02e23};
+    for (size_t i = 0; i < sizeof(vals) / sizeof(double); ++i) {
+      TS_ASSERT_EQUALS(buffer_format(vals[i]), ostream_format(vals[i]));
+      TS_ASSERT_EQUALS(buffer_format(float(vals[i])),
+                       ostream_format(float(vals[i])));
+    }
+    output_buffer out;
+    out.write_double(1.0 / 3, 12);
+    std::ostringstream strm;
+    strm.precision(12);
+    strm << 1.0 / 3;
+    TS_ASSERT_EQUALS(std::string(out.data(), out.size()), strm.str());
+  }
+
+  void test_mixed_and_growth() {
+    // starts smaller than a single value
+    output_buffer out(1);
+    std::ostringstream strm;
+    for (int i = 0; i < 10000; ++i) {
+      out << i << '\t' << "edge" << std::string(" ") << -0.5 * i << '\n';
+      strm << i << '\t' << "edge" << std::string(" ") << -0.5 * i << '\n';
+    }
+    TS_ASSERT_EQUALS(std::string(out.data(), out.size()), strm.str());
+    out.clear();
+    TS_ASSERT_EQUALS(out.size(), 0);
+    const double val = 2.75;
+    out.write_pod(val);
+    TS_ASSERT_EQUALS(out.size(), sizeof(double));
+    TS_ASSERT_EQUALS(*reinterpret_cast<const double*>(out.data()), val);
+  }
+};
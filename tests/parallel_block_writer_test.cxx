@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <graphlab/util/parallel_block_writer.hpp>
+#include <graphlab/util/output_buffer.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+
+using namespace graphlab;
+
+// each block holds whole lines, so the lines can be checked in any order
+void write_lines(parallel_block_writer* writer, size_t thread,
+                 size_t nblocks, size_t lines_per_block) {
+  output_buffer buffer;
+  for (size_t b = 0; b < nblocks; ++b) {
+    buffer.clear();
+    for (size_t i = 0; i < lines_per_block; ++i) {
+      buffer << thread << ' ' << b << ' ' << i << '\n';
+    }
+    writer->write_block(buffer.data(), buffer.size());
+  }
+}
+
+std::vector<std::string> read_lines(std::stringstream& strm, bool gzip) {
+  boost::iostreams::filtering_stream<boost::iostreams::input> fin;
+  if (gzip) fin.push(boost::iostreams::gzip_decompressor());
+  fin.push(strm);
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(fin, line)) lines.push_back(line);
+  return lines;
+}
+
+
+class ParallelBlockWriterTest: public CxxTest::TestSuite {
+ public:
+  void check_writer(bool gzip) {
+    const size_t nthreads = 4, nblocks = 50, lines_per_block = 200;
+    std::stringstream out1, out2;
+    std::vector<std::ostream*> outs;
+    outs.push_back(&out1);
+    outs.push_back(&out2);
+    parallel_block_writer writer(outs, gzip);
+    thread_group group;
+    for (size_t t = 0; t < nthreads; ++t) {
+      group.launch(boost::bind(write_lines, &writer, t, nblocks,
+                               lines_per_block));
+    }
+    group.join();
+    const size_t written = out1.str().size() + out2.str().size();
+    TS_ASSERT_EQUALS(writer.written_bytes(), written);
+    if (gzip) {
+      TS_ASSERT_LESS_THAN(written, writer.uncompressed_bytes());
+    } else {
+      TS_ASSERT_EQUALS(written, writer.uncompressed_bytes());
+    }
+
+    // every file is a valid concatenation of gzip members
+    std::vector<std::string> lines = read_lines(out1, gzip);
+    std::vector<std::string> lines2 = read_lines(out2, gzip);
+    TS_ASSERT_LESS_THAN(0, lines.size());
+    TS_ASSERT_LESS_THAN(0, lines2.size());
+    lines.insert(lines.end(), lines2.begin(), lines2.end());
+    std::vector<std::string> expected;
+    for (size_t t = 0; t < nthreads; ++t) {
+      for (size_t b = 0; b < nblocks; ++b) {
+        for (size_t i = 0; i < lines_per_block; ++i) {
+          std::ostringstream strm;
+          strm << t << ' ' << b << ' ' << i;
+          expected.push_back(strm.str());
+        }
+      }
+    }
+    std::sort(lines.begin(), lines.end());
+    std::sort(expected.begin(), expected.end());
+    TS_ASSERT(lines == expected);
+  }
+
+  void test_gzip_members() {
+    check_writer(true);
+  }
+
+  void test_uncompressed() {
+    check_writer(false);
+  }
+};
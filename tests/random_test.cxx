@@ -66,6 +66,18 @@ public:
   }
 };
 
+class counter_worker {
+public:
+  size_t stream;
+  std::vector<int> values;
+  void run() {
+    graphlab::random::counter_generator rng(12345, stream);
+    for(size_t i = 0; i < values.size(); ++i) {
+      values[i] = rng.uniform<int>(0,3);
+    }
+  }
+};
+
 template<typename T>
 std::ostream& operator<<(std::ostream& out, const std::vector<T>& values) {
   out << "{";
@@ -152,6 +164,196 @@ class RandomTestSuite: public CxxTest::TestSuite {
 
 
 
+  void test_counter_generator() {
+    namespace random = graphlab::random;
+    // known answers of Philox4x32-10 from the Random123 test vectors
+    const uint32_t zero[4] = {0, 0, 0, 0};
+    const uint32_t ones[4] = {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff};
+    uint32_t out[4];
+    random::counter_generator::philox(zero, zero, out);
+    TS_ASSERT_EQUALS(out[0], 0x6627e8d5u);
+    TS_ASSERT_EQUALS(out[1], 0xe169c58du);
+    TS_ASSERT_EQUALS(out[2], 0xbc57ac4cu);
+    TS_ASSERT_EQUALS(out[3], 0x9b00dbd8u);
+    random::counter_generator::philox(ones, ones, out);
+    TS_ASSERT_EQUALS(out[0], 0x408f276du);
+    TS_ASSERT_EQUALS(out[1], 0x41c83b0eu);
+    TS_ASSERT_EQUALS(out[2], 0xa20bc7c6u);
+    TS_ASSERT_EQUALS(out[3], 0x6d5451fdu);
+
+    // the bulk and the scalar draws walk the same stream
+    const size_t n = 1001;
+    std::vector<double> bulk(n);
+    random::counter_generator rng(12345, 7, 3);
+    rng.rand01();
+    rng.fill_uniform(&bulk[0], n);
+    const double after_bulk = rng.rand01();
+    rng.seed(12345, 7, 3);
+    rng.rand01();
+    std::vector<double> scalar(n);
+    for (size_t i = 0; i < n; ++i) scalar[i] = rng.rand01();
+    TS_ASSERT(bulk == scalar);
+    TS_ASSERT_EQUALS(after_bulk, rng.rand01());
+
+    // starting one word into a block, every pair straddles two blocks
+    for (size_t skip = 1; skip <= 3; ++skip) {
+      rng.seed(12345, 7, 3);
+      for (size_t j = 0; j < skip; ++j) rng.next_uint32();
+      rng.fill_uniform(&bulk[0], n);
+      const double after_odd = rng.rand01();
+      rng.seed(12345, 7, 3);
+      for (size_t j = 0; j < skip; ++j) rng.next_uint32();
+      for (size_t i = 0; i < n; ++i) scalar[i] = rng.rand01();
+      TS_ASSERT(bulk == scalar);
+      TS_ASSERT_EQUALS(after_odd, rng.rand01());
+    }
+
+    // other streams and iterations differ
+    random::counter_generator other_stream(12345, 8, 3);
+    random::counter_generator other_iteration(12345, 7, 4);
+    rng.seed(12345, 7, 3);
+    const double first = rng.rand01();
+    TS_ASSERT_DIFFERS(first, other_stream.rand01());
+    TS_ASSERT_DIFFERS(first, other_iteration.rand01());
+
+    // moments of the bulk distributions
+    const size_t m = 1000000;
+    std::vector<double> values(m);
+    rng.fill_uniform(&values[0], m);
+    double sum = 0;
+    for (size_t i = 0; i < m; ++i) {
+      TS_ASSERT(values[i] >= 0 && values[i] < 1);
+      sum += values[i];
+    }
+    TS_ASSERT_DELTA(sum / m, 0.5, 0.005);
+    rng.fill_gaussian(&values[0], m, 1, 2);
+    double sumsq = 0;
+    sum = 0;
+    for (size_t i = 0; i < m; ++i) {
+      sum += values[i];
+      sumsq += values[i] * values[i];
+    }
+    const double mean = sum / m;
+    TS_ASSERT_DELTA(mean, 1, 0.01);
+    TS_ASSERT_DELTA(sumsq / m - mean * mean, 4, 0.05);
+
+    // discrete draws cover the closed range
+    std::vector<size_t> counts(4, 0);
+    for (size_t i = 0; i < 100000; ++i) {
+      const int value = rng.uniform<int>(-1, 2);
+      TS_ASSERT(value >= -1 && value <= 2);
+      ++counts[value + 1];
+    }
+    for (size_t i = 0; i < counts.size(); ++i) {
+      TS_ASSERT_DELTA(counts[i] / 100000.0, 0.25, 0.01);
+    }
+  }
+
+
+
+  void test_counter_generator_threads() {
+    namespace random = graphlab::random;
+    // each worker draws the stream of its own index, so the values do
+    // not depend on the number of threads or on their schedule
+    const size_t num_iterations(20);
+    std::vector<counter_worker> workers(10);
+    for(size_t i = 0; i < workers.size(); ++i) {
+      workers[i].stream = i;
+      workers[i].values.resize(num_iterations);
+    }
+    graphlab::thread_group threads;
+    for(size_t i = 0; i < workers.size(); ++i) {
+      threads.launch(boost::bind(&counter_worker::run, &(workers[i])));
+    }
+    threads.join();
+    for(size_t i = 0; i < workers.size(); ++i) {
+      random::counter_generator rng(12345, i);
+      for (size_t j = 0; j < num_iterations; ++j) {
+        TS_ASSERT_EQUALS(workers[i].values[j], rng.uniform<int>(0, 3));
+      }
+    }
+  }
+
+
+
+  void test_alias_table() {
+    namespace random = graphlab::random;
+    std::vector<double> weights(5);
+    weights[0] = 1; weights[1] = 0; weights[2] = 3; weights[3] = 0.5;
+    weights[4] = 5.5;
+    const random::alias_table table(weights);
+    TS_ASSERT_EQUALS(table.size(), weights.size());
+    random::counter_generator rng(42);
+    const size_t n = 1000000;
+    std::vector<size_t> counts(weights.size(), 0);
+    for (size_t i = 0; i < n; ++i) ++counts[table.sample(rng)];
+    TS_ASSERT_EQUALS(counts[1], 0);
+    for (size_t i = 0; i < weights.size(); ++i) {
+      TS_ASSERT_DELTA(double(counts[i]) / n, weights[i] / 10, 0.005);
+    }
+  }
+
+
+
+  void test_counter_generator_speed() {
+    namespace random = graphlab::random;
+    random::seed(12345);
+    const size_t n = 10000000;
+    std::vector<double> values(n);
+    double sum = 0;
+    graphlab::timer ti;
+    ti.start();
+    for (size_t i = 0; i < n; ++i) sum += random::uniform<double>(0, 1);
+    const double locked_uniform = ti.current_time();
+    ti.start();
+    random::counter_generator rng(12345);
+    for (size_t i = 0; i < n; ++i) sum += rng.rand01();
+    const double counter_uniform = ti.current_time();
+    ti.start();
+    rng.fill_uniform(&values[0], n);
+    const double bulk_uniform = ti.current_time();
+    sum += values[n - 1];
+
+    ti.start();
+    for (size_t i = 0; i < n; ++i) sum += random::gaussian();
+    const double locked_gaussian = ti.current_time();
+    ti.start();
+    for (size_t i = 0; i < n; ++i) sum += rng.gaussian();
+    const double counter_gaussian = ti.current_time();
+    ti.start();
+    rng.fill_gaussian(&values[0], n);
+    const double bulk_gaussian = ti.current_time();
+    sum += values[n - 1];
+
+    std::vector<double> weights(1000);
+    for (size_t i = 0; i < weights.size(); ++i) {
+      weights[i] = std::pow(double(i + 1), -2.1);
+    }
+    const size_t ndraws = n / 10;
+    size_t draws = 0;
+    ti.start();
+    for (size_t i = 0; i < ndraws; ++i) draws += random::multinomial(weights);
+    const double locked_multinomial = ti.current_time();
+    ti.start();
+    const random::alias_table table(weights);
+    for (size_t i = 0; i < ndraws; ++i) draws += table.sample(rng);
+    const double alias_multinomial = ti.current_time();
+
+    std::cout << std::endl
+              << n << " uniform draws, locked: " << locked_uniform
+              << "s, counter: " << counter_uniform
+              << "s, bulk: " << bulk_uniform << "s\n"
+              << n << " gaussian draws, locked: " << locked_gaussian
+              << "s, counter: " << counter_gaussian
+              << "s, bulk: " << bulk_gaussian << "s\n"
+              << ndraws << " multinomial draws of " << weights.size()
+              << " outcomes, locked: " << locked_multinomial
+              << "s, alias table: " << alias_multinomial << "s\n"
+              << "(checksum " << sum + draws << ")" << std::endl;
+  }
+
+
+
   // void test_speed() {
   //   namespace random = graphlab::random;
   //   std::cout << "speed test run: " << std::endl;
@@ -1,39 +1,82 @@
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/rpc/sample_sort.hpp>
+#include <graphlab/util/timer.hpp>
 #include <algorithm>
+#include <string>
 
 using namespace graphlab;
 
-int main(int argc, char** argv) {
-  mpi_tools::init(argc, argv);
-  distributed_control dc;
+enum key_distribution { UNIFORM, DUPLICATES, SKEWED };
+
+size_t generate_key(key_distribution dist) {
+  switch(dist) {
+   case UNIFORM:
+     return rand();
+   case DUPLICATES:
+     // only 16 distinct keys
+     return rand() % 16;
+   case SKEWED:
+   default:
+     // half of the keys are 0, the rest are uniform
+     return (rand() % 2) ? 0 : rand();
+  }
+}
+
+void run_sort(distributed_control& dc, key_distribution dist,
+              const std::string& name, bool use_radix_sort, size_t n) {
   std::vector<size_t> keys;
   std::vector<size_t> values;
-  for (size_t i = 0;i < 1000000; ++i) {
-    size_t s = rand();
+  srand(dc.procid() + 1);
+  for (size_t i = 0;i < n; ++i) {
+    size_t s = generate_key(dist);
     keys.push_back(s); values.push_back(s);
   }
 
-  sample_sort<size_t, size_t> sorter(dc);
+  sample_sort<size_t, size_t> sorter(dc, use_radix_sort);
+  dc.barrier();
+  timer ti; ti.start();
   sorter.sort(keys.begin(), keys.end(),
               values.begin(), values.end());
+  const double runtime = std::max(ti.current_time(), 1E-6);
 
   std::vector<std::vector<std::pair<size_t, size_t> > > result(dc.numprocs());
-  
+
   std::swap(result[dc.procid()], sorter.result());
   dc.gather(result, 0);
   if (dc.procid() == 0) {
     // test that it is sorted and the values are correct
     size_t last = 0;
+    size_t total = 0;
+    size_t largest = 0;
     for (size_t i = 0;i < result.size(); ++i) {
-      dc.cout() << result[i].size() << ",";
+      total += result[i].size();
+      largest = std::max(largest, result[i].size());
       for (size_t j = 0; j < result[i].size(); ++j) {
         ASSERT_EQ(result[i][j].first, result[i][j].second);
         ASSERT_GE(result[i][j].first, last);
         last = result[i][j].first;
       }
     }
-    dc.cout() << std::endl;
+    ASSERT_EQ(total, n * dc.numprocs());
+    dc.cout() << name << (use_radix_sort ? " radix: " : " std::sort: ")
+              << total / runtime << " keys/s. Partitions: ";
+    for (size_t i = 0;i < result.size(); ++i) {
+      dc.cout() << result[i].size() << ",";
+    }
+    dc.cout() << " imbalance "
+              << double(largest) * dc.numprocs() / std::max<size_t>(total, 1)
+              << std::endl;
+  }
+}
+
+int main(int argc, char** argv) {
+  mpi_tools::init(argc, argv);
+  distributed_control dc;
+  const size_t n = 1000000;
+  for (size_t radix = 0; radix < 2; ++radix) {
+    run_sort(dc, UNIFORM, "uniform", radix, n);
+    run_sort(dc, DUPLICATES, "duplicates", radix, n);
+    run_sort(dc, SKEWED, "skewed", radix, n);
   }
   mpi_tools::finalize();
 }
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <iostream>
+#include <cmath>
+#include <graphlab.hpp>
+#include <graphlab/engine/stochastic_diffusion.hpp>
+
+using namespace graphlab;
+
+// a path with certain edges, and a star whose edges fire half the time
+const size_t PATH_LENGTH = 100;
+const size_t STAR_CENTER = 1000;
+const size_t STAR_LEAVES = 200;
+const size_t RUNS = 1000;
+
+template <typename Graph>
+void build_graph(distributed_control& dc, Graph& graph) {
+  if (dc.procid() == 0) {
+    for (size_t i = 0; i + 1 < PATH_LENGTH; ++i) {
+      graph.add_edge(i, i + 1, diffusion::edge_data(1));
+    }
+  }
+  for (size_t i = dc.procid(); i < STAR_LEAVES; i += dc.numprocs()) {
+    graph.add_edge(STAR_CENTER, STAR_CENTER + 1 + i, diffusion::edge_data(0.5));
+  }
+  graph.finalize();
+}
+
+template <typename VertexType>
+bool is_seed(const VertexType& vertex) {
+  return vertex.id() == 0 || vertex.id() == STAR_CENTER;
+}
+
+template <typename VertexType>
+size_t path_end_activations(const VertexType& vertex) {
+  return vertex.id() == PATH_LENGTH - 1 ? vertex.data().activations : 0;
+}
+
+template <diffusion::model_type Model>
+void test_model(distributed_control& dc, const std::string& name) {
+  typedef diffusion::simulator<Model> simulator_type;
+  typedef typename simulator_type::graph_type graph_type;
+  typedef typename graph_type::vertex_type vertex_type;
+  graph_type graph(dc);
+  build_graph(dc, graph);
+  const vertex_set seeds = graph.select(is_seed<vertex_type>);
+
+  timer ti; ti.start();
+  const double spread = simulator_type::simulate(dc, graph, seeds, RUNS, 7);
+  const double runtime = ti.current_time();
+  // the path is always active, and half of the leaves on average
+  const double expected = PATH_LENGTH + 1 + STAR_LEAVES / 2;
+  dc.cout() << name << ": spread " << spread << ", expected " << expected
+            << ", " << RUNS << " runs in " << runtime << " secs" << std::endl;
+  ASSERT_LT(std::fabs(spread - expected), 2);
+  ASSERT_EQ(graph.template map_reduce_vertices<size_t>(
+                path_end_activations<vertex_type>), RUNS);
+
+  // the draws do not depend on the engine
+  const double async_spread =
+    simulator_type::simulate(dc, graph, seeds, RUNS, 7, "asynchronous");
+  ASSERT_EQ(spread, async_spread);
+  // a partial batch
+  const double short_spread = simulator_type::simulate(dc, graph, seeds, 10, 7);
+  ASSERT_GT(short_spread, PATH_LENGTH);
+}
+
+int main(int argc, char** argv) {
+  mpi_tools::init(argc, argv);
+  distributed_control dc;
+
+  test_model<diffusion::INDEPENDENT_CASCADE>(dc, "Independent cascade");
+  test_model<diffusion::LINEAR_THRESHOLD>(dc, "Linear threshold");
+  dc.cout() << "\n+ Pass test: stochastic diffusion. :) \n";
+
+  mpi_tools::finalize();
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/rpc/string_dictionary.hpp>
+#include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/util/timer.hpp>
+using namespace graphlab;
+
+const size_t NUM_STRINGS = 1000000;
+const size_t NUM_DISTINCT = 10000;
+
+std::string label(size_t i) {
+  std::stringstream strm;
+  strm << "label_" << i % NUM_DISTINCT;
+  return strm.str();
+}
+
+int main(int argc, char** argv) {
+  mpi_tools::init(argc, argv);
+  distributed_control dc;
+  string_dictionary dictionary(dc);
+
+  // every machine interns an overlapping range of the labels
+  std::vector<std::string> keys;
+  for (size_t i = dc.procid(); i < NUM_STRINGS; i += dc.numprocs()) {
+    keys.push_back(label(i * 7));
+  }
+  std::vector<string_dictionary::id_type> ids;
+  timer ti;
+  ti.start();
+  dictionary.intern(keys, ids);
+  const double runtime = ti.current_time();
+  ASSERT_EQ(dictionary.size(), NUM_DISTINCT);
+  ASSERT_EQ(ids.size(), keys.size());
+  for (size_t i = 0; i < ids.size(); ++i) {
+    ASSERT_LT(ids[i], NUM_DISTINCT);
+  }
+
+  // the same strings get the same ids on every machine
+  std::vector<std::string> first(1, label(0));
+  std::vector<string_dictionary::id_type> first_id;
+  dictionary.intern(first, first_id);
+  std::vector<string_dictionary::id_type> all_ids(dc.numprocs(), first_id[0]);
+  dc.all_gather(all_ids);
+  for (size_t i = 0; i < all_ids.size(); ++i) ASSERT_EQ(all_ids[i], first_id[0]);
+  ASSERT_EQ(dictionary.size(), NUM_DISTINCT);
+
+  // new strings are numbered after the existing ones
+  std::vector<std::string> more(1, "new label");
+  std::vector<string_dictionary::id_type> more_ids;
+  dictionary.intern(more, more_ids);
+  ASSERT_EQ(more_ids[0], NUM_DISTINCT);
+  ASSERT_EQ(dictionary.size(), NUM_DISTINCT + 1);
+
+  // and are translated back
+  std::vector<std::string> strings;
+  dictionary.lookup(ids, strings);
+  for (size_t i = 0; i < keys.size(); ++i) ASSERT_EQ(strings[i], keys[i]);
+  dictionary.lookup(more_ids, strings);
+  ASSERT_EQ(strings[0], more[0]);
+
+  dc.cout() << "Interned " << NUM_STRINGS << " strings in " << runtime
+            << "s (" << NUM_STRINGS / runtime << " strings/s)" << std::endl;
+  dc.cout() << "\n+ Pass test: string dictionary. :) \n";
+  mpi_tools::finalize();
+}
@@ -0,0 +1,112 @@
+#include <graphlab/graph/vertex_record_table.hpp>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/util/timer.hpp>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace graphlab;
+
+typedef vertex_record_table::vertex_record vertex_record;
+
+/**
+ * Builds n records owned by numprocs procs with up to max_mirrors
+ * mirrors each, checks the compact table against the records and
+ * reports memory per vertex and owner lookup throughput against an
+ * array of vertex_record.
+ */
+void run_test(const std::string& name, size_t n, procid_t numprocs,
+              size_t max_mirrors) {
+  std::vector<vertex_record> records(n);
+  vertex_record_table table;
+  table.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    vertex_record& rec = records[i];
+    rec.gvid = i * 7;
+    rec.owner = rand() % numprocs;
+    rec.num_in_edges = rand() % 100;
+    rec.num_out_edges = rand() % 100;
+    const size_t nmirrors = rand() % (max_mirrors + 1);
+    for (size_t j = 0; j < nmirrors; ++j) {
+      const procid_t proc = rand() % numprocs;
+      if (proc != rec.owner) rec._mirrors.set_bit(proc);
+    }
+    table.set(i, rec);
+  }
+  const size_t dense_bytes = table.memory_usage();
+  const size_t saved = table.compact();
+  ASSERT_EQ(dense_bytes - saved, table.memory_usage());
+  const bool compact = table.is_compact();
+
+  for (size_t i = 0; i < n; ++i) {
+    ASSERT_TRUE(table.get(i) == records[i]);
+    ASSERT_EQ(table.owner(i), records[i].owner);
+    ASSERT_EQ(table.gvid(i), records[i].gvid);
+    ASSERT_EQ(table.num_mirrors(i), records[i].num_mirrors());
+    vertex_record_table::mirror_list mirrors = table.mirrors(i);
+    ASSERT_EQ(mirrors.size(), records[i].num_mirrors());
+    procid_t last = 0;
+    for (vertex_record_table::mirror_list::const_iterator it = mirrors.begin();
+         it != mirrors.end(); ++it) {
+      ASSERT_TRUE(records[i]._mirrors.get(*it));
+      ASSERT_TRUE(mirrors.contains(*it));
+      ASSERT_GE(*it, last);
+      last = *it;
+    }
+  }
+
+  // serialization uses the std::vector<vertex_record> format
+  std::stringstream strm;
+  oarchive oarc(strm);
+  oarc << table;
+  strm.flush();
+  iarchive iarc(strm);
+  std::vector<vertex_record> loaded;
+  iarc >> loaded;
+  ASSERT_EQ(loaded.size(), n);
+  for (size_t i = 0; i < n; ++i) ASSERT_TRUE(loaded[i] == records[i]);
+
+  // modification switches back to bitsets
+  table.mutable_mirrors(0).set_bit(numprocs);
+  ASSERT_FALSE(table.is_compact());
+  ASSERT_TRUE(table.mirrors(0).contains(numprocs));
+  for (size_t i = 1; i < n; ++i) ASSERT_TRUE(table.get(i) == records[i]);
+  table.compact();
+  ASSERT_EQ(table.is_compact(), compact);
+
+  // owner lookups as in l_is_master and l_master
+  const procid_t procid = 0;
+  timer ti;
+  ti.start();
+  size_t record_masters = 0, record_sum = 0;
+  for (size_t i = 0; i < n; ++i) {
+    record_masters += records[i].owner == procid;
+    record_sum += records[i].owner;
+  }
+  const double record_time = std::max(ti.current_time(), 1E-6);
+  ti.start();
+  size_t table_masters = 0, table_sum = 0;
+  for (size_t i = 0; i < n; ++i) {
+    table_masters += table.owner(i) == procid;
+    table_sum += table.owner(i);
+  }
+  const double table_time = std::max(ti.current_time(), 1E-6);
+  ASSERT_EQ(record_masters, table_masters);
+  ASSERT_EQ(record_sum, table_sum);
+
+  std::cout << name << ": " << n << " vertices. records "
+            << double(sizeof(vertex_record) * n) / n << " bytes/vertex, "
+            << n / record_time / 1000000 << "M owner lookups/s. table "
+            << double(table.memory_usage()) / n << " bytes/vertex ("
+            << (compact ? "compact mirrors, " : "dense mirrors, ")
+            << double(table.hot_memory_usage()) / n << " hot), "
+            << n / table_time / 1000000 << "M owner lookups/s." << std::endl;
+}
+
+int main(int argc, char** argv) {
+  const size_t n = 4000000;
+  run_test("few mirrors", n, 64, 2);
+  run_test("many mirrors", n, 64, 16);
+  std::cout << "Done" << std::endl;
+}
@@ -0,0 +1,99 @@
+#include <graphlab/graph/vid2lvid_map.hpp>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/util/timer.hpp>
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace graphlab;
+
+/**
+ * Builds a map of n vertices with ids spaced by 1 + rand() % spacing
+ * starting at first_vid, checks every representation against the hash
+ * map and reports memory and lookup throughput.
+ */
+void run_test(const std::string& name, size_t n, size_t spacing,
+              vertex_id_type first_vid) {
+  std::vector<vertex_id_type> vids;
+  vertex_id_type vid = first_vid;
+  for (size_t i = 0; i < n; ++i) {
+    vids.push_back(vid);
+    vid += 1 + rand() % spacing;
+  }
+  // lvids are assigned in arrival order, which is not id order
+  std::random_shuffle(vids.begin(), vids.end());
+  std::vector<std::pair<vertex_id_type, lvid_type> > pairs;
+  for (size_t i = 0; i < n; ++i) pairs.push_back(std::make_pair(vids[i], i));
+
+  vid2lvid_map map;
+  map.bulk_insert(pairs.begin(), pairs.end());
+  ASSERT_EQ(map.size(), n);
+  const size_t hash_bytes = map.memory_usage();
+
+  timer ti;
+  ti.start();
+  size_t checksum = 0;
+  for (size_t i = 0; i < n; ++i) checksum += map.lookup(vids[i]);
+  const double hash_time = std::max(ti.current_time(), 1E-6);
+
+  const size_t saved = map.compact();
+  ASSERT_EQ(map.size(), n);
+  ASSERT_EQ(hash_bytes - saved, map.memory_usage());
+
+  ti.start();
+  size_t checksum2 = 0;
+  for (size_t i = 0; i < n; ++i) checksum2 += map.lookup(vids[i]);
+  const double compact_time = std::max(ti.current_time(), 1E-6);
+  ASSERT_EQ(checksum, checksum2);
+  const std::string mode_name = map.mode_name();
+
+  for (size_t i = 0; i < n; ++i) {
+    ASSERT_EQ(map.lookup(vids[i]), i);
+    ASSERT_TRUE(map.find(vids[i]) != map.end());
+    ASSERT_EQ(map.find(vids[i])->second, i);
+  }
+  // ids which are not present
+  ASSERT_EQ(map.count(vid + 1), 0);
+  if (first_vid > 0) ASSERT_EQ(map.count(first_vid - 1), 0);
+  if (spacing > 1) {
+    std::vector<vertex_id_type> sorted(vids);
+    std::sort(sorted.begin(), sorted.end());
+    for (size_t i = 0; i + 1 < n; ++i) {
+      for (vertex_id_type v = sorted[i] + 1; v < sorted[i + 1]; ++v) {
+        ASSERT_EQ(map.count(v), 0);
+      }
+    }
+  }
+
+  // serialization uses the hopscotch_map format
+  std::stringstream strm;
+  oarchive oarc(strm);
+  oarc << map;
+  strm.flush();
+  iarchive iarc(strm);
+  vid2lvid_map::hash_map_type loaded;
+  iarc >> loaded;
+  ASSERT_EQ(loaded.size(), n);
+  for (size_t i = 0; i < n; ++i) ASSERT_EQ(loaded[vids[i]], i);
+
+  // modification switches back to the hash map
+  map[vid + 1] = n;
+  ASSERT_EQ(map.get_mode(), vid2lvid_map::HASH_MODE);
+  ASSERT_EQ(map.size(), n + 1);
+  for (size_t i = 0; i < n; ++i) ASSERT_EQ(map.lookup(vids[i]), i);
+
+  std::cout << name << ": " << n << " vertices. hash " << hash_bytes
+            << " bytes, " << n / hash_time / 1000000 << "M lookups/s. "
+            << mode_name << " "  << hash_bytes - saved << " bytes, "
+            << n / compact_time / 1000000 << "M lookups/s." << std::endl;
+}
+
+int main(int argc, char** argv) {
+  const size_t n = 4000000;
+  run_test("contiguous", n, 1, 0);
+  run_test("dense", n, 3, 1000);
+  run_test("sparse", n, 1000, 0);
+  std::cout << "Done" << std::endl;
+}
@@ -489,68 +489,61 @@ struct error_aggregator : public graphlab::IS_POD_TYPE {
  * \brief The prediction saver is used by the graph.save routine to
  * output the final predictions back to the filesystem.
  */
-struct prediction_saver {
+struct prediction_saver: public graphlab::buffered_writer {
   typedef graph_type::vertex_type vertex_type;
   typedef graph_type::edge_type   edge_type;
-  std::string save_vertex(const vertex_type& vertex) const {
-    return ""; //nop
-  }
-  std::string save_edge(const edge_type& edge) const {
+  void save_vertex(const vertex_type& vertex, 
+                   graphlab::output_buffer& out) const { } //nop
+  void save_edge(const edge_type& edge, graphlab::output_buffer& out) const {
     if(edge.data().role == edge_data::PREDICT) {
-      std::stringstream strm;
       double prediction =
         edge.source().data().factor.dot(edge.target().data().factor);
 	  prediction = std::min(als_vertex_program::MAXVAL, prediction);
 	  prediction = std::max(als_vertex_program::MINVAL, prediction);
-      strm << edge.source().id() << '\t';
-      strm << (-edge.target().id() - SAFE_NEG_OFFSET) << '\t';
-      strm << prediction << '\n';
-      return strm.str();
-    } else return "";
+      out << edge.source().id() << '\t';
+      out << (-edge.target().id() - SAFE_NEG_OFFSET) << '\t';
+      out << prediction << '\n';
+    }
   }
 }; // end of prediction_saver
 
 
-struct linear_model_saver_U {
+/* save the linear model, using the format:
+   nodeid factor1 factor2 ... factorNLATENT \n
+*/
+inline void save_factor(graphlab::vertex_id_type id, const vertex_data& data,
+                        graphlab::output_buffer& out) {
+  out << id << ' ';
+  for (uint i=0; i< vertex_data::NLATENT; i++) {
+    // same precision as boost::lexical_cast<std::string>(double)
+    out.write_double(data.factor[i], 17);
+    out << ' ';
+  }
+  out << '\n';
+}
+
+struct linear_model_saver_U: public graphlab::buffered_writer {
   typedef graph_type::vertex_type vertex_type;
   typedef graph_type::edge_type   edge_type;
-  /* save the linear model, using the format:
-     nodeid factor1 factor2 ... factorNLATENT \n
-  */
-  std::string save_vertex(const vertex_type& vertex) const {
+  void save_vertex(const vertex_type& vertex, 
+                   graphlab::output_buffer& out) const {
     if (vertex.num_out_edges() > 0){
-      std::string ret = boost::lexical_cast<std::string>(vertex.id()) + " ";
-      for (uint i=0; i< vertex_data::NLATENT; i++)
-        ret += boost::lexical_cast<std::string>(vertex.data().factor[i]) + " ";
-        ret += "\n";
-      return ret;
+      save_factor(vertex.id(), vertex.data(), out);
     }
-    else return "";
-  }
-  std::string save_edge(const edge_type& edge) const {
-    return "";
   }
+  void save_edge(const edge_type& edge, graphlab::output_buffer& out) const { }
 }; 
 
-struct linear_model_saver_V {
+struct linear_model_saver_V: public graphlab::buffered_writer {
   typedef graph_type::vertex_type vertex_type;
   typedef graph_type::edge_type   edge_type;
-  /* save the linear model, using the format:
-     nodeid factor1 factor2 ... factorNLATENT \n
-  */
-  std::string save_vertex(const vertex_type& vertex) const {
+  void save_vertex(const vertex_type& vertex, 
+                   graphlab::output_buffer& out) const {
     if (vertex.num_out_edges() == 0){
-      std::string ret = boost::lexical_cast<std::string>(-vertex.id()-SAFE_NEG_OFFSET) + " ";
-      for (uint i=0; i< vertex_data::NLATENT; i++)
-        ret += boost::lexical_cast<std::string>(vertex.data().factor[i]) + " ";
-        ret += "\n";
-      return ret;
+      save_factor(-vertex.id()-SAFE_NEG_OFFSET, vertex.data(), out);
     }
-    else return "";
-  }
-  std::string save_edge(const edge_type& edge) const {
-    return "";
   }
+  void save_edge(const edge_type& edge, graphlab::output_buffer& out) const { }
 }; 
 
 
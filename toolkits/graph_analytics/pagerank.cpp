@@ -150,13 +150,11 @@ public:
  * We want to save the final graph so we define a write which will be
  * used in graph.save("path/prefix", pagerank_writer()) to save the graph.
  */
-struct pagerank_writer {
-  std::string save_vertex(graph_type::vertex_type v) {
-    std::stringstream strm;
-    strm << v.id() << "\t" << v.data() << "\n";
-    return strm.str();
+struct pagerank_writer: public graphlab::buffered_writer {
+  void save_vertex(graph_type::vertex_type v, graphlab::output_buffer& out) {
+    out << v.id() << '\t' << v.data() << '\n';
   }
-  std::string save_edge(graph_type::edge_type e) { return ""; }
+  void save_edge(graph_type::edge_type e, graphlab::output_buffer& out) { }
 }; // end of pagerank writer
 
 